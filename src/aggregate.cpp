@@ -0,0 +1,658 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "aggregate.h"
+#include "utf8.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <strsafe.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// nesting of the JSON inputs, CRecordWriter writing 3 levels: deeper files are invalid
+#define AGG_JSON_MAX_DEPTH		64
+
+typedef std::basic_string<TCHAR> tstring;
+
+// fields of a volume record used by the aggregation
+typedef struct
+{
+    std::string record;		/* record holding the volume in the input */
+    std::string letter;		/* driveLetter field, "system" for the boot drive */
+    int ea;
+    int pkcs5;
+    int pkcs5Iterations;
+    int volumePim;
+} AGG_VOLUME;
+
+// what is kept of one endpoint output
+typedef struct
+{
+    BOOL bParsed;				/* FALSE if the file isn't a VeraStatus output */
+    BOOL bSysEncValid;			/* a sysenc record was present */
+    BootEncryptionStatus bootStatus;
+    int masterKeyVulnerable;	/* 1, 0 or -1 when not reported by the driver */
+    BOOL bDriverBootLoaderVersion;
+    UINT16 driverBootLoaderVersion;
+    BOOL bBootDriveValid;
+    AGG_VOLUME bootDrive;
+    std::vector<AGG_VOLUME> volumes;
+} AGG_ENDPOINT;
+
+typedef struct
+{
+    tstring path;
+    std::string host;
+} AGG_FILE;
+
+typedef enum
+{
+    AGG_GROUP_STATE = 0,
+    AGG_GROUP_MASTER_KEY,
+    AGG_GROUP_BOOTLOADER,
+    AGG_GROUP_CIPHER,
+    AGG_GROUP_PRF,
+    AGG_GROUP_ITERATIONS,
+    AGG_GROUP_PIM,
+    AGG_GROUP_COUNT
+} eAggGroup;
+
+static const char* g_szGroupNames[AGG_GROUP_COUNT] = { "state", "masterKeyVulnerable", "bootLoaderVersion", "cipher", "prf", "iterations", "pim" };
+static const char* g_szGroupTitles[AGG_GROUP_COUNT] = {
+    "System encryption state",
+    "System encryption master key vulnerable",
+    "Bootloader version",
+    "Encryption algorithm (volumes and system drives)",
+    "PKCS-5 PRF (volumes and system drives)",
+    "Iterations number (volumes and system drives)",
+    "PIM (volumes and system drives)"
+};
+
+// hosts, or host:drive for volumes, of each value of a group
+typedef std::map<std::string, std::vector<std::string> > AGG_GROUP;
+
+static void InitVolume (AGG_VOLUME& volume, const std::string& record)
+{
+    volume.record = record;
+    volume.letter.clear ();
+    volume.ea = 0;
+    volume.pkcs5 = 0;
+    volume.pkcs5Iterations = 0;
+    volume.volumePim = 0;
+}
+
+static BOOL ParseBool (const std::string& value)
+{
+    return value == "true" || value == "1";
+}
+
+static void SetVolumeField (AGG_VOLUME& volume, const std::string& field, const std::string& value)
+{
+    if (field == "driveLetter")
+        volume.letter = value;
+    else if (field == "ea")
+        volume.ea = atoi (value.c_str ());
+    else if (field == "pkcs5")
+        volume.pkcs5 = atoi (value.c_str ());
+    else if (field == "pkcs5Iterations")
+        volume.pkcs5Iterations = atoi (value.c_str ());
+    else if (field == "volumePim")
+        volume.volumePim = atoi (value.c_str ());
+}
+
+// store a field of the input, identified by its record ("sysenc", "volumes.M"...) and name
+static void SetField (AGG_ENDPOINT& endpoint, const std::string& record, const std::string& field, const std::string& value)
+{
+    BootEncryptionStatus& status = endpoint.bootStatus;
+
+    if (record.empty ())
+    {
+        if (field == "schemaVersion")
+            endpoint.bParsed = TRUE;
+    }
+    else if (record == "sysenc")
+    {
+        // the state is computed again from the raw fields instead of using the "state" field
+        endpoint.bSysEncValid = TRUE;
+        if (field == "DriveMounted")
+            status.DriveMounted = ParseBool (value);
+        else if (field == "DriveEncrypted")
+            status.DriveEncrypted = ParseBool (value);
+        else if (field == "SetupInProgress")
+            status.SetupInProgress = ParseBool (value);
+        else if (field == "ConfiguredEncryptedAreaStart")
+            status.ConfiguredEncryptedAreaStart = strtoll (value.c_str (), NULL, 10);
+        else if (field == "ConfiguredEncryptedAreaEnd")
+            status.ConfiguredEncryptedAreaEnd = strtoll (value.c_str (), NULL, 10);
+        else if (field == "EncryptedAreaStart")
+            status.EncryptedAreaStart = strtoll (value.c_str (), NULL, 10);
+        else if (field == "EncryptedAreaEnd")
+            status.EncryptedAreaEnd = strtoll (value.c_str (), NULL, 10);
+        else if (field == "BootLoaderVersion")
+            status.BootLoaderVersion = (UINT16) strtoul (value.c_str (), NULL, 10);
+        else if (field == "DriverBootLoaderVersion")
+        {
+            endpoint.bDriverBootLoaderVersion = TRUE;
+            endpoint.driverBootLoaderVersion = (UINT16) strtoul (value.c_str (), NULL, 10);
+        }
+        else if (field == "MasterKeyVulnerable")
+            endpoint.masterKeyVulnerable = value.empty () || value == "null"? -1 : (ParseBool (value)? 1 : 0);
+    }
+    else if (record == "bootDrive")
+    {
+        endpoint.bBootDriveValid = TRUE;
+        SetVolumeField (endpoint.bootDrive, field, value);
+    }
+    else if (record == "volume" || record.compare (0, 8, "volumes.") == 0)
+    {
+        if (endpoint.volumes.empty () || endpoint.volumes.back ().record != record)
+        {
+            endpoint.volumes.push_back (AGG_VOLUME ());
+            InitVolume (endpoint.volumes.back (), record);
+        }
+        SetVolumeField (endpoint.volumes.back (), field, value);
+    }
+}
+
+// record.field=value lines
+static void ParseKv (AGG_ENDPOINT& endpoint, const char* p, const char* pEnd)
+{
+    while (p < pEnd)
+    {
+        const char* pEol = (const char*) memchr (p, '\n', pEnd - p);
+        if (!pEol)
+            pEol = pEnd;
+        const char* pEqual = (const char*) memchr (p, '=', pEol - p);
+        if (pEqual)
+        {
+            std::string key (p, pEqual);
+            std::string value (pEqual + 1, (pEol > pEqual + 1 && pEol[-1] == '\r')? pEol - 1 : pEol);
+            size_t dot = key.rfind ('.');
+            if (dot == std::string::npos)
+                SetField (endpoint, std::string (), key, value);
+            else
+                SetField (endpoint, key.substr (0, dot), key.substr (dot + 1), value);
+        }
+        p = pEol + 1;
+    }
+}
+
+// record,field,value rows after the header, values containing separators being quoted
+static void ParseCsv (AGG_ENDPOINT& endpoint, const char* p, const char* pEnd)
+{
+    std::vector<std::string> row;
+    std::string cell;
+    BOOL bHeader = TRUE;
+
+    while (p < pEnd)
+    {
+        if (*p == '"')
+        {
+            for (p++; p < pEnd; p++)
+            {
+                if (*p == '"')
+                {
+                    if (p + 1 < pEnd && p[1] == '"')
+                        p++;
+                    else
+                        break;
+                }
+                cell += *p;
+            }
+            p++;
+        }
+        else if (*p == ',' || *p == '\n')
+        {
+            row.push_back (cell);
+            cell.clear ();
+            if (*p == '\n')
+            {
+                if (!bHeader && row.size () == 3)
+                    SetField (endpoint, row[0], row[1], row[2]);
+                bHeader = FALSE;
+                row.clear ();
+            }
+            p++;
+        }
+        else
+        {
+            if (*p != '\r')
+                cell += *p;
+            p++;
+        }
+    }
+
+    // last row without line feed
+    if (!bHeader && row.size () == 2)
+        SetField (endpoint, row[0], row[1], cell);
+}
+
+// JSON documents written by CRecordWriter: scalar fields at the top level, objects for records
+// and arrays of objects for lists. Records of lists are named list.index.
+class CJsonReader
+{
+public:
+    CJsonReader (AGG_ENDPOINT& endpoint, const char* p, const char* pEnd) : m_Endpoint (endpoint), m_p (p), m_pEnd (pEnd) {}
+
+    BOOL Parse ()
+    {
+        SkipSpaces ();
+        return Value (std::string (), std::string (), 0);
+    }
+
+protected:
+    void SkipSpaces ()
+    {
+        while (m_p < m_pEnd && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n'))
+            m_p++;
+    }
+
+    BOOL String (std::string& value)
+    {
+        value.clear ();
+        if (m_p >= m_pEnd || *m_p != '"')
+            return FALSE;
+        for (m_p++; m_p < m_pEnd && *m_p != '"'; m_p++)
+        {
+            if (*m_p != '\\')
+                value += *m_p;
+            else if (++m_p < m_pEnd)
+            {
+                switch (*m_p)
+                {
+                case 'n': value += '\n'; break;
+                case 'r': value += '\r'; break;
+                case 't': value += '\t'; break;
+                case 'b': value += '\b'; break;
+                case 'f': value += '\f'; break;
+                case 'u':
+                    // only control characters are escaped by CRecordWriter
+                    if (m_pEnd - m_p < 5)
+                        return FALSE;
+                    value += (char) strtol (std::string (m_p + 1, m_p + 5).c_str (), NULL, 16);
+                    m_p += 4;
+                    break;
+                default: value += *m_p; break;
+                }
+            }
+        }
+        if (m_p >= m_pEnd)
+            return FALSE;
+        m_p++;
+        return TRUE;
+    }
+
+    // the value of the field name of record, which is a record name itself for objects, nested
+    // in depth objects and arrays
+    BOOL Value (const std::string& record, const std::string& name, int depth)
+    {
+        std::string value;
+
+        SkipSpaces ();
+        if (m_p >= m_pEnd)
+            return FALSE;
+        if ((*m_p == '{' || *m_p == '[') && depth >= AGG_JSON_MAX_DEPTH)
+            return FALSE;
+
+        if (*m_p == '{')
+        {
+            std::string objectRecord = record.empty ()? name : record + "." + name;
+            m_p++;
+            SkipSpaces ();
+            if (m_p < m_pEnd && *m_p == '}')
+            {
+                m_p++;
+                return TRUE;
+            }
+            for (;;)
+            {
+                std::string field;
+                SkipSpaces ();
+                if (!String (field))
+                    return FALSE;
+                SkipSpaces ();
+                if (m_p >= m_pEnd || *m_p++ != ':')
+                    return FALSE;
+                if (!Value (objectRecord, field, depth + 1))
+                    return FALSE;
+                SkipSpaces ();
+                if (m_p < m_pEnd && *m_p == ',')
+                    m_p++;
+                else if (m_p < m_pEnd && *m_p == '}')
+                {
+                    m_p++;
+                    return TRUE;
+                }
+                else
+                    return FALSE;
+            }
+        }
+
+        if (*m_p == '[')
+        {
+            int index = 0;
+            m_p++;
+            SkipSpaces ();
+            if (m_p < m_pEnd && *m_p == ']')
+            {
+                m_p++;
+                return TRUE;
+            }
+            for (;;)
+            {
+                char szIndex[64];
+                StringCbPrintfA (szIndex, sizeof (szIndex), "%s.%d", name.c_str (), index++);
+                if (!Value (record, szIndex, depth + 1))
+                    return FALSE;
+                SkipSpaces ();
+                if (m_p < m_pEnd && *m_p == ',')
+                    m_p++;
+                else if (m_p < m_pEnd && *m_p == ']')
+                {
+                    m_p++;
+                    return TRUE;
+                }
+                else
+                    return FALSE;
+            }
+        }
+
+        if (*m_p == '"')
+        {
+            if (!String (value))
+                return FALSE;
+        }
+        else
+        {
+            // number, true, false or null
+            const char* pStart = m_p;
+            while (m_p < m_pEnd && *m_p != ',' && *m_p != '}' && *m_p != ']' && *m_p != ' ' && *m_p != '\r' && *m_p != '\n')
+                m_p++;
+            value.assign (pStart, m_p);
+            if (value.empty ())
+                return FALSE;
+        }
+
+        SetField (m_Endpoint, record, name, value);
+        return TRUE;
+    }
+
+    AGG_ENDPOINT& m_Endpoint;
+    const char* m_p;
+    const char* m_pEnd;
+};
+
+static void ParseEndpointFile (const AGG_FILE& file, AGG_ENDPOINT& endpoint)
+{
+    std::vector<char> data;
+    FILE* f = _tfopen (file.path.c_str (), TEXT("rb"));
+
+    endpoint.bParsed = FALSE;
+    endpoint.bSysEncValid = FALSE;
+    memset (&endpoint.bootStatus, 0, sizeof (endpoint.bootStatus));
+    endpoint.masterKeyVulnerable = -1;
+    endpoint.bDriverBootLoaderVersion = FALSE;
+    endpoint.driverBootLoaderVersion = 0;
+    endpoint.bBootDriveValid = FALSE;
+    InitVolume (endpoint.bootDrive, "bootDrive");
+    endpoint.bootDrive.letter = "system";
+    endpoint.volumes.clear ();
+
+    if (!f)
+        return;
+
+    char buffer[65536];
+    size_t cbRead;
+    while ((cbRead = fread (buffer, 1, sizeof (buffer), f)) > 0)
+        data.insert (data.end (), buffer, buffer + cbRead);
+    fclose (f);
+
+    const char* p = data.empty ()? "" : &data[0];
+    const char* pEnd = p + data.size ();
+    while (p < pEnd && (*p == ' ' || *p == '\r' || *p == '\n' || *p == '\t'))
+        p++;
+
+    if (p < pEnd && *p == '{')
+    {
+        CJsonReader reader (endpoint, p, pEnd);
+        if (!reader.Parse ())
+            endpoint.bParsed = FALSE;
+    }
+    else if ((size_t) (pEnd - p) >= 18 && memcmp (p, "record,field,value", 18) == 0)
+        ParseCsv (endpoint, p, pEnd);
+    else
+        ParseKv (endpoint, p, pEnd);
+}
+
+static std::string ToUtf8 (LPCTSTR szValue)
+{
+#if defined (_WIN32) && defined (UNICODE)
+    char szUtf8[1024];
+    Utf16ToUtf8 ((const WCHAR*) szValue, (size_t) -1, szUtf8, sizeof (szUtf8));
+    return szUtf8;
+#else
+    return szValue;
+#endif
+}
+
+// regular files of szDirectory sorted by name, the host being the name without its extension
+static BOOL ListEndpointFiles (LPCTSTR szDirectory, std::vector<AGG_FILE>& files)
+{
+    tstring directory (szDirectory);
+    std::vector<tstring> names;
+
+#ifdef _WIN32
+    WIN32_FIND_DATA findData;
+    HANDLE hFind = FindFirstFile ((directory + TEXT("\\*")).c_str (), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+        return FALSE;
+    do
+    {
+        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            names.push_back (findData.cFileName);
+    } while (FindNextFile (hFind, &findData));
+    FindClose (hFind);
+    directory += TEXT("\\");
+#else
+    DIR* pDir = opendir (szDirectory);
+    if (!pDir)
+        return FALSE;
+    directory += "/";
+    for (struct dirent* pEntry = readdir (pDir); pEntry; pEntry = readdir (pDir))
+    {
+        struct stat st;
+        if (stat ((directory + pEntry->d_name).c_str (), &st) == 0 && S_ISREG (st.st_mode))
+            names.push_back (pEntry->d_name);
+    }
+    closedir (pDir);
+#endif
+
+    std::sort (names.begin (), names.end ());
+    for (size_t i = 0; i < names.size (); i++)
+    {
+        AGG_FILE file;
+        size_t dot = names[i].rfind (TEXT('.'));
+        file.path = directory + names[i];
+        file.host = ToUtf8 (((dot == tstring::npos || dot == 0)? names[i] : names[i].substr (0, dot)).c_str ());
+        files.push_back (file);
+    }
+    return TRUE;
+}
+
+static void AddVolume (AGG_GROUP groups[AGG_GROUP_COUNT], const std::string& host, const AGG_VOLUME& volume)
+{
+    char szIterations[16];
+    std::string member = host + ":" + (volume.letter.empty ()? volume.record : volume.letter);
+
+    // the name functions aren't thread safe (unknown ids are formatted in a static buffer)
+    // which is why the endpoints are grouped once all of them are parsed
+    groups[AGG_GROUP_CIPHER][ToUtf8 (GetEncryptionAlgorithmName (volume.ea))].push_back (member);
+    groups[AGG_GROUP_PRF][ToUtf8 (GetPrfAlgorithmName (volume.pkcs5))].push_back (member);
+    StringCbPrintfA (szIterations, sizeof (szIterations), "%d", volume.pkcs5Iterations);
+    groups[AGG_GROUP_ITERATIONS][szIterations].push_back (member);
+    groups[AGG_GROUP_PIM][volume.volumePim > 0? "Custom" : "Default"].push_back (member);
+}
+
+static void AddEndpoint (AGG_GROUP groups[AGG_GROUP_COUNT], const std::string& host, AGG_ENDPOINT& endpoint)
+{
+    static const char* g_szStateNames[] = { "Full", "Partial", "None" };
+
+    if (endpoint.bSysEncValid)
+    {
+        eSysEncState state = GetSystemEncryptionState (endpoint.bootStatus);
+        groups[AGG_GROUP_STATE][g_szStateNames[state]].push_back (host);
+        groups[AGG_GROUP_MASTER_KEY][endpoint.masterKeyVulnerable < 0? "Unknown" : (endpoint.masterKeyVulnerable? "Yes" : "No")].push_back (host);
+
+        if (state != SYSENC_NONE)
+        {
+            UINT16 version = endpoint.bDriverBootLoaderVersion? endpoint.driverBootLoaderVersion : endpoint.bootStatus.BootLoaderVersion;
+            char szVersion[16];
+            StringCbPrintfA (szVersion, sizeof (szVersion), "%x.%x", (int) (version >> 8), (int) (version & 0x00FF));
+            groups[AGG_GROUP_BOOTLOADER][szVersion].push_back (host);
+            if (endpoint.bBootDriveValid)
+                AddVolume (groups, host, endpoint.bootDrive);
+        }
+    }
+    else
+        groups[AGG_GROUP_STATE]["Unknown"].push_back (host);
+
+    for (size_t i = 0; i < endpoint.volumes.size (); i++)
+        AddVolume (groups, host, endpoint.volumes[i]);
+}
+
+// largest groups first
+static bool CompareGroupEntries (const AGG_GROUP::const_iterator& a, const AGG_GROUP::const_iterator& b)
+{
+    if (a->second.size () != b->second.size ())
+        return a->second.size () > b->second.size ();
+    return a->first < b->first;
+}
+
+static void SortGroup (const AGG_GROUP& group, std::vector<AGG_GROUP::const_iterator>& entries)
+{
+    entries.clear ();
+    for (AGG_GROUP::const_iterator it = group.begin (); it != group.end (); ++it)
+        entries.push_back (it);
+    std::sort (entries.begin (), entries.end (), CompareGroupEntries);
+}
+
+int RunAggregate (LPCTSTR szDirectory, BOOL bListHosts, eOutputFormat format)
+{
+    std::vector<AGG_FILE> files;
+    AGG_GROUP groups[AGG_GROUP_COUNT];
+    std::vector<AGG_GROUP::const_iterator> entries;
+    size_t endpointCount = 0;
+    COutputBuffer out;
+    unsigned __int64 startUs = GetTimestampUs ();
+
+    if (!ListEndpointFiles (szDirectory, files))
+    {
+        _tprintf (TEXT("Failed to list the files of directory %s\n"), szDirectory);
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    // parsing is distributed over all the cores, each endpoint having its own slot
+    std::vector<AGG_ENDPOINT> endpoints (files.size ());
+    std::atomic<size_t> nextFile (0);
+    std::vector<std::thread> workers;
+    unsigned int threadCount = std::thread::hardware_concurrency ();
+    if (threadCount == 0)
+        threadCount = 1;
+    threadCount = (unsigned int) std::min<size_t> (threadCount, std::max<size_t> (files.size (), 1));
+
+    for (unsigned int t = 0; t < threadCount; t++)
+    {
+        workers.push_back (std::thread ([&files, &endpoints, &nextFile] ()
+        {
+            for (size_t i = nextFile++; i < files.size (); i = nextFile++)
+                ParseEndpointFile (files[i], endpoints[i]);
+        }));
+    }
+    for (size_t t = 0; t < workers.size (); t++)
+        workers[t].join ();
+
+    for (size_t i = 0; i < files.size (); i++)
+    {
+        if (endpoints[i].bParsed)
+        {
+            AddEndpoint (groups, files[i].host, endpoints[i]);
+            endpointCount++;
+        }
+    }
+
+    if (format == OUTPUT_TEXT)
+    {
+        out.AppendFormat ("Endpoints: %llu\nIgnored files: %llu\nParsed by %u threads in %.3f seconds\n",
+            (unsigned long long) endpointCount, (unsigned long long) (files.size () - endpointCount),
+            threadCount, (double) (GetTimestampUs () - startUs) / 1000000.0);
+
+        for (int g = 0; g < AGG_GROUP_COUNT; g++)
+        {
+            out.AppendFormat ("\n%s:\n", g_szGroupTitles[g]);
+            SortGroup (groups[g], entries);
+            if (entries.empty ())
+                out.Append ("   -\n");
+            for (size_t i = 0; i < entries.size (); i++)
+            {
+                out.AppendFormat ("   %-40s %8llu\n", entries[i]->first.c_str (), (unsigned long long) entries[i]->second.size ());
+                if (bListHosts)
+                {
+                    for (size_t j = 0; j < entries[i]->second.size (); j++)
+                        out.AppendFormat ("      %s\n", entries[i]->second[j].c_str ());
+                }
+            }
+        }
+    }
+    else
+    {
+        CRecordWriter writer (out, format);
+        int index = 0;
+
+        writer.BeginDocument ();
+        writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+        writer.UInt ("endpoints", endpointCount);
+        writer.UInt ("ignoredFiles", files.size () - endpointCount);
+        writer.BeginList ("groups");
+        for (int g = 0; g < AGG_GROUP_COUNT; g++)
+        {
+            SortGroup (groups[g], entries);
+            for (size_t i = 0; i < entries.size (); i++)
+            {
+                char szKey[16];
+                StringCbPrintfA (szKey, sizeof (szKey), "%d", index++);
+                writer.BeginRecord ("group", szKey);
+                writer.String ("group", g_szGroupNames[g]);
+                writer.String ("value", entries[i]->first.c_str ());
+                writer.UInt ("count", entries[i]->second.size ());
+                if (bListHosts)
+                {
+                    std::string hosts;
+                    for (size_t j = 0; j < entries[i]->second.size (); j++)
+                    {
+                        if (j)
+                            hosts += ',';
+                        hosts += entries[i]->second[j];
+                    }
+                    writer.String ("hosts", hosts.c_str ());
+                }
+                writer.EndRecord ();
+            }
+        }
+        writer.EndList ();
+        writer.Int ("exitCode", VC_STATUS_OK);
+        writer.EndDocument ();
+    }
+
+    out.Write (stdout);
+    return VC_STATUS_OK;
+}
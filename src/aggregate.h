@@ -0,0 +1,17 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "common.h"
+#include "format.h"
+
+// Aggregate the machine readable outputs (/format json, csv or kv) collected from many endpoints
+// in szDirectory, one file per endpoint named after the host. Files are parsed in parallel on all
+// cores and the endpoints are grouped by system encryption state, master key vulnerability,
+// bootloader version, encryption algorithm, PRF, iterations number and PIM usage.
+// bListHosts adds the hosts of each group to the report.
+int RunAggregate (LPCTSTR szDirectory, BOOL bListHosts, eOutputFormat format);
@@ -0,0 +1,661 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "alerts.h"
+#ifdef _WIN32
+#include <strsafe.h>
+#endif
+
+#define VC_ALERT_MAX_RULES_FILE		(16 * 1024 * 1024)
+#define VC_ALERT_MAX_NAME_ID		256		/* values tried when matching a name */
+
+static const char* g_szSeverityNames[] = { "info", "warning", "critical" };
+static const char* g_szRecordNames[] = { "sysenc", "bootDrive", "volume" };
+
+static LPCTSTR GetSysEncStateName (int state)
+{
+    switch (state)
+    {
+    case SYSENC_FULL: return TEXT("Full");
+    case SYSENC_PARTIAL: return TEXT("Partial");
+    default: return TEXT("None");
+    }
+}
+
+static BOOL IsSameName (const char* szA, const char* szB)
+{
+    for (; *szA && *szB; szA++, szB++)
+    {
+        if (tolower ((unsigned char) *szA) != tolower ((unsigned char) *szB))
+            return FALSE;
+    }
+    return *szA == *szB;
+}
+
+// next word of a rule, words being separated by blanks
+static std::string NextWord (const char*& p)
+{
+    const char* pStart;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+    pStart = p;
+    while (*p && *p != ' ' && *p != '\t')
+        p++;
+    return std::string (pStart, p - pStart);
+}
+
+static std::string Trim (const std::string& s)
+{
+    size_t start = s.find_first_not_of (" \t\r");
+    size_t end = s.find_last_not_of (" \t\r");
+    return (start == std::string::npos)? std::string () : s.substr (start, end - start + 1);
+}
+
+// number with an optional multiplier and unit (e.g. 50MB/s, 1.5G, 80%), Yes/No, or name of a value of the field
+static BOOL ParseRuleValue (const ALERT_RULE& rule, const std::string& token, double& value)
+{
+    const char* p = token.c_str ();
+    char* pEnd;
+
+    if (token.empty ())
+        return FALSE;
+
+    if (IsSameName (p, "Yes") || IsSameName (p, "true"))
+    {
+        value = 1;
+        return TRUE;
+    }
+    if (IsSameName (p, "No") || IsSameName (p, "false"))
+    {
+        value = 0;
+        return TRUE;
+    }
+
+    value = strtod (p, &pEnd);
+    if (pEnd != p)
+    {
+        p = pEnd;
+        while (*p == ' ')
+            p++;
+        switch (toupper ((unsigned char) *p))
+        {
+        case 'K': value *= 1024.0; p++; break;
+        case 'M': value *= 1024.0 * 1024.0; p++; break;
+        case 'G': value *= 1024.0 * 1024.0 * 1024.0; p++; break;
+        case 'T': value *= 1024.0 * 1024.0 * 1024.0 * 1024.0; p++; break;
+        }
+        if (toupper ((unsigned char) *p) == 'B')
+            p++;
+        if (p[0] == '/' && (p[1] == 's' || p[1] == 'S'))
+            p += 2;
+        if (*p == '%')
+            p++;
+        return *p == 0;
+    }
+
+    if (rule.pfnName && token.size () < 64)
+    {
+        TCHAR szName[64];
+
+        for (size_t i = 0; i <= token.size (); i++)
+            szName[i] = (TCHAR) (unsigned char) token[i];
+        for (int id = 0; id < VC_ALERT_MAX_NAME_ID; id++)
+        {
+            if (_tcsicmp (rule.pfnName (id), szName) == 0)
+            {
+                value = id;
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+// names of the values of a FIELD_NAME field, or of the FIELD_NAME field sharing the offset of a raw one (e.g. ea and eaName)
+static PFN_FIELD_NAME FindValueNames (const STRUCT_SCHEMA& schema, const FIELD_DESC& field)
+{
+    if (field.kind == FIELD_NAME)
+        return field.pfnName;
+    for (size_t i = 0; i < schema.fieldCount; i++)
+    {
+        if (schema.pFields[i].kind == FIELD_NAME && schema.pFields[i].offset == field.offset)
+            return schema.pFields[i].pfnName;
+    }
+    return NULL;
+}
+
+static BOOL CompileRule (const std::string& text, int line, ALERT_RULE& rule, std::string& error)
+{
+    static const char* g_szOperators[] = { "==", "!=", "<", "<=", ">", ">=", "in", "increased", "decreased", "changed" };
+    const char* p = text.c_str ();
+    std::string severity = NextWord (p);
+    std::string body = Trim (p);
+    std::string path = NextWord (p);
+    std::string op = NextWord (p);
+    std::string operand = Trim (p);
+    std::string recordName, fieldName;
+    const STRUCT_SCHEMA* pSchema;
+    size_t dot = path.find ('.');
+    int i;
+
+    rule.line = line;
+    rule.pField = NULL;
+    rule.pfnName = NULL;
+    rule.value = ALERT_VALUE_FIELD;
+    rule.operand = 0;
+    rule.setMask = 0;
+    rule.set.clear ();
+    rule.text = body;
+
+    for (i = 0; i < (int) ARRAYSIZE (g_szSeverityNames) && !IsSameName (severity.c_str (), g_szSeverityNames[i]); i++)
+        ;
+    if (i == (int) ARRAYSIZE (g_szSeverityNames))
+    {
+        error = "unknown severity \"" + severity + "\" (info, warning or critical expected)";
+        return FALSE;
+    }
+    rule.severity = (eAlertSeverity) i;
+
+    if (dot == std::string::npos)
+    {
+        error = "record.field expected instead of \"" + path + "\"";
+        return FALSE;
+    }
+    recordName = path.substr (0, dot);
+    fieldName = path.substr (dot + 1);
+    for (i = 0; i < ALERT_RECORD_COUNT && recordName != g_szRecordNames[i]; i++)
+        ;
+    if (i == ALERT_RECORD_COUNT)
+    {
+        error = "unknown record \"" + recordName + "\" (sysenc, bootDrive or volume expected)";
+        return FALSE;
+    }
+    rule.record = (eAlertRecord) i;
+    pSchema = (rule.record == ALERT_RECORD_SYSENC)? &g_BootEncryptionStatusSchema : &g_VolumePropertiesSchema;
+
+    // computed values, then the fields of the driver structures
+    if (rule.record == ALERT_RECORD_SYSENC && fieldName == "state")
+    {
+        rule.value = ALERT_VALUE_STATE;
+        rule.pfnName = GetSysEncStateName;
+    }
+    else if (rule.record == ALERT_RECORD_SYSENC && fieldName == "encryptedPercentage")
+        rule.value = ALERT_VALUE_PERCENTAGE;
+    else if (rule.record == ALERT_RECORD_VOLUME && fieldName == "readRate")
+        rule.value = ALERT_VALUE_READ_RATE;
+    else if (rule.record == ALERT_RECORD_VOLUME && fieldName == "writeRate")
+        rule.value = ALERT_VALUE_WRITE_RATE;
+    else if ((rule.pField = FindSchemaField (*pSchema, fieldName.c_str ())) == NULL)
+    {
+        error = "unknown field \"" + fieldName + "\" in " + recordName;
+        return FALSE;
+    }
+    else if (rule.pField->kind == FIELD_WSTRING || rule.pField->kind == FIELD_BYTES)
+    {
+        error = "field \"" + fieldName + "\" can't be compared";
+        return FALSE;
+    }
+    else
+        rule.pfnName = FindValueNames (*pSchema, *rule.pField);
+
+    for (i = 0; i < (int) ARRAYSIZE (g_szOperators) && op != g_szOperators[i]; i++)
+        ;
+    if (i == (int) ARRAYSIZE (g_szOperators))
+    {
+        error = "unknown operator \"" + op + "\"";
+        return FALSE;
+    }
+    rule.op = (eAlertOp) i;
+
+    switch (rule.op)
+    {
+    case ALERT_OP_INCREASED:
+    case ALERT_OP_DECREASED:
+    case ALERT_OP_CHANGED:
+        if (!operand.empty ())
+        {
+            error = "no value expected after \"" + op + "\"";
+            return FALSE;
+        }
+        if (rule.value == ALERT_VALUE_READ_RATE || rule.value == ALERT_VALUE_WRITE_RATE)
+        {
+            error = "rates can't be compared with the previous snapshot";
+            return FALSE;
+        }
+        break;
+
+    case ALERT_OP_IN:
+        if (operand.size () < 2 || operand[0] != '{' || operand[operand.size () - 1] != '}')
+        {
+            error = "{value, ...} expected after \"in\"";
+            return FALSE;
+        }
+        operand = operand.substr (1, operand.size () - 2);
+        for (size_t start = 0; start <= operand.size (); )
+        {
+            size_t end = operand.find (',', start);
+            std::string item = Trim (operand.substr (start, (end == std::string::npos)? std::string::npos : end - start));
+            double value;
+
+            if (!ParseRuleValue (rule, item, value))
+            {
+                error = "invalid value \"" + item + "\"";
+                return FALSE;
+            }
+            // small integers, like algorithm identifiers, are looked up in a bitmask
+            if (value >= 0 && value < 64 && value == (double) (int) value)
+                rule.setMask |= (unsigned __int64) 1 << (int) value;
+            else
+                rule.set.push_back (value);
+
+            if (end == std::string::npos)
+                break;
+            start = end + 1;
+        }
+        break;
+
+    default:
+        if (!ParseRuleValue (rule, operand, rule.operand))
+        {
+            error = "invalid value \"" + operand + "\"";
+            return FALSE;
+        }
+        break;
+    }
+
+    return TRUE;
+}
+
+CAlertEvaluator::CAlertEvaluator () : m_bPreviousValid (FALSE)
+{
+    memset (&m_Previous, 0, sizeof (m_Previous));
+}
+
+BOOL CAlertEvaluator::Compile (const char* szRules, int& iErrorLine, std::string& error)
+{
+    int line = 0;
+
+    m_Rules.clear ();
+    for (const char* p = szRules; *p; )
+    {
+        const char* pEnd = strchr (p, '\n');
+        size_t cchLine = pEnd? (size_t) (pEnd - p) : strlen (p);
+        std::string text = Trim (std::string (p, cchLine));
+        ALERT_RULE rule;
+
+        p += cchLine + (pEnd? 1 : 0);
+        line++;
+        if (text.empty () || text[0] == '#')
+            continue;
+
+        if (!CompileRule (text, line, rule, error))
+        {
+            iErrorLine = line;
+            return FALSE;
+        }
+        m_Rules.push_back (rule);
+    }
+
+    for (int r = 0; r < ALERT_RECORD_COUNT; r++)
+        m_RecordRules[r].clear ();
+    for (size_t i = 0; i < m_Rules.size (); i++)
+        m_RecordRules[m_Rules[i].record].push_back (i);
+    m_Active.assign (m_Rules.size (), 0);
+    m_bPreviousValid = FALSE;
+    return TRUE;
+}
+
+// value of the rule field in a record of the snapshot, FALSE if the record or the field isn't available
+BOOL CAlertEvaluator::GetValue (const ALERT_RULE& rule, const VC_SNAPSHOT& snapshot, int slot, double& value) const
+{
+    const VOLUME_PROPERTIES_STRUCT* pProp;
+
+    switch (rule.record)
+    {
+    case ALERT_RECORD_SYSENC:
+        if (!snapshot.bBootStatusValid)
+            return FALSE;
+        if (rule.value == ALERT_VALUE_STATE)
+            value = (double) VsGetSystemEncryptionState (&snapshot.bootStatus, NULL);
+        else if (rule.value == ALERT_VALUE_PERCENTAGE)
+            VsGetSystemEncryptionState (&snapshot.bootStatus, &value);
+        else if (IsFieldAvailable (*rule.pField, snapshot.cbBootStatus))
+            value = (double) ReadFieldValue (*rule.pField, &snapshot.bootStatus);
+        else
+            return FALSE;
+        return TRUE;
+
+    case ALERT_RECORD_BOOT_DRIVE:
+        if (!snapshot.bBootDrivePropValid)
+            return FALSE;
+        value = (double) ReadFieldValue (*rule.pField, &snapshot.bootDriveProp);
+        return TRUE;
+
+    default:
+        break;
+    }
+
+    int driveNo = slot - ALERT_SLOT_VOLUME;
+    if (!(snapshot.volumes.ulMountedDrives & (1 << driveNo)))
+        return FALSE;
+    pProp = &snapshot.volumes.prop[driveNo];
+
+    if (rule.value == ALERT_VALUE_READ_RATE || rule.value == ALERT_VALUE_WRITE_RATE)
+    {
+        // same volume in the previous snapshot, with counters that didn't go backwards
+        const VOLUME_PROPERTIES_STRUCT* pPrevious = &m_Previous.volumes.prop[driveNo];
+        unsigned __int64 current = (rule.value == ALERT_VALUE_READ_RATE)? pProp->totalBytesRead : pProp->totalBytesWritten;
+        unsigned __int64 previous = (rule.value == ALERT_VALUE_READ_RATE)? pPrevious->totalBytesRead : pPrevious->totalBytesWritten;
+
+        if (!m_bPreviousValid || &snapshot == &m_Previous || !(m_Previous.volumes.ulMountedDrives & (1 << driveNo))
+            || pPrevious->uniqueId != pProp->uniqueId || current < previous
+            || snapshot.volumes.timestampUs <= m_Previous.volumes.timestampUs)
+        {
+            return FALSE;
+        }
+        value = (double) (current - previous) * 1000000.0 / (double) (snapshot.volumes.timestampUs - m_Previous.volumes.timestampUs);
+        return TRUE;
+    }
+
+    value = (double) ReadFieldValue (*rule.pField, pProp);
+    return TRUE;
+}
+
+BOOL CAlertEvaluator::Matches (const ALERT_RULE& rule, const VC_SNAPSHOT& snapshot, int slot, double& value) const
+{
+    double previous;
+
+    if (!GetValue (rule, snapshot, slot, value))
+        return FALSE;
+
+    switch (rule.op)
+    {
+    case ALERT_OP_EQ: return value == rule.operand;
+    case ALERT_OP_NE: return value != rule.operand;
+    case ALERT_OP_LT: return value < rule.operand;
+    case ALERT_OP_LE: return value <= rule.operand;
+    case ALERT_OP_GT: return value > rule.operand;
+    case ALERT_OP_GE: return value >= rule.operand;
+    case ALERT_OP_IN:
+        if (value >= 0 && value < 64 && value == (double) (int) value)
+            return (rule.setMask >> (int) value) & 1;
+        for (size_t i = 0; i < rule.set.size (); i++)
+        {
+            if (rule.set[i] == value)
+                return TRUE;
+        }
+        return FALSE;
+    default:
+        break;
+    }
+
+    // comparisons over time: same volume in the previous snapshot
+    if (!m_bPreviousValid || !GetValue (rule, m_Previous, slot, previous))
+        return FALSE;
+    if (rule.record == ALERT_RECORD_VOLUME && m_Previous.volumes.prop[slot - ALERT_SLOT_VOLUME].uniqueId != snapshot.volumes.prop[slot - ALERT_SLOT_VOLUME].uniqueId)
+        return FALSE;
+
+    switch (rule.op)
+    {
+    case ALERT_OP_INCREASED: return value > previous;
+    case ALERT_OP_DECREASED: return value < previous;
+    default: return value != previous;
+    }
+}
+
+void CAlertEvaluator::Evaluate (const VC_SNAPSHOT& snapshot, std::vector<ALERT_EVENT>& events)
+{
+    events.clear ();
+    for (int r = 0; r < ALERT_RECORD_COUNT; r++)
+    {
+        const std::vector<size_t>& rules = m_RecordRules[r];
+
+        for (size_t n = 0; n < rules.size (); n++)
+        {
+            const ALERT_RULE& rule = m_Rules[rules[n]];
+            unsigned __int32& active = m_Active[rules[n]];
+            unsigned __int32 slots;
+
+            // the volumes mounted now, and the ones that violated the rule to report the end of the violation
+            if (r == ALERT_RECORD_VOLUME)
+                slots = (snapshot.volumes.ulMountedDrives << ALERT_SLOT_VOLUME) | active;
+            else
+                slots = 1 << ((r == ALERT_RECORD_SYSENC)? ALERT_SLOT_SYSENC : ALERT_SLOT_BOOT_DRIVE);
+
+            for (int slot = 0; slots; slot++, slots >>= 1)
+            {
+                ALERT_EVENT event;
+                unsigned __int32 bit = 1 << slot;
+                BOOL bMatch;
+
+                if (!(slots & 1))
+                    continue;
+
+                event.value = 0;
+                bMatch = Matches (rule, snapshot, slot, event.value);
+                if (bMatch == ((active & bit) != 0))
+                    continue;
+
+                event.pRule = &rule;
+                event.slot = slot;
+                event.bRaised = bMatch;
+                events.push_back (event);
+                active ^= bit;
+            }
+        }
+    }
+
+    m_Previous = snapshot;
+    m_bPreviousValid = TRUE;
+}
+
+int CAlertEvaluator::GetActiveSeverity () const
+{
+    int severity = -1;
+
+    for (size_t i = 0; i < m_Rules.size (); i++)
+    {
+        if (m_Active[i] && (int) m_Rules[i].severity > severity)
+            severity = (int) m_Rules[i].severity;
+    }
+    return severity;
+}
+
+size_t CAlertEvaluator::GetActiveCount (eAlertSeverity severity) const
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < m_Rules.size (); i++)
+    {
+        if (m_Rules[i].severity != severity)
+            continue;
+        for (unsigned __int32 active = m_Active[i]; active; active &= active - 1)
+            count++;
+    }
+    return count;
+}
+
+static void FormatAlertValue (const ALERT_RULE& rule, double value, TCHAR* szOut, size_t cchOut)
+{
+    if (rule.pfnName)
+        StringCchPrintf (szOut, cchOut, TEXT("%s"), rule.pfnName ((int) value));
+    else if (rule.value == ALERT_VALUE_READ_RATE || rule.value == ALERT_VALUE_WRITE_RATE)
+        FormatRate (value, szOut, cchOut);
+    else if (rule.value == ALERT_VALUE_PERCENTAGE)
+        StringCchPrintf (szOut, cchOut, TEXT("%.2f%%"), value);
+    else if (rule.pField->kind == FIELD_BOOL)
+        StringCchPrintf (szOut, cchOut, TEXT("%s"), value? TEXT("Yes") : TEXT("No"));
+    else if (rule.pField->kind == FIELD_HEX32)
+        StringCchPrintf (szOut, cchOut, TEXT("0x%.8X"), (unsigned int) value);
+    else
+        StringCchPrintf (szOut, cchOut, TEXT("%.0f"), value);
+}
+
+static void PrintAlertEvent (double dTime, const ALERT_EVENT& event)
+{
+    TCHAR szValue[64];
+    TCHAR szRecord[16];
+
+    if (event.slot >= ALERT_SLOT_VOLUME)
+        StringCchPrintf (szRecord, ARRAYSIZE (szRecord), TEXT("%c"), TEXT('A') + event.slot - ALERT_SLOT_VOLUME);
+    else
+        StringCchPrintf (szRecord, ARRAYSIZE (szRecord), TEXT("%s"), (event.slot == ALERT_SLOT_SYSENC)? TEXT("system") : TEXT("boot drive"));
+
+    if (event.bRaised)
+    {
+        FormatAlertValue (*event.pRule, event.value, szValue, ARRAYSIZE (szValue));
+        _tprintf (TEXT("[%8.1fs] %-8hs %s: %hs (value: %s, line %d)\n"), dTime, g_szSeverityNames[event.pRule->severity], szRecord,
+            event.pRule->text.c_str (), szValue, event.pRule->line);
+    }
+    else
+        _tprintf (TEXT("[%8.1fs] %-8hs %s: %hs (line %d)\n"), dTime, "cleared", szRecord, event.pRule->text.c_str (), event.pRule->line);
+}
+
+// one document per event, the csv header only preceding the first one
+static void WriteAlertEvent (eOutputFormat format, BOOL bFirst, unsigned __int64 seq, const ALERT_EVENT& event)
+{
+    COutputBuffer out;
+    CRecordWriter writer (out, format);
+    const ALERT_RULE& rule = *event.pRule;
+
+    writer.BeginDocument (bFirst);
+    writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+    writer.BeginRecord ("alert");
+    writer.UInt ("seq", seq);
+    writer.UInt ("timeUs", GetSystemTimeUs ());
+    writer.String ("type", event.bRaised? "raised" : "cleared");
+    writer.String ("severity", g_szSeverityNames[rule.severity]);
+    writer.String ("record", g_szRecordNames[rule.record]);
+    if (event.slot >= ALERT_SLOT_VOLUME)
+    {
+        char szDrive[2] = { (char) ('A' + event.slot - ALERT_SLOT_VOLUME), 0 };
+        writer.String ("driveLetter", szDrive);
+    }
+    else
+        writer.Null ("driveLetter");
+    writer.Int ("line", rule.line);
+    writer.String ("rule", rule.text.c_str ());
+    if (event.bRaised)
+    {
+        TCHAR szValue[64];
+        FormatAlertValue (rule, event.value, szValue, ARRAYSIZE (szValue));
+        writer.Double ("value", event.value);
+        writer.TString ("valueText", szValue);
+    }
+    else
+    {
+        writer.Null ("value");
+        writer.Null ("valueText");
+    }
+    writer.EndRecord ();
+    writer.EndDocument ();
+    out.Write (stdout);
+}
+
+static BOOL LoadRulesFile (LPCTSTR szFileName, std::string& rules)
+{
+    FILE* f = _tfopen (szFileName, TEXT("rb"));
+    char buffer[4096];
+    size_t cbRead;
+
+    if (!f)
+        return FALSE;
+    rules.clear ();
+    while ((cbRead = fread (buffer, 1, sizeof (buffer), f)) > 0 && rules.size () < VC_ALERT_MAX_RULES_FILE)
+        rules.append (buffer, cbRead);
+    fclose (f);
+    return TRUE;
+}
+
+int RunAlerts (CVcDriver& driver, LPCTSTR szRulesFile, DWORD dwIntervalMs, int iCount, eOutputFormat format)
+{
+    static VC_SNAPSHOT snapshot;
+    CAlertEvaluator* pEvaluator = new CAlertEvaluator ();
+    std::vector<ALERT_EVENT> events;
+    std::string rules, error;
+    unsigned __int64 seq = 0, startUs, nextUs;
+    int iErrorLine = 0, iRet = VC_STATUS_OK;
+
+    if (!LoadRulesFile (szRulesFile, rules))
+    {
+        _tprintf (TEXT("Error: Can't read the rules file %s.\n"), szRulesFile);
+        delete pEvaluator;
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+    if (!pEvaluator->Compile (rules.c_str (), iErrorLine, error))
+    {
+        _tprintf (TEXT("Error: %s line %d: %hs.\n"), szRulesFile, iErrorLine, error.c_str ());
+        delete pEvaluator;
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    if (format == OUTPUT_TEXT)
+    {
+        if (dwIntervalMs)
+            _tprintf (TEXT("Evaluating %u rule(s) every %.1f seconds\n"), (unsigned int) pEvaluator->GetRuleCount (), (double) dwIntervalMs / 1000.0);
+        else
+            _tprintf (TEXT("Evaluating %u rule(s)\n"), (unsigned int) pEvaluator->GetRuleCount ());
+    }
+
+    startUs = nextUs = GetTimestampUs ();
+    for (int n = 1; ; n++)
+    {
+        if (!TakeSnapshot (driver, snapshot))
+        {
+            DWORD dwError = GetLastError ();
+            if (format == OUTPUT_TEXT)
+                _tprintf (TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr (dwError));
+            else
+            {
+                COutputBuffer out;
+                CRecordWriter writer (out, format);
+                writer.BeginDocument (seq == 0);
+                writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+                FormatDriverError (writer, "GET_MOUNTED_VOLUMES", dwError);
+                writer.EndDocument ();
+                out.Write (stdout);
+            }
+            iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            break;
+        }
+
+        pEvaluator->Evaluate (snapshot, events);
+        for (size_t i = 0; i < events.size (); i++)
+        {
+            seq++;
+            if (format == OUTPUT_TEXT)
+                PrintAlertEvent ((double) (GetTimestampUs () - startUs) / 1000000.0, events[i]);
+            else
+                WriteAlertEvent (format, seq == 1, seq, events[i]);
+        }
+        fflush (stdout);
+
+        if (dwIntervalMs == 0 || (iCount > 0 && n >= iCount))
+            break;
+        // the evaluation period doesn't drift with the time taken by the snapshots
+        SleepUntilNext (nextUs, dwIntervalMs);
+    }
+
+    if (iRet == VC_STATUS_OK)
+    {
+        int severity = pEvaluator->GetActiveSeverity ();
+
+        if (format == OUTPUT_TEXT)
+        {
+            _tprintf (TEXT("Active violations: %u critical, %u warning, %u info\n"), (unsigned int) pEvaluator->GetActiveCount (ALERT_CRITICAL),
+                (unsigned int) pEvaluator->GetActiveCount (ALERT_WARNING), (unsigned int) pEvaluator->GetActiveCount (ALERT_INFO));
+        }
+        if (severity == ALERT_CRITICAL)
+            iRet = VC_STATUS_ALERT_CRITICAL;
+        else if (severity == ALERT_WARNING)
+            iRet = VC_STATUS_ALERT_WARNING;
+    }
+
+    delete pEvaluator;
+    return iRet;
+}
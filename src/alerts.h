@@ -0,0 +1,127 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "snapshot.h"
+#include "schema.h"
+#include <string>
+#include <vector>
+
+// Alert rules files (command /alerts RulesFile) contain one rule per line:
+//
+//   critical sysenc.MasterKeyVulnerable == Yes
+//   warning  sysenc.HiddenSysLeakProtectionCount increased
+//   warning  volume.pkcs5Iterations < 500000
+//   critical volume.ea in {GOST89, Kuznyechik}
+//   warning  volume.writeRate > 50MB/s
+//
+// The severity is info, warning or critical. The record is sysenc, bootDrive or volume (each mounted
+// volume), and the field one of its fields in the machine readable outputs, or the computed
+// sysenc.state, sysenc.encryptedPercentage, volume.readRate and volume.writeRate (bytes per second
+// since the previous snapshot).
+// Operators: == != < <= > >= and "in {...}" compare with values, "increased", "decreased" and
+// "changed" with the previous snapshot.
+// Values are numbers with an optional K, M, G or T multiplier (powers of 1024) and B or B/s unit,
+// Yes/No, or names of the values of the field (e.g. AES, HMAC-SHA-512, Partial), matched once
+// when the rules are compiled. Lines starting with '#' are comments.
+
+typedef enum
+{
+	ALERT_INFO = 0,
+	ALERT_WARNING,
+	ALERT_CRITICAL
+} eAlertSeverity;
+
+typedef enum
+{
+	ALERT_RECORD_SYSENC = 0,
+	ALERT_RECORD_BOOT_DRIVE,
+	ALERT_RECORD_VOLUME,
+	ALERT_RECORD_COUNT
+} eAlertRecord;
+
+typedef enum
+{
+	ALERT_VALUE_FIELD = 0,
+	ALERT_VALUE_STATE,
+	ALERT_VALUE_PERCENTAGE,
+	ALERT_VALUE_READ_RATE,
+	ALERT_VALUE_WRITE_RATE
+} eAlertValue;
+
+typedef enum
+{
+	ALERT_OP_EQ = 0,
+	ALERT_OP_NE,
+	ALERT_OP_LT,
+	ALERT_OP_LE,
+	ALERT_OP_GT,
+	ALERT_OP_GE,
+	ALERT_OP_IN,
+	ALERT_OP_INCREASED,
+	ALERT_OP_DECREASED,
+	ALERT_OP_CHANGED
+} eAlertOp;
+
+typedef struct
+{
+	eAlertSeverity severity;
+	eAlertRecord record;
+	eAlertValue value;
+	const FIELD_DESC* pField;	/* ALERT_VALUE_FIELD */
+	PFN_FIELD_NAME pfnName;		/* names of the values, NULL if none */
+	eAlertOp op;
+	double operand;
+	unsigned __int64 setMask;	/* ALERT_OP_IN: the values from 0 to 63 */
+	std::vector<double> set;	/* ALERT_OP_IN: the other values */
+	int line;
+	std::string text;			/* rule without the severity, as written */
+} ALERT_RULE;
+
+// records a rule applies to: sysenc, boot drive, then the volumes from A: to Z:
+#define ALERT_SLOT_SYSENC		0
+#define ALERT_SLOT_BOOT_DRIVE	1
+#define ALERT_SLOT_VOLUME		2
+#define ALERT_SLOT_COUNT		(ALERT_SLOT_VOLUME + 26)
+
+typedef struct
+{
+	const ALERT_RULE* pRule;
+	int slot;
+	BOOL bRaised;		/* FALSE when the rule doesn't match anymore */
+	double value;		/* value of the field when raised */
+} ALERT_EVENT;
+
+// Rules compiled into field offsets and constants, evaluated against successive snapshots.
+// A violation is reported when it starts and when it ends.
+class CAlertEvaluator
+{
+public:
+	CAlertEvaluator ();
+
+	// FALSE on syntax error, with its line and description
+	BOOL Compile (const char* szRules, int& iErrorLine, std::string& error);
+	void Evaluate (const VC_SNAPSHOT& snapshot, std::vector<ALERT_EVENT>& events);
+	size_t GetRuleCount () const { return m_Rules.size (); }
+	// highest severity of the violations of the last snapshot, -1 if none
+	int GetActiveSeverity () const;
+	size_t GetActiveCount (eAlertSeverity severity) const;
+
+protected:
+	BOOL GetValue (const ALERT_RULE& rule, const VC_SNAPSHOT& snapshot, int slot, double& value) const;
+	BOOL Matches (const ALERT_RULE& rule, const VC_SNAPSHOT& snapshot, int slot, double& value) const;
+
+	std::vector<ALERT_RULE> m_Rules;
+	std::vector<size_t> m_RecordRules[ALERT_RECORD_COUNT];
+	std::vector<unsigned __int32> m_Active;	/* slots violating each rule */
+	VC_SNAPSHOT m_Previous;
+	BOOL m_bPreviousValid;
+};
+
+// Evaluate the rules against a snapshot every dwIntervalMs, or once if 0, during iCount snapshots (0 = no limit).
+// Returns the exit code matching the highest severity of the violations of the last snapshot.
+int RunAlerts (CVcDriver& driver, LPCTSTR szRulesFile, DWORD dwIntervalMs, int iCount, eOutputFormat format);
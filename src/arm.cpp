@@ -0,0 +1,494 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "arm.h"
+#include "netio.h"
+#ifdef _WIN32
+#include <strsafe.h>
+#include <aclapi.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#endif
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define ARM_DEFAULT_EVENT_NAME	TEXT("VeraStatusClearKeys")
+// the client sends "clearkeys <token>", optionally followed by a new line
+#define ARM_PORT_COMMAND		"clearkeys"
+#define ARM_PORT_TIMEOUT_MS		1000
+// connections being read at the same time, the others are closed right away
+#define ARM_PORT_MAX_CONNECTIONS	64
+#define ARM_TOKEN_MIN_LENGTH	16
+#define ARM_TOKEN_MAX_LENGTH	256
+
+#ifdef _WIN32
+// named event set by another process of the session (OpenEvent with EVENT_MODIFY_STATE, then SetEvent)
+class CEventArmTrigger : public CArmTrigger
+{
+public:
+    CEventArmTrigger (LPCTSTR szName) : m_hEvent (NULL), m_Name (szName) {}
+    virtual ~CEventArmTrigger ()
+    {
+        if (m_hEvent)
+            CloseHandle (m_hEvent);
+    }
+
+    BOOL Create ()
+    {
+        m_hEvent = CreateEvent (NULL, TRUE, FALSE, m_Name.c_str ());
+        return m_hEvent != NULL;
+    }
+
+    virtual BOOL Wait ()
+    {
+        if (WaitForSingleObject (m_hEvent, INFINITE) != WAIT_OBJECT_0)
+            return FALSE;
+        m_TriggerNs = GetTimestampNs ();
+        return TRUE;
+    }
+    virtual void GetDescription (TCHAR* szOut, size_t cchOut) const
+    {
+        StringCchPrintf (szOut, cchOut, TEXT("event %s"), m_Name.c_str ());
+    }
+
+protected:
+    HANDLE m_hEvent;
+    std::basic_string<TCHAR> m_Name;
+};
+#else
+// SIGUSR1 sent to the process, blocked so that it is only received by sigwait
+class CEventArmTrigger : public CArmTrigger
+{
+public:
+    BOOL Create ()
+    {
+        sigemptyset (&m_Signals);
+        sigaddset (&m_Signals, SIGUSR1);
+        if (pthread_sigmask (SIG_BLOCK, &m_Signals, NULL) != 0)
+            return FALSE;
+        return TRUE;
+    }
+
+    virtual BOOL Wait ()
+    {
+        int signal = 0;
+        if (sigwait (&m_Signals, &signal) != 0)
+            return FALSE;
+        m_TriggerNs = GetTimestampNs ();
+        return TRUE;
+    }
+    virtual void GetDescription (TCHAR* szOut, size_t cchOut) const
+    {
+        StringCchPrintf (szOut, cchOut, TEXT("SIGUSR1 (kill -USR1 %d)"), (int) getpid ());
+    }
+
+protected:
+    sigset_t m_Signals;
+};
+#endif
+
+#ifdef _WIN32
+static BOOL IsTrustedSid (PSID pSid, PSID pUserSid)
+{
+    return EqualSid (pSid, pUserSid) || IsWellKnownSid (pSid, WinLocalSystemSid) || IsWellKnownSid (pSid, WinBuiltinAdministratorsSid);
+}
+
+// owned by the current user (or SYSTEM, Administrators) and readable by nobody else
+static BOOL IsOwnerOnlyFile (HANDLE hFile)
+{
+    PSID pOwner = NULL;
+    PACL pDacl = NULL;
+    PSECURITY_DESCRIPTOR pSecurityDescriptor = NULL;
+    HANDLE hToken = NULL;
+    BYTE userBuffer[sizeof (TOKEN_USER) + SECURITY_MAX_SID_SIZE];
+    DWORD cbUser = 0;
+    BOOL bResult = FALSE;
+
+    if (GetSecurityInfo (hFile, SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION | DACL_SECURITY_INFORMATION, &pOwner, NULL, &pDacl, NULL, &pSecurityDescriptor) != ERROR_SUCCESS)
+        return FALSE;
+    if (OpenProcessToken (GetCurrentProcess (), TOKEN_QUERY, &hToken)
+        && GetTokenInformation (hToken, TokenUser, userBuffer, sizeof (userBuffer), &cbUser))
+    {
+        PSID pUserSid = ((TOKEN_USER*) userBuffer)->User.Sid;
+
+        // a NULL DACL grants everyone full access
+        bResult = pOwner && pDacl && IsTrustedSid (pOwner, pUserSid);
+        for (DWORD i = 0; bResult && i < pDacl->AceCount; i++)
+        {
+            ACE_HEADER* pAce = NULL;
+            if (!GetAce (pDacl, i, (LPVOID*) &pAce))
+                bResult = FALSE;
+            else if (pAce->AceType == ACCESS_DENIED_ACE_TYPE || (pAce->AceFlags & INHERIT_ONLY_ACE))
+                continue;
+            else if (pAce->AceType != ACCESS_ALLOWED_ACE_TYPE || !IsTrustedSid ((PSID) &((ACCESS_ALLOWED_ACE*) pAce)->SidStart, pUserSid))
+                bResult = FALSE;
+        }
+    }
+    if (hToken)
+        CloseHandle (hToken);
+    LocalFree (pSecurityDescriptor);
+    return bResult;
+}
+#endif
+
+// Read the token of the port trigger from a file that only its owner can read, so that other
+// local users can't clear the keys. Its trailing spaces and new lines are ignored.
+static BOOL ReadArmToken (LPCTSTR szPath, std::string& token)
+{
+    char buffer[ARM_TOKEN_MAX_LENGTH + 3];
+    int cbRead = 0;
+
+#ifdef _WIN32
+    HANDLE hFile = CreateFile (szPath, GENERIC_READ | READ_CONTROL, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    DWORD cbFile = 0;
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        _tprintf (TEXT("Failed to open %s. Error %d\n"), szPath, (int) GetLastError ());
+        return FALSE;
+    }
+    if (!IsOwnerOnlyFile (hFile))
+    {
+        _tprintf (TEXT("Error: %s must be owned by the current user and readable by nobody else.\n"), szPath);
+        CloseHandle (hFile);
+        return FALSE;
+    }
+    if (ReadFile (hFile, buffer, sizeof (buffer), &cbFile, NULL))
+        cbRead = (int) cbFile;
+    CloseHandle (hFile);
+#else
+    struct stat st;
+    int fd = open (szPath, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0)
+    {
+        _tprintf (TEXT("Failed to open %s. Error %d\n"), szPath, errno);
+        return FALSE;
+    }
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_uid != geteuid () || (st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+    {
+        _tprintf (TEXT("Error: %s must be a file owned by the current user and readable by nobody else (chmod 600).\n"), szPath);
+        close (fd);
+        return FALSE;
+    }
+    ssize_t cbFile = read (fd, buffer, sizeof (buffer));
+    if (cbFile > 0)
+        cbRead = (int) cbFile;
+    close (fd);
+#endif
+
+    while (cbRead > 0 && isspace ((unsigned char) buffer[cbRead - 1]))
+        cbRead--;
+    if (cbRead < ARM_TOKEN_MIN_LENGTH || cbRead > ARM_TOKEN_MAX_LENGTH)
+    {
+        _tprintf (TEXT("Error: the token in %s must be %d to %d characters long.\n"), szPath, ARM_TOKEN_MIN_LENGTH, ARM_TOKEN_MAX_LENGTH);
+        return FALSE;
+    }
+    token.assign (buffer, cbRead);
+    return TRUE;
+}
+
+// the time taken doesn't depend on where the received command differs from the expected one
+static bool EqualConstantTime (const std::string& received, const std::string& expected)
+{
+    unsigned char diff = (received.size () == expected.size ())? 0 : 1;
+    for (size_t i = 0; i < expected.size (); i++)
+        diff |= (unsigned char) (expected[i] ^ ((i < received.size ())? received[i] : 0));
+    return diff == 0;
+}
+
+// Connection to 127.0.0.1:port sending "clearkeys <token>", other connections being ignored.
+// The connections are accepted and read on their own threads so that an idle one doesn't delay
+// the others. The threads are detached: the state they share outlives the trigger.
+class CPortArmTrigger : public CArmTrigger
+{
+public:
+    CPortArmTrigger () : m_pState (std::make_shared<PORT_STATE> ()) {}
+    virtual ~CPortArmTrigger ()
+    {
+        std::lock_guard<std::mutex> lock (m_pState->mutex);
+        m_pState->bStopped = true;
+    }
+
+    BOOL Create (unsigned short port, const std::string& token)
+    {
+        m_pState->expected = std::string (ARM_PORT_COMMAND " ") + token;
+        m_pState->listener = NetListenLoopback (port);
+        if (m_pState->listener == VC_INVALID_SOCKET)
+            return FALSE;
+        std::thread (AcceptConnections, m_pState).detach ();
+        return TRUE;
+    }
+
+    virtual BOOL Wait ()
+    {
+        std::unique_lock<std::mutex> lock (m_pState->mutex);
+        m_pState->fired.wait (lock, [this] () { return m_pState->bFired || m_pState->bFailed; });
+        m_TriggerNs = m_pState->triggerNs;
+        return m_pState->bFired;
+    }
+    virtual void GetDescription (TCHAR* szOut, size_t cchOut) const
+    {
+        StringCchPrintf (szOut, cchOut, TEXT("\"%hs <token>\" on 127.0.0.1:%d"), ARM_PORT_COMMAND, (int) NetGetLocalPort (m_pState->listener));
+    }
+
+protected:
+    typedef struct PORT_STATE
+    {
+        PORT_STATE () : listener (VC_INVALID_SOCKET), activeConnections (0), bFired (false), bFailed (false), bStopped (false), triggerNs (0) {}
+        ~PORT_STATE ()
+        {
+            if (listener != VC_INVALID_SOCKET)
+                NetClose (listener);
+        }
+
+        VC_SOCKET listener;
+        std::string expected;
+        std::atomic<int> activeConnections;
+        std::mutex mutex;
+        std::condition_variable fired;
+        bool bFired, bFailed, bStopped;
+        unsigned __int64 triggerNs;
+    } PORT_STATE;
+
+    static void AcceptConnections (std::shared_ptr<PORT_STATE> pState)
+    {
+        for (;;)
+        {
+            VC_SOCKET s = NetAccept (pState->listener);
+            if (s == VC_INVALID_SOCKET)
+            {
+                std::lock_guard<std::mutex> lock (pState->mutex);
+                pState->bFailed = true;
+                pState->fired.notify_all ();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock (pState->mutex);
+                if (pState->bFired || pState->bStopped)
+                {
+                    NetClose (s);
+                    return;
+                }
+            }
+            if (++pState->activeConnections > ARM_PORT_MAX_CONNECTIONS)
+            {
+                pState->activeConnections--;
+                NetClose (s);
+                continue;
+            }
+            std::thread (ReadConnection, pState, s).detach ();
+        }
+    }
+
+    static void ReadConnection (std::shared_ptr<PORT_STATE> pState, VC_SOCKET s)
+    {
+        char command[sizeof (ARM_PORT_COMMAND) + ARM_TOKEN_MAX_LENGTH + 2];
+        int cbCommand = 0, cbReceived;
+
+        NetSetTimeout (s, ARM_PORT_TIMEOUT_MS);
+        while (cbCommand < (int) sizeof (command)
+            && (cbReceived = NetReceive (s, command + cbCommand, (int) sizeof (command) - cbCommand)) > 0)
+        {
+            cbCommand += cbReceived;
+            if (command[cbCommand - 1] == '\n')
+                break;
+        }
+        unsigned __int64 receivedNs = GetTimestampNs ();
+        NetClose (s);
+        pState->activeConnections--;
+
+        while (cbCommand > 0 && (command[cbCommand - 1] == '\n' || command[cbCommand - 1] == '\r'))
+            cbCommand--;
+        if (EqualConstantTime (std::string (command, cbCommand), pState->expected))
+        {
+            std::lock_guard<std::mutex> lock (pState->mutex);
+            if (!pState->bFired)
+            {
+                pState->bFired = true;
+                pState->triggerNs = receivedNs;
+                pState->fired.notify_all ();
+            }
+        }
+    }
+
+    std::shared_ptr<PORT_STATE> m_pState;
+};
+
+// creation of a file, notified by the changes of its directory
+class CFileArmTrigger : public CArmTrigger
+{
+public:
+    CFileArmTrigger (LPCTSTR szPath) : m_Path (szPath), m_hChange (INVALID_HANDLE_VALUE) {}
+    virtual ~CFileArmTrigger ()
+    {
+#ifdef _WIN32
+        if (m_hChange != INVALID_HANDLE_VALUE)
+            FindCloseChangeNotification (m_hChange);
+#else
+        if (m_hChange != INVALID_HANDLE_VALUE)
+            close ((int) (intptr_t) m_hChange);
+#endif
+    }
+
+    BOOL Create ()
+    {
+        size_t sep = m_Path.find_last_of (TEXT("\\/"));
+        std::basic_string<TCHAR> directory = (sep == std::basic_string<TCHAR>::npos)? TEXT(".") : m_Path.substr (0, sep + 1);
+
+#ifdef _WIN32
+        m_hChange = FindFirstChangeNotification (directory.c_str (), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME);
+        return m_hChange != INVALID_HANDLE_VALUE;
+#else
+        int fd = inotify_init1 (IN_CLOEXEC);
+        if (fd < 0)
+            return FALSE;
+        m_hChange = (HANDLE) (intptr_t) fd;
+        return inotify_add_watch (fd, directory.c_str (), IN_CREATE | IN_MOVED_TO) >= 0;
+#endif
+    }
+
+    BOOL Exists () const
+    {
+#ifdef _WIN32
+        return GetFileAttributes (m_Path.c_str ()) != INVALID_FILE_ATTRIBUTES;
+#else
+        return access (m_Path.c_str (), F_OK) == 0;
+#endif
+    }
+
+    virtual BOOL Wait ()
+    {
+        // the notifications don't say which file was created: check it after each one
+        m_TriggerNs = GetTimestampNs ();
+        while (!Exists ())
+        {
+#ifdef _WIN32
+            if (WaitForSingleObject (m_hChange, INFINITE) != WAIT_OBJECT_0 || !FindNextChangeNotification (m_hChange))
+                return FALSE;
+#else
+            char buffer[4096];
+            if (read ((int) (intptr_t) m_hChange, buffer, sizeof (buffer)) < 0 && errno != EINTR)
+                return FALSE;
+#endif
+            m_TriggerNs = GetTimestampNs ();
+        }
+        return TRUE;
+    }
+    virtual void GetDescription (TCHAR* szOut, size_t cchOut) const
+    {
+        StringCchPrintf (szOut, cchOut, TEXT("creation of %s"), m_Path.c_str ());
+    }
+
+protected:
+    std::basic_string<TCHAR> m_Path;
+    HANDLE m_hChange;
+};
+
+static int GetTriggerError ()
+{
+#ifdef _WIN32
+    return (int) GetLastError ();
+#else
+    return errno;
+#endif
+}
+
+CArmTrigger* CreateArmTrigger (eArmTrigger type, LPCTSTR szParameter, LPCTSTR szTokenFile)
+{
+    if (type == ARM_TRIGGER_EVENT)
+    {
+#ifdef _WIN32
+        CEventArmTrigger* pTrigger = new CEventArmTrigger (szParameter? szParameter : ARM_DEFAULT_EVENT_NAME);
+#else
+        CEventArmTrigger* pTrigger = new CEventArmTrigger ();
+        if (szParameter)
+        {
+            _tprintf (TEXT("Error: named events are only available on Windows.\n"));
+            delete pTrigger;
+            return NULL;
+        }
+#endif
+        if (pTrigger->Create ())
+            return pTrigger;
+        _tprintf (TEXT("Failed to create the trigger event. Error %d\n"), GetTriggerError ());
+        delete pTrigger;
+    }
+    else if (type == ARM_TRIGGER_PORT)
+    {
+        std::string token;
+        if (!szTokenFile || !ReadArmToken (szTokenFile, token))
+            return NULL;
+
+        CPortArmTrigger* pTrigger = new CPortArmTrigger ();
+        if (pTrigger->Create ((unsigned short) _tcstoul (szParameter, NULL, 10), token))
+            return pTrigger;
+        _tprintf (TEXT("Failed to listen on 127.0.0.1:%s. Error %d\n"), szParameter, NetGetLastError ());
+        delete pTrigger;
+    }
+    else
+    {
+        CFileArmTrigger* pTrigger = new CFileArmTrigger (szParameter);
+        // a file left by a previous trigger must not clear the keys at startup
+        if (pTrigger->Exists ())
+            _tprintf (TEXT("Error: %s already exists.\n"), szParameter);
+        else if (pTrigger->Create ())
+            return pTrigger;
+        else
+            _tprintf (TEXT("Failed to watch the directory of %s. Error %d\n"), szParameter, GetTriggerError ());
+        delete pTrigger;
+    }
+    return NULL;
+}
+
+int RunArm (CVcDriver& driver, CArmTrigger& trigger)
+{
+    CSimulatedDriver* pSimulated = dynamic_cast<CSimulatedDriver*> (&driver);
+    unsigned __int64 callNs, returnNs;
+    TCHAR szDescription[1024];
+    DWORD cbBytesReturned = 0, dwError = ERROR_SUCCESS;
+    BOOL bResult;
+
+    trigger.GetDescription (szDescription, ARRAYSIZE (szDescription));
+    _tprintf (TEXT("Armed: the keys will be cleared on %s\n"), szDescription);
+    fflush (stdout);
+
+#ifdef _WIN32
+    // the waiting thread is scheduled first when the trigger fires
+    SetThreadPriority (GetCurrentThread (), THREAD_PRIORITY_TIME_CRITICAL);
+#endif
+    if (!trigger.Wait ())
+    {
+        _tprintf (TEXT("Failed to wait for the trigger. Error %d\n"), GetTriggerError ());
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    // measured from the moment the trigger itself was seen
+    callNs = GetTimestampNs ();
+    bResult = driver.IoControl (VC_IOCTL_EMERGENCY_CLEAR_KEYS, NULL, 0, NULL, 0, &cbBytesReturned);
+    if (!bResult)
+        dwError = GetLastError ();
+    returnNs = GetTimestampNs ();
+
+    if (!bResult)
+    {
+        _tprintf (TEXT("Call to VeraCrypt driver (VC_IOCTL_EMERGENCY_CLEAR_KEYS) failed with error %s\n"), GetWin32ErrorStr (dwError));
+        return VC_STATUS_DRIVER_CALL_FAILED;
+    }
+
+    _tprintf (TEXT("Keys cleared successfully!\n"));
+    _tprintf (TEXT("Trigger to driver call: %.1f us, driver call: %.1f us\n"), (double) (callNs - trigger.GetTriggerNs ()) / 1000.0, (double) (returnNs - callNs) / 1000.0);
+    if (pSimulated && pSimulated->GetKeysClearedNs ())
+        _tprintf (TEXT("Request received by the simulated driver %.1f us after the trigger\n"), (double) (pSimulated->GetKeysClearedNs () - trigger.GetTriggerNs ()) / 1000.0);
+    return VC_STATUS_OK;
+}
@@ -0,0 +1,43 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+
+// Pre-armed emergency key clearing (/arm): the driver is opened and queried before arming, so
+// that EMERGENCY_CLEAR_KEYS is the only call left when the trigger fires.
+
+typedef enum
+{
+	ARM_TRIGGER_EVENT = 0,	/* named event on Windows, SIGUSR1 elsewhere */
+	ARM_TRIGGER_PORT,		/* "clearkeys <token>" received on 127.0.0.1:port */
+	ARM_TRIGGER_FILE		/* file created */
+} eArmTrigger;
+
+// local trigger waited for by the armed process
+class CArmTrigger
+{
+public:
+	CArmTrigger () : m_TriggerNs (0) {}
+	virtual ~CArmTrigger () {}
+	// block until the trigger fires: FALSE on failure
+	virtual BOOL Wait () = 0;
+	virtual void GetDescription (TCHAR* szOut, size_t cchOut) const = 0;
+	// GetTimestampNs () when the trigger was seen (signal, command received or file notification)
+	unsigned __int64 GetTriggerNs () const { return m_TriggerNs; }
+
+protected:
+	unsigned __int64 m_TriggerNs;
+};
+
+// szParameter: event name (NULL for the default one), port number or file path.
+// szTokenFile: for the port trigger, file holding the token, readable only by its owner.
+// Returns NULL on failure, after printing the error.
+CArmTrigger* CreateArmTrigger (eArmTrigger type, LPCTSTR szParameter, LPCTSTR szTokenFile = NULL);
+
+// Wait for the trigger, clear the keys and report the latency from the trigger to the driver call.
+int RunArm (CVcDriver& driver, CArmTrigger& trigger);
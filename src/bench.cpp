@@ -0,0 +1,421 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+// VeraStatusBench: measures the cost of the VeraStatus code paths against a simulated driver
+// (or a trace replay, or the real driver) and reports latency percentiles.
+
+#include "common.h"
+#include "driver.h"
+#include "snapshot.h"
+#include "format.h"
+#include "utf8.h"
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <strsafe.h>
+#define NULL_DEVICE	"NUL"
+#else
+#define _dup		dup
+#define _dup2		dup2
+#define _open		open
+#define _close		close
+#define _fileno		fileno
+#define _O_WRONLY	O_WRONLY
+#define _tpopen		popen
+#define _pclose		pclose
+#define NULL_DEVICE	"/dev/null"
+#endif
+
+typedef struct
+{
+	const char* szName;
+	unsigned int batch;				/* operations timed together for each sample */
+	std::vector<double> samples;	/* microseconds per operation */
+} BENCH_STAGE;
+
+static std::vector<BENCH_STAGE> g_Stages;
+
+// time iterations samples of batch calls to fn
+template <typename F> static void RunStage (const char* szName, int iterations, unsigned int batch, F fn)
+{
+    BENCH_STAGE stage;
+
+    stage.szName = szName;
+    stage.batch = batch;
+    for (int i = 0; i < iterations; i++)
+    {
+        unsigned __int64 startUs = GetTimestampUs ();
+        for (unsigned int j = 0; j < batch; j++)
+            fn ();
+        stage.samples.push_back ((double) (GetTimestampUs () - startUs) / (double) batch);
+    }
+    g_Stages.push_back (stage);
+}
+
+static double Percentile (const std::vector<double>& sorted, double p)
+{
+    size_t index = (size_t) (p / 100.0 * (double) sorted.size () + 0.5);
+    if (index > 0)
+        index--;
+    if (index >= sorted.size ())
+        index = sorted.size () - 1;
+    return sorted[index];
+}
+
+static void SetWideString (WCHAR* wszDest, size_t cchDest, const char* szSrc)
+{
+    size_t i;
+    for (i = 0; szSrc[i] && i + 1 < cchDest; i++)
+        wszDest[i] = (WCHAR) (unsigned char) szSrc[i];
+    wszDest[i] = 0;
+}
+
+// worst case driver state: all 26 drive letters used with long paths, partially encrypted system
+static CSimulatedDriver* CreateFullSimulatedDriver ()
+{
+    CSimulatedDriver* pDriver = new CSimulatedDriver ();
+    VOLUME_PROPERTIES_STRUCT prop;
+    BootEncryptionStatus status;
+    char szPath[260];
+
+    for (int i = 0; i < 26; i++)
+    {
+        memset (&prop, 0, sizeof (prop));
+        memset (szPath, 'x', sizeof (szPath) - 1);
+        szPath[sizeof (szPath) - 1] = 0;
+        memcpy (szPath, "\\??\\C:\\Containers\\", 18);
+        SetWideString (prop.wszVolume, ARRAYSIZE (prop.wszVolume), szPath);
+        SetWideString (prop.wszLabel, ARRAYSIZE (prop.wszLabel), "Benchmark volume label 32 chars.");
+        prop.bDriverSetLabel = TRUE;
+        prop.diskLength = (unsigned __int64) (i + 1) * 1024 * 1024 * 1024;
+        prop.ea = 1 + (i % 16);
+        prop.mode = 1;
+        prop.pkcs5 = 1 + (i % 5);
+        prop.pkcs5Iterations = 500000;
+        prop.volumePim = (i % 2)? 0 : 485;
+        prop.volFormatVersion = 2;
+        for (int j = 0; j < VOLUME_ID_SIZE; j++)
+            prop.volumeID[j] = (unsigned char) (i * VOLUME_ID_SIZE + j);
+        pDriver->Mount (i, prop);
+        pDriver->SetIoRate (i, 1024 * 1024, 512 * 1024);
+    }
+
+    memset (&status, 0, sizeof (status));
+    status.DeviceFilterActive = TRUE;
+    status.BootLoaderVersion = 0x0126;
+    status.DriveMounted = TRUE;
+    status.DriveEncrypted = TRUE;
+    status.VolumeHeaderPresent = TRUE;
+    status.BootDriveLength.QuadPart = 512LL * 1024 * 1024 * 1024;
+    status.ConfiguredEncryptedAreaStart = 1024 * 1024;
+    status.ConfiguredEncryptedAreaEnd = status.BootDriveLength.QuadPart - 1;
+    status.EncryptedAreaStart = status.ConfiguredEncryptedAreaStart;
+    status.EncryptedAreaEnd = status.ConfiguredEncryptedAreaEnd / 3;
+    status.SetupInProgress = TRUE;
+    status.SetupMode = SetupEncryption;
+    pDriver->SetBootEncryptionStatus (status, sizeof (status));
+    pDriver->SetBootLoaderVersion (0x0126);
+    memset (&prop, 0, sizeof (prop));
+    SetWideString (prop.wszVolume, ARRAYSIZE (prop.wszVolume), "\\Device\\Harddisk0\\Partition2");
+    prop.ea = 1;
+    prop.pkcs5 = 3;
+    prop.pkcs5Iterations = 200000;
+    pDriver->SetBootDriveProperties (prop);
+
+    return pDriver;
+}
+
+// time from process creation to the first byte written by VeraStatus, and to its exit
+static void RunStartupStage (LPCTSTR szExe, int iterations)
+{
+    BENCH_STAGE first, total;
+    TCHAR szCommand[1024];
+
+    StringCchPrintf (szCommand, ARRAYSIZE (szCommand), TEXT("\"%s\" /simulate /list"), szExe);
+    first.szName = "startup.first_output";
+    total.szName = "startup.exit";
+    first.batch = total.batch = 1;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        unsigned __int64 startUs = GetTimestampUs ();
+        FILE* f = _tpopen (szCommand, TEXT("r"));
+        if (!f)
+        {
+            _tprintf (TEXT("Failed to start %s\n"), szExe);
+            return;
+        }
+        if (fgetc (f) != EOF)
+            first.samples.push_back ((double) (GetTimestampUs () - startUs));
+        while (fgetc (f) != EOF)
+            ;
+        _pclose (f);
+        total.samples.push_back ((double) (GetTimestampUs () - startUs));
+    }
+
+    if (!first.samples.empty ())
+        g_Stages.push_back (first);
+    g_Stages.push_back (total);
+}
+
+static void RunFormattingStages (CVcDriver& driver, int iterations)
+{
+    static VC_SNAPSHOT snapshot;
+    static const struct
+    {
+        const char* szName;
+        eOutputFormat format;
+    } g_Formats[] =
+    {
+        { "format.json.26_volumes", OUTPUT_JSON },
+        { "format.csv.26_volumes", OUTPUT_CSV },
+        { "format.kv.26_volumes", OUTPUT_KV },
+    };
+
+    TakeSnapshot (driver, snapshot);
+
+    // text output goes to the null device
+    fflush (stdout);
+    int fdStdout = _dup (_fileno (stdout));
+    int fdNull = _open (NULL_DEVICE, _O_WRONLY);
+    _dup2 (fdNull, _fileno (stdout));
+    RunStage ("format.text.26_volumes", iterations, 1, [&] () { PrintSnapshotInformation (snapshot); fflush (stdout); });
+    fflush (stdout);
+    _dup2 (fdStdout, _fileno (stdout));
+    _close (fdNull);
+    _close (fdStdout);
+
+    for (size_t i = 0; i < ARRAYSIZE (g_Formats); i++)
+    {
+        COutputBuffer out;
+        RunStage (g_Formats[i].szName, iterations, 1, [&] ()
+        {
+            CRecordWriter writer (out, g_Formats[i].format);
+            out.Reset ();
+            writer.BeginDocument ();
+            writer.BeginRecord ("sysenc");
+            FormatSystemEncryptionInformation (writer, snapshot.bootStatus, snapshot.cbBootStatus);
+            writer.EndRecord ();
+            writer.BeginList ("volumes");
+            for (int d = 0; d < 26; d++)
+            {
+                char szKey[2] = { (char) ('A' + d), 0 };
+                writer.BeginRecord ("volume", szKey);
+                FormatVolumeInformation (writer, snapshot.volumes.prop[d]);
+                writer.EndRecord ();
+            }
+            writer.EndList ();
+            writer.EndDocument ();
+        });
+    }
+}
+
+// UTF-8 conversion of the paths and labels of 26 volumes, with printf and with each transcoder
+static void RunTranscodingStages (CVcDriver& driver, int iterations)
+{
+    static VC_SNAPSHOT snapshot;
+    static const struct
+    {
+        const char* szName;
+        eUtf8Implementation impl;
+    } g_Implementations[] =
+    {
+        { "utf8.scalar.26_volumes", UTF8_SCALAR },
+        { "utf8.sse2.26_volumes", UTF8_SSE2 },
+        { "utf8.avx2.26_volumes", UTF8_AVX2 },
+    };
+    char szOut[3 * 260 + 1];
+    volatile size_t sink = 0;
+
+    TakeSnapshot (driver, snapshot);
+
+    RunStage ("utf8.stdio.26_volumes", iterations, 10, [&] ()
+    {
+        for (int d = 0; d < 26; d++)
+        {
+#ifdef _WIN32
+            StringCchPrintfA (szOut, sizeof (szOut), "%ls", snapshot.volumes.prop[d].wszVolume);
+            StringCchPrintfA (szOut, sizeof (szOut), "%ls", snapshot.volumes.prop[d].wszLabel);
+#else
+            StringCchPrintf (szOut, sizeof (szOut), "%s", VC_WSTR (snapshot.volumes.prop[d].wszVolume));
+            StringCchPrintf (szOut, sizeof (szOut), "%s", VC_WSTR (snapshot.volumes.prop[d].wszLabel));
+#endif
+            sink += szOut[0];
+        }
+    });
+
+    for (size_t i = 0; i < ARRAYSIZE (g_Implementations); i++)
+    {
+        eUtf8Implementation impl = g_Implementations[i].impl;
+
+        if (impl > GetUtf8Implementation ())
+            continue;
+        RunStage (g_Implementations[i].szName, iterations, 10, [&] ()
+        {
+            for (int d = 0; d < 26; d++)
+            {
+                const VOLUME_PROPERTIES_STRUCT& prop = snapshot.volumes.prop[d];
+                sink += Utf16ToUtf8With (impl, prop.wszVolume, ARRAYSIZE (prop.wszVolume), szOut, sizeof (szOut));
+                sink += Utf16ToUtf8With (impl, prop.wszLabel, ARRAYSIZE (prop.wszLabel), szOut, sizeof (szOut));
+            }
+        });
+    }
+}
+
+static void RunDriverStages (CVcDriver& driver, int iterations, BOOL bRealDriver)
+{
+    static MOUNT_LIST_STRUCT mlist;
+    static VC_SNAPSHOT snapshot;
+    static BootEncryptionStatus status;
+    static VOLUME_PROPERTIES_STRUCT prop;
+    LONG DriverVersion;
+    UINT16 bootLoaderVersion;
+    DWORD cbBytesReturned;
+
+    RunStage ("ioctl.GET_DRIVER_VERSION", iterations, 100, [&] () { driver.IoControl (VC_IOCTL_GET_DRIVER_VERSION, NULL, 0, &DriverVersion, sizeof (DriverVersion), &cbBytesReturned); });
+    RunStage ("ioctl.GET_BOOT_LOADER_VERSION", iterations, 100, [&] () { driver.IoControl (VC_IOCTL_GET_BOOT_LOADER_VERSION, NULL, 0, &bootLoaderVersion, sizeof (bootLoaderVersion), &cbBytesReturned); });
+    RunStage ("ioctl.GET_MOUNTED_VOLUMES", iterations, 100, [&] ()
+    {
+        memset (&mlist, 0, sizeof (mlist));
+        driver.IoControl (VC_IOCTL_GET_MOUNTED_VOLUMES, &mlist, sizeof (mlist), &mlist, sizeof (mlist), &cbBytesReturned);
+    });
+    RunStage ("ioctl.GET_VOLUME_PROPERTIES", iterations, 100, [&] ()
+    {
+        memset (&prop, 0, sizeof (prop));
+        prop.driveNo = 0;
+        driver.IoControl (VC_IOCTL_GET_VOLUME_PROPERTIES, &prop, sizeof (prop), &prop, sizeof (prop), &cbBytesReturned);
+    });
+    RunStage ("ioctl.GET_BOOT_ENCRYPTION_STATUS", iterations, 100, [&] () { driver.IoControl (VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS, NULL, 0, &status, sizeof (status), &cbBytesReturned); });
+    RunStage ("ioctl.GET_BOOT_DRIVE_VOLUME_PROPERTIES", iterations, 100, [&] () { driver.IoControl (VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES, NULL, 0, &prop, sizeof (prop), &cbBytesReturned); });
+    // never clear the keys of the real driver
+    if (!bRealDriver)
+        RunStage ("ioctl.EMERGENCY_CLEAR_KEYS", iterations, 100, [&] () { driver.IoControl (VC_IOCTL_EMERGENCY_CLEAR_KEYS, NULL, 0, NULL, 0, &cbBytesReturned); });
+
+    RunStage ("snapshot.all", iterations, 1, [&] () { TakeSnapshot (driver, snapshot); });
+
+    driver.IoControl (VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS, NULL, 0, &status, sizeof (status), &cbBytesReturned);
+    volatile int sink = 0;
+    RunStage ("GetSystemEncryptionState", iterations, 10000, [&] () { sink += GetSystemEncryptionState (status); });
+}
+
+static BOOL WriteResults (LPCTSTR szFileName)
+{
+    COutputBuffer out;
+    CRecordWriter writer (out, OUTPUT_JSON);
+    FILE* f;
+
+    writer.BeginDocument ();
+    writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+    writer.String ("unit", "us");
+    writer.BeginList ("stages");
+    for (size_t i = 0; i < g_Stages.size (); i++)
+    {
+        std::vector<double> sorted = g_Stages[i].samples;
+        double sum = 0;
+
+        std::sort (sorted.begin (), sorted.end ());
+        for (size_t j = 0; j < sorted.size (); j++)
+            sum += sorted[j];
+
+        writer.BeginRecord ("stage", g_Stages[i].szName);
+        writer.String ("name", g_Stages[i].szName);
+        writer.UInt ("samples", sorted.size ());
+        writer.UInt ("batch", g_Stages[i].batch);
+        writer.Double ("min", sorted.front ());
+        writer.Double ("p50", Percentile (sorted, 50));
+        writer.Double ("p90", Percentile (sorted, 90));
+        writer.Double ("p99", Percentile (sorted, 99));
+        writer.Double ("max", sorted.back ());
+        writer.Double ("mean", sum / (double) sorted.size ());
+        writer.EndRecord ();
+
+        _tprintf (TEXT("%-40hs %10.3f %10.3f %10.3f %10.3f %10.3f\n"), g_Stages[i].szName,
+            sorted.front (), Percentile (sorted, 50), Percentile (sorted, 90), Percentile (sorted, 99), sorted.back ());
+    }
+    writer.EndList ();
+    writer.EndDocument ();
+
+    f = _tfopen (szFileName, TEXT("wb"));
+    if (!f)
+        return FALSE;
+    BOOL bRet = out.Write (f);
+    fclose (f);
+    return bRet;
+}
+
+static void PrintBenchUsage ()
+{
+    _tprintf (TEXT("Usage: VeraStatusBench.exe [/iterations N] [/out ResultFile] [/exe VeraStatusPath] [/replay TraceFile | /real]\n"));
+    _tprintf (TEXT("   /iterations: number of samples per stage (default 1000)\n"));
+    _tprintf (TEXT("   /out: JSON result file (default verastatus_bench.json)\n"));
+    _tprintf (TEXT("   /exe: VeraStatus executable used to measure startup time (stage skipped if not specified)\n"));
+    _tprintf (TEXT("   /replay: use the responses of a driver trace instead of the simulated driver\n"));
+    _tprintf (TEXT("   /real: use the real VeraCrypt driver (EMERGENCY_CLEAR_KEYS is never called)\n"));
+}
+
+int _tmain (int argc, TCHAR** argv)
+{
+    DRIVER_OPTIONS driverOptions = { FALSE, NULL, NULL, 0, 0, NULL, 0, 0 };
+    BOOL bRealDriver = FALSE;
+    int iterations = 1000;
+    LPCTSTR szOutFile = TEXT("verastatus_bench.json");
+    LPCTSTR szExe = NULL;
+    CVcDriver* pDriver;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (_tcsicmp (argv[i], TEXT("/iterations")) == 0 && i + 1 < argc)
+            iterations = (int) _tcstol (argv[++i], NULL, 10);
+        else if (_tcsicmp (argv[i], TEXT("/out")) == 0 && i + 1 < argc)
+            szOutFile = argv[++i];
+        else if (_tcsicmp (argv[i], TEXT("/exe")) == 0 && i + 1 < argc)
+            szExe = argv[++i];
+        else if (_tcsicmp (argv[i], TEXT("/replay")) == 0 && i + 1 < argc)
+            driverOptions.szReplayFile = argv[++i];
+        else if (_tcsicmp (argv[i], TEXT("/real")) == 0)
+            bRealDriver = TRUE;
+        else
+        {
+            PrintBenchUsage ();
+            return VC_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    if (iterations <= 0)
+    {
+        PrintBenchUsage ();
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    if (driverOptions.szReplayFile || bRealDriver)
+        pDriver = OpenVcDriver (driverOptions);
+    else
+        pDriver = CreateFullSimulatedDriver ();
+
+    if (!pDriver)
+    {
+        _tprintf (TEXT("Failed to open the driver backend. Error %s\n"), GetWin32ErrorStr (GetLastError ()));
+        return VC_STATUS_NO_DRIVER;
+    }
+
+    if (szExe)
+        RunStartupStage (szExe, (iterations < 50)? iterations : 50);
+    RunDriverStages (*pDriver, iterations, bRealDriver);
+    RunFormattingStages (*pDriver, iterations);
+    RunTranscodingStages (*pDriver, iterations);
+    delete pDriver;
+
+    _tprintf (TEXT("%-40hs %10hs %10hs %10hs %10hs %10hs\n"), "Stage (us per operation)", "min", "p50", "p90", "p99", "max");
+    if (!WriteResults (szOutFile))
+    {
+        _tprintf (TEXT("Failed to write %s\n"), szOutFile);
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    return VC_STATUS_OK;
+}
@@ -0,0 +1,57 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "cache.h"
+
+CSnapshotCache::CSnapshotCache (CVcDriver& driver, DWORD dwTtlMs) :
+    m_Driver (driver),
+    m_dwTtlMs (dwTtlMs),
+    m_bRefreshing (FALSE),
+    m_SweepCount (0)
+{
+}
+
+std::shared_ptr<const CACHED_SNAPSHOT> CSnapshotCache::Get ()
+{
+    std::unique_lock<std::mutex> lock (m_Mutex);
+
+    for (;;)
+    {
+        if (m_Current && GetTimestampUs () - m_Current->timestampUs < (unsigned __int64) m_dwTtlMs * 1000)
+            return m_Current;
+
+        if (!m_bRefreshing)
+            break;
+
+        // another caller is sweeping the driver: use its result
+        unsigned __int64 sweep = m_SweepCount;
+        m_Refreshed.wait (lock, [&] { return m_SweepCount != sweep; });
+        return m_Current;
+    }
+
+    m_bRefreshing = TRUE;
+    lock.unlock ();
+
+    // the driver is queried without holding the lock so that fresh readers are never blocked
+    std::shared_ptr<CACHED_SNAPSHOT> pEntry = std::make_shared<CACHED_SNAPSHOT> ();
+    pEntry->bValid = TakeSnapshot (m_Driver, pEntry->snapshot);
+    pEntry->dwError = pEntry->bValid? ERROR_SUCCESS : GetLastError ();
+    pEntry->timestampUs = GetTimestampUs ();
+
+    lock.lock ();
+    m_Current = pEntry;
+    m_SweepCount++;
+    m_bRefreshing = FALSE;
+    m_Refreshed.notify_all ();
+    return m_Current;
+}
+
+unsigned __int64 CSnapshotCache::GetSweepCount ()
+{
+    std::lock_guard<std::mutex> lock (m_Mutex);
+    return m_SweepCount;
+}
@@ -0,0 +1,42 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "snapshot.h"
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+// result of a driver sweep shared by all the requests served while it is fresh
+typedef struct
+{
+	unsigned __int64 timestampUs;	/* end of the sweep */
+	BOOL bValid;					/* FALSE if the mount list couldn't be retrieved */
+	DWORD dwError;					/* error of GET_MOUNTED_VOLUMES when bValid is FALSE */
+	VC_SNAPSHOT snapshot;
+} CACHED_SNAPSHOT;
+
+// Snapshot cache with a time to live and single-flight refresh: when the cached snapshot
+// is expired, the first caller sweeps the driver and concurrent callers wait for its result
+// instead of querying the driver themselves. Failures are cached too.
+class CSnapshotCache
+{
+public:
+	CSnapshotCache (CVcDriver& driver, DWORD dwTtlMs);
+
+	std::shared_ptr<const CACHED_SNAPSHOT> Get ();
+	unsigned __int64 GetSweepCount ();
+
+protected:
+	CVcDriver& m_Driver;
+	DWORD m_dwTtlMs;
+	std::mutex m_Mutex;
+	std::condition_variable m_Refreshed;
+	BOOL m_bRefreshing;
+	unsigned __int64 m_SweepCount;
+	std::shared_ptr<const CACHED_SNAPSHOT> m_Current;
+};
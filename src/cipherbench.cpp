@@ -0,0 +1,173 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "cipherbench.h"
+#include "ciphers.h"
+#include "watch.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// each algorithm is timed over this duration per direction and thread count, on a buffer per thread
+#define CIPHERBENCH_RUN_NS			100000000ULL
+#define CIPHERBENCH_BUFFER_SIZE		(256 * 1024)
+#define CIPHERBENCH_EA_COUNT		16
+// share of the throughput of its algorithm above which the I/O of a volume is limited by the cipher
+#define CIPHERBENCH_BOUND_PERCENT	80.0
+
+static unsigned char g_BenchKey[XTS_MAX_CASCADE * XTS_CIPHER_KEY_SIZE];
+
+typedef struct
+{
+    double encryptBytesPerSec[2];	/* one thread, all the cores */
+    double decryptBytesPerSec[2];
+} CIPHER_THROUGHPUT;
+
+// bytes per second of XTS encryption or decryption with the algorithm, each thread having its own buffer
+static double MeasureXts (int ea, BOOL bEncrypt, unsigned int threadCount)
+{
+    std::atomic<unsigned __int64> totalBytes (0);
+    std::vector<std::thread> workers;
+    unsigned __int64 startNs, endNs, elapsedNs;
+
+    // the tables of the ciphers are computed on first use: not in the timed run
+    delete CreateXtsCascade (ea, g_BenchKey);
+
+    startNs = GetTimestampNs ();
+    endNs = startNs + CIPHERBENCH_RUN_NS;
+    for (unsigned int t = 0; t < threadCount; t++)
+    {
+        workers.push_back (std::thread ([ea, bEncrypt, endNs, &totalBytes] ()
+        {
+            std::vector<unsigned char> buffer (CIPHERBENCH_BUFFER_SIZE);
+            CXtsCascade* pCascade = CreateXtsCascade (ea, g_BenchKey);
+            unsigned __int64 unitNo = 0, cbDone = 0;
+
+            do
+            {
+                if (bEncrypt)
+                    pCascade->Encrypt (&buffer[0], buffer.size (), unitNo);
+                else
+                    pCascade->Decrypt (&buffer[0], buffer.size (), unitNo);
+                unitNo += buffer.size () / XTS_DATA_UNIT_SIZE;
+                cbDone += buffer.size ();
+            } while (GetTimestampNs () < endNs);
+
+            totalBytes += cbDone;
+            delete pCascade;
+        }));
+    }
+    for (size_t t = 0; t < workers.size (); t++)
+        workers[t].join ();
+
+    elapsedNs = GetTimestampNs () - startNs;
+    return (double) totalBytes * 1000000000.0 / (double) elapsedNs;
+}
+
+static void PrintRateColumn (double dBytesPerSec)
+{
+    TCHAR szRate[32];
+    FormatRate (dBytesPerSec, szRate, ARRAYSIZE (szRate));
+    _tprintf (TEXT(" %13s"), szRate);
+}
+
+int RunCipherBench (CVcDriver& driver, DWORD dwObserveMs)
+{
+    static VOLUME_SAMPLE samples[2];
+    CIPHER_THROUGHPUT throughput[CIPHERBENCH_EA_COUNT + 1];
+    unsigned int coreCount = std::max (1u, std::thread::hardware_concurrency ());
+    int columns = (coreCount > 1)? 2 : 1;
+    BOOL bVolumes = FALSE;
+
+    for (size_t i = 0; i < sizeof (g_BenchKey); i++)
+        g_BenchKey[i] = (unsigned char) (i * 37 + 11);
+
+    // the I/O is observed first, so that the benchmark doesn't take the CPU from the volumes
+    if (!SampleVolumes (driver, samples[0]))
+    {
+        _tprintf (TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr (GetLastError ()));
+        return VC_STATUS_DRIVER_CALL_FAILED;
+    }
+    _tprintf (TEXT("Observing the I/O of the mounted volumes for %.1f seconds...\n"), (double) dwObserveMs / 1000.0);
+    Sleep (dwObserveMs);
+    if (!SampleVolumes (driver, samples[1]))
+    {
+        _tprintf (TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr (GetLastError ()));
+        return VC_STATUS_DRIVER_CALL_FAILED;
+    }
+
+    _tprintf (TEXT("\nXTS throughput on this machine (%s):\n"), GetXtsImplementations ());
+    _tprintf (TEXT("   %-29s %13s %13s"), TEXT("Algorithm"), TEXT("Encrypt 1T"), TEXT("Decrypt 1T"));
+    if (columns > 1)
+        _tprintf (TEXT(" %10s %2uT %10s %2uT"), TEXT("Encrypt"), coreCount, TEXT("Decrypt"), coreCount);
+    _tprintf (TEXT("\n"));
+    for (int ea = 1; ea <= CIPHERBENCH_EA_COUNT; ea++)
+    {
+        CIPHER_THROUGHPUT& t = throughput[ea];
+
+        memset (&t, 0, sizeof (t));
+        _tprintf (TEXT("   %-29s"), GetEncryptionAlgorithmName (ea));
+        if (GetEaCipherCount (ea) == 0)
+        {
+            _tprintf (TEXT(" not supported\n"));
+            continue;
+        }
+        for (int c = 0; c < columns; c++)
+        {
+            unsigned int threadCount = c? coreCount : 1;
+            t.encryptBytesPerSec[c] = MeasureXts (ea, TRUE, threadCount);
+            t.decryptBytesPerSec[c] = MeasureXts (ea, FALSE, threadCount);
+            PrintRateColumn (t.encryptBytesPerSec[c]);
+            PrintRateColumn (t.decryptBytesPerSec[c]);
+        }
+        _tprintf (TEXT("\n"));
+    }
+
+    // reads are decrypted and writes encrypted by the driver on all the cores
+    _tprintf (TEXT("\nMounted volumes:\n"));
+    _tprintf (TEXT("   %-5s %-29s %13s %13s %11s  %s\n"), TEXT("Drive"), TEXT("Algorithm"), TEXT("Read"), TEXT("Write"), TEXT("Cipher load"), TEXT("Bound"));
+    for (int i = 0; i < 26; i++)
+    {
+        const VOLUME_PROPERTIES_STRUCT& prop = samples[1].prop[i];
+        VOLUME_DELTA delta;
+
+        if ((samples[1].ulMountedDrives & (1 << i)) == 0)
+            continue;
+        bVolumes = TRUE;
+        ComputeVolumeDelta (samples[0], samples[1], i, delta);
+        _tprintf (TEXT("   %c:    %-29s"), TEXT('A') + i, GetEncryptionAlgorithmName (prop.ea));
+        if (delta.change == VOLUME_TIMED_OUT)
+        {
+            _tprintf (TEXT(" properties timed out during the observation\n"));
+            continue;
+        }
+        if (delta.change != VOLUME_UNCHANGED)
+        {
+            _tprintf (TEXT(" mounted during the observation\n"));
+            continue;
+        }
+
+        PrintRateColumn (delta.readBytesPerSec);
+        PrintRateColumn (delta.writtenBytesPerSec);
+        if (prop.ea < 1 || prop.ea > CIPHERBENCH_EA_COUNT || GetEaCipherCount (prop.ea) == 0)
+            _tprintf (TEXT(" %11s  %s\n"), TEXT("-"), TEXT("algorithm not benchmarked"));
+        else if (delta.readBytesPerSec == 0 && delta.writtenBytesPerSec == 0)
+            _tprintf (TEXT(" %10.1f%%  %s\n"), 0.0, TEXT("idle"));
+        else
+        {
+            const CIPHER_THROUGHPUT& t = throughput[prop.ea];
+            double dLoad = 100.0 * (delta.readBytesPerSec / t.decryptBytesPerSec[columns - 1]
+                + delta.writtenBytesPerSec / t.encryptBytesPerSec[columns - 1]);
+            _tprintf (TEXT(" %10.1f%%  %s\n"), dLoad, (dLoad >= CIPHERBENCH_BOUND_PERCENT)? TEXT("cipher") : TEXT("storage"));
+        }
+    }
+    if (!bVolumes)
+        _tprintf (TEXT("   No mounted volume.\n"));
+
+    return VC_STATUS_OK;
+}
@@ -0,0 +1,15 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+
+// Cipher throughput against the I/O of the mounted volumes (/cipherbench): the read/write rates of
+// the volumes are observed for dwObserveMs, then XTS encryption and decryption are benchmarked for
+// every encryption algorithm on one thread and on all the cores, and each volume is reported as
+// cipher-bound when its I/O uses most of the throughput of its algorithm.
+int RunCipherBench (CVcDriver& driver, DWORD dwObserveMs);
@@ -0,0 +1,43 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "defs.h"
+
+// XTS encryption with the ciphers of VeraCrypt, used to measure their throughput on this machine.
+// AES uses AES-NI and Serpent runs on 4 blocks at once with SSE2 on x64, the other ciphers use tables.
+
+#define XTS_DATA_UNIT_SIZE		512
+// key material of each cipher of a cascade: primary and secondary (tweak) 256-bit keys. As in a
+// volume header, the primary keys of all the ciphers come first, then their secondary keys.
+#define XTS_CIPHER_KEY_SIZE		64
+#define XTS_MAX_CASCADE			3
+
+// Encryption algorithm (ea field of the volume properties) in XTS mode. The ciphers of a cascade
+// are applied one after the other to the whole buffer, like VeraCrypt does.
+class CXtsCascade
+{
+public:
+	virtual ~CXtsCascade () {}
+	// cbData is a multiple of XTS_DATA_UNIT_SIZE, unitNo the number of the first data unit
+	virtual void Encrypt (unsigned char* pbData, size_t cbData, unsigned __int64 unitNo) = 0;
+	virtual void Decrypt (unsigned char* pbData, size_t cbData, unsigned __int64 unitNo) = 0;
+};
+
+// number of ciphers of the encryption algorithm, 0 if it is unknown or not supported (GOST89,
+// a 64-bit block cipher removed from VeraCrypt 1.19)
+int GetEaCipherCount (int ea);
+
+// pbKey: GetEaCipherCount (ea) * XTS_CIPHER_KEY_SIZE bytes. NULL if the algorithm is not supported.
+CXtsCascade* CreateXtsCascade (int ea, const unsigned char* pbKey);
+
+// Known answer tests of the block ciphers and of XTS, alone and in a cascade: NULL if all of them
+// passed, else the name of the first one that failed.
+LPCTSTR TestXtsCiphers ();
+
+// implementations selected for this processor, e.g. "AES-NI, Serpent SSE2"
+LPCTSTR GetXtsImplementations ();
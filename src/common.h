@@ -0,0 +1,34 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "defs.h"
+#include "verastatus.h"
+
+// Exit codes values
+#define VC_STATUS_OK                    0
+#define VC_STATUS_NO_DRIVER             -1
+#define VC_STATUS_DRIVER_CALL_FAILED    -2
+#define VC_STATUS_INVALID_PARAMETER     -3
+#define VC_STATUS_DRIVER_TIMEOUT        -4
+#define VC_STATUS_SYSENC_PARTIAL         1
+#define VC_STATUS_SYSENC_NONE            2
+#define VC_STATUS_NOT_VOLUME             3
+#define VC_STATUS_SNAPSHOT_INCONSISTENT  4
+#define VC_STATUS_SYSENC_STALLED         5
+#define VC_STATUS_ALERT_WARNING          6
+#define VC_STATUS_ALERT_CRITICAL         7
+#define VC_STATUS_SELF_TEST_FAILED       8	/* /selftest, not documented */
+
+LPTSTR GetWin32ErrorStr (DWORD dwError);
+eSysEncState GetSystemEncryptionState (BootEncryptionStatus& status);
+double GetSystemEncryptionPercentage (BootEncryptionStatus& status, eSysEncState state);
+LPCTSTR GetEncryptionAlgorithmName (int ea);
+LPCTSTR GetPrfAlgorithmName (int pkcs5);
+eSysEncState PrintSystemEncryptionInformation (BootEncryptionStatus& status, DWORD cbSize);
+void PrintVolumeInformation (VOLUME_PROPERTIES_STRUCT& prop);
+void FormatRate (double dBytesPerSec, TCHAR* szOut, size_t cchOut);
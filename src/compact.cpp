@@ -0,0 +1,200 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "compact.h"
+#include "schema.h"
+
+#define COMPACT_BOOT_STATUS		0x01
+#define COMPACT_BOOT_LOADER		0x02
+#define COMPACT_BOOT_DRIVE		0x04
+#define COMPACT_CONSISTENT		0x08
+
+// sequential writer and reader over a buffer, failing once the end is reached
+typedef struct
+{
+    unsigned char* p;
+    unsigned char* pEnd;
+} COMPACT_WRITER;
+
+typedef struct
+{
+    const unsigned char* p;
+    const unsigned char* pEnd;
+} COMPACT_READER;
+
+static BOOL Put (COMPACT_WRITER& w, const void* pData, size_t cbData)
+{
+    if ((size_t) (w.pEnd - w.p) < cbData)
+        return FALSE;
+    memcpy (w.p, pData, cbData);
+    w.p += cbData;
+    return TRUE;
+}
+
+static BOOL Get (COMPACT_READER& r, void* pData, size_t cbData)
+{
+    if ((size_t) (r.pEnd - r.p) < cbData)
+        return FALSE;
+    memcpy (pData, r.p, cbData);
+    r.p += cbData;
+    return TRUE;
+}
+
+// raw fields of pStruct ending within cbStruct, in the order of the schema, preceded by the size of the encoding
+static BOOL PutStruct (COMPACT_WRITER& w, const STRUCT_SCHEMA& schema, const void* pStruct, size_t cbStruct)
+{
+    unsigned char* pSize = w.p;
+    UINT16 cbEncoded;
+
+    if (!Put (w, "\0\0", 2))
+        return FALSE;
+
+    for (size_t i = 0; i < schema.fieldCount; i++)
+    {
+        const FIELD_DESC& field = schema.pFields[i];
+        const unsigned char* pField = (const unsigned char*) pStruct + field.offset;
+
+        if (!(field.flags & FIELD_RAW))
+            continue;
+
+        if ((size_t) field.offset + field.size > cbStruct)
+            break;
+
+        if (field.kind == FIELD_WSTRING)
+        {
+            const WCHAR* wszValue = (const WCHAR*) pField;
+            UINT16 cch = 0;
+            while (cch < field.size / sizeof (WCHAR) && wszValue[cch])
+                cch++;
+            if (!Put (w, &cch, sizeof (cch)) || !Put (w, wszValue, cch * sizeof (WCHAR)))
+                return FALSE;
+        }
+        else if (!Put (w, pField, field.size))
+            return FALSE;
+    }
+
+    cbEncoded = (UINT16) (w.p - pSize - 2);
+    memcpy (pSize, &cbEncoded, sizeof (cbEncoded));
+    return TRUE;
+}
+
+// zeroes pStruct, then fills the fields present in the encoding
+static BOOL GetStruct (COMPACT_READER& r, const STRUCT_SCHEMA& schema, void* pStruct, size_t cbStruct)
+{
+    UINT16 cbEncoded;
+    COMPACT_READER s;
+
+    memset (pStruct, 0, cbStruct);
+    if (!Get (r, &cbEncoded, sizeof (cbEncoded)) || (size_t) (r.pEnd - r.p) < cbEncoded)
+        return FALSE;
+    s.p = r.p;
+    s.pEnd = r.p + cbEncoded;
+    r.p += cbEncoded;
+
+    for (size_t i = 0; i < schema.fieldCount && s.p < s.pEnd; i++)
+    {
+        const FIELD_DESC& field = schema.pFields[i];
+        unsigned char* pField = (unsigned char*) pStruct + field.offset;
+
+        if (!(field.flags & FIELD_RAW))
+            continue;
+
+        if ((size_t) field.offset + field.size > cbStruct)
+            break;
+
+        if (field.kind == FIELD_WSTRING)
+        {
+            UINT16 cch;
+            if (!Get (s, &cch, sizeof (cch)) || cch > field.size / sizeof (WCHAR) || !Get (s, pField, cch * sizeof (WCHAR)))
+                return FALSE;
+        }
+        else if (!Get (s, pField, field.size))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+size_t EncodeSnapshot (const VC_SNAPSHOT& snapshot, unsigned char* pbOut, size_t cbOut)
+{
+    COMPACT_WRITER w = { pbOut, pbOut + cbOut };
+    unsigned char version = VC_COMPACT_VERSION;
+    unsigned char flags = 0;
+    UINT16 cbBootStatus = (UINT16) (snapshot.bBootStatusValid? snapshot.cbBootStatus : 0);
+    BOOL bResult;
+
+    if (snapshot.bBootStatusValid)
+        flags |= COMPACT_BOOT_STATUS;
+    if (snapshot.bBootLoaderVersionValid)
+        flags |= COMPACT_BOOT_LOADER;
+    if (snapshot.bBootDrivePropValid)
+        flags |= COMPACT_BOOT_DRIVE;
+    if (snapshot.bConsistent)
+        flags |= COMPACT_CONSISTENT;
+
+    bResult = Put (w, &version, 1) && Put (w, &flags, 1) && Put (w, &cbBootStatus, 2)
+        && Put (w, &snapshot.volumes.ulListedDrives, 4)
+        && Put (w, &snapshot.volumes.ulMountedDrives, 4)
+        && Put (w, &snapshot.ulFinalMountedDrives, 4)
+        && Put (w, &snapshot.volumes.timestampUs, 8);
+
+    if (bResult && snapshot.bBootStatusValid)
+        bResult = PutStruct (w, g_BootEncryptionStatusSchema, &snapshot.bootStatus, snapshot.cbBootStatus);
+    if (bResult && snapshot.bBootLoaderVersionValid)
+        bResult = Put (w, &snapshot.bootLoaderVersion, sizeof (snapshot.bootLoaderVersion));
+    if (bResult && snapshot.bBootDrivePropValid)
+        bResult = PutStruct (w, g_VolumePropertiesSchema, &snapshot.bootDriveProp, sizeof (snapshot.bootDriveProp));
+
+    for (int i = 0; bResult && i < 26; i++)
+    {
+        if (snapshot.volumes.ulMountedDrives & (1 << i))
+            bResult = PutStruct (w, g_VolumePropertiesSchema, &snapshot.volumes.prop[i], sizeof (snapshot.volumes.prop[i]));
+    }
+
+    return bResult? (size_t) (w.p - pbOut) : 0;
+}
+
+BOOL DecodeSnapshot (const unsigned char* pbData, size_t cbData, VC_SNAPSHOT& snapshot)
+{
+    COMPACT_READER r = { pbData, pbData + cbData };
+    unsigned char version = 0, flags = 0;
+    UINT16 cbBootStatus;
+    BOOL bResult;
+
+    memset (&snapshot, 0, sizeof (snapshot));
+    bResult = Get (r, &version, 1) && version == VC_COMPACT_VERSION
+        && Get (r, &flags, 1) && Get (r, &cbBootStatus, 2)
+        && Get (r, &snapshot.volumes.ulListedDrives, 4)
+        && Get (r, &snapshot.volumes.ulMountedDrives, 4)
+        && Get (r, &snapshot.ulFinalMountedDrives, 4)
+        && Get (r, &snapshot.volumes.timestampUs, 8);
+
+    snapshot.bConsistent = (flags & COMPACT_CONSISTENT)? TRUE : FALSE;
+    if (bResult && (flags & COMPACT_BOOT_STATUS))
+    {
+        snapshot.bBootStatusValid = TRUE;
+        snapshot.cbBootStatus = (cbBootStatus > sizeof (BootEncryptionStatus))? sizeof (BootEncryptionStatus) : cbBootStatus;
+        bResult = GetStruct (r, g_BootEncryptionStatusSchema, &snapshot.bootStatus, snapshot.cbBootStatus);
+    }
+    if (bResult && (flags & COMPACT_BOOT_LOADER))
+    {
+        snapshot.bBootLoaderVersionValid = TRUE;
+        bResult = Get (r, &snapshot.bootLoaderVersion, sizeof (snapshot.bootLoaderVersion));
+    }
+    if (bResult && (flags & COMPACT_BOOT_DRIVE))
+    {
+        snapshot.bBootDrivePropValid = TRUE;
+        bResult = GetStruct (r, g_VolumePropertiesSchema, &snapshot.bootDriveProp, sizeof (snapshot.bootDriveProp));
+    }
+
+    for (int i = 0; bResult && i < 26; i++)
+    {
+        if (snapshot.volumes.ulMountedDrives & (1 << i))
+            bResult = GetStruct (r, g_VolumePropertiesSchema, &snapshot.volumes.prop[i], sizeof (snapshot.volumes.prop[i]));
+    }
+
+    return bResult;
+}
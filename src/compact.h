@@ -0,0 +1,30 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "snapshot.h"
+
+// Compact binary encoding of a VC_SNAPSHOT, used by the history log.
+// Only mounted volumes are stored, strings are stored up to their terminating NUL and the
+// system encryption status up to the size returned by the driver, so the short structure of
+// drivers older than 1.26.13 is decoded with the same cbBootStatus. Integers are little-endian.
+//
+// Layout: version (1 byte), flags (1 byte), cbBootStatus (2 bytes), ulListedDrives,
+// ulMountedDrives, ulFinalMountedDrives (4 bytes each), timestampUs (8 bytes), then the boot
+// status, the bootloader version, the boot drive and the mounted volumes in drive order when
+// present. Structures are stored as a 2 bytes size followed by their fields in declaration order:
+// fields are only ever appended so that decoders skip the ones they don't know.
+
+#define VC_COMPACT_VERSION		1
+#define VC_COMPACT_HEADER_SIZE	24
+
+// largest possible encoding: every string is shorter than its array
+#define VC_COMPACT_MAX_SIZE		(VC_COMPACT_HEADER_SIZE + 2 + sizeof (BootEncryptionStatus) + sizeof (UINT16) + 27 * (2 + 2 * 2 + sizeof (VOLUME_PROPERTIES_STRUCT)))
+
+// returns the size of the encoding, 0 if cbOut is too small
+size_t EncodeSnapshot (const VC_SNAPSHOT& snapshot, unsigned char* pbOut, size_t cbOut);
+BOOL DecodeSnapshot (const unsigned char* pbData, size_t cbData, VC_SNAPSHOT& snapshot);
@@ -0,0 +1,86 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+// Implementation of the non-Windows compatibility layer (see compat.h)
+
+#include "defs.h"
+#include "utf8.h"
+
+#ifndef _WIN32
+
+#include <stdarg.h>
+
+static thread_local DWORD g_dwLastError = 0;
+
+DWORD GetLastError (void)
+{
+    return g_dwLastError;
+}
+
+void SetLastError (DWORD dwError)
+{
+    g_dwLastError = dwError;
+}
+
+// replace the MSVC specific "%I64" length modifier by its C99 equivalent "%ll"
+static const char* TranslateFormat (const char* szFormat, char* szBuffer, size_t cbBuffer)
+{
+    if (!strstr (szFormat, "I64"))
+        return szFormat;
+
+    size_t j = 0;
+    for (size_t i = 0; szFormat[i] && j + 3 < cbBuffer; i++)
+    {
+        szBuffer[j++] = szFormat[i];
+        if (szFormat[i] == '%')
+        {
+            // copy flags, width and precision
+            while (szFormat[i + 1] && strchr ("-+ #0123456789.", szFormat[i + 1]) && j + 3 < cbBuffer)
+                szBuffer[j++] = szFormat[++i];
+            if (strncmp (&szFormat[i + 1], "I64", 3) == 0)
+            {
+                szBuffer[j++] = 'l';
+                szBuffer[j++] = 'l';
+                i += 3;
+            }
+        }
+    }
+    szBuffer[j] = 0;
+    return szBuffer;
+}
+
+int _tprintf (const char* szFormat, ...)
+{
+    char szTranslated[1024];
+    va_list args;
+    va_start (args, szFormat);
+    int iRet = vprintf (TranslateFormat (szFormat, szTranslated, sizeof (szTranslated)), args);
+    va_end (args);
+    return iRet;
+}
+
+int StringCchPrintf (char* szDest, size_t cchDest, const char* szFormat, ...)
+{
+    char szTranslated[1024];
+    va_list args;
+    va_start (args, szFormat);
+    int iRet = vsnprintf (szDest, cchDest, TranslateFormat (szFormat, szTranslated, sizeof (szTranslated)), args);
+    va_end (args);
+    return iRet;
+}
+
+const char* WideToUtf8Tmp (const WCHAR* wsz)
+{
+    static thread_local char g_szBuffers[4][1024];
+    static thread_local int g_iNext = 0;
+    char* szOut = g_szBuffers[g_iNext];
+
+    g_iNext = (g_iNext + 1) % 4;
+    Utf16ToUtf8 (wsz, (size_t) -1, szOut, sizeof (g_szBuffers[0]));
+    return szOut;
+}
+
+#endif
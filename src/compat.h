@@ -0,0 +1,198 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+// Minimal Win32 compatibility layer used when VeraStatus is built on non-Windows
+// platforms (e.g. Linux build machines) against a simulated driver backend.
+// Only the subset of the Win32 API actually used by VeraStatus is provided.
+
+#pragma once
+
+#ifdef _WIN32
+
+// wide strings coming from the driver can be printed directly with %s in Unicode builds
+#define VC_WSTR(s)	(s)
+
+// high resolution timestamp in microseconds
+static inline unsigned __int64 GetTimestampUs ()
+{
+	static LARGE_INTEGER freq = {0};
+	LARGE_INTEGER now;
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency (&freq);
+	QueryPerformanceCounter (&now);
+	return (unsigned __int64) ((now.QuadPart / freq.QuadPart) * 1000000 + ((now.QuadPart % freq.QuadPart) * 1000000) / freq.QuadPart);
+}
+
+// same clock in nanoseconds, for latency tracing
+static inline unsigned __int64 GetTimestampNs ()
+{
+	static LARGE_INTEGER freq = {0};
+	LARGE_INTEGER now;
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency (&freq);
+	QueryPerformanceCounter (&now);
+	return (unsigned __int64) ((now.QuadPart / freq.QuadPart) * 1000000000 + ((now.QuadPart % freq.QuadPart) * 1000000000) / freq.QuadPart);
+}
+
+// wall clock time in microseconds since 1970-01-01 UTC
+static inline unsigned __int64 GetSystemTimeUs ()
+{
+	FILETIME ft;
+	GetSystemTimeAsFileTime (&ft);
+	return ((((unsigned __int64) ft.dwHighDateTime << 32) | ft.dwLowDateTime) - 116444736000000000ULL) / 10;
+}
+
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <wchar.h>
+#include <time.h>
+#include <unistd.h>
+
+#define __int64	long long
+#define __int32	int
+
+typedef int BOOL;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint16_t UINT16;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef unsigned int UINT;
+typedef unsigned long long ULONGLONG;
+typedef void* HANDLE;
+typedef void* LPVOID;
+typedef DWORD* LPDWORD;
+typedef uint16_t WCHAR;
+
+typedef union
+{
+	struct
+	{
+		DWORD LowPart;
+		LONG HighPart;
+	} u;
+	long long QuadPart;
+} LARGE_INTEGER;
+
+#ifndef TRUE
+#define TRUE	1
+#define FALSE	0
+#endif
+
+// TCHAR is always narrow (UTF-8) outside Windows
+typedef char TCHAR;
+typedef TCHAR* LPTSTR;
+typedef const TCHAR* LPCTSTR;
+
+#define TEXT(x)		x
+#define _T(x)		x
+#define _tmain		main
+#define _tcslen		strlen
+#define _tcscmp		strcmp
+#define _tcsicmp	strcasecmp
+#define _tcsnicmp	strncasecmp
+#define _tcschr		strchr
+#define _tcstol		strtol
+#define _tcstoul	strtoul
+#define _tcstod		strtod
+#define _totupper	toupper
+#define _puttchar	putchar
+#define _fputts		fputs
+#define _tfopen		fopen
+
+#define ARRAYSIZE(a)	(sizeof (a) / sizeof ((a)[0]))
+#define INVALID_HANDLE_VALUE	((HANDLE) (intptr_t) -1)
+#define VK_BACK		0x08
+#define INFINITE	0xFFFFFFFF
+
+#define FILE_DEVICE_UNKNOWN		0x00000022
+#define METHOD_BUFFERED			0
+#define FILE_ANY_ACCESS			0
+#define CTL_CODE(DeviceType, Function, Method, Access) (((DeviceType) << 16) | ((Access) << 14) | ((Function) << 2) | (Method))
+
+#define ERROR_SUCCESS				0
+#define ERROR_FILE_NOT_FOUND		2
+#define ERROR_NOT_ENOUGH_MEMORY		8
+#define ERROR_INVALID_FUNCTION		1
+#define ERROR_NOT_SUPPORTED			50
+#define ERROR_INVALID_PARAMETER		87
+#define ERROR_INSUFFICIENT_BUFFER	122
+#define ERROR_MORE_DATA				234
+#define ERROR_TIMEOUT				1460
+
+// C linkage: also used by the C callers of libverastatus
+#ifdef __cplusplus
+extern "C" {
+#endif
+DWORD GetLastError (void);
+void SetLastError (DWORD dwError);
+#ifdef __cplusplus
+}
+#endif
+
+// Only the implementation of VeraStatus (C++) uses these: C callers of libverastatus including
+// this file through verastatus.h don't need the feature macros of usleep and clock_gettime.
+#ifdef __cplusplus
+static inline void Sleep (DWORD dwMilliseconds)
+{
+	usleep ((useconds_t) dwMilliseconds * 1000);
+}
+
+static inline unsigned __int64 GetTimestampUs ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (unsigned __int64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline unsigned __int64 GetTimestampNs ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (unsigned __int64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline unsigned __int64 GetSystemTimeUs ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_REALTIME, &ts);
+	return (unsigned __int64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+// printf family accepting the MSVC "%I64" length modifier used throughout VeraStatus
+int _tprintf (const char* szFormat, ...);
+int StringCchPrintf (char* szDest, size_t cchDest, const char* szFormat, ...);
+#define StringCbPrintf	StringCchPrintf
+#define StringCchPrintfA	StringCchPrintf
+#define StringCbPrintfA	StringCchPrintf
+
+// convert a NUL terminated UTF-16 string returned by the driver to UTF-8 for printing.
+// The result lives in a small per-thread ring of buffers.
+const char* WideToUtf8Tmp (const WCHAR* wsz);
+#define VC_WSTR(s)	WideToUtf8Tmp (s)
+
+#endif
+
+#ifdef __cplusplus
+// Sleep until nextUs + dwIntervalMs (GetTimestampUs clock) and advance nextUs, so that a periodic
+// loop doesn't drift. A deadline already passed restarts the period from now.
+static inline void SleepUntilNext (unsigned __int64& nextUs, DWORD dwIntervalMs)
+{
+	unsigned __int64 nowUs = GetTimestampUs ();
+	nextUs += (unsigned __int64) dwIntervalMs * 1000;
+	if (nextUs > nowUs)
+		Sleep ((DWORD) ((nextUs - nowUs) / 1000));
+	else
+		nextUs = nowUs;
+}
+#endif
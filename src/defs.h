@@ -13,12 +13,16 @@
 
 #pragma once
 
+#ifdef _WIN32
 #define	_WIN32_WINNT 0x0501
 #define WINVER _WIN32_WINNT
 
 #include <windows.h>
 #include <stdio.h>
 #include <tchar.h>
+#endif
+
+#include "compat.h"
 
 
 #define VC_IOCTL(CODE) (CTL_CODE (FILE_DEVICE_UNKNOWN, 0x800 + (CODE), METHOD_BUFFERED, FILE_ANY_ACCESS))
@@ -34,15 +38,27 @@
 
 #define VOLUME_ID_SIZE	32
 
+// MOUNT_LIST_STRUCT.volumeType
+#define PROP_VOL_TYPE_NORMAL						0
+#define PROP_VOL_TYPE_HIDDEN						1
+#define PROP_VOL_TYPE_OUTER							2	/* outer volume with hidden volume protection */
+#define PROP_VOL_TYPE_OUTER_VOL_WRITE_PREVENTED		3	/* the protection blocked a write to the hidden volume area */
+#define PROP_VOL_TYPE_SYSTEM						4
+
+// VOLUME_PROPERTIES_STRUCT.hiddenVolProtection
+#define HIDVOL_PROT_STATUS_NONE						0
+#define HIDVOL_PROT_STATUS_ACTIVE					1
+#define HIDVOL_PROT_STATUS_ACTION_TAKEN				2
+
 #pragma pack (push)
 #pragma pack(1)
 
 typedef struct
 {
 	unsigned __int32 ulMountedDrives;	/* Bitfield of all mounted drive letters */
-	wchar_t wszVolume[26][260];	/* Volume names of mounted volumes */
-	wchar_t wszLabel[26][33];	/* Labels of mounted volumes */
-	wchar_t volumeID[26][VOLUME_ID_SIZE];	/* IDs of mounted volumes */
+	WCHAR wszVolume[26][260];	/* Volume names of mounted volumes */
+	WCHAR wszLabel[26][33];	/* Labels of mounted volumes */
+	WCHAR volumeID[26][VOLUME_ID_SIZE];	/* IDs of mounted volumes */
 	unsigned __int64 diskLength[26];
 	int ea[26];
 	int volumeType[26];	/* Volume type (e.g. PROP_VOL_TYPE_OUTER, PROP_VOL_TYPE_OUTER_VOL_WRITE_PREVENTED, etc.) */
@@ -97,7 +113,7 @@ typedef struct
 {
 	int driveNo;
 	int uniqueId;
-	wchar_t wszVolume[260];
+	WCHAR wszVolume[260];
 	unsigned __int64 diskLength;
 	int ea;
 	int mode;
@@ -113,7 +129,7 @@ typedef struct
 	int hiddenVolProtection;
 	int volFormatVersion;
 	int volumePim;
-	wchar_t wszLabel[33];
+	WCHAR wszLabel[33];
 	BOOL bDriverSetLabel;
 	unsigned char volumeID[VOLUME_ID_SIZE];
 	BOOL mountDisabled;
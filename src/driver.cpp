@@ -0,0 +1,717 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "driver.h"
+#include "replay.h"
+#include "linuxdrv.h"
+#include "trace.h"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <vector>
+
+void InitDriverCall (VC_DRIVER_CALL& call, DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize)
+{
+    memset (&call, 0, sizeof (call));
+    call.dwIoControlCode = dwIoControlCode;
+    call.lpInBuffer = lpInBuffer;
+    call.nInBufferSize = nInBufferSize;
+    call.lpOutBuffer = lpOutBuffer;
+    call.nOutBufferSize = nOutBufferSize;
+}
+
+// Calls of a batch made on their own threads. The threads of the calls that time out keep running
+// after IoControlBatch returns: they only use this state, which they share, and private buffers.
+struct VC_BATCH_STATE
+{
+    std::mutex mutex;
+    std::condition_variable completed;
+    size_t pending;
+    std::vector<VC_DRIVER_CALL> calls;
+    std::vector<bool> done;
+    std::vector<std::vector<unsigned char> > inBuffers;
+    std::vector<std::vector<unsigned char> > outBuffers;
+};
+
+static void RunBatchCall (CVcDriver* pDriver, std::shared_ptr<VC_BATCH_STATE> pState, size_t i)
+{
+    VC_DRIVER_CALL call = pState->calls[i];
+    unsigned __int64 startNs = GetTimestampNs ();
+    BOOL bResult = pDriver->IoControl (call.dwIoControlCode, call.lpInBuffer, call.nInBufferSize, call.lpOutBuffer, call.nOutBufferSize, &call.cbReturned);
+    DWORD dwError = bResult? ERROR_SUCCESS : GetLastError ();
+    unsigned __int64 endNs = GetTimestampNs ();
+
+    std::lock_guard<std::mutex> lock (pState->mutex);
+    pState->calls[i].startNs = startNs;
+    pState->calls[i].endNs = endNs;
+    pState->calls[i].bResult = bResult;
+    pState->calls[i].dwError = dwError;
+    pState->calls[i].cbReturned = call.cbReturned;
+    pState->done[i] = true;
+    pState->pending--;
+    pState->completed.notify_all ();
+}
+
+BOOL CVcDriver::IoControlBatch (VC_DRIVER_CALL* pCalls, size_t count, DWORD dwTimeoutMs)
+{
+    if (dwTimeoutMs == INFINITE)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            VC_DRIVER_CALL& call = pCalls[i];
+            call.startNs = GetTimestampNs ();
+            call.bResult = IoControl (call.dwIoControlCode, call.lpInBuffer, call.nInBufferSize, call.lpOutBuffer, call.nOutBufferSize, &call.cbReturned);
+            call.dwError = call.bResult? ERROR_SUCCESS : GetLastError ();
+            call.endNs = GetTimestampNs ();
+        }
+        return TRUE;
+    }
+
+    std::shared_ptr<VC_BATCH_STATE> pState = std::make_shared<VC_BATCH_STATE> ();
+    BOOL bCompleted = TRUE;
+
+    pState->pending = count;
+    pState->calls.assign (pCalls, pCalls + count);
+    pState->done.assign (count, false);
+    pState->inBuffers.resize (count);
+    pState->outBuffers.resize (count);
+    for (size_t i = 0; i < count; i++)
+    {
+        VC_DRIVER_CALL& call = pState->calls[i];
+        call.startNs = GetTimestampNs ();
+        // the output buffer keeps its content, as when the call is made directly
+        if (call.lpInBuffer && call.nInBufferSize)
+            pState->inBuffers[i].assign ((unsigned char*) call.lpInBuffer, (unsigned char*) call.lpInBuffer + call.nInBufferSize);
+        if (call.lpOutBuffer && call.nOutBufferSize)
+            pState->outBuffers[i].assign ((unsigned char*) call.lpOutBuffer, (unsigned char*) call.lpOutBuffer + call.nOutBufferSize);
+        call.lpInBuffer = pState->inBuffers[i].empty ()? NULL : &pState->inBuffers[i][0];
+        call.lpOutBuffer = pState->outBuffers[i].empty ()? NULL : &pState->outBuffers[i][0];
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        try
+        {
+            std::thread (RunBatchCall, this, pState, i).detach ();
+        }
+        catch (const std::system_error&)
+        {
+            std::lock_guard<std::mutex> lock (pState->mutex);
+            pState->calls[i].dwError = ERROR_NOT_ENOUGH_MEMORY;
+            pState->done[i] = true;
+            pState->pending--;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock (pState->mutex);
+    pState->completed.wait_for (lock, std::chrono::milliseconds (dwTimeoutMs), [&pState] { return pState->pending == 0; });
+    for (size_t i = 0; i < count; i++)
+    {
+        VC_DRIVER_CALL& call = pCalls[i];
+        if (pState->done[i])
+        {
+            call.startNs = pState->calls[i].startNs;
+            call.endNs = pState->calls[i].endNs;
+            call.bResult = pState->calls[i].bResult;
+            call.dwError = pState->calls[i].dwError;
+            call.cbReturned = pState->calls[i].cbReturned;
+            if (!pState->outBuffers[i].empty ())
+                memcpy (call.lpOutBuffer, &pState->outBuffers[i][0], call.nOutBufferSize);
+        }
+        else
+        {
+            call.startNs = pState->calls[i].startNs;
+            call.endNs = GetTimestampNs ();
+            call.bResult = FALSE;
+            call.dwError = ERROR_TIMEOUT;
+            call.cbReturned = 0;
+            bCompleted = FALSE;
+        }
+    }
+
+    return bCompleted;
+}
+
+#ifdef _WIN32
+
+CWin32Driver::~CWin32Driver ()
+{
+    if (m_hDriver != INVALID_HANDLE_VALUE)
+        CloseHandle (m_hDriver);
+}
+
+BOOL CWin32Driver::IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    OVERLAPPED ov;
+    BOOL bResult;
+    DWORD dwError;
+
+    memset (&ov, 0, sizeof (ov));
+    ov.hEvent = CreateEvent (NULL, TRUE, FALSE, NULL);
+    if (!ov.hEvent)
+        return FALSE;
+
+    bResult = DeviceIoControl (m_hDriver, dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize, lpBytesReturned, &ov);
+    if (!bResult && GetLastError () == ERROR_IO_PENDING)
+        bResult = GetOverlappedResult (m_hDriver, &ov, lpBytesReturned, TRUE);
+
+    dwError = GetLastError ();
+    CloseHandle (ov.hEvent);
+    SetLastError (dwError);
+    return bResult;
+}
+
+// overlapped call with private buffers (input then output), which the driver may write to until it
+// completes the call: a call that is still running after its cancellation is never freed
+typedef struct
+{
+    OVERLAPPED ov;
+    unsigned char data[1];
+} WIN32_DRIVER_CALL;
+
+// CancelIoEx is only available since Vista: on XP, CancelIo cancels all the calls issued by the
+// thread, which is only done once all of them completed or timed out
+typedef BOOL (WINAPI *CANCEL_IO_EX) (HANDLE hFile, LPOVERLAPPED lpOverlapped);
+
+static CANCEL_IO_EX GetCancelIoEx ()
+{
+    static CANCEL_IO_EX pfnCancelIoEx = (CANCEL_IO_EX) GetProcAddress (GetModuleHandle (TEXT("kernel32.dll")), "CancelIoEx");
+    return pfnCancelIoEx;
+}
+
+static void CompleteWin32Call (HANDLE hDriver, WIN32_DRIVER_CALL* pCall, VC_DRIVER_CALL& call)
+{
+    call.bResult = GetOverlappedResult (hDriver, &pCall->ov, &call.cbReturned, FALSE);
+    call.dwError = call.bResult? ERROR_SUCCESS : GetLastError ();
+    call.endNs = GetTimestampNs ();
+    if (call.nOutBufferSize)
+        memcpy (call.lpOutBuffer, pCall->data + call.nInBufferSize, call.nOutBufferSize);
+    CloseHandle (pCall->ov.hEvent);
+    free (pCall);
+}
+
+BOOL CWin32Driver::IoControlBatch (VC_DRIVER_CALL* pCalls, size_t count, DWORD dwTimeoutMs)
+{
+    std::vector<WIN32_DRIVER_CALL*> pending (count, (WIN32_DRIVER_CALL*) NULL);
+    unsigned __int64 deadlineUs = GetTimestampUs () + (unsigned __int64) dwTimeoutMs * 1000;
+    CANCEL_IO_EX pfnCancelIoEx = GetCancelIoEx ();
+    BOOL bCompleted = TRUE;
+
+    // all the calls are issued before waiting for the first one
+    for (size_t i = 0; i < count; i++)
+    {
+        VC_DRIVER_CALL& call = pCalls[i];
+        WIN32_DRIVER_CALL* pCall = (WIN32_DRIVER_CALL*) calloc (1, sizeof (WIN32_DRIVER_CALL) + call.nInBufferSize + call.nOutBufferSize);
+        unsigned char* pIn;
+        unsigned char* pOut;
+
+        call.bResult = FALSE;
+        call.cbReturned = 0;
+        call.startNs = call.endNs = GetTimestampNs ();
+        if (!pCall || (pCall->ov.hEvent = CreateEvent (NULL, TRUE, FALSE, NULL)) == NULL)
+        {
+            call.dwError = pCall? GetLastError () : ERROR_NOT_ENOUGH_MEMORY;
+            free (pCall);
+            continue;
+        }
+
+        pIn = pCall->data;
+        pOut = pCall->data + call.nInBufferSize;
+        if (call.nInBufferSize)
+            memcpy (pIn, call.lpInBuffer, call.nInBufferSize);
+        if (call.nOutBufferSize)
+            memcpy (pOut, call.lpOutBuffer, call.nOutBufferSize);
+
+        if (DeviceIoControl (m_hDriver, call.dwIoControlCode, call.nInBufferSize? pIn : NULL, call.nInBufferSize,
+                call.nOutBufferSize? pOut : NULL, call.nOutBufferSize, NULL, &pCall->ov)
+            || GetLastError () == ERROR_IO_PENDING)
+        {
+            pending[i] = pCall;
+        }
+        else
+        {
+            call.dwError = GetLastError ();
+            CloseHandle (pCall->ov.hEvent);
+            free (pCall);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        WIN32_DRIVER_CALL* pCall = pending[i];
+        DWORD dwWaitMs = INFINITE;
+
+        if (!pCall)
+            continue;
+
+        if (dwTimeoutMs != INFINITE)
+        {
+            unsigned __int64 nowUs = GetTimestampUs ();
+            dwWaitMs = (nowUs < deadlineUs)? (DWORD) ((deadlineUs - nowUs + 999) / 1000) : 0;
+        }
+
+        if (WaitForSingleObject (pCall->ov.hEvent, dwWaitMs) == WAIT_OBJECT_0)
+            CompleteWin32Call (m_hDriver, pCall, pCalls[i]);
+        else
+        {
+            if (pfnCancelIoEx)
+                pfnCancelIoEx (m_hDriver, &pCall->ov);
+            // a driver that doesn't complete the cancellation right away keeps the buffers
+            if (WaitForSingleObject (pCall->ov.hEvent, 0) == WAIT_OBJECT_0)
+                CompleteWin32Call (m_hDriver, pCall, pCalls[i]);
+            if (!pCalls[i].bResult)
+            {
+                pCalls[i].endNs = GetTimestampNs ();
+                pCalls[i].dwError = ERROR_TIMEOUT;
+                bCompleted = FALSE;
+            }
+        }
+    }
+
+    if (!bCompleted && !pfnCancelIoEx)
+        CancelIo (m_hDriver);
+    return bCompleted;
+}
+
+#endif
+
+CDeadlineDriver::CDeadlineDriver (CVcDriver* pDriver, DWORD dwCallTimeoutMs, DWORD dwTotalTimeoutMs) :
+    m_pDriver (pDriver),
+    m_dwCallTimeoutMs (dwCallTimeoutMs),
+    m_DeadlineUs (dwTotalTimeoutMs? GetTimestampUs () + (unsigned __int64) dwTotalTimeoutMs * 1000 : 0),
+    m_bTimedOut (false)
+{
+}
+
+CDeadlineDriver::~CDeadlineDriver ()
+{
+    // calls that timed out may still be running in the backend: it is left to the end of the process
+    if (!m_bTimedOut)
+        delete m_pDriver;
+}
+
+BOOL CDeadlineDriver::IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    VC_DRIVER_CALL call;
+
+    InitDriverCall (call, dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize);
+    IoControlBatch (&call, 1, INFINITE);
+    *lpBytesReturned = call.cbReturned;
+    if (!call.bResult)
+        SetLastError (call.dwError);
+    return call.bResult;
+}
+
+BOOL CDeadlineDriver::IoControlBatch (VC_DRIVER_CALL* pCalls, size_t count, DWORD dwTimeoutMs)
+{
+    if (m_dwCallTimeoutMs && m_dwCallTimeoutMs < dwTimeoutMs)
+        dwTimeoutMs = m_dwCallTimeoutMs;
+
+    if (m_DeadlineUs)
+    {
+        unsigned __int64 nowUs = GetTimestampUs ();
+        DWORD dwRemainingMs = (nowUs < m_DeadlineUs)? (DWORD) ((m_DeadlineUs - nowUs + 999) / 1000) : 0;
+
+        if (dwRemainingMs == 0)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                pCalls[i].startNs = pCalls[i].endNs = GetTimestampNs ();
+                pCalls[i].bResult = FALSE;
+                pCalls[i].dwError = ERROR_TIMEOUT;
+                pCalls[i].cbReturned = 0;
+            }
+            m_bTimedOut = true;
+            return FALSE;
+        }
+        if (dwRemainingMs < dwTimeoutMs)
+            dwTimeoutMs = dwRemainingMs;
+    }
+
+    if (!m_pDriver->IoControlBatch (pCalls, count, dwTimeoutMs))
+    {
+        m_bTimedOut = true;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+CSimulatedDriver::CSimulatedDriver () :
+    m_DriverVersion (0x0126),
+    m_BootLoaderVersion (0),
+    m_cbBootStatus (sizeof (BootEncryptionStatus)),
+    m_TransformRate (0),
+    m_BootStatusUpdateUs (0),
+    m_ulMountedDrives (0),
+    m_NextUniqueId (0),
+    m_bKeysCleared (FALSE),
+    m_KeysClearedNs (0)
+{
+    memset (&m_BootStatus, 0, sizeof (m_BootStatus));
+    memset (&m_BootDriveProperties, 0, sizeof (m_BootDriveProperties));
+    memset (m_Volumes, 0, sizeof (m_Volumes));
+    memset (m_ReadRate, 0, sizeof (m_ReadRate));
+    memset (m_WriteRate, 0, sizeof (m_WriteRate));
+    memset (m_LastUpdateUs, 0, sizeof (m_LastUpdateUs));
+}
+
+static void SetWideString (WCHAR* wszDest, size_t cchDest, const char* szSrc)
+{
+    size_t i;
+    for (i = 0; szSrc[i] && i + 1 < cchDest; i++)
+        wszDest[i] = (WCHAR) (unsigned char) szSrc[i];
+    wszDest[i] = 0;
+}
+
+// two file containers with a steady I/O load, no system encryption
+void CSimulatedDriver::LoadSampleConfiguration ()
+{
+    VOLUME_PROPERTIES_STRUCT prop;
+
+    memset (&prop, 0, sizeof (prop));
+    SetWideString (prop.wszVolume, ARRAYSIZE (prop.wszVolume), "\\??\\C:\\Data\\projects.hc");
+    prop.diskLength = 10ULL * 1024 * 1024 * 1024;
+    prop.ea = 1;
+    prop.mode = 1;
+    prop.pkcs5 = 1;
+    prop.pkcs5Iterations = 500000;
+    prop.volFormatVersion = 2;
+    for (int i = 0; i < VOLUME_ID_SIZE; i++)
+        prop.volumeID[i] = (unsigned char) (0x10 + i);
+    Mount (12, prop);
+    SetIoRate (12, 8 * 1024 * 1024, 2 * 1024 * 1024);
+
+    memset (&prop, 0, sizeof (prop));
+    SetWideString (prop.wszVolume, ARRAYSIZE (prop.wszVolume), "\\Device\\Harddisk1\\Partition1");
+    SetWideString (prop.wszLabel, ARRAYSIZE (prop.wszLabel), "Archive");
+    prop.bDriverSetLabel = TRUE;
+    prop.diskLength = 500ULL * 1024 * 1024 * 1024;
+    prop.ea = 10;
+    prop.mode = 1;
+    prop.pkcs5 = 2;
+    prop.pkcs5Iterations = 500000;
+    prop.volumePim = 485;
+    prop.readOnly = TRUE;
+    prop.volFormatVersion = 2;
+    for (int i = 0; i < VOLUME_ID_SIZE; i++)
+        prop.volumeID[i] = (unsigned char) (0xA0 + i);
+    Mount (13, prop);
+    SetIoRate (13, 512 * 1024, 0);
+}
+
+void CSimulatedDriver::SetBootEncryptionStatus (const BootEncryptionStatus& status, DWORD cbSize)
+{
+    m_BootStatus = status;
+    m_cbBootStatus = (cbSize > sizeof (BootEncryptionStatus))? sizeof (BootEncryptionStatus) : cbSize;
+    m_BootStatusUpdateUs = GetTimestampUs ();
+}
+
+void CSimulatedDriver::SetTransformRate (unsigned __int64 bytesPerSec)
+{
+    UpdateBootStatus ();
+    m_TransformRate = bytesPerSec;
+}
+
+void CSimulatedDriver::StartSetup (BootEncryptionSetupMode mode, unsigned __int64 bytesPerSec)
+{
+    BootEncryptionStatus status;
+    VOLUME_PROPERTIES_STRUCT prop;
+
+    memset (&status, 0, sizeof (status));
+    status.DeviceFilterActive = TRUE;
+    status.BootLoaderVersion = 0x0126;
+    status.DriveMounted = TRUE;
+    status.VolumeHeaderPresent = TRUE;
+    status.BootDriveLength.QuadPart = 512LL * 1024 * 1024 * 1024;
+    status.ConfiguredEncryptedAreaStart = 1024 * 1024;
+    status.ConfiguredEncryptedAreaEnd = status.BootDriveLength.QuadPart - 1;
+    status.EncryptedAreaStart = status.ConfiguredEncryptedAreaStart;
+    status.EncryptedAreaEnd = status.ConfiguredEncryptedAreaEnd / 3;
+    status.SetupInProgress = TRUE;
+    status.SetupMode = mode;
+    SetBootEncryptionStatus (status, sizeof (status));
+    SetBootLoaderVersion (0x0126);
+
+    memset (&prop, 0, sizeof (prop));
+    SetWideString (prop.wszVolume, ARRAYSIZE (prop.wszVolume), "\\Device\\Harddisk0\\Partition2");
+    prop.diskLength = status.BootDriveLength.QuadPart;
+    prop.ea = 1;
+    prop.mode = 1;
+    prop.pkcs5 = 1;
+    prop.pkcs5Iterations = 500000;
+    prop.volFormatVersion = 2;
+    SetBootDriveProperties (prop);
+    SetTransformRate (bytesPerSec);
+}
+
+// move the end of the encrypted area according to the transform rate, as the driver does
+// when encrypting or decrypting the system drive
+void CSimulatedDriver::UpdateBootStatus ()
+{
+    unsigned __int64 now = GetTimestampUs ();
+    __int64 delta = (__int64) ((m_TransformRate * (now - m_BootStatusUpdateUs)) / 1000000);
+    BootEncryptionStatus& status = m_BootStatus;
+
+    m_BootStatusUpdateUs = now;
+    if (!status.SetupInProgress || status.TransformWaitingForIdle || delta == 0)
+        return;
+
+    if (status.SetupMode == SetupEncryption)
+    {
+        if (status.EncryptedAreaStart < 0 || status.EncryptedAreaEnd < status.EncryptedAreaStart)
+        {
+            status.EncryptedAreaStart = status.ConfiguredEncryptedAreaStart;
+            status.EncryptedAreaEnd = status.ConfiguredEncryptedAreaStart - 1;
+        }
+        status.EncryptedAreaEnd += delta;
+        if (status.EncryptedAreaEnd >= status.ConfiguredEncryptedAreaEnd)
+        {
+            status.EncryptedAreaEnd = status.ConfiguredEncryptedAreaEnd;
+            status.DriveEncrypted = TRUE;
+            status.SetupInProgress = FALSE;
+            status.SetupMode = SetupNone;
+        }
+    }
+    else if (status.SetupMode == SetupDecryption)
+    {
+        status.EncryptedAreaEnd -= delta;
+        if (status.EncryptedAreaEnd <= status.EncryptedAreaStart)
+        {
+            status.EncryptedAreaStart = status.EncryptedAreaEnd = -1;
+            status.DriveEncrypted = FALSE;
+            status.SetupInProgress = FALSE;
+            status.SetupMode = SetupNone;
+        }
+    }
+}
+
+void CSimulatedDriver::Mount (int driveNo, const VOLUME_PROPERTIES_STRUCT& prop)
+{
+    if (driveNo < 0 || driveNo >= 26)
+        return;
+    m_Volumes[driveNo] = prop;
+    m_Volumes[driveNo].driveNo = driveNo;
+    m_Volumes[driveNo].uniqueId = m_NextUniqueId++;
+    m_LastUpdateUs[driveNo] = GetTimestampUs ();
+    m_ulMountedDrives |= (1 << driveNo);
+}
+
+void CSimulatedDriver::Dismount (int driveNo)
+{
+    if (driveNo < 0 || driveNo >= 26)
+        return;
+    m_ulMountedDrives &= ~(1 << driveNo);
+    memset (&m_Volumes[driveNo], 0, sizeof (m_Volumes[driveNo]));
+    m_ReadRate[driveNo] = m_WriteRate[driveNo] = 0;
+}
+
+void CSimulatedDriver::SetIoRate (int driveNo, unsigned __int64 readBytesPerSec, unsigned __int64 writtenBytesPerSec)
+{
+    if (driveNo < 0 || driveNo >= 26)
+        return;
+    UpdateCounters (driveNo);
+    m_ReadRate[driveNo] = readBytesPerSec;
+    m_WriteRate[driveNo] = writtenBytesPerSec;
+}
+
+void CSimulatedDriver::UpdateCounters (int driveNo)
+{
+    unsigned __int64 now = GetTimestampUs ();
+    unsigned __int64 elapsedUs = now - m_LastUpdateUs[driveNo];
+
+    m_Volumes[driveNo].totalBytesRead += (m_ReadRate[driveNo] * elapsedUs) / 1000000;
+    m_Volumes[driveNo].totalBytesWritten += (m_WriteRate[driveNo] * elapsedUs) / 1000000;
+    m_LastUpdateUs[driveNo] = now;
+}
+
+BOOL CSimulatedDriver::IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    std::lock_guard<std::mutex> lock (m_Mutex);
+
+    *lpBytesReturned = 0;
+
+    switch (dwIoControlCode)
+    {
+    case VC_IOCTL_GET_DRIVER_VERSION:
+        if (nOutBufferSize < sizeof (LONG))
+            break;
+        memcpy (lpOutBuffer, &m_DriverVersion, sizeof (LONG));
+        *lpBytesReturned = sizeof (LONG);
+        return TRUE;
+
+    case VC_IOCTL_GET_BOOT_LOADER_VERSION:
+        if (nOutBufferSize < sizeof (UINT16))
+            break;
+        memcpy (lpOutBuffer, &m_BootLoaderVersion, sizeof (UINT16));
+        *lpBytesReturned = sizeof (UINT16);
+        return TRUE;
+
+    case VC_IOCTL_GET_MOUNTED_VOLUMES:
+        {
+            if (nOutBufferSize < sizeof (MOUNT_LIST_STRUCT))
+                break;
+            MOUNT_LIST_STRUCT* pList = (MOUNT_LIST_STRUCT*) lpOutBuffer;
+            memset (pList, 0, sizeof (MOUNT_LIST_STRUCT));
+            pList->ulMountedDrives = m_ulMountedDrives;
+            for (int i = 0; i < 26; i++)
+            {
+                if (m_ulMountedDrives & (1 << i))
+                {
+                    memcpy (pList->wszVolume[i], m_Volumes[i].wszVolume, sizeof (pList->wszVolume[i]));
+                    memcpy (pList->wszLabel[i], m_Volumes[i].wszLabel, sizeof (pList->wszLabel[i]));
+                    // the driver only fills the first VOLUME_ID_SIZE bytes
+                    memcpy (pList->volumeID[i], m_Volumes[i].volumeID, VOLUME_ID_SIZE);
+                    pList->diskLength[i] = m_Volumes[i].diskLength;
+                    pList->ea[i] = m_Volumes[i].ea;
+                    if (m_Volumes[i].hiddenVolume)
+                        pList->volumeType[i] = PROP_VOL_TYPE_HIDDEN;
+                    else if (m_Volumes[i].hiddenVolProtection == HIDVOL_PROT_STATUS_ACTION_TAKEN)
+                        pList->volumeType[i] = PROP_VOL_TYPE_OUTER_VOL_WRITE_PREVENTED;
+                    else if (m_Volumes[i].hiddenVolProtection == HIDVOL_PROT_STATUS_ACTIVE)
+                        pList->volumeType[i] = PROP_VOL_TYPE_OUTER;
+                    else
+                        pList->volumeType[i] = PROP_VOL_TYPE_NORMAL;
+                }
+            }
+            *lpBytesReturned = sizeof (MOUNT_LIST_STRUCT);
+            return TRUE;
+        }
+
+    case VC_IOCTL_GET_VOLUME_PROPERTIES:
+        {
+            if (nInBufferSize < sizeof (VOLUME_PROPERTIES_STRUCT) || nOutBufferSize < sizeof (VOLUME_PROPERTIES_STRUCT))
+                break;
+            int driveNo = ((VOLUME_PROPERTIES_STRUCT*) lpInBuffer)->driveNo;
+            if (driveNo < 0 || driveNo >= 26 || !(m_ulMountedDrives & (1 << driveNo)))
+            {
+                SetLastError (ERROR_FILE_NOT_FOUND);
+                return FALSE;
+            }
+            UpdateCounters (driveNo);
+            memcpy (lpOutBuffer, &m_Volumes[driveNo], sizeof (VOLUME_PROPERTIES_STRUCT));
+            *lpBytesReturned = sizeof (VOLUME_PROPERTIES_STRUCT);
+            return TRUE;
+        }
+
+    case VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS:
+        if (nOutBufferSize < m_cbBootStatus)
+            break;
+        UpdateBootStatus ();
+        memcpy (lpOutBuffer, &m_BootStatus, m_cbBootStatus);
+        *lpBytesReturned = m_cbBootStatus;
+        return TRUE;
+
+    case VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES:
+        if (!m_BootStatus.DriveMounted)
+        {
+            SetLastError (ERROR_FILE_NOT_FOUND);
+            return FALSE;
+        }
+        if (nOutBufferSize < sizeof (VOLUME_PROPERTIES_STRUCT))
+            break;
+        memcpy (lpOutBuffer, &m_BootDriveProperties, sizeof (VOLUME_PROPERTIES_STRUCT));
+        *lpBytesReturned = sizeof (VOLUME_PROPERTIES_STRUCT);
+        return TRUE;
+
+    case VC_IOCTL_EMERGENCY_CLEAR_KEYS:
+        m_KeysClearedNs = GetTimestampNs ();
+        m_bKeysCleared = TRUE;
+        return TRUE;
+
+    default:
+        SetLastError (ERROR_INVALID_FUNCTION);
+        return FALSE;
+    }
+
+    SetLastError (ERROR_INSUFFICIENT_BUFFER);
+    return FALSE;
+}
+
+static const struct
+{
+    DWORD dwCode;
+    const char* szName;
+} g_IoctlNames[] =
+{
+    { VC_IOCTL_GET_DRIVER_VERSION, "GET_DRIVER_VERSION" },
+    { VC_IOCTL_GET_BOOT_LOADER_VERSION, "GET_BOOT_LOADER_VERSION" },
+    { VC_IOCTL_GET_MOUNTED_VOLUMES, "GET_MOUNTED_VOLUMES" },
+    { VC_IOCTL_GET_VOLUME_PROPERTIES, "GET_VOLUME_PROPERTIES" },
+    { VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS, "GET_BOOT_ENCRYPTION_STATUS" },
+    { VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES, "GET_BOOT_DRIVE_VOLUME_PROPERTIES" },
+    { VC_IOCTL_EMERGENCY_CLEAR_KEYS, "EMERGENCY_CLEAR_KEYS" },
+};
+
+const char* GetIoctlName (DWORD dwIoControlCode)
+{
+    for (size_t i = 0; i < ARRAYSIZE (g_IoctlNames); i++)
+    {
+        if (g_IoctlNames[i].dwCode == dwIoControlCode)
+            return g_IoctlNames[i].szName;
+    }
+    return NULL;
+}
+
+DWORD GetIoctlCode (const char* szName)
+{
+    for (size_t i = 0; i < ARRAYSIZE (g_IoctlNames); i++)
+    {
+        if (strcmp (g_IoctlNames[i].szName, szName) == 0)
+            return g_IoctlNames[i].dwCode;
+    }
+    return 0;
+}
+
+CVcDriver* OpenVcDriver (const DRIVER_OPTIONS& options)
+{
+    CTraceScope scope ("open driver", "phase");
+    CVcDriver* pDriver = NULL;
+
+    if (options.szReplayFile)
+    {
+        pDriver = CReplayDriver::Load (options.szReplayFile);
+    }
+    else if (options.bSimulate)
+    {
+        CSimulatedDriver* pSimulated = new CSimulatedDriver ();
+        pSimulated->LoadSampleConfiguration ();
+        if (options.simulatedSetupMode != SetupNone)
+            pSimulated->StartSetup ((BootEncryptionSetupMode) options.simulatedSetupMode, options.dwSimulatedSetupRate);
+        pDriver = pSimulated;
+    }
+    else
+    {
+#ifdef _WIN32
+        HANDLE hDriver = CreateFileW (L"\\\\.\\VeraCrypt", 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+        if (hDriver != INVALID_HANDLE_VALUE)
+            pDriver = new CWin32Driver (hDriver);
+#else
+        pDriver = CLinuxDriver::Open (options.szSysfsRoot);
+#endif
+    }
+
+    // the latency of the backend itself, without the recording and deadline layers
+    pDriver = TraceDriverCalls (pDriver);
+
+    if (pDriver && options.szRecordFile)
+    {
+        CVcDriver* pRecorder = CRecordingDriver::Create (pDriver, options.szRecordFile);
+        if (!pRecorder)
+        {
+            DWORD dwError = GetLastError ();
+            delete pDriver;
+            SetLastError (dwError);
+            return NULL;
+        }
+        pDriver = pRecorder;
+    }
+
+    if (pDriver && (options.dwCallTimeoutMs || options.dwTotalTimeoutMs))
+        pDriver = new CDeadlineDriver (pDriver, options.dwCallTimeoutMs, options.dwTotalTimeoutMs);
+
+    return pDriver;
+}
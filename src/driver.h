@@ -0,0 +1,145 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "defs.h"
+#include "verastatus.h"
+#include <atomic>
+#include <mutex>
+
+// one call of a batch issued by CVcDriver::IoControlBatch
+typedef struct
+{
+	DWORD dwIoControlCode;
+	LPVOID lpInBuffer;
+	DWORD nInBufferSize;
+	LPVOID lpOutBuffer;
+	DWORD nOutBufferSize;
+	BOOL bResult;
+	DWORD dwError;		/* error of the call when bResult is FALSE, ERROR_TIMEOUT if it didn't complete in time */
+	DWORD cbReturned;
+	unsigned __int64 startNs;	/* GetTimestampNs () when the call was issued */
+	unsigned __int64 endNs;		/* and when its completion (or timeout) was seen */
+} VC_DRIVER_CALL;
+
+void InitDriverCall (VC_DRIVER_CALL& call, DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize);
+
+// Access to the VeraCrypt driver.
+// IoControl has the same semantics as DeviceIoControl: it returns FALSE on failure
+// and the error code is available through GetLastError. It can be called from several threads.
+class CVcDriver
+{
+public:
+	virtual ~CVcDriver () {}
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned) = 0;
+	// Issue independent calls concurrently and wait for them during at most dwTimeoutMs (INFINITE = no
+	// limit). Calls still running at the deadline fail with ERROR_TIMEOUT and their buffers are never
+	// written afterwards. Returns FALSE if a call timed out.
+	// By default, the calls are made one after the other without deadline, and on their own thread with one.
+	virtual BOOL IoControlBatch (VC_DRIVER_CALL* pCalls, size_t count, DWORD dwTimeoutMs);
+	// FALSE if the backend can never complete the call (e.g. EMERGENCY_CLEAR_KEYS on Linux)
+	virtual BOOL SupportsIoControl (DWORD /* dwIoControlCode */) { return TRUE; }
+	// TRUE once a call failed because of the /timeout or /deadline limits, seen through the wrappers
+	virtual BOOL TimedOut () const { return FALSE; }
+};
+
+#ifdef _WIN32
+
+// real VeraCrypt driver accessed through \\.\VeraCrypt
+class CWin32Driver : public CVcDriver
+{
+public:
+	// hDriver must be opened for overlapped I/O
+	CWin32Driver (HANDLE hDriver) : m_hDriver (hDriver) {}
+	virtual ~CWin32Driver ();
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned);
+	// overlapped calls, cancelled at the deadline
+	virtual BOOL IoControlBatch (VC_DRIVER_CALL* pCalls, size_t count, DWORD dwTimeoutMs);
+
+protected:
+	HANDLE m_hDriver;
+};
+
+#endif
+
+// In-memory driver used to run VeraStatus without VeraCrypt installed.
+// The byte counters of mounted volumes advance with time according to the configured I/O rates,
+// and so does the encrypted area of the system drive while a setup is in progress.
+class CSimulatedDriver : public CVcDriver
+{
+public:
+	CSimulatedDriver ();
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned);
+
+	void LoadSampleConfiguration ();
+	void SetDriverVersion (LONG version) { m_DriverVersion = version; }
+	void SetBootLoaderVersion (UINT16 version) { m_BootLoaderVersion = version; }
+	void SetBootEncryptionStatus (const BootEncryptionStatus& status, DWORD cbSize);
+	void SetBootDriveProperties (const VOLUME_PROPERTIES_STRUCT& prop) { m_BootDriveProperties = prop; }
+	void Mount (int driveNo, const VOLUME_PROPERTIES_STRUCT& prop);
+	void Dismount (int driveNo);
+	void SetIoRate (int driveNo, unsigned __int64 readBytesPerSec, unsigned __int64 writtenBytesPerSec);
+	void SetTransformRate (unsigned __int64 bytesPerSec);
+	// system drive encrypted for a third, the setup transforming bytesPerSec from now
+	void StartSetup (BootEncryptionSetupMode mode, unsigned __int64 bytesPerSec);
+	BOOL KeysCleared () const { return m_bKeysCleared; }
+	// GetTimestampNs when EMERGENCY_CLEAR_KEYS was received, 0 if never
+	unsigned __int64 GetKeysClearedNs () const { return m_KeysClearedNs; }
+
+protected:
+	void UpdateCounters (int driveNo);
+	void UpdateBootStatus ();
+
+	LONG m_DriverVersion;
+	UINT16 m_BootLoaderVersion;
+	BootEncryptionStatus m_BootStatus;
+	DWORD m_cbBootStatus;
+	unsigned __int64 m_TransformRate;
+	unsigned __int64 m_BootStatusUpdateUs;
+	VOLUME_PROPERTIES_STRUCT m_BootDriveProperties;
+	unsigned __int32 m_ulMountedDrives;
+	VOLUME_PROPERTIES_STRUCT m_Volumes[26];
+	unsigned __int64 m_ReadRate[26];
+	unsigned __int64 m_WriteRate[26];
+	unsigned __int64 m_LastUpdateUs[26];
+	int m_NextUniqueId;
+	BOOL m_bKeysCleared;
+	unsigned __int64 m_KeysClearedNs;
+	std::mutex m_Mutex;
+};
+
+// Backend bounding the time spent in the calls of another one (global options /timeout and /deadline)
+class CDeadlineDriver : public CVcDriver
+{
+public:
+	// dwCallTimeoutMs: limit of each call, dwTotalTimeoutMs: limit of all the calls from now (0 = no limit)
+	CDeadlineDriver (CVcDriver* pDriver, DWORD dwCallTimeoutMs, DWORD dwTotalTimeoutMs);
+	virtual ~CDeadlineDriver ();
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned);
+	virtual BOOL IoControlBatch (VC_DRIVER_CALL* pCalls, size_t count, DWORD dwTimeoutMs);
+	virtual BOOL SupportsIoControl (DWORD dwIoControlCode) { return m_pDriver->SupportsIoControl (dwIoControlCode); }
+	virtual BOOL TimedOut () const { return m_bTimedOut; }
+	// backend whose calls are bounded
+	CVcDriver& GetDriver () { return *m_pDriver; }
+
+protected:
+	CVcDriver* m_pDriver;
+	DWORD m_dwCallTimeoutMs;
+	unsigned __int64 m_DeadlineUs;	/* GetTimestampUs () value, 0 = none */
+	std::atomic<bool> m_bTimedOut;
+};
+
+// selection of the driver backend (global command line options /simulate, /replay, /record, /timeout, /deadline and /sysfs)
+typedef VS_SESSION_OPTIONS DRIVER_OPTIONS;
+
+// Open the driver backend selected by the options, the real VeraCrypt driver by default.
+// Returns NULL on failure, the error code being available through GetLastError.
+CVcDriver* OpenVcDriver (const DRIVER_OPTIONS& options);
+
+// name of a VC_IOCTL_* code without the prefix (e.g. "GET_MOUNTED_VOLUMES"), NULL if unknown
+const char* GetIoctlName (DWORD dwIoControlCode);
+DWORD GetIoctlCode (const char* szName);
@@ -0,0 +1,544 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "events.h"
+
+#ifdef _WIN32
+#include <dbt.h>
+#endif
+
+// WCHAR is not wchar_t on every platform
+static BOOL IsSameString (const WCHAR* a, const WCHAR* b)
+{
+    while (*a && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static BOOL IsSameVolume (const MOUNT_ENTRY& a, const MOUNT_ENTRY& b)
+{
+    return memcmp (a.volumeID, b.volumeID, VOLUME_ID_SIZE) == 0 && IsSameString (a.wszVolume, b.wszVolume);
+}
+
+BOOL QueryMountState (CVcDriver& driver, const MOUNT_STATE* pPrevious, MOUNT_STATE& state)
+{
+    DWORD cbBytesReturned = 0;
+    static MOUNT_LIST_STRUCT mlist;
+
+    memset (&mlist, 0, sizeof (mlist));
+    if (!driver.IoControl (VC_IOCTL_GET_MOUNTED_VOLUMES, &mlist, sizeof (mlist), &mlist, sizeof (mlist), &cbBytesReturned))
+        return FALSE;
+
+    memset (&state, 0, sizeof (state));
+    for (int i = 0; i < 26; i++)
+    {
+        if (!(mlist.ulMountedDrives & (1 << i)))
+            continue;
+
+        MOUNT_ENTRY& entry = state.entries[i];
+        memcpy (entry.wszVolume, mlist.wszVolume[i], sizeof (entry.wszVolume));
+        memcpy (entry.wszLabel, mlist.wszLabel[i], sizeof (entry.wszLabel));
+        entry.wszVolume[ARRAYSIZE (entry.wszVolume) - 1] = 0;
+        entry.wszLabel[ARRAYSIZE (entry.wszLabel) - 1] = 0;
+        // the driver only fills the first VOLUME_ID_SIZE bytes of the WCHAR array
+        memcpy (entry.volumeID, mlist.volumeID[i], VOLUME_ID_SIZE);
+        entry.diskLength = mlist.diskLength[i];
+        entry.ea = mlist.ea[i];
+        entry.volumeType = mlist.volumeType[i];
+
+        // the driver only makes a volume read-only when mounting it or when the hidden volume
+        // protection is triggered, which also changes its type
+        if (pPrevious && (pPrevious->ulMountedDrives & (1 << i)) && !pPrevious->entries[i].readOnlyTimedOut
+            && IsSameVolume (pPrevious->entries[i], entry) && pPrevious->entries[i].volumeType == entry.volumeType)
+        {
+            entry.readOnly = pPrevious->entries[i].readOnly;
+        }
+        else
+        {
+            VOLUME_PROPERTIES_STRUCT prop;
+            memset (&prop, 0, sizeof (prop));
+            prop.driveNo = i;
+            // another failure means that the volume was dismounted after GET_MOUNTED_VOLUMES returned,
+            // a listed volume whose properties timed out is still mounted
+            if (driver.IoControl (VC_IOCTL_GET_VOLUME_PROPERTIES, &prop, sizeof (prop), &prop, sizeof (prop), &cbBytesReturned))
+                entry.readOnly = prop.readOnly;
+            else if (GetLastError () == ERROR_TIMEOUT)
+                entry.readOnlyTimedOut = TRUE;
+            else
+                continue;
+        }
+        state.ulMountedDrives |= (1 << i);
+    }
+
+    return TRUE;
+}
+
+static int AddEvent (MOUNT_EVENT* pEvents, int n, eMountEventType type, int driveNo, const MOUNT_ENTRY* pPrevious, const MOUNT_ENTRY* pCurrent)
+{
+    pEvents[n].type = type;
+    pEvents[n].driveNo = driveNo;
+    pEvents[n].pPrevious = pPrevious;
+    pEvents[n].pCurrent = pCurrent;
+    return n + 1;
+}
+
+int DiffMountStates (const MOUNT_STATE& previous, const MOUNT_STATE& current, MOUNT_EVENT* pEvents)
+{
+    int n = 0;
+
+    for (int i = 0; i < 26; i++)
+    {
+        BOOL bWasMounted = (previous.ulMountedDrives & (1 << i))? TRUE : FALSE;
+        BOOL bIsMounted = (current.ulMountedDrives & (1 << i))? TRUE : FALSE;
+        const MOUNT_ENTRY& before = previous.entries[i];
+        const MOUNT_ENTRY& after = current.entries[i];
+
+        if (bWasMounted && !bIsMounted)
+            n = AddEvent (pEvents, n, MOUNT_EVENT_DISMOUNTED, i, &before, NULL);
+        else if (!bWasMounted && bIsMounted)
+            n = AddEvent (pEvents, n, MOUNT_EVENT_MOUNTED, i, NULL, &after);
+        else if (bIsMounted)
+        {
+            if (!IsSameVolume (before, after))
+                n = AddEvent (pEvents, n, MOUNT_EVENT_REPLACED, i, &before, &after);
+            else
+            {
+                if (!IsSameString (before.wszLabel, after.wszLabel))
+                    n = AddEvent (pEvents, n, MOUNT_EVENT_LABEL_CHANGED, i, &before, &after);
+                if (before.volumeType != after.volumeType)
+                    n = AddEvent (pEvents, n, MOUNT_EVENT_VOLUME_TYPE_CHANGED, i, &before, &after);
+                if (!before.readOnlyTimedOut && !after.readOnlyTimedOut && before.readOnly != after.readOnly)
+                    n = AddEvent (pEvents, n, MOUNT_EVENT_READ_ONLY_CHANGED, i, &before, &after);
+            }
+        }
+    }
+
+    return n;
+}
+
+// no notification: the changes are only seen at the polling interval
+class CPollingEventSource : public CMountEventSource
+{
+public:
+    virtual BOOL Wait (DWORD dwTimeoutMs)
+    {
+        Sleep (dwTimeoutMs);
+        return FALSE;
+    }
+    virtual LPCTSTR GetName () const { return TEXT("polling"); }
+};
+
+// Cycle of changes applied to the simulated driver every VC_SIMULATED_EVENT_STEP_MS. Mounts and
+// dismounts are notified as VeraCrypt does, label and protection changes are silent and can only
+// be seen by polling.
+#define VC_SIMULATED_EVENT_STEP_MS	1000
+
+class CSimulatedEventSource : public CMountEventSource
+{
+public:
+    CSimulatedEventSource (CSimulatedDriver& driver) : m_Driver (driver), m_Step (0), m_NextStepUs (GetTimestampUs () + VC_SIMULATED_EVENT_STEP_MS * 1000ULL)
+    {
+        memset (&m_OuterVolume, 0, sizeof (m_OuterVolume));
+    }
+
+    virtual BOOL Wait (DWORD dwTimeoutMs)
+    {
+        unsigned __int64 deadlineUs = GetTimestampUs () + (unsigned __int64) dwTimeoutMs * 1000;
+
+        for (;;)
+        {
+            unsigned __int64 nowUs = GetTimestampUs ();
+            if (m_NextStepUs > deadlineUs)
+            {
+                if (deadlineUs > nowUs)
+                    Sleep ((DWORD) ((deadlineUs - nowUs) / 1000));
+                return FALSE;
+            }
+            if (m_NextStepUs > nowUs)
+                Sleep ((DWORD) ((m_NextStepUs - nowUs) / 1000));
+            m_NextStepUs += VC_SIMULATED_EVENT_STEP_MS * 1000ULL;
+            if (Step ())
+                return TRUE;
+        }
+    }
+    virtual LPCTSTR GetName () const { return TEXT("simulated"); }
+
+protected:
+    static void SetVolume (VOLUME_PROPERTIES_STRUCT& prop, const char* szVolume, const char* szLabel, unsigned char idBase)
+    {
+        memset (&prop, 0, sizeof (prop));
+        for (size_t i = 0; szVolume[i] && i < ARRAYSIZE (prop.wszVolume) - 1; i++)
+            prop.wszVolume[i] = (WCHAR) szVolume[i];
+        for (size_t i = 0; szLabel[i] && i < ARRAYSIZE (prop.wszLabel) - 1; i++)
+            prop.wszLabel[i] = (WCHAR) szLabel[i];
+        prop.diskLength = 1024ULL * 1024 * 1024;
+        prop.ea = 1;
+        prop.mode = 1;
+        prop.pkcs5 = 1;
+        prop.pkcs5Iterations = 500000;
+        prop.volFormatVersion = 2;
+        for (int i = 0; i < VOLUME_ID_SIZE; i++)
+            prop.volumeID[i] = (unsigned char) (idBase + i);
+    }
+
+    // apply the next change, TRUE if it is notified
+    BOOL Step ()
+    {
+        const int driveP = 'P' - 'A', driveM = 'M' - 'A';
+        VOLUME_PROPERTIES_STRUCT prop;
+        DWORD cbReturned = 0;
+
+        memset (&prop, 0, sizeof (prop));
+        prop.driveNo = driveM;
+        switch (m_Step++ % 6)
+        {
+        case 0:
+            SetVolume (prop, "\\??\\C:\\Temp\\scratch.hc", "Scratch", 0x40);
+            m_Driver.Mount (driveP, prop);
+            return TRUE;
+        case 1:
+            SetVolume (prop, "\\??\\C:\\Temp\\scratch.hc", "Scratch (old)", 0x40);
+            m_Driver.Mount (driveP, prop);
+            return FALSE;
+        case 2:
+            // writing to the outer volume triggered the protection of its hidden volume
+            if (!m_Driver.IoControl (VC_IOCTL_GET_VOLUME_PROPERTIES, &prop, sizeof (prop), &prop, sizeof (prop), &cbReturned))
+                return FALSE;
+            m_OuterVolume = prop;
+            prop.hiddenVolProtection = HIDVOL_PROT_STATUS_ACTION_TAKEN;
+            prop.readOnly = TRUE;
+            m_Driver.Mount (driveM, prop);
+            return FALSE;
+        case 3:
+            m_Driver.Dismount (driveP);
+            SetVolume (prop, "\\Device\\Harddisk2\\Partition1", "Backup", 0x60);
+            m_Driver.Mount (driveP, prop);
+            return TRUE;
+        case 4:
+            m_Driver.Dismount (driveP);
+            return TRUE;
+        default:
+            // remounted with the protection of the hidden volume
+            if (m_OuterVolume.wszVolume[0])
+            {
+                m_OuterVolume.hiddenVolProtection = HIDVOL_PROT_STATUS_ACTIVE;
+                m_Driver.Dismount (driveM);
+                m_Driver.Mount (driveM, m_OuterVolume);
+            }
+            return TRUE;
+        }
+    }
+
+    CSimulatedDriver& m_Driver;
+    int m_Step;
+    unsigned __int64 m_NextStepUs;
+    VOLUME_PROPERTIES_STRUCT m_OuterVolume;
+};
+
+#ifdef _WIN32
+// VeraCrypt broadcasts WM_DEVICECHANGE to the top-level windows when a volume is mounted or
+// dismounted: a hidden window receives them while Wait pumps its messages.
+class CDeviceChangeEventSource : public CMountEventSource
+{
+public:
+    CDeviceChangeEventSource () : m_hWnd (NULL), m_bNotified (FALSE) {}
+    virtual ~CDeviceChangeEventSource ()
+    {
+        if (m_hWnd)
+            DestroyWindow (m_hWnd);
+    }
+
+    BOOL Create ()
+    {
+        WNDCLASS wc;
+
+        memset (&wc, 0, sizeof (wc));
+        wc.lpfnWndProc = WindowProc;
+        wc.hInstance = GetModuleHandle (NULL);
+        wc.lpszClassName = TEXT("VeraStatusDeviceChange");
+        if (!RegisterClass (&wc) && GetLastError () != ERROR_CLASS_ALREADY_EXISTS)
+            return FALSE;
+
+        // not a message-only window: those don't receive broadcasts
+        m_hWnd = CreateWindow (wc.lpszClassName, TEXT(""), 0, 0, 0, 0, 0, NULL, NULL, wc.hInstance, NULL);
+        if (!m_hWnd)
+            return FALSE;
+        SetWindowLongPtr (m_hWnd, GWLP_USERDATA, (LONG_PTR) this);
+        return TRUE;
+    }
+
+    virtual BOOL Wait (DWORD dwTimeoutMs)
+    {
+        unsigned __int64 deadlineUs = GetTimestampUs () + (unsigned __int64) dwTimeoutMs * 1000;
+        MSG msg;
+
+        m_bNotified = FALSE;
+        for (;;)
+        {
+            while (PeekMessage (&msg, NULL, 0, 0, PM_REMOVE))
+            {
+                TranslateMessage (&msg);
+                DispatchMessage (&msg);
+            }
+            if (m_bNotified)
+                return TRUE;
+
+            unsigned __int64 nowUs = GetTimestampUs ();
+            if (nowUs >= deadlineUs)
+                return FALSE;
+            MsgWaitForMultipleObjects (0, NULL, FALSE, (DWORD) ((deadlineUs - nowUs + 999) / 1000), QS_ALLINPUT);
+        }
+    }
+    virtual LPCTSTR GetName () const { return TEXT("device notifications"); }
+
+protected:
+    static LRESULT CALLBACK WindowProc (HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+    {
+        if (uMsg == WM_DEVICECHANGE && (wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE)
+            && lParam && ((DEV_BROADCAST_HDR*) lParam)->dbch_devicetype == DBT_DEVTYP_VOLUME)
+        {
+            CDeviceChangeEventSource* pSource = (CDeviceChangeEventSource*) GetWindowLongPtr (hWnd, GWLP_USERDATA);
+            if (pSource)
+                pSource->m_bNotified = TRUE;
+            return TRUE;
+        }
+        return DefWindowProc (hWnd, uMsg, wParam, lParam);
+    }
+
+    HWND m_hWnd;
+    BOOL m_bNotified;
+};
+#endif
+
+CMountEventSource* CreateMountEventSource (CVcDriver& driver)
+{
+    CSimulatedDriver* pSimulated = dynamic_cast<CSimulatedDriver*> (&driver);
+
+    if (pSimulated)
+        return new CSimulatedEventSource (*pSimulated);
+#ifdef _WIN32
+    CDeviceChangeEventSource* pSource = new CDeviceChangeEventSource ();
+    if (pSource->Create ())
+        return pSource;
+    delete pSource;
+#endif
+    return new CPollingEventSource ();
+}
+
+static const char* GetMountEventName (eMountEventType type)
+{
+    switch (type)
+    {
+    case MOUNT_EVENT_MOUNTED: return "mounted";
+    case MOUNT_EVENT_DISMOUNTED: return "dismounted";
+    case MOUNT_EVENT_REPLACED: return "replaced";
+    case MOUNT_EVENT_LABEL_CHANGED: return "labelChanged";
+    case MOUNT_EVENT_VOLUME_TYPE_CHANGED: return "volumeTypeChanged";
+    default: return "readOnlyChanged";
+    }
+}
+
+static LPCTSTR GetVolumeTypeName (int volumeType)
+{
+    switch (volumeType)
+    {
+    case PROP_VOL_TYPE_NORMAL: return TEXT("normal");
+    case PROP_VOL_TYPE_HIDDEN: return TEXT("hidden");
+    case PROP_VOL_TYPE_OUTER: return TEXT("outer");
+    case PROP_VOL_TYPE_OUTER_VOL_WRITE_PREVENTED: return TEXT("outer, write prevented");
+    case PROP_VOL_TYPE_SYSTEM: return TEXT("system");
+    default: return TEXT("unknown");
+    }
+}
+
+static LPCTSTR GetAccessName (const MOUNT_ENTRY& entry)
+{
+    if (entry.readOnlyTimedOut)
+        return TEXT("access unknown");
+    return entry.readOnly? TEXT("read-only") : TEXT("read-write");
+}
+
+// path, label, type and start of the ID of a volume
+static void FormatMountEntry (const MOUNT_ENTRY& entry, TCHAR* szOut, size_t cchOut)
+{
+    TCHAR szID[2 * 8 + 1];
+
+    for (int i = 0; i < 8; i++)
+        StringCchPrintf (szID + 2 * i, ARRAYSIZE (szID) - 2 * i, TEXT("%.2X"), entry.volumeID[i]);
+    if (entry.wszLabel[0])
+        StringCchPrintf (szOut, cchOut, TEXT("%s \"%s\" (%s, %s, ID %s...)"), VC_WSTR (entry.wszVolume), VC_WSTR (entry.wszLabel),
+            GetVolumeTypeName (entry.volumeType), GetAccessName (entry), szID);
+    else
+        StringCchPrintf (szOut, cchOut, TEXT("%s (%s, %s, ID %s...)"), VC_WSTR (entry.wszVolume),
+            GetVolumeTypeName (entry.volumeType), GetAccessName (entry), szID);
+}
+
+static void PrintMountEvent (double dTime, const MOUNT_EVENT& event)
+{
+    TCHAR szEntry[512];
+    TCHAR cDrive = (TCHAR) (TEXT('A') + event.driveNo);
+
+    switch (event.type)
+    {
+    case MOUNT_EVENT_MOUNTED:
+        FormatMountEntry (*event.pCurrent, szEntry, ARRAYSIZE (szEntry));
+        _tprintf (TEXT("[%8.1fs] %c: mounted %s\n"), dTime, cDrive, szEntry);
+        break;
+    case MOUNT_EVENT_DISMOUNTED:
+        FormatMountEntry (*event.pPrevious, szEntry, ARRAYSIZE (szEntry));
+        _tprintf (TEXT("[%8.1fs] %c: dismounted %s\n"), dTime, cDrive, szEntry);
+        break;
+    case MOUNT_EVENT_REPLACED:
+        FormatMountEntry (*event.pCurrent, szEntry, ARRAYSIZE (szEntry));
+        _tprintf (TEXT("[%8.1fs] %c: %s replaced by %s\n"), dTime, cDrive, VC_WSTR (event.pPrevious->wszVolume), szEntry);
+        break;
+    case MOUNT_EVENT_LABEL_CHANGED:
+        _tprintf (TEXT("[%8.1fs] %c: label changed from \"%s\""), dTime, cDrive, VC_WSTR (event.pPrevious->wszLabel));
+        _tprintf (TEXT(" to \"%s\"\n"), VC_WSTR (event.pCurrent->wszLabel));
+        break;
+    case MOUNT_EVENT_VOLUME_TYPE_CHANGED:
+        _tprintf (TEXT("[%8.1fs] %c: type changed from %s to %s\n"), dTime, cDrive, GetVolumeTypeName (event.pPrevious->volumeType), GetVolumeTypeName (event.pCurrent->volumeType));
+        break;
+    default:
+        _tprintf (TEXT("[%8.1fs] %c: now %s\n"), dTime, cDrive, event.pCurrent->readOnly? TEXT("read-only") : TEXT("read-write"));
+        break;
+    }
+}
+
+static void FormatEntryFields (CRecordWriter& writer, const MOUNT_ENTRY& entry)
+{
+    writer.WideString ("wszVolume", entry.wszVolume, ARRAYSIZE (entry.wszVolume));
+    writer.Bytes ("volumeID", entry.volumeID, VOLUME_ID_SIZE);
+    writer.WideString ("wszLabel", entry.wszLabel, ARRAYSIZE (entry.wszLabel));
+    writer.UInt ("diskLength", entry.diskLength);
+    writer.Int ("ea", entry.ea);
+    writer.Int ("volumeType", entry.volumeType);
+    writer.TString ("volumeTypeName", GetVolumeTypeName (entry.volumeType));
+    writer.Bool ("readOnly", entry.readOnly);
+}
+
+// one document per event, the csv header only preceding the first one
+static void WriteMountEvent (eOutputFormat format, BOOL bFirst, unsigned __int64 seq, const MOUNT_EVENT& event)
+{
+    COutputBuffer out;
+    CRecordWriter writer (out, format);
+    const MOUNT_ENTRY& entry = event.pCurrent? *event.pCurrent : *event.pPrevious;
+    char szDrive[2] = { (char) ('A' + event.driveNo), 0 };
+
+    writer.BeginDocument (bFirst);
+    writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+    writer.BeginRecord ("event");
+    writer.UInt ("seq", seq);
+    writer.UInt ("timeUs", GetSystemTimeUs ());
+    writer.String ("type", GetMountEventName (event.type));
+    writer.Int ("driveNo", event.driveNo);
+    writer.String ("driveLetter", szDrive);
+    FormatEntryFields (writer, entry);
+    switch (event.type)
+    {
+    case MOUNT_EVENT_REPLACED:
+        writer.WideString ("previousWszVolume", event.pPrevious->wszVolume, ARRAYSIZE (event.pPrevious->wszVolume));
+        writer.Bytes ("previousVolumeID", event.pPrevious->volumeID, VOLUME_ID_SIZE);
+        break;
+    case MOUNT_EVENT_LABEL_CHANGED:
+        writer.WideString ("previousWszLabel", event.pPrevious->wszLabel, ARRAYSIZE (event.pPrevious->wszLabel));
+        break;
+    case MOUNT_EVENT_VOLUME_TYPE_CHANGED:
+        writer.Int ("previousVolumeType", event.pPrevious->volumeType);
+        break;
+    case MOUNT_EVENT_READ_ONLY_CHANGED:
+        writer.Bool ("previousReadOnly", event.pPrevious->readOnly);
+        break;
+    default:
+        break;
+    }
+    writer.EndRecord ();
+    writer.EndDocument ();
+    out.Write (stdout);
+}
+
+static void ReportMountStateError (eOutputFormat format, BOOL bFirst, DWORD dwError)
+{
+    if (format == OUTPUT_TEXT)
+        _tprintf(TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr(dwError));
+    else
+    {
+        COutputBuffer out;
+        CRecordWriter writer (out, format);
+
+        writer.BeginDocument (bFirst);
+        writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+        FormatDriverError (writer, "GET_MOUNTED_VOLUMES", dwError);
+        writer.EndDocument ();
+        out.Write (stdout);
+    }
+}
+
+int RunMountEvents (CVcDriver& driver, DWORD dwPollMs, int iCount, eOutputFormat format)
+{
+    static MOUNT_STATE states[2];
+    MOUNT_STATE* pPrevious = &states[0];
+    MOUNT_STATE* pCurrent = &states[1];
+    MOUNT_EVENT events[MAX_MOUNT_EVENTS];
+    CMountEventSource* pSource;
+    unsigned __int64 seq = 0, startUs;
+    int iRet = VC_STATUS_OK;
+
+    // compared with an empty state, the volumes already mounted are reported first
+    memset (pPrevious, 0, sizeof (MOUNT_STATE));
+    if (!QueryMountState (driver, NULL, *pCurrent))
+    {
+        ReportMountStateError (format, TRUE, GetLastError ());
+        return VC_STATUS_DRIVER_CALL_FAILED;
+    }
+
+    startUs = GetTimestampUs ();
+    pSource = CreateMountEventSource (driver);
+    if (format == OUTPUT_TEXT)
+    {
+        _tprintf (TEXT("Watching mount changes (%s, checked every %.1f seconds)\n"), pSource->GetName (), (double) dwPollMs / 1000.0);
+        fflush (stdout);
+    }
+
+    for (;;)
+    {
+        int n = DiffMountStates (*pPrevious, *pCurrent, events);
+        double dTime = (double) (GetTimestampUs () - startUs) / 1000000.0;
+
+        for (int i = 0; i < n && (iCount <= 0 || seq < (unsigned __int64) iCount); i++)
+        {
+            seq++;
+            if (format == OUTPUT_TEXT)
+                PrintMountEvent (dTime, events[i]);
+            else
+                WriteMountEvent (format, seq == 1, seq, events[i]);
+        }
+        fflush (stdout);
+        if (iCount > 0 && seq >= (unsigned __int64) iCount)
+            break;
+
+        MOUNT_STATE* pTmp = pPrevious;
+        pPrevious = pCurrent;
+        pCurrent = pTmp;
+
+        // a notification only shortens the wait: changes that aren't notified, like a new label,
+        // are still seen at the polling interval
+        pSource->Wait (dwPollMs);
+        if (!QueryMountState (driver, pPrevious, *pCurrent))
+        {
+            ReportMountStateError (format, seq == 0, GetLastError ());
+            iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            break;
+        }
+    }
+
+    delete pSource;
+    return iRet;
+}
@@ -0,0 +1,78 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+#include "format.h"
+
+// Stream of the changes of the mounted volumes (/events): the last mount list is kept in memory
+// and compared with a new one each time the event source reports a possible change, or when the
+// polling interval elapses without notification.
+
+// what is known of a mounted volume, from GET_MOUNTED_VOLUMES except readOnly
+typedef struct
+{
+	WCHAR wszVolume[260];
+	WCHAR wszLabel[33];
+	unsigned char volumeID[VOLUME_ID_SIZE];
+	unsigned __int64 diskLength;
+	int ea;
+	int volumeType;		/* PROP_VOL_TYPE_* */
+	BOOL readOnly;		/* GET_VOLUME_PROPERTIES, only queried when the volume appears or its type changes */
+	BOOL readOnlyTimedOut;	/* GET_VOLUME_PROPERTIES timed out: readOnly is unknown and queried again next time */
+} MOUNT_ENTRY;
+
+typedef struct
+{
+	unsigned __int32 ulMountedDrives;
+	MOUNT_ENTRY entries[26];
+} MOUNT_STATE;
+
+typedef enum
+{
+	MOUNT_EVENT_MOUNTED = 0,
+	MOUNT_EVENT_DISMOUNTED,
+	MOUNT_EVENT_REPLACED,		/* another volume now uses the drive letter */
+	MOUNT_EVENT_LABEL_CHANGED,
+	MOUNT_EVENT_VOLUME_TYPE_CHANGED,
+	MOUNT_EVENT_READ_ONLY_CHANGED
+} eMountEventType;
+
+typedef struct
+{
+	eMountEventType type;
+	int driveNo;
+	const MOUNT_ENTRY* pPrevious;	/* NULL for MOUNT_EVENT_MOUNTED */
+	const MOUNT_ENTRY* pCurrent;	/* NULL for MOUNT_EVENT_DISMOUNTED */
+} MOUNT_EVENT;
+
+// at most one mount, dismount or replacement per drive, or one event per changed field
+#define MAX_MOUNT_EVENTS	(26 * 3)
+
+// Query the driver for the new state. The volume properties are only queried for the volumes
+// that appeared or whose type changed, the other ones keep the readOnly value of pPrevious.
+BOOL QueryMountState (CVcDriver& driver, const MOUNT_STATE* pPrevious, MOUNT_STATE& state);
+// Events leading from previous to current, in drive order. They point to the entries of both states.
+int DiffMountStates (const MOUNT_STATE& previous, const MOUNT_STATE& current, MOUNT_EVENT* pEvents);
+
+// source of the notifications of possible changes
+class CMountEventSource
+{
+public:
+	virtual ~CMountEventSource () {}
+	// wait for a notification during at most dwTimeoutMs: TRUE if notified, FALSE on timeout
+	virtual BOOL Wait (DWORD dwTimeoutMs) = 0;
+	virtual LPCTSTR GetName () const = 0;
+};
+
+// Device arrival/removal notifications on Windows (broadcast by VeraCrypt on mount and dismount),
+// scripted mounts and dismounts for the simulated driver, plain polling otherwise.
+CMountEventSource* CreateMountEventSource (CVcDriver& driver);
+
+// Print the events until iCount events are reported (0 = forever). dwPollMs is the interval of
+// the checks made without notification.
+int RunMountEvents (CVcDriver& driver, DWORD dwPollMs, int iCount, eOutputFormat format);
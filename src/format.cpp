@@ -0,0 +1,472 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "format.h"
+#include "schema.h"
+#include "utf8.h"
+#include "trace.h"
+#include <stdarg.h>
+#include <string>
+#ifdef _WIN32
+#include <io.h>
+#include <strsafe.h>
+#endif
+
+COutputBuffer::COutputBuffer (size_t cbInitial) : m_pbData (NULL), m_cbData (0), m_cbAllocated (0)
+{
+    Reserve (cbInitial);
+}
+
+COutputBuffer::~COutputBuffer ()
+{
+    free (m_pbData);
+}
+
+void COutputBuffer::Reserve (size_t cbNeeded)
+{
+    if (cbNeeded <= m_cbAllocated)
+        return;
+
+    size_t cbNew = m_cbAllocated? m_cbAllocated : 4096;
+    while (cbNew < cbNeeded)
+        cbNew *= 2;
+
+    char* pbNew = (char*) realloc (m_pbData, cbNew);
+    if (!pbNew)
+    {
+        _tprintf (TEXT("Error: out of memory.\n"));
+        exit (VC_STATUS_DRIVER_CALL_FAILED);
+    }
+    m_pbData = pbNew;
+    m_cbAllocated = cbNew;
+}
+
+void COutputBuffer::Append (const char* szData, size_t cbData)
+{
+    Reserve (m_cbData + cbData);
+    memcpy (m_pbData + m_cbData, szData, cbData);
+    m_cbData += cbData;
+}
+
+void COutputBuffer::AppendFormat (const char* szFormat, ...)
+{
+    va_list args;
+    int cbWritten;
+
+    Reserve (m_cbData + 256);
+    va_start (args, szFormat);
+    cbWritten = vsnprintf (m_pbData + m_cbData, m_cbAllocated - m_cbData, szFormat, args);
+    va_end (args);
+
+    if (cbWritten >= (int) (m_cbAllocated - m_cbData))
+    {
+        Reserve (m_cbData + cbWritten + 1);
+        va_start (args, szFormat);
+        cbWritten = vsnprintf (m_pbData + m_cbData, m_cbAllocated - m_cbData, szFormat, args);
+        va_end (args);
+    }
+
+    if (cbWritten > 0)
+        m_cbData += cbWritten;
+}
+
+void COutputBuffer::AppendUtf16 (const WCHAR* wszValue, size_t cchMax)
+{
+    size_t cch = cchMax;
+
+    // 3 bytes at most per UTF-16 code unit
+    if (cchMax == (size_t) -1)
+    {
+        for (cch = 0; wszValue[cch]; cch++)
+            ;
+    }
+    Reserve (m_cbData + 3 * cch + 1);
+    m_cbData += Utf16ToUtf8 (wszValue, cch, m_pbData + m_cbData, 3 * cch + 1);
+}
+
+// write the whole buffer with a single system call (bypassing the CRT text mode translation)
+BOOL COutputBuffer::Write (FILE* f)
+{
+    CTraceScope scope ("write output", "output");
+    size_t cbDone = 0;
+
+    fflush (f);
+    while (cbDone < m_cbData)
+    {
+#ifdef _WIN32
+        DWORD cbWritten = 0;
+        if (!WriteFile ((HANDLE) _get_osfhandle (_fileno (f)), m_pbData + cbDone, (DWORD) (m_cbData - cbDone), &cbWritten, NULL) || cbWritten == 0)
+            return FALSE;
+#else
+        ssize_t cbWritten = write (fileno (f), m_pbData + cbDone, m_cbData - cbDone);
+        if (cbWritten <= 0)
+            return FALSE;
+#endif
+        cbDone += cbWritten;
+    }
+
+    return TRUE;
+}
+
+BOOL COutputBuffer::WriteText (FILE* f)
+{
+    CTraceScope scope ("write text", "output");
+#ifdef _WIN32
+    HANDLE hOutput = (HANDLE) _get_osfhandle (_fileno (f));
+    DWORD dwMode;
+
+    if (GetConsoleMode (hOutput, &dwMode))
+    {
+        int cchText = m_cbData? MultiByteToWideChar (CP_UTF8, 0, m_pbData, (int) m_cbData, NULL, 0) : 0;
+        WCHAR* wszText = (WCHAR*) malloc ((cchText + 1) * sizeof (WCHAR));
+        DWORD cchWritten = 0;
+        BOOL bResult;
+
+        if (!wszText)
+            return FALSE;
+        MultiByteToWideChar (CP_UTF8, 0, m_pbData, (int) m_cbData, wszText, cchText);
+        fflush (f);
+        bResult = (cchText == 0) || WriteConsoleW (hOutput, wszText, cchText, &cchWritten, NULL);
+        free (wszText);
+        return bResult;
+    }
+    else
+    {
+        COutputBuffer crlf (m_cbData + m_cbData / 16);
+        const char* pLine = m_pbData;
+        const char* pEnd = m_pbData + m_cbData;
+        const char* pNewLine;
+
+        while ((pNewLine = (const char*) memchr (pLine, '\n', pEnd - pLine)) != NULL)
+        {
+            crlf.Append (pLine, pNewLine - pLine);
+            crlf.Append ("\r\n", 2);
+            pLine = pNewLine + 1;
+        }
+        crlf.Append (pLine, pEnd - pLine);
+        return crlf.Write (f);
+    }
+#else
+    return Write (f);
+#endif
+}
+
+CRecordWriter::CRecordWriter (COutputBuffer& out, eOutputFormat format) : m_Out (out), m_Format (format), m_Depth (0), m_bInList (FALSE)
+{
+    for (size_t i = 0; i < ARRAYSIZE (m_bFirst); i++)
+        m_bFirst[i] = TRUE;
+    m_szPrefix[0] = 0;
+    m_szList[0] = 0;
+}
+
+void CRecordWriter::BeginDocument (BOOL bHeader)
+{
+    if (m_Format == OUTPUT_JSON)
+        m_Out.Append ('{');
+    else if (m_Format == OUTPUT_CSV && bHeader)
+        m_Out.Append ("record,field,value\n");
+    m_Depth = 0;
+    m_bFirst[0] = TRUE;
+}
+
+void CRecordWriter::EndDocument ()
+{
+    if (m_Format == OUTPUT_JSON)
+        m_Out.Append ("}\n");
+}
+
+void CRecordWriter::BeginList (const char* szName)
+{
+    if (m_Format == OUTPUT_JSON)
+    {
+        BeginField (szName);
+        m_Out.Append ('[');
+    }
+    StringCbPrintfA (m_szList, sizeof (m_szList), "%s", szName);
+    m_bInList = TRUE;
+    m_bFirst[++m_Depth] = TRUE;
+}
+
+void CRecordWriter::EndList ()
+{
+    if (m_Format == OUTPUT_JSON)
+        m_Out.Append (']');
+    m_bInList = FALSE;
+    m_szList[0] = 0;
+    m_Depth--;
+}
+
+void CRecordWriter::BeginRecord (const char* szName, const char* szKey)
+{
+    if (m_Format == OUTPUT_JSON)
+    {
+        if (m_bInList)
+        {
+            if (!m_bFirst[m_Depth])
+                m_Out.Append (',');
+            m_bFirst[m_Depth] = FALSE;
+        }
+        else
+            BeginField (szName);
+        m_Out.Append ('{');
+    }
+
+    if (m_bInList)
+        StringCbPrintfA (m_szPrefix, sizeof (m_szPrefix), "%s.%s", m_szList, szKey? szKey : szName);
+    else
+        StringCbPrintfA (m_szPrefix, sizeof (m_szPrefix), "%s", szName);
+    m_bFirst[++m_Depth] = TRUE;
+}
+
+void CRecordWriter::EndRecord ()
+{
+    if (m_Format == OUTPUT_JSON)
+        m_Out.Append ('}');
+    m_szPrefix[0] = 0;
+    m_Depth--;
+}
+
+void CRecordWriter::BeginField (const char* szName)
+{
+    switch (m_Format)
+    {
+    case OUTPUT_JSON:
+        if (!m_bFirst[m_Depth])
+            m_Out.Append (',');
+        m_Out.Append ('"');
+        m_Out.Append (szName);
+        m_Out.Append ("\":");
+        break;
+    case OUTPUT_CSV:
+        m_Out.Append (m_szPrefix);
+        m_Out.Append (',');
+        m_Out.Append (szName);
+        m_Out.Append (',');
+        break;
+    default:
+        if (m_szPrefix[0])
+        {
+            m_Out.Append (m_szPrefix);
+            m_Out.Append ('.');
+        }
+        m_Out.Append (szName);
+        m_Out.Append ('=');
+        break;
+    }
+    m_bFirst[m_Depth] = FALSE;
+}
+
+void CRecordWriter::EndField ()
+{
+    if (m_Format != OUTPUT_JSON)
+        m_Out.Append ('\n');
+}
+
+// append a string value using the quoting rules of the output format
+BOOL CRecordWriter::NeedsEscaping (const char* pValue, size_t cbValue) const
+{
+    const unsigned char* p = (const unsigned char*) pValue;
+
+    for (size_t i = 0; i < cbValue; i++)
+    {
+        if (p[i] < 0x20 || (m_Format == OUTPUT_JSON && (p[i] == '"' || p[i] == '\\')) || (m_Format == OUTPUT_CSV && (p[i] == '"' || p[i] == ',')))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+void CRecordWriter::AppendEscaped (const char* szValue)
+{
+    const unsigned char* p = (const unsigned char*) szValue;
+
+    switch (m_Format)
+    {
+    case OUTPUT_JSON:
+        m_Out.Append ('"');
+        for (; *p; p++)
+        {
+            if (*p == '"' || *p == '\\')
+            {
+                m_Out.Append ('\\');
+                m_Out.Append ((char) *p);
+            }
+            else if (*p < 0x20)
+                m_Out.AppendFormat ("\\u%04x", *p);
+            else
+                m_Out.Append ((char) *p);
+        }
+        m_Out.Append ('"');
+        break;
+
+    case OUTPUT_CSV:
+        if (strpbrk (szValue, ",\"\r\n"))
+        {
+            m_Out.Append ('"');
+            for (; *p; p++)
+            {
+                if (*p == '"')
+                    m_Out.Append ('"');
+                m_Out.Append ((char) *p);
+            }
+            m_Out.Append ('"');
+        }
+        else
+            m_Out.Append (szValue);
+        break;
+
+    default:
+        // kv values extend to the end of the line: control characters can't be represented
+        for (; *p; p++)
+            m_Out.Append ((*p < 0x20)? '?' : (char) *p);
+        break;
+    }
+}
+
+void CRecordWriter::AppendRaw (const char* szValue)
+{
+    m_Out.Append (szValue);
+}
+
+void CRecordWriter::Int (const char* szName, __int64 value)
+{
+    BeginField (szName);
+    m_Out.AppendFormat ("%lld", (long long) value);
+    EndField ();
+}
+
+void CRecordWriter::UInt (const char* szName, unsigned __int64 value)
+{
+    BeginField (szName);
+    m_Out.AppendFormat ("%llu", (unsigned long long) value);
+    EndField ();
+}
+
+void CRecordWriter::Hex32 (const char* szName, unsigned __int32 value)
+{
+    char szValue[16];
+    StringCbPrintfA (szValue, sizeof (szValue), "0x%.8X", value);
+    String (szName, szValue);
+}
+
+void CRecordWriter::Double (const char* szName, double value)
+{
+    BeginField (szName);
+    m_Out.AppendFormat ("%.2f", value);
+    EndField ();
+}
+
+void CRecordWriter::Bool (const char* szName, BOOL value)
+{
+    BeginField (szName);
+    AppendRaw (value? "true" : "false");
+    EndField ();
+}
+
+void CRecordWriter::String (const char* szName, const char* szValue)
+{
+    BeginField (szName);
+    AppendEscaped (szValue);
+    EndField ();
+}
+
+void CRecordWriter::WideString (const char* szName, const WCHAR* wszValue, size_t cchMax)
+{
+    size_t cbStart;
+
+    BeginField (szName);
+    if (m_Format == OUTPUT_JSON)
+        m_Out.Append ('"');
+
+    // converted straight into the output, then escaped in the rare cases where it is needed
+    cbStart = m_Out.Size ();
+    m_Out.AppendUtf16 (wszValue, cchMax);
+    if (NeedsEscaping (m_Out.Data () + cbStart, m_Out.Size () - cbStart))
+    {
+        std::string value (m_Out.Data () + cbStart, m_Out.Size () - cbStart);
+        m_Out.Truncate ((m_Format == OUTPUT_JSON)? cbStart - 1 : cbStart);
+        AppendEscaped (value.c_str ());
+    }
+    else if (m_Format == OUTPUT_JSON)
+        m_Out.Append ('"');
+    EndField ();
+}
+
+void CRecordWriter::TString (const char* szName, LPCTSTR szValue)
+{
+#if defined (_WIN32) && defined (UNICODE)
+    WideString (szName, (const WCHAR*) szValue, (size_t) -1);
+#else
+    String (szName, szValue);
+#endif
+}
+
+void CRecordWriter::Bytes (const char* szName, const unsigned char* pbData, size_t cbData)
+{
+    static const char g_szHex[] = "0123456789ABCDEF";
+    char szValue[256];
+    size_t j = 0;
+
+    for (size_t i = 0; i < cbData && j + 2 < sizeof (szValue); i++)
+    {
+        szValue[j++] = g_szHex[pbData[i] >> 4];
+        szValue[j++] = g_szHex[pbData[i] & 0x0F];
+    }
+    szValue[j] = 0;
+    String (szName, szValue);
+}
+
+void CRecordWriter::Null (const char* szName)
+{
+    BeginField (szName);
+    if (m_Format == OUTPUT_JSON)
+        AppendRaw ("null");
+    EndField ();
+}
+
+BOOL ParseOutputFormat (LPCTSTR szName, eOutputFormat& format)
+{
+    if (_tcsicmp (szName, TEXT("text")) == 0)
+        format = OUTPUT_TEXT;
+    else if (_tcsicmp (szName, TEXT("json")) == 0)
+        format = OUTPUT_JSON;
+    else if (_tcsicmp (szName, TEXT("csv")) == 0)
+        format = OUTPUT_CSV;
+    else if (_tcsicmp (szName, TEXT("kv")) == 0)
+        format = OUTPUT_KV;
+    else
+        return FALSE;
+    return TRUE;
+}
+
+// every field of VOLUME_PROPERTIES_STRUCT, using the names of the driver structure
+void FormatVolumeInformation (CRecordWriter& writer, const VOLUME_PROPERTIES_STRUCT& prop)
+{
+    CTraceScope scope ("format volume", "format");
+    FormatSchemaFields (writer, g_VolumePropertiesSchema, &prop, sizeof (prop));
+}
+
+// every field of BootEncryptionStatus plus the computed state. Fields not returned by
+// older drivers (cbSize smaller than the structure) are reported as null.
+void FormatSystemEncryptionInformation (CRecordWriter& writer, BootEncryptionStatus& status, DWORD cbSize)
+{
+    static const char* g_szStateNames[] = { "Full", "Partial", "None" };
+    CTraceScope scope ("format sysenc", "format");
+    eSysEncState state = GetSystemEncryptionState (status);
+
+    writer.String ("state", g_szStateNames[state]);
+    writer.Double ("encryptedPercentage", GetSystemEncryptionPercentage (status, state));
+    writer.UInt ("cbSize", cbSize);
+    FormatSchemaFields (writer, g_BootEncryptionStatusSchema, &status, cbSize);
+}
+
+void FormatDriverError (CRecordWriter& writer, const char* szIoctl, DWORD dwError)
+{
+    writer.BeginRecord ("error");
+    writer.String ("ioctl", szIoctl);
+    writer.UInt ("code", dwError);
+    writer.EndRecord ();
+}
@@ -0,0 +1,106 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "defs.h"
+
+// output formats selected by /format
+typedef enum
+{
+	OUTPUT_TEXT = 0,
+	OUTPUT_JSON,
+	OUTPUT_CSV,
+	OUTPUT_KV
+} eOutputFormat;
+
+// version of the machine readable schema, incremented when fields are renamed or removed
+#define VC_OUTPUT_SCHEMA_VERSION	1
+
+// growable UTF-8 buffer written to the output with a single call
+class COutputBuffer
+{
+public:
+	COutputBuffer (size_t cbInitial = 64 * 1024);
+	~COutputBuffer ();
+
+	void Append (const char* szData, size_t cbData);
+	void Append (const char* szData) { Append (szData, strlen (szData)); }
+	void Append (char c) { Append (&c, 1); }
+	void AppendFormat (const char* szFormat, ...);
+	// UTF-8 conversion of a UTF-16 string of at most cchMax characters, written in place
+	void AppendUtf16 (const WCHAR* wszValue, size_t cchMax);
+	void Reset () { m_cbData = 0; }
+	void Truncate (size_t cbData) { if (cbData < m_cbData) m_cbData = cbData; }
+	const char* Data () const { return m_pbData; }
+	size_t Size () const { return m_cbData; }
+	BOOL Write (FILE* f);
+	// text report: written to the console as UTF-16, with the line endings of the CRT text mode otherwise
+	BOOL WriteText (FILE* f);
+
+protected:
+	void Reserve (size_t cbNeeded);
+
+	char* m_pbData;
+	size_t m_cbData;
+	size_t m_cbAllocated;
+
+private:
+	COutputBuffer (const COutputBuffer&);
+	COutputBuffer& operator= (const COutputBuffer&);
+};
+
+// Machine readable writer producing a document made of top level fields, records and lists of records.
+//   json: {"field":value,"record":{...},"list":[{...},...]}
+//   csv:  record,field,value (one line per field, the record of top level fields is empty)
+//   kv:   record.field=value
+// Records of a list are identified by szKey (e.g. the drive letter) in csv and kv.
+class CRecordWriter
+{
+public:
+	CRecordWriter (COutputBuffer& out, eOutputFormat format);
+
+	// bHeader: csv column names, omitted by the following documents of a stream (one document per line in json)
+	void BeginDocument (BOOL bHeader = TRUE);
+	void EndDocument ();
+	void BeginList (const char* szName);
+	void EndList ();
+	void BeginRecord (const char* szName, const char* szKey = NULL);
+	void EndRecord ();
+
+	void Int (const char* szName, __int64 value);
+	void UInt (const char* szName, unsigned __int64 value);
+	void Hex32 (const char* szName, unsigned __int32 value);
+	void Double (const char* szName, double value);
+	void Bool (const char* szName, BOOL value);
+	void String (const char* szName, const char* szValue);
+	void WideString (const char* szName, const WCHAR* wszValue, size_t cchMax);
+	// TCHAR strings like the names returned by GetEncryptionAlgorithmName
+	void TString (const char* szName, LPCTSTR szValue);
+	void Bytes (const char* szName, const unsigned char* pbData, size_t cbData);
+	void Null (const char* szName);
+
+protected:
+	void BeginField (const char* szName);
+	void EndField ();
+	BOOL NeedsEscaping (const char* pValue, size_t cbValue) const;
+	void AppendEscaped (const char* szValue);
+	void AppendRaw (const char* szValue);
+
+	COutputBuffer& m_Out;
+	eOutputFormat m_Format;
+	int m_Depth;
+	BOOL m_bFirst[4];
+	BOOL m_bInList;
+	char m_szPrefix[64];
+	char m_szList[32];
+};
+
+BOOL ParseOutputFormat (LPCTSTR szName, eOutputFormat& format);
+
+void FormatVolumeInformation (CRecordWriter& writer, const VOLUME_PROPERTIES_STRUCT& prop);
+void FormatSystemEncryptionInformation (CRecordWriter& writer, BootEncryptionStatus& status, DWORD cbSize);
+void FormatDriverError (CRecordWriter& writer, const char* szIoctl, DWORD dwError);
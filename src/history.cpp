@@ -0,0 +1,720 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "history.h"
+#include <atomic>
+#include <time.h>
+#ifdef _WIN32
+#include <strsafe.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+// the file is extended by this many blocks at a time
+#define HISTORY_GROW_BLOCKS		16
+
+static_assert (sizeof (HISTORY_FILE_HEADER) <= VC_HISTORY_HEADER_SIZE, "HISTORY_FILE_HEADER must fit in the header");
+static_assert (VC_COMPACT_MAX_SIZE + sizeof (HISTORY_RECORD_HEADER) + 8 <= VC_HISTORY_BLOCK_SIZE, "a snapshot must fit in a block");
+
+static size_t AlignRecordSize (size_t cbRecord)
+{
+    return (cbRecord + 7) & ~(size_t) 7;
+}
+
+// map the file, read-only or read-write when bWrite (created if needed)
+static BOOL OpenMapping (HISTORY_MAPPING& mapping, LPCTSTR szFile, BOOL bWrite)
+{
+    memset (&mapping, 0, sizeof (mapping));
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    mapping.hFile = CreateFile (szFile, bWrite? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        bWrite? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mapping.hFile == INVALID_HANDLE_VALUE)
+        return FALSE;
+    if (!GetFileSizeEx (mapping.hFile, &size))
+    {
+        CloseHandle (mapping.hFile);
+        mapping.hFile = NULL;
+        return FALSE;
+    }
+    // an empty file can't be mapped: the writer extends it first
+    mapping.cbView = (size_t) size.QuadPart;
+    if (mapping.cbView)
+    {
+        mapping.hMapping = CreateFileMapping (mapping.hFile, NULL, bWrite? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+        if (mapping.hMapping)
+            mapping.pView = (unsigned char*) MapViewOfFile (mapping.hMapping, bWrite? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+        if (!mapping.pView)
+        {
+            if (mapping.hMapping)
+                CloseHandle (mapping.hMapping);
+            CloseHandle (mapping.hFile);
+            mapping.hFile = mapping.hMapping = NULL;
+            return FALSE;
+        }
+    }
+#else
+    struct stat st;
+    mapping.fd = bWrite? open (szFile, O_RDWR | O_CREAT, 0644) : open (szFile, O_RDONLY);
+    if (mapping.fd < 0)
+        return FALSE;
+    if (fstat (mapping.fd, &st) != 0)
+    {
+        close (mapping.fd);
+        mapping.fd = -1;
+        return FALSE;
+    }
+    mapping.cbView = (size_t) st.st_size;
+    if (mapping.cbView)
+    {
+        void* pView = mmap (NULL, mapping.cbView, bWrite? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, mapping.fd, 0);
+        if (pView == MAP_FAILED)
+        {
+            close (mapping.fd);
+            mapping.fd = -1;
+            return FALSE;
+        }
+        mapping.pView = (unsigned char*) pView;
+    }
+#endif
+    return TRUE;
+}
+
+static void UnmapView (HISTORY_MAPPING& mapping)
+{
+    if (!mapping.pView)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile (mapping.pView);
+    CloseHandle (mapping.hMapping);
+    mapping.hMapping = NULL;
+#else
+    munmap (mapping.pView, mapping.cbView);
+#endif
+    mapping.pView = NULL;
+}
+
+static void CloseMapping (HISTORY_MAPPING& mapping)
+{
+    UnmapView (mapping);
+#ifdef _WIN32
+    if (mapping.hFile && mapping.hFile != INVALID_HANDLE_VALUE)
+        CloseHandle (mapping.hFile);
+    mapping.hFile = NULL;
+#else
+    if (mapping.fd >= 0)
+        close (mapping.fd);
+    mapping.fd = -1;
+#endif
+}
+
+// extend the file of a read-write mapping to cbSize and map it again
+static BOOL ResizeMapping (HISTORY_MAPPING& mapping, size_t cbSize)
+{
+    UnmapView (mapping);
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    size.QuadPart = (LONGLONG) cbSize;
+    if (!SetFilePointerEx (mapping.hFile, size, NULL, FILE_BEGIN) || !SetEndOfFile (mapping.hFile))
+        return FALSE;
+    mapping.hMapping = CreateFileMapping (mapping.hFile, NULL, PAGE_READWRITE, 0, 0, NULL);
+    if (!mapping.hMapping)
+        return FALSE;
+    mapping.pView = (unsigned char*) MapViewOfFile (mapping.hMapping, FILE_MAP_WRITE, 0, 0, 0);
+    if (!mapping.pView)
+    {
+        CloseHandle (mapping.hMapping);
+        mapping.hMapping = NULL;
+        return FALSE;
+    }
+#else
+    if (ftruncate (mapping.fd, (off_t) cbSize) != 0)
+        return FALSE;
+    void* pView = mmap (NULL, cbSize, PROT_READ | PROT_WRITE, MAP_SHARED, mapping.fd, 0);
+    if (pView == MAP_FAILED)
+        return FALSE;
+    mapping.pView = (unsigned char*) pView;
+#endif
+    mapping.cbView = cbSize;
+    return TRUE;
+}
+
+static BOOL IsValidHeader (const HISTORY_MAPPING& mapping)
+{
+    const HISTORY_FILE_HEADER* pHeader = (const HISTORY_FILE_HEADER*) mapping.pView;
+
+    return mapping.cbView >= VC_HISTORY_HEADER_SIZE
+        && pHeader->magic == VC_HISTORY_MAGIC
+        && pHeader->version == VC_HISTORY_VERSION
+        && pHeader->headerSize >= sizeof (HISTORY_FILE_HEADER)
+        && pHeader->blockSize >= VC_HISTORY_BLOCK_SIZE
+        && pHeader->cbUsed >= pHeader->headerSize
+        && pHeader->cbUsed <= mapping.cbView;
+}
+
+// Appends the records. Record times are kept increasing even if the wall clock goes back.
+class CHistoryWriter
+{
+public:
+    CHistoryWriter () : m_dwRollupSeconds (0), m_bRollupStarted (FALSE), m_RollupEndUs (0), m_bPrevious (FALSE)
+    {
+        memset (&m_Mapping, 0, sizeof (m_Mapping));
+#ifndef _WIN32
+        m_Mapping.fd = -1;
+#endif
+    }
+    ~CHistoryWriter () { CloseMapping (m_Mapping); }
+
+    BOOL Open (LPCTSTR szFile, DWORD dwRollupSeconds);
+    BOOL Append (const VC_SNAPSHOT& snapshot);
+    BOOL FlushRollup (unsigned __int64 timeUs);
+    unsigned __int64 GetUsedSize () { return Header ()->cbUsed; }
+
+protected:
+    HISTORY_FILE_HEADER* Header () { return (HISTORY_FILE_HEADER*) m_Mapping.pView; }
+    BOOL AppendRecord (eHistoryRecordType type, unsigned __int64 timeUs, const void* pData, size_t cbData);
+    void AddToRollup (const VC_SNAPSHOT& snapshot, unsigned __int64 timeUs);
+
+    HISTORY_MAPPING m_Mapping;
+    DWORD m_dwRollupSeconds;
+    BOOL m_bRollupStarted;
+    unsigned __int64 m_RollupEndUs;
+    HISTORY_ROLLUP m_Rollup;
+    HISTORY_ROLLUP_DRIVE m_RollupDrives[26];
+    BOOL m_bPrevious;
+    VOLUME_SAMPLE m_Previous;
+};
+
+BOOL CHistoryWriter::Open (LPCTSTR szFile, DWORD dwRollupSeconds)
+{
+    if (!OpenMapping (m_Mapping, szFile, TRUE))
+        return FALSE;
+
+    m_dwRollupSeconds = dwRollupSeconds;
+    if (m_Mapping.cbView == 0)
+    {
+        if (!ResizeMapping (m_Mapping, VC_HISTORY_HEADER_SIZE + HISTORY_GROW_BLOCKS * VC_HISTORY_BLOCK_SIZE))
+            return FALSE;
+        HISTORY_FILE_HEADER* pHeader = Header ();
+        memset (pHeader, 0, VC_HISTORY_HEADER_SIZE);
+        pHeader->magic = VC_HISTORY_MAGIC;
+        pHeader->version = VC_HISTORY_VERSION;
+        pHeader->headerSize = VC_HISTORY_HEADER_SIZE;
+        pHeader->blockSize = VC_HISTORY_BLOCK_SIZE;
+        pHeader->cbUsed = VC_HISTORY_HEADER_SIZE;
+        pHeader->createTimeUs = GetSystemTimeUs ();
+    }
+    else if (!IsValidHeader (m_Mapping))
+    {
+        SetLastError (ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    Header ()->rollupSeconds = dwRollupSeconds;
+    return TRUE;
+}
+
+BOOL CHistoryWriter::AppendRecord (eHistoryRecordType type, unsigned __int64 timeUs, const void* pData, size_t cbData)
+{
+    HISTORY_FILE_HEADER* pHeader = Header ();
+    size_t cbRecord = AlignRecordSize (sizeof (HISTORY_RECORD_HEADER) + cbData);
+    unsigned __int64 offset = pHeader->cbUsed;
+    unsigned __int64 blockEnd = pHeader->headerSize + ((offset - pHeader->headerSize) / pHeader->blockSize + 1) * pHeader->blockSize;
+    HISTORY_RECORD_HEADER* pRecord;
+
+    if (timeUs < pHeader->lastTimeUs)
+        timeUs = pHeader->lastTimeUs;
+    if (cbRecord > pHeader->blockSize)
+    {
+        SetLastError (ERROR_INSUFFICIENT_BUFFER);
+        return FALSE;
+    }
+
+    // the record goes to the next block, the end of this one is skipped
+    if (offset + cbRecord > blockEnd)
+    {
+        if (blockEnd - offset >= sizeof (HISTORY_RECORD_HEADER))
+        {
+            pRecord = (HISTORY_RECORD_HEADER*) (m_Mapping.pView + offset);
+            pRecord->cbRecord = (unsigned __int32) (blockEnd - offset);
+            pRecord->type = HISTORY_RECORD_PADDING;
+            pRecord->reserved = 0;
+            pRecord->timeUs = pHeader->lastTimeUs;
+        }
+        offset = blockEnd;
+    }
+
+    if (offset + cbRecord > m_Mapping.cbView)
+    {
+        if (!ResizeMapping (m_Mapping, (size_t) (blockEnd + HISTORY_GROW_BLOCKS * pHeader->blockSize)))
+            return FALSE;
+        pHeader = Header ();
+    }
+
+    pRecord = (HISTORY_RECORD_HEADER*) (m_Mapping.pView + offset);
+    memset (pRecord, 0, cbRecord);
+    pRecord->cbRecord = (unsigned __int32) cbRecord;
+    pRecord->type = (UINT16) type;
+    pRecord->timeUs = timeUs;
+    memcpy (pRecord + 1, pData, cbData);
+
+    // readers only consider the records before cbUsed
+    std::atomic_thread_fence (std::memory_order_release);
+    pHeader->lastTimeUs = timeUs;
+    pHeader->cbUsed = offset + cbRecord;
+    return TRUE;
+}
+
+void CHistoryWriter::AddToRollup (const VC_SNAPSHOT& snapshot, unsigned __int64 timeUs)
+{
+    if (!m_bRollupStarted)
+    {
+        unsigned __int64 periodUs = (unsigned __int64) m_dwRollupSeconds * 1000000;
+        memset (&m_Rollup, 0, sizeof (m_Rollup));
+        memset (m_RollupDrives, 0, sizeof (m_RollupDrives));
+        m_Rollup.startTimeUs = timeUs;
+        m_Rollup.minEncryptedPercentage = m_Rollup.maxEncryptedPercentage = -1.0;
+        m_RollupEndUs = (timeUs / periodUs + 1) * periodUs;
+        m_bRollupStarted = TRUE;
+    }
+
+    m_Rollup.snapshotCount++;
+    if (!snapshot.bConsistent)
+        m_Rollup.inconsistentCount++;
+    m_Rollup.mountedDrives |= snapshot.volumes.ulMountedDrives;
+
+    if (snapshot.bBootStatusValid)
+    {
+        BootEncryptionStatus status = snapshot.bootStatus;
+        double dPercentage = GetSystemEncryptionPercentage (status, GetSystemEncryptionState (status));
+        if (m_Rollup.minEncryptedPercentage < 0 || dPercentage < m_Rollup.minEncryptedPercentage)
+            m_Rollup.minEncryptedPercentage = dPercentage;
+        if (dPercentage > m_Rollup.maxEncryptedPercentage)
+            m_Rollup.maxEncryptedPercentage = dPercentage;
+    }
+
+    // bytes transferred since the previous snapshot, or since the mount for new volumes
+    for (int i = 0; i < 26; i++)
+    {
+        const VOLUME_PROPERTIES_STRUCT& prop = snapshot.volumes.prop[i];
+        VOLUME_DELTA delta;
+
+        if (!m_bPrevious)
+            continue;
+        ComputeVolumeDelta (m_Previous, snapshot.volumes, i, delta);
+        if (delta.change != VOLUME_UNCHANGED && delta.change != VOLUME_TIMED_OUT)
+            m_Rollup.mountChanges++;
+        if (!(snapshot.volumes.ulMountedDrives & (1 << i)))
+            continue;
+        if (delta.change == VOLUME_UNCHANGED || delta.change == VOLUME_TIMED_OUT)
+        {
+            m_RollupDrives[i].bytesRead += prop.totalBytesRead - m_Previous.prop[i].totalBytesRead;
+            m_RollupDrives[i].bytesWritten += prop.totalBytesWritten - m_Previous.prop[i].totalBytesWritten;
+        }
+        else
+        {
+            m_RollupDrives[i].bytesRead += prop.totalBytesRead;
+            m_RollupDrives[i].bytesWritten += prop.totalBytesWritten;
+        }
+    }
+
+    if (m_bPrevious)
+    {
+        VOLUME_SAMPLE previous = m_Previous;
+        m_Previous = snapshot.volumes;
+        CarryTimedOutVolumes (previous, m_Previous);
+    }
+    else
+        m_Previous = snapshot.volumes;
+    m_bPrevious = TRUE;
+}
+
+BOOL CHistoryWriter::FlushRollup (unsigned __int64 timeUs)
+{
+    unsigned char buffer[sizeof (HISTORY_ROLLUP) + 26 * sizeof (HISTORY_ROLLUP_DRIVE)];
+    size_t cbData = sizeof (HISTORY_ROLLUP);
+
+    if (!m_bRollupStarted)
+        return TRUE;
+    m_bRollupStarted = FALSE;
+
+    memcpy (buffer, &m_Rollup, sizeof (m_Rollup));
+    for (int i = 0; i < 26; i++)
+    {
+        if (m_Rollup.mountedDrives & (1 << i))
+        {
+            memcpy (buffer + cbData, &m_RollupDrives[i], sizeof (HISTORY_ROLLUP_DRIVE));
+            cbData += sizeof (HISTORY_ROLLUP_DRIVE);
+        }
+    }
+    return AppendRecord (HISTORY_RECORD_ROLLUP, timeUs, buffer, cbData);
+}
+
+BOOL CHistoryWriter::Append (const VC_SNAPSHOT& snapshot)
+{
+    static unsigned char encoded[VC_COMPACT_MAX_SIZE];
+    unsigned __int64 timeUs = GetSystemTimeUs ();
+    size_t cbEncoded;
+
+    if (timeUs < Header ()->lastTimeUs)
+        timeUs = Header ()->lastTimeUs;
+
+    // the rollup of a finished period is dated from its end
+    if (m_bRollupStarted && timeUs >= m_RollupEndUs && !FlushRollup (m_RollupEndUs))
+        return FALSE;
+
+    cbEncoded = EncodeSnapshot (snapshot, encoded, sizeof (encoded));
+    if (!cbEncoded || !AppendRecord (HISTORY_RECORD_SNAPSHOT, timeUs, encoded, cbEncoded))
+        return FALSE;
+
+    AddToRollup (snapshot, timeUs);
+    return TRUE;
+}
+
+CHistoryReader::CHistoryReader () : m_cbUsed (0)
+{
+    memset (&m_Mapping, 0, sizeof (m_Mapping));
+#ifndef _WIN32
+    m_Mapping.fd = -1;
+#endif
+}
+
+CHistoryReader::~CHistoryReader ()
+{
+    CloseMapping (m_Mapping);
+}
+
+BOOL CHistoryReader::Open (LPCTSTR szFile)
+{
+    if (!OpenMapping (m_Mapping, szFile, FALSE))
+        return FALSE;
+    if (!IsValidHeader (m_Mapping))
+    {
+        CloseMapping (m_Mapping);
+        SetLastError (ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+    // records appended after this point are not seen
+    m_cbUsed = GetHeader ()->cbUsed;
+    std::atomic_thread_fence (std::memory_order_acquire);
+    return TRUE;
+}
+
+const HISTORY_RECORD_HEADER* CHistoryReader::Validate (unsigned __int64 offset) const
+{
+    const HISTORY_RECORD_HEADER* pRecord;
+
+    if (offset + sizeof (HISTORY_RECORD_HEADER) > m_cbUsed)
+        return NULL;
+    pRecord = (const HISTORY_RECORD_HEADER*) (m_Mapping.pView + offset);
+    if (pRecord->cbRecord < sizeof (HISTORY_RECORD_HEADER) || (pRecord->cbRecord & 7) || offset + pRecord->cbRecord > m_cbUsed)
+        return NULL;
+    return pRecord;
+}
+
+const HISTORY_RECORD_HEADER* CHistoryReader::Next (const HISTORY_RECORD_HEADER* pRecord) const
+{
+    const HISTORY_FILE_HEADER* pHeader = GetHeader ();
+    unsigned __int64 offset = (const unsigned char*) pRecord - m_Mapping.pView;
+
+    for (;;)
+    {
+        unsigned __int64 blockEnd;
+
+        offset += pRecord->cbRecord;
+        blockEnd = pHeader->headerSize + ((offset - pHeader->headerSize) / pHeader->blockSize + 1) * pHeader->blockSize;
+        if (blockEnd - offset < sizeof (HISTORY_RECORD_HEADER))
+            offset = blockEnd;
+        pRecord = Validate (offset);
+        if (!pRecord || pRecord->type != HISTORY_RECORD_PADDING)
+            return pRecord;
+    }
+}
+
+const HISTORY_RECORD_HEADER* CHistoryReader::Seek (unsigned __int64 fromUs) const
+{
+    const HISTORY_FILE_HEADER* pHeader = GetHeader ();
+    unsigned __int64 blockCount = (m_cbUsed - pHeader->headerSize + pHeader->blockSize - 1) / pHeader->blockSize;
+    unsigned __int64 lo = 0, hi = blockCount;
+    const HISTORY_RECORD_HEADER* pRecord;
+
+    // last block starting before fromUs: only the first record of the visited blocks is read
+    while (hi - lo > 1)
+    {
+        unsigned __int64 mid = (lo + hi) / 2;
+        pRecord = Validate (pHeader->headerSize + mid * pHeader->blockSize);
+        if (pRecord && pRecord->timeUs < fromUs)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    pRecord = Validate (pHeader->headerSize + lo * pHeader->blockSize);
+    while (pRecord && (pRecord->timeUs < fromUs || pRecord->type == HISTORY_RECORD_PADDING))
+        pRecord = Next (pRecord);
+    return pRecord;
+}
+
+int RunHistoryLog (CVcDriver& driver, LPCTSTR szFile, DWORD dwIntervalMs, DWORD dwRollupSeconds, int iCount)
+{
+    static VC_SNAPSHOT snapshot;
+    CHistoryWriter writer;
+    unsigned __int64 nextUs;
+    int iLogged = 0;
+
+    if (!writer.Open (szFile, dwRollupSeconds))
+    {
+        _tprintf (TEXT("Failed to open history file %s. Error %s\n"), szFile, GetWin32ErrorStr (GetLastError ()));
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    _tprintf (TEXT("Logging a snapshot every %.1f seconds to %s (rollup every %u seconds)\n"), (double) dwIntervalMs / 1000.0, szFile, (unsigned int) dwRollupSeconds);
+    fflush (stdout);
+
+    nextUs = GetTimestampUs ();
+    for (;;)
+    {
+        if (!TakeSnapshot (driver, snapshot))
+            _tprintf (TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr (GetLastError ()));
+        else if (!writer.Append (snapshot))
+        {
+            _tprintf (TEXT("Failed to write to history file %s. Error %s\n"), szFile, GetWin32ErrorStr (GetLastError ()));
+            return VC_STATUS_INVALID_PARAMETER;
+        }
+        else
+            iLogged++;
+
+        if (iCount && iLogged >= iCount)
+            break;
+
+        SleepUntilNext (nextUs, dwIntervalMs);
+    }
+
+    // the current period is rolled up when logging stops
+    if (!writer.FlushRollup (GetSystemTimeUs ()))
+    {
+        _tprintf (TEXT("Failed to write to history file %s. Error %s\n"), szFile, GetWin32ErrorStr (GetLastError ()));
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    _tprintf (TEXT("%d snapshots logged, %I64u bytes used\n"), iLogged, writer.GetUsedSize ());
+    return VC_STATUS_OK;
+}
+
+static void FormatUtcTime (unsigned __int64 timeUs, char* szOut, size_t cbOut)
+{
+    time_t t = (time_t) (timeUs / 1000000);
+    struct tm tmUtc;
+#ifdef _WIN32
+    gmtime_s (&tmUtc, &t);
+#else
+    gmtime_r (&t, &tmUtc);
+#endif
+    StringCbPrintfA (szOut, cbOut, "%04d-%02d-%02d %02d:%02d:%02d.%03d", tmUtc.tm_year + 1900, tmUtc.tm_mon + 1, tmUtc.tm_mday,
+        tmUtc.tm_hour, tmUtc.tm_min, tmUtc.tm_sec, (int) ((timeUs / 1000) % 1000));
+}
+
+static void FormatDriveList (unsigned __int32 ulDrives, char* szOut, size_t cbOut)
+{
+    size_t cch = 0;
+
+    szOut[0] = 0;
+    for (int i = 0; i < 26 && cch + 3 < cbOut; i++)
+    {
+        if (ulDrives & (1 << i))
+        {
+            szOut[cch++] = (char) ('A' + i);
+            szOut[cch] = 0;
+        }
+    }
+}
+
+static void PrintHistoryRecord (const HISTORY_RECORD_HEADER* pRecord)
+{
+    static const TCHAR* g_szStateNames[] = { TEXT("Full"), TEXT("Partial"), TEXT("None") };
+    static VC_SNAPSHOT snapshot;
+    char szTime[32], szDrives[32];
+    const unsigned char* pbData = (const unsigned char*) (pRecord + 1);
+    size_t cbData = pRecord->cbRecord - sizeof (HISTORY_RECORD_HEADER);
+
+    FormatUtcTime (pRecord->timeUs, szTime, sizeof (szTime));
+    if (pRecord->type == HISTORY_RECORD_SNAPSHOT)
+    {
+        if (!DecodeSnapshot (pbData, cbData, snapshot))
+        {
+            _tprintf (TEXT("%hs  Snapshot  (invalid encoding)\n"), szTime);
+            return;
+        }
+        FormatDriveList (snapshot.volumes.ulMountedDrives, szDrives, sizeof (szDrives));
+        _tprintf (TEXT("%hs  Snapshot  volumes: %-10hs"), szTime, szDrives[0]? szDrives : "-");
+        if (snapshot.bBootStatusValid)
+        {
+            eSysEncState state = GetSystemEncryptionState (snapshot.bootStatus);
+            _tprintf (TEXT(" system: %s %.2f%%"), g_szStateNames[state], GetSystemEncryptionPercentage (snapshot.bootStatus, state));
+        }
+        _tprintf (TEXT("%s\n"), snapshot.bConsistent? TEXT("") : TEXT(" (inconsistent)"));
+    }
+    else if (pRecord->type == HISTORY_RECORD_ROLLUP && cbData >= sizeof (HISTORY_ROLLUP))
+    {
+        const HISTORY_ROLLUP* pRollup = (const HISTORY_ROLLUP*) pbData;
+        const HISTORY_ROLLUP_DRIVE* pDrive = (const HISTORY_ROLLUP_DRIVE*) (pRollup + 1);
+        char szStart[32];
+
+        FormatUtcTime (pRollup->startTimeUs, szStart, sizeof (szStart));
+        FormatDriveList (pRollup->mountedDrives, szDrives, sizeof (szDrives));
+        _tprintf (TEXT("%hs  Rollup    %u snapshots since %hs, %u inconsistent, %u mount changes, volumes: %hs"),
+            szTime, pRollup->snapshotCount, szStart, pRollup->inconsistentCount, pRollup->mountChanges, szDrives[0]? szDrives : "-");
+        if (pRollup->minEncryptedPercentage >= 0)
+            _tprintf (TEXT(", system encrypted %.2f%% to %.2f%%"), pRollup->minEncryptedPercentage, pRollup->maxEncryptedPercentage);
+        _tprintf (TEXT("\n"));
+
+        for (int i = 0; i < 26; i++)
+        {
+            if ((pRollup->mountedDrives & (1 << i)) && (const unsigned char*) (pDrive + 1) <= pbData + cbData)
+            {
+                _tprintf (TEXT("      %c: %I64u bytes read, %I64u bytes written\n"), TEXT('A') + i, pDrive->bytesRead, pDrive->bytesWritten);
+                pDrive++;
+            }
+        }
+    }
+}
+
+static void FormatHistoryRecord (CRecordWriter& writer, const HISTORY_RECORD_HEADER* pRecord)
+{
+    static const char* g_szStateNames[] = { "Full", "Partial", "None" };
+    static VC_SNAPSHOT snapshot;
+    char szTime[32], szDrives[32];
+    const unsigned char* pbData = (const unsigned char*) (pRecord + 1);
+    size_t cbData = pRecord->cbRecord - sizeof (HISTORY_RECORD_HEADER);
+
+    FormatUtcTime (pRecord->timeUs, szTime, sizeof (szTime));
+    writer.UInt ("timeUs", pRecord->timeUs);
+    writer.String ("time", szTime);
+    if (pRecord->type == HISTORY_RECORD_SNAPSHOT)
+    {
+        writer.String ("type", "snapshot");
+        if (DecodeSnapshot (pbData, cbData, snapshot))
+        {
+            FormatDriveList (snapshot.volumes.ulMountedDrives, szDrives, sizeof (szDrives));
+            writer.String ("mountedDrives", szDrives);
+            writer.Bool ("consistent", snapshot.bConsistent);
+            if (snapshot.bBootStatusValid)
+            {
+                eSysEncState state = GetSystemEncryptionState (snapshot.bootStatus);
+                writer.String ("sysencState", g_szStateNames[state]);
+                writer.Double ("encryptedPercentage", GetSystemEncryptionPercentage (snapshot.bootStatus, state));
+                writer.UInt ("cbBootStatus", snapshot.cbBootStatus);
+            }
+            else
+            {
+                writer.Null ("sysencState");
+                writer.Null ("encryptedPercentage");
+                writer.Null ("cbBootStatus");
+            }
+        }
+        else
+            writer.Bool ("valid", FALSE);
+    }
+    else if (pRecord->type == HISTORY_RECORD_ROLLUP && cbData >= sizeof (HISTORY_ROLLUP))
+    {
+        const HISTORY_ROLLUP* pRollup = (const HISTORY_ROLLUP*) pbData;
+        const HISTORY_ROLLUP_DRIVE* pDrive = (const HISTORY_ROLLUP_DRIVE*) (pRollup + 1);
+
+        writer.String ("type", "rollup");
+        writer.UInt ("startTimeUs", pRollup->startTimeUs);
+        writer.UInt ("snapshotCount", pRollup->snapshotCount);
+        writer.UInt ("inconsistentCount", pRollup->inconsistentCount);
+        writer.UInt ("mountChanges", pRollup->mountChanges);
+        FormatDriveList (pRollup->mountedDrives, szDrives, sizeof (szDrives));
+        writer.String ("mountedDrives", szDrives);
+        if (pRollup->minEncryptedPercentage >= 0)
+        {
+            writer.Double ("minEncryptedPercentage", pRollup->minEncryptedPercentage);
+            writer.Double ("maxEncryptedPercentage", pRollup->maxEncryptedPercentage);
+        }
+        else
+        {
+            writer.Null ("minEncryptedPercentage");
+            writer.Null ("maxEncryptedPercentage");
+        }
+        for (int i = 0; i < 26; i++)
+        {
+            if ((pRollup->mountedDrives & (1 << i)) && (const unsigned char*) (pDrive + 1) <= pbData + cbData)
+            {
+                char szName[32];
+                StringCbPrintfA (szName, sizeof (szName), "bytesRead%c", 'A' + i);
+                writer.UInt (szName, pDrive->bytesRead);
+                StringCbPrintfA (szName, sizeof (szName), "bytesWritten%c", 'A' + i);
+                writer.UInt (szName, pDrive->bytesWritten);
+                pDrive++;
+            }
+        }
+    }
+}
+
+int RunHistoryQuery (LPCTSTR szFile, unsigned __int64 fromUs, unsigned __int64 toUs, BOOL bRollupsOnly, eOutputFormat format)
+{
+    CHistoryReader reader;
+    COutputBuffer out;
+    CRecordWriter writer (out, format);
+    int iIndex = 0;
+
+    if (!reader.Open (szFile))
+    {
+        if (format == OUTPUT_TEXT)
+            _tprintf (TEXT("Failed to open history file %s. Error %s\n"), szFile, GetWin32ErrorStr (GetLastError ()));
+        else
+        {
+            writer.BeginDocument ();
+            writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+            FormatDriverError (writer, "OPEN_HISTORY", GetLastError ());
+            writer.Int ("exitCode", VC_STATUS_INVALID_PARAMETER);
+            writer.EndDocument ();
+            out.Write (stdout);
+        }
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    if (format != OUTPUT_TEXT)
+    {
+        writer.BeginDocument ();
+        writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+        writer.BeginList ("records");
+    }
+
+    for (const HISTORY_RECORD_HEADER* pRecord = reader.Seek (fromUs); pRecord && pRecord->timeUs <= toUs; pRecord = reader.Next (pRecord))
+    {
+        if (bRollupsOnly && pRecord->type != HISTORY_RECORD_ROLLUP)
+            continue;
+
+        if (format == OUTPUT_TEXT)
+            PrintHistoryRecord (pRecord);
+        else
+        {
+            char szKey[16];
+            StringCbPrintfA (szKey, sizeof (szKey), "%d", iIndex);
+            writer.BeginRecord ("record", szKey);
+            FormatHistoryRecord (writer, pRecord);
+            writer.EndRecord ();
+        }
+        iIndex++;
+    }
+
+    if (format != OUTPUT_TEXT)
+    {
+        writer.EndList ();
+        writer.Int ("exitCode", VC_STATUS_OK);
+        writer.EndDocument ();
+        out.Write (stdout);
+    }
+    else if (iIndex == 0)
+        _tprintf (TEXT("No records in this time range.\n"));
+
+    return VC_STATUS_OK;
+}
@@ -0,0 +1,109 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "compact.h"
+#include "format.h"
+
+// Append-only history log of compact snapshots, written and read through a memory mapping.
+//
+// The file starts with HISTORY_FILE_HEADER padded to headerSize, followed by blocks of blockSize
+// bytes. Records never cross a block boundary (the end of a block is skipped when the next record
+// doesn't fit) so that every block starts with a record: a time range is located with a binary
+// search over the first record of each block, then read in place. Record times are increasing.
+// Every rollupSeconds (aligned on the wall clock) a rollup record summarizes the snapshots of
+// the period, so that long ranges can be reviewed without going through every snapshot.
+
+#define VC_HISTORY_MAGIC		0x48535356	/* "VSSH" */
+#define VC_HISTORY_VERSION		1
+#define VC_HISTORY_HEADER_SIZE	4096
+#define VC_HISTORY_BLOCK_SIZE	65536
+
+typedef struct
+{
+	unsigned __int32 magic;
+	unsigned __int32 version;
+	unsigned __int32 headerSize;	/* offset of the first block */
+	unsigned __int32 blockSize;
+	unsigned __int64 cbUsed;		/* end of the last complete record: what follows is ignored */
+	unsigned __int32 rollupSeconds;
+	unsigned __int32 reserved;
+	unsigned __int64 createTimeUs;
+	unsigned __int64 lastTimeUs;	/* time of the last record */
+} HISTORY_FILE_HEADER;
+
+typedef enum
+{
+	HISTORY_RECORD_PADDING = 0,
+	HISTORY_RECORD_SNAPSHOT = 1,	/* compact snapshot (see compact.h) */
+	HISTORY_RECORD_ROLLUP = 2		/* HISTORY_ROLLUP followed by a HISTORY_ROLLUP_DRIVE for each drive of mountedDrives */
+} eHistoryRecordType;
+
+typedef struct
+{
+	unsigned __int32 cbRecord;	/* header included, multiple of 8 */
+	UINT16 type;
+	UINT16 reserved;
+	unsigned __int64 timeUs;	/* microseconds since 1970-01-01 UTC */
+} HISTORY_RECORD_HEADER;
+
+typedef struct
+{
+	unsigned __int64 startTimeUs;	/* time of the first snapshot of the period */
+	unsigned __int32 snapshotCount;
+	unsigned __int32 inconsistentCount;
+	unsigned __int32 mountedDrives;	/* drives mounted in at least one snapshot */
+	unsigned __int32 mountChanges;	/* mounts, dismounts and remounts between the snapshots */
+	double minEncryptedPercentage;	/* system encryption, negative if never reported */
+	double maxEncryptedPercentage;
+} HISTORY_ROLLUP;
+
+typedef struct
+{
+	unsigned __int64 bytesRead;		/* during the period, across remounts */
+	unsigned __int64 bytesWritten;
+} HISTORY_ROLLUP_DRIVE;
+
+// memory mapping of a history file
+typedef struct
+{
+	unsigned char* pView;
+	size_t cbView;
+#ifdef _WIN32
+	HANDLE hFile;
+	HANDLE hMapping;
+#else
+	int fd;
+#endif
+} HISTORY_MAPPING;
+
+// Zero-copy reader: records are returned as pointers in the mapping of the file
+class CHistoryReader
+{
+public:
+	CHistoryReader ();
+	~CHistoryReader ();
+
+	BOOL Open (LPCTSTR szFile);
+	// first record at or after fromUs, NULL if none
+	const HISTORY_RECORD_HEADER* Seek (unsigned __int64 fromUs) const;
+	const HISTORY_RECORD_HEADER* Next (const HISTORY_RECORD_HEADER* pRecord) const;
+	const HISTORY_FILE_HEADER* GetHeader () const { return (const HISTORY_FILE_HEADER*) m_Mapping.pView; }
+
+protected:
+	const HISTORY_RECORD_HEADER* Validate (unsigned __int64 offset) const;
+
+	HISTORY_MAPPING m_Mapping;
+	unsigned __int64 m_cbUsed;
+};
+
+// Take a snapshot every dwIntervalMs and append it to szFile (created if needed) until iCount
+// snapshots are logged (0 = no limit).
+int RunHistoryLog (CVcDriver& driver, LPCTSTR szFile, DWORD dwIntervalMs, DWORD dwRollupSeconds, int iCount);
+
+// Print the records of szFile logged between fromUs and toUs, only the rollups if bRollupsOnly.
+int RunHistoryQuery (LPCTSTR szFile, unsigned __int64 fromUs, unsigned __int64 toUs, BOOL bRollupsOnly, eOutputFormat format);
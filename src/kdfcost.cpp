@@ -0,0 +1,136 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "kdfcost.h"
+#include "pbkdf2.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// each PRF is timed over at least this duration, then all of them concurrently over about the second one
+#define KDF_CALIBRATION_NS		100000000ULL
+#define KDF_CONCURRENT_NS		1000000000ULL
+
+// the password and salt only have to be of the usual size: the cost does not depend on their value
+static const unsigned char g_KdfPassword[] = "VeraStatus KDF benchmark";
+static unsigned char g_KdfSalt[64];
+
+static int GetHeaderKeyBlocks (int pkcs5)
+{
+    size_t cbDigest = GetPrfDigestSize (pkcs5);
+    return (int) ((PRF_HEADER_KEY_SIZE + cbDigest - 1) / cbDigest);
+}
+
+static void DeriveHeaderKey (int pkcs5, int iterations)
+{
+    unsigned char key[PRF_HEADER_KEY_SIZE];
+    DerivePbkdf2 (pkcs5, g_KdfPassword, sizeof (g_KdfPassword) - 1, g_KdfSalt, sizeof (g_KdfSalt), iterations, key, sizeof (key));
+}
+
+// nanoseconds per iteration for one block of PRF output, doubling the iterations until the run is long enough
+static double MeasureIterationNs (int pkcs5)
+{
+    unsigned char key[64];
+    size_t cbKey = GetPrfDigestSize (pkcs5);
+
+    for (int iterations = 1000; ; iterations *= 2)
+    {
+        unsigned __int64 startNs = GetTimestampNs (), elapsedNs;
+
+        DerivePbkdf2 (pkcs5, g_KdfPassword, sizeof (g_KdfPassword) - 1, g_KdfSalt, sizeof (g_KdfSalt), iterations, key, cbKey);
+        elapsedNs = GetTimestampNs () - startNs;
+        if (elapsedNs >= KDF_CALIBRATION_NS || iterations >= (1 << 24))
+            return (double) elapsedNs / iterations;
+    }
+}
+
+// VeraCrypt derives the header key with every PRF in its thread pool and tries them as they complete:
+// in the worst case the right one completes last. Returns the wall time of the run and its thread count.
+static unsigned __int64 RunConcurrentDerivations (const int* iterations, unsigned int* pThreadCount)
+{
+    const int prfCount = PRF_LAST_ID - PRF_FIRST_ID + 1;
+    std::atomic<int> nextPrf (PRF_FIRST_ID);
+    std::vector<std::thread> workers;
+    unsigned int threadCount = std::min<unsigned int> (std::thread::hardware_concurrency (), prfCount);
+    unsigned __int64 startNs = GetTimestampNs ();
+
+    for (unsigned int t = 0; t < threadCount; t++)
+    {
+        workers.push_back (std::thread ([iterations, &nextPrf] ()
+        {
+            for (int prf = nextPrf++; prf <= PRF_LAST_ID; prf = nextPrf++)
+                DeriveHeaderKey (prf, iterations[prf - PRF_FIRST_ID]);
+        }));
+    }
+    for (size_t t = 0; t < workers.size (); t++)
+        workers[t].join ();
+
+    *pThreadCount = threadCount;
+    return GetTimestampNs () - startNs;
+}
+
+int RunKdfCost (const VOLUME_PROPERTIES_STRUCT& prop)
+{
+    const int prfCount = PRF_LAST_ID - PRF_FIRST_ID + 1;
+    // a partition of the system drive mounted outside of system encryption uses the pre-boot iterations
+    BOOL bBoot = prop.partitionInInactiveSysEncScope;
+    BOOL bKnownPrf = GetPrfDigestSize (prop.pkcs5) != 0;
+    double iterationNs[prfCount], sequentialNs = 0.0, scale;
+    int autoIterations[prfCount], scaledIterations[prfCount];
+    unsigned int coreCount = std::thread::hardware_concurrency (), threadCount = 0;
+    unsigned __int64 concurrentNs;
+
+    for (size_t i = 0; i < sizeof (g_KdfSalt); i++)
+        g_KdfSalt[i] = (unsigned char) i;
+
+    _tprintf (TEXT("Drive letter: %c:\n"), TEXT('A') + prop.driveNo);
+    _tprintf (TEXT("PKCS-5 PRF: %s\n"), GetPrfAlgorithmName (prop.pkcs5));
+    if (prop.volumePim > 0)
+        _tprintf (TEXT("PKCS-5 iterations: %d (PIM %d)\n"), prop.pkcs5Iterations, prop.volumePim);
+    else
+        _tprintf (TEXT("PKCS-5 iterations: %d (default PIM)\n"), prop.pkcs5Iterations);
+
+    _tprintf (TEXT("\nPBKDF2 on this machine (%d bytes of header key):\n"), PRF_HEADER_KEY_SIZE);
+    _tprintf (TEXT("   %-16s %10s %12s %12s\n"), TEXT("PRF"), TEXT("Iterations"), TEXT("Iteration"), TEXT("Derivation"));
+    for (int prf = PRF_FIRST_ID; prf <= PRF_LAST_ID; prf++)
+    {
+        int i = prf - PRF_FIRST_ID;
+        // the iterations the PRF would use with the PIM of the volume when it is auto-detected
+        autoIterations[i] = (prf == prop.pkcs5 && prop.pkcs5Iterations > 0)? prop.pkcs5Iterations : GetPkcs5IterationCount (prf, prop.volumePim, bBoot);
+        iterationNs[i] = MeasureIterationNs (prf) * GetHeaderKeyBlocks (prf);
+        sequentialNs += iterationNs[i] * autoIterations[i];
+        _tprintf (TEXT("   %-16s %10d %9.3f us %9.0f ms\n"), GetPrfAlgorithmName (prf), autoIterations[i],
+            iterationNs[i] / 1000.0, iterationNs[i] * autoIterations[i] / 1000000.0);
+    }
+
+    _tprintf (TEXT("\n"));
+    if (bKnownPrf)
+    {
+        int i = prop.pkcs5 - PRF_FIRST_ID;
+        // the iterations grow linearly with the PIM: PIM 0 (the default count) is not on the line
+        int pim = std::max (1, prop.volumePim);
+        int pimStep = GetPkcs5IterationCount (prop.pkcs5, pim + 1, bBoot) - GetPkcs5IterationCount (prop.pkcs5, pim, bBoot);
+        _tprintf (TEXT("Header key derivation with %s: %.0f ms\n"), GetPrfAlgorithmName (prop.pkcs5), iterationNs[i] * autoIterations[i] / 1000000.0);
+        _tprintf (TEXT("Each PIM unit adds %d iterations: %.1f ms\n"), pimStep, iterationNs[i] * pimStep / 1000000.0);
+    }
+    else
+        _tprintf (TEXT("The PRF is not reported by the driver: only the auto-detection cost is predicted.\n"));
+
+    _tprintf (TEXT("PRF auto-detection, worst case on 1 core: %.0f ms\n"), sequentialNs / 1000000.0);
+    if (coreCount > 1)
+    {
+        // the concurrent run is scaled down to about KDF_CONCURRENT_NS and its time scaled back up
+        scale = std::min (1.0, (double) KDF_CONCURRENT_NS / sequentialNs);
+        for (int i = 0; i < prfCount; i++)
+            scaledIterations[i] = std::max (1, (int) (autoIterations[i] * scale));
+        concurrentNs = RunConcurrentDerivations (scaledIterations, &threadCount);
+        _tprintf (TEXT("PRF auto-detection, worst case on %u cores: %.0f ms (%d PRFs derived by %u threads)\n"),
+            coreCount, (double) concurrentNs / scale / 1000000.0, prfCount, threadCount);
+    }
+    return VC_STATUS_OK;
+}
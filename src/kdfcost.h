@@ -0,0 +1,15 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "defs.h"
+
+// Header key derivation cost of a mounted volume (/kdfcost): PBKDF2 is benchmarked on this machine
+// for each PRF and the cost is predicted for the iterations of the volume, when its PRF is given at
+// mount time and, in the worst case, when all the PRFs must be tried (auto-detection) on one core
+// and concurrently on all of them.
+int RunKdfCost (const VOLUME_PROPERTIES_STRUCT& prop);
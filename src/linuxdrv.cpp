@@ -0,0 +1,427 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "linuxdrv.h"
+
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+
+#define LINUX_SECTOR_SIZE		512
+#define LINUX_MAX_CASCADE		4		/* device-mapper devices stacked on each other */
+#define LINUX_LOOP_ID_BASE		10000	/* uniqueId of the FUSE volumes, after those of the dm devices */
+
+static const char g_szDmPrefix[] = "veracrypt";
+static const char g_szFusePrefix[] = "/.veracrypt_auxmnt";
+static const char g_szFuseSuffix[] = "/volume";
+static const char g_szFuseControl[] = "/control";
+
+// content of a small sysfs file without its trailing new line, empty if it can't be read
+static std::string ReadSysfsFile (const std::string& path)
+{
+    char buffer[4096];
+    int fd = open (path.c_str (), O_RDONLY | O_CLOEXEC);
+    ssize_t cbRead;
+
+    if (fd < 0)
+        return std::string ();
+    cbRead = read (fd, buffer, sizeof (buffer));
+    close (fd);
+    if (cbRead <= 0)
+        return std::string ();
+    while (cbRead > 0 && (buffer[cbRead - 1] == '\n' || buffer[cbRead - 1] == ' '))
+        cbRead--;
+    return std::string (buffer, cbRead);
+}
+
+// N of szPrefix followed by a number N and szSuffix, 0 if the name doesn't match
+static int ParseSlot (const char* szName, const char* szPrefix, const char* szSuffix)
+{
+    size_t cchPrefix = strlen (szPrefix);
+    char* pEnd;
+    long slot;
+
+    if (strncmp (szName, szPrefix, cchPrefix) != 0 || !isdigit ((unsigned char) szName[cchPrefix]))
+        return 0;
+    slot = strtol (szName + cchPrefix, &pEnd, 10);
+    return (strcmp (pEnd, szSuffix) == 0 && slot > 0 && slot <= 64)? (int) slot : 0;
+}
+
+// UTF-8 path to the UTF-16 buffer of the driver structures, truncated if needed
+static void Utf8ToUtf16 (const std::string& s, WCHAR* wszDest, size_t cchDest)
+{
+    const unsigned char* p = (const unsigned char*) s.c_str ();
+    size_t j = 0;
+
+    while (*p && j + 1 < cchDest)
+    {
+        unsigned int cp;
+        int extra;
+
+        if (*p < 0x80) { cp = *p; extra = 0; }
+        else if ((*p & 0xE0) == 0xC0) { cp = *p & 0x1F; extra = 1; }
+        else if ((*p & 0xF0) == 0xE0) { cp = *p & 0x0F; extra = 2; }
+        else if ((*p & 0xF8) == 0xF0) { cp = *p & 0x07; extra = 3; }
+        else { cp = 0xFFFD; extra = 0; }
+        p++;
+        for (; extra > 0; extra--, p++)
+        {
+            if ((*p & 0xC0) != 0x80)
+            {
+                cp = 0xFFFD;
+                break;
+            }
+            cp = (cp << 6) | (*p & 0x3F);
+        }
+
+        if (cp >= 0x10000)
+        {
+            if (j + 2 >= cchDest)
+                break;
+            cp -= 0x10000;
+            wszDest[j++] = (WCHAR) (0xD800 + (cp >> 10));
+            wszDest[j++] = (WCHAR) (0xDC00 + (cp & 0x3FF));
+        }
+        else
+            wszDest[j++] = (WCHAR) cp;
+    }
+    wszDest[j] = 0;
+}
+
+static unsigned __int64 ReadBigEndian64 (const unsigned char* p)
+{
+    unsigned __int64 value = 0;
+    for (int i = 0; i < 8; i++)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+// Container path of a FUSE volume, read from the control file of its auxiliary mount, which holds
+// the MountedVolume serialized by VeraCrypt: each field is its name then its value, strings being
+// a big endian 64-bit size followed by their bytes (NUL included), and "Path" a wchar_t (UTF-32)
+// string. Empty if the file can't be read: only the user who mounted the volume and root can.
+static std::string ReadFuseVolumePath (const std::string& controlPath)
+{
+    static const unsigned char fieldName[] = { 0, 0, 0, 0, 0, 0, 0, 5, 'P', 'a', 't', 'h', 0 };
+    std::vector<unsigned char> data (64 * 1024);
+    std::string path;
+    int fd = open (controlPath.c_str (), O_RDONLY | O_CLOEXEC);
+    ssize_t cbRead;
+
+    if (fd < 0)
+        return path;
+    cbRead = read (fd, &data[0], data.size ());
+    close (fd);
+    if (cbRead <= 0)
+        return path;
+    data.resize ((size_t) cbRead);
+
+    std::vector<unsigned char>::iterator it = std::search (data.begin (), data.end (), fieldName, fieldName + sizeof (fieldName));
+    size_t offset = (size_t) (it - data.begin ()) + sizeof (fieldName);
+    if (it == data.end () || offset + 8 > data.size ())
+        return path;
+    unsigned __int64 cbValue = ReadBigEndian64 (&data[offset]);
+    offset += 8;
+    if (cbValue % 4 != 0 || cbValue > data.size () - offset)
+        return path;
+
+    // UTF-32 in the byte order of the machine, to UTF-8
+    for (size_t i = 0; i < cbValue / 4; i++)
+    {
+        unsigned __int32 cp;
+        memcpy (&cp, &data[offset + i * 4], 4);
+        if (cp == 0)
+            break;
+        if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+            cp = 0xFFFD;
+        if (cp < 0x80)
+            path += (char) cp;
+        else if (cp < 0x800)
+        {
+            path += (char) (0xC0 | (cp >> 6));
+            path += (char) (0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            path += (char) (0xE0 | (cp >> 12));
+            path += (char) (0x80 | ((cp >> 6) & 0x3F));
+            path += (char) (0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            path += (char) (0xF0 | (cp >> 18));
+            path += (char) (0x80 | ((cp >> 12) & 0x3F));
+            path += (char) (0x80 | ((cp >> 6) & 0x3F));
+            path += (char) (0x80 | (cp & 0x3F));
+        }
+    }
+    return path;
+}
+
+CLinuxDriver::CLinuxDriver (const std::string& root) : m_Root (root), m_ulMountedDrives (0), m_bScanned (FALSE)
+{
+    for (int i = 0; i < 26; i++)
+    {
+        m_Volumes[i].diskLength = 0;
+        m_Volumes[i].readOnly = FALSE;
+        m_Volumes[i].uniqueId = 0;
+        m_Volumes[i].statFd = -1;
+    }
+}
+
+CLinuxDriver::~CLinuxDriver ()
+{
+    for (int i = 0; i < 26; i++)
+    {
+        if (m_Volumes[i].statFd >= 0)
+            close (m_Volumes[i].statFd);
+    }
+}
+
+CLinuxDriver* CLinuxDriver::Open (LPCTSTR szSysfsRoot)
+{
+    std::string root = szSysfsRoot? szSysfsRoot : "/sys";
+    struct stat st;
+
+    if (stat ((root + "/block").c_str (), &st) != 0 || !S_ISDIR (st.st_mode))
+    {
+        SetLastError (ERROR_FILE_NOT_FOUND);
+        return NULL;
+    }
+    return new CLinuxDriver (root);
+}
+
+// file or device under a dm device: its slave, through the dm devices of a cipher cascade and
+// the loop device of a container file
+std::string CLinuxDriver::GetBackingPath (const std::string& device, int depth) const
+{
+    std::string slave;
+    DIR* pDir = opendir ((m_Root + "/block/" + device + "/slaves").c_str ());
+    struct dirent* pEntry;
+
+    if (!pDir)
+        return std::string ();
+    while ((pEntry = readdir (pDir)) != NULL)
+    {
+        if (pEntry->d_name[0] != '.')
+        {
+            slave = pEntry->d_name;
+            break;
+        }
+    }
+    closedir (pDir);
+
+    if (slave.empty ())
+        return std::string ();
+    if (slave.compare (0, 3, "dm-") == 0 && depth < LINUX_MAX_CASCADE)
+        return GetBackingPath (slave, depth + 1);
+    if (slave.compare (0, 4, "loop") == 0)
+    {
+        std::string backingFile = ReadSysfsFile (m_Root + "/block/" + slave + "/loop/backing_file");
+        if (!backingFile.empty ())
+            return backingFile;
+    }
+    return "/dev/" + slave;
+}
+
+// find the volumes of the slots, keeping the counters file of the devices that didn't change
+void CLinuxDriver::Scan ()
+{
+    LINUX_VOLUME volumes[26];
+    unsigned __int32 ulMountedDrives = 0;
+    std::string loopDevices[26];
+    DIR* pDir = opendir ((m_Root + "/block").c_str ());
+    struct dirent* pEntry;
+
+    while (pDir && (pEntry = readdir (pDir)) != NULL)
+    {
+        std::string device = pEntry->d_name;
+        int slot = 0;
+
+        if (device.compare (0, 3, "dm-") == 0)
+            slot = ParseSlot (ReadSysfsFile (m_Root + "/block/" + device + "/dm/name").c_str (), g_szDmPrefix, "");
+        else if (device.compare (0, 4, "loop") == 0)
+        {
+            // FUSE volumes: only used for the slots without dm device
+            std::string backingFile = ReadSysfsFile (m_Root + "/block/" + device + "/loop/backing_file");
+            size_t pos = backingFile.rfind (g_szFusePrefix);
+            int fuseSlot = (pos == std::string::npos)? 0 : ParseSlot (backingFile.c_str () + pos, g_szFusePrefix, g_szFuseSuffix);
+            if (fuseSlot > 0 && fuseSlot <= 26)
+                loopDevices[fuseSlot - 1] = device;
+            continue;
+        }
+
+        if (slot <= 0 || slot > 26)
+            continue;
+        volumes[slot - 1].device = device;
+        volumes[slot - 1].path = GetBackingPath (device, 0);
+        volumes[slot - 1].uniqueId = atoi (device.c_str () + 3) + 1;
+        ulMountedDrives |= 1 << (slot - 1);
+    }
+    if (pDir)
+        closedir (pDir);
+
+    for (int i = 0; i < 26; i++)
+    {
+        LINUX_VOLUME& volume = volumes[i];
+
+        if (!(ulMountedDrives & (1 << i)) && !loopDevices[i].empty ())
+        {
+            volume.device = loopDevices[i];
+            volume.path = ReadSysfsFile (m_Root + "/block/" + volume.device + "/loop/backing_file");
+            // the auxiliary volume file is reported if the container path can't be read
+            std::string containerPath = ReadFuseVolumePath (volume.path.substr (0, volume.path.size () - strlen (g_szFuseSuffix)) + g_szFuseControl);
+            if (!containerPath.empty ())
+                volume.path = containerPath;
+            volume.uniqueId = LINUX_LOOP_ID_BASE + atoi (volume.device.c_str () + 4);
+            ulMountedDrives |= 1 << i;
+        }
+
+        if (!(ulMountedDrives & (1 << i)))
+        {
+            volume.statFd = -1;
+            continue;
+        }
+        volume.diskLength = (unsigned __int64) strtoull (ReadSysfsFile (m_Root + "/block/" + volume.device + "/size").c_str (), NULL, 10) * LINUX_SECTOR_SIZE;
+        volume.readOnly = ReadSysfsFile (m_Root + "/block/" + volume.device + "/ro") == "1";
+
+        if (m_Volumes[i].statFd >= 0 && m_Volumes[i].device == volume.device)
+        {
+            volume.statFd = m_Volumes[i].statFd;
+            m_Volumes[i].statFd = -1;
+        }
+        else
+            volume.statFd = open ((m_Root + "/block/" + volume.device + "/stat").c_str (), O_RDONLY | O_CLOEXEC);
+    }
+
+    for (int i = 0; i < 26; i++)
+    {
+        if (m_Volumes[i].statFd >= 0)
+            close (m_Volumes[i].statFd);
+        m_Volumes[i] = volumes[i];
+    }
+    m_ulMountedDrives = ulMountedDrives;
+    m_bScanned = TRUE;
+}
+
+// sectors read and written (3rd and 7th fields of the block device stat file)
+BOOL CLinuxDriver::ReadCounters (int driveNo, VOLUME_PROPERTIES_STRUCT& prop)
+{
+    unsigned long long fields[7] = { 0 };
+    char buffer[256];
+    ssize_t cbRead;
+    char* p = buffer;
+
+    if (m_Volumes[driveNo].statFd < 0)
+        return FALSE;
+    cbRead = pread (m_Volumes[driveNo].statFd, buffer, sizeof (buffer) - 1, 0);
+    if (cbRead <= 0)
+        return FALSE;
+    buffer[cbRead] = 0;
+
+    for (int i = 0; i < 7; i++)
+        fields[i] = strtoull (p, &p, 10);
+    prop.totalBytesRead = fields[2] * LINUX_SECTOR_SIZE;
+    prop.totalBytesWritten = fields[6] * LINUX_SECTOR_SIZE;
+    return TRUE;
+}
+
+BOOL CLinuxDriver::IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    std::lock_guard<std::mutex> lock (m_Mutex);
+
+    *lpBytesReturned = 0;
+    switch (dwIoControlCode)
+    {
+    case VC_IOCTL_GET_DRIVER_VERSION:
+        if (nOutBufferSize < sizeof (LONG))
+            break;
+        *(LONG*) lpOutBuffer = VC_LINUX_DRIVER_VERSION;
+        *lpBytesReturned = sizeof (LONG);
+        return TRUE;
+
+    case VC_IOCTL_GET_MOUNTED_VOLUMES:
+        {
+            if (nOutBufferSize < sizeof (MOUNT_LIST_STRUCT))
+                break;
+            MOUNT_LIST_STRUCT* pList = (MOUNT_LIST_STRUCT*) lpOutBuffer;
+            Scan ();
+            memset (pList, 0, sizeof (MOUNT_LIST_STRUCT));
+            pList->ulMountedDrives = m_ulMountedDrives;
+            for (int i = 0; i < 26; i++)
+            {
+                if (m_ulMountedDrives & (1 << i))
+                {
+                    Utf8ToUtf16 (m_Volumes[i].path, pList->wszVolume[i], ARRAYSIZE (pList->wszVolume[i]));
+                    pList->diskLength[i] = m_Volumes[i].diskLength;
+                    pList->volumeType[i] = PROP_VOL_TYPE_NORMAL;
+                }
+            }
+            *lpBytesReturned = sizeof (MOUNT_LIST_STRUCT);
+            return TRUE;
+        }
+
+    case VC_IOCTL_GET_VOLUME_PROPERTIES:
+        {
+            if (nInBufferSize < sizeof (VOLUME_PROPERTIES_STRUCT) || nOutBufferSize < sizeof (VOLUME_PROPERTIES_STRUCT))
+                break;
+            int driveNo = ((VOLUME_PROPERTIES_STRUCT*) lpInBuffer)->driveNo;
+            VOLUME_PROPERTIES_STRUCT* pProp = (VOLUME_PROPERTIES_STRUCT*) lpOutBuffer;
+
+            if (!m_bScanned)
+                Scan ();
+            // the counters file of a dismounted device can't be read anymore
+            if (driveNo < 0 || driveNo >= 26 || !(m_ulMountedDrives & (1 << driveNo)))
+            {
+                SetLastError (ERROR_FILE_NOT_FOUND);
+                return FALSE;
+            }
+            memset (pProp, 0, sizeof (VOLUME_PROPERTIES_STRUCT));
+            if (!ReadCounters (driveNo, *pProp))
+            {
+                SetLastError (ERROR_FILE_NOT_FOUND);
+                return FALSE;
+            }
+            pProp->driveNo = driveNo;
+            pProp->uniqueId = m_Volumes[driveNo].uniqueId;
+            Utf8ToUtf16 (m_Volumes[driveNo].path, pProp->wszVolume, ARRAYSIZE (pProp->wszVolume));
+            pProp->diskLength = m_Volumes[driveNo].diskLength;
+            pProp->mode = 1;	/* XTS, the only mode of VeraCrypt volumes */
+            pProp->readOnly = m_Volumes[driveNo].readOnly;
+            *lpBytesReturned = sizeof (VOLUME_PROPERTIES_STRUCT);
+            return TRUE;
+        }
+
+    case VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS:
+        if (nOutBufferSize < sizeof (BootEncryptionStatus))
+            break;
+        memset (lpOutBuffer, 0, sizeof (BootEncryptionStatus));
+        *lpBytesReturned = sizeof (BootEncryptionStatus);
+        return TRUE;
+
+    case VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES:
+        SetLastError (ERROR_FILE_NOT_FOUND);
+        return FALSE;
+
+    case VC_IOCTL_GET_BOOT_LOADER_VERSION:
+    case VC_IOCTL_EMERGENCY_CLEAR_KEYS:
+        SetLastError (ERROR_NOT_SUPPORTED);
+        return FALSE;
+
+    default:
+        SetLastError (ERROR_INVALID_FUNCTION);
+        return FALSE;
+    }
+
+    SetLastError (ERROR_INSUFFICIENT_BUFFER);
+    return FALSE;
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+
+#ifndef _WIN32
+
+#include <string>
+
+// driver interface version reported by the Linux backend
+#define VC_LINUX_DRIVER_VERSION	0x0126
+
+// Linux backend answering the driver calls from sysfs. VeraCrypt slot N is reported as drive
+// number N - 1 (A: for slot 1), slots above 26 are ignored. A slot is mounted if it has a
+// device-mapper device named veracryptN (kernel cryptography), or else a loop device backed by the
+// volume file of its FUSE mount (/tmp/.veracrypt_auxmntN/volume).
+// The encryption algorithm and PRF are not available in sysfs and are reported as 0, the dm-crypt
+// table, which also holds the key, is never read. There is no system encryption on Linux.
+class CLinuxDriver : public CVcDriver
+{
+public:
+	// szSysfsRoot: mount point of sysfs, NULL for /sys. Returns NULL if it has no block directory.
+	static CLinuxDriver* Open (LPCTSTR szSysfsRoot);
+	virtual ~CLinuxDriver ();
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned);
+	// the keys are held by the kernel or the FUSE process of VeraCrypt: they can't be cleared from here
+	virtual BOOL SupportsIoControl (DWORD dwIoControlCode)
+	{
+		return dwIoControlCode != VC_IOCTL_EMERGENCY_CLEAR_KEYS && dwIoControlCode != VC_IOCTL_GET_BOOT_LOADER_VERSION;
+	}
+
+protected:
+	typedef struct
+	{
+		std::string device;		/* block device in sysfs, e.g. dm-3 */
+		std::string path;		/* container file or device */
+		unsigned __int64 diskLength;
+		BOOL readOnly;
+		int uniqueId;
+		int statFd;				/* <device>/stat, kept open to read the counters with a single pread */
+	} LINUX_VOLUME;
+
+	CLinuxDriver (const std::string& root);
+	std::string GetBackingPath (const std::string& device, int depth) const;
+	void Scan ();
+	BOOL ReadCounters (int driveNo, VOLUME_PROPERTIES_STRUCT& prop);
+
+	std::string m_Root;
+	unsigned __int32 m_ulMountedDrives;
+	LINUX_VOLUME m_Volumes[26];
+	BOOL m_bScanned;
+	std::mutex m_Mutex;
+};
+
+#endif
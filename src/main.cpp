@@ -11,246 +11,125 @@
  contained in the file License.txt included in VeraCrypt binary and source
  code distribution packages. */
 
-#include "defs.h"
+#include "common.h"
+#include "driver.h"
+#include "watch.h"
+#include "events.h"
+#include "alerts.h"
+#include "arm.h"
+#include "kdfcost.h"
+#include "cipherbench.h"
+#include "ciphers.h"
+#include "pbkdf2.h"
+#include "progress.h"
+#include "sampler.h"
+#include "metrics.h"
+#include "shared.h"
+#include "aggregate.h"
+#include "history.h"
+#include "snapshot.h"
+#include "format.h"
+#include "query.h"
+#include "serve.h"
+#include "trace.h"
+#ifdef _WIN32
 #include <strsafe.h>
+#endif
 
-// Exit codes values
-#define VC_STATUS_OK                    0
-#define VC_STATUS_NO_DRIVER             -1
-#define VC_STATUS_DRIVER_CALL_FAILED    -2
-#define VC_STATUS_INVALID_PARAMETER     -3
-#define VC_STATUS_SYSENC_PARTIAL         1
-#define VC_STATUS_SYSENC_NONE            2
-#define VC_STATUS_NOT_VOLUME             3
-
-// possible state values of system encryption
-typedef enum
+// time argument of /history: seconds since 1970-01-01 UTC, or relative to now when negative
+static BOOL ParseHistoryTime (LPCTSTR szValue, unsigned __int64& timeUs)
 {
-    SYSENC_FULL = 0,
-    SYSENC_PARTIAL = 1,
-    SYSENC_NONE = 2
-} eSysEncState;
+    TCHAR* szEnd = NULL;
+    double dSeconds = _tcstod (szValue, &szEnd);
+    if (szEnd == szValue || *szEnd)
+        return FALSE;
+    if (dSeconds < 0)
+        dSeconds += (double) GetSystemTimeUs () / 1000000.0;
+    if (dSeconds < 0)
+        return FALSE;
+    timeUs = (unsigned __int64) (dSeconds * 1000000.0);
+    return TRUE;
+}
 
-LPTSTR GetWin32ErrorStr (DWORD dwError)
+// value of /timeout and /deadline in seconds
+static BOOL ParseTimeout (LPCTSTR szValue, DWORD& dwTimeoutMs)
 {
-	LPTSTR lpMsgBuf = NULL;
-	static TCHAR g_szErrMsg[1024];	
-
-	FormatMessage (
-		FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-			      NULL,
-			      dwError,
-			      MAKELANGID (LANG_NEUTRAL, SUBLANG_DEFAULT),	/* Default language */
-			      (PWSTR) &lpMsgBuf,
-			      0,
-			      NULL
-	    );
-
-	if (lpMsgBuf)
-	{
-		LPTSTR szFormatMsg = (LPTSTR) lpMsgBuf;
-		size_t msgLen = _tcslen(szFormatMsg);
-		// remove ending \r\n
-		if (msgLen >= 1 && szFormatMsg[msgLen - 1] == TEXT('\n'))
-			szFormatMsg[msgLen - 1] = 0;
-		if (msgLen >= 2 && szFormatMsg[msgLen - 2] == TEXT('\r'))
-			szFormatMsg[msgLen - 2] = 0;
-		StringCchPrintf (g_szErrMsg, ARRAYSIZE (g_szErrMsg), TEXT("0x%.8X: %s"), dwError, szFormatMsg);
-	}
-	else
-	{
-		StringCchPrintf (g_szErrMsg, ARRAYSIZE (g_szErrMsg), TEXT("0x%.8X."), dwError);
-	}
-
-	if (lpMsgBuf) LocalFree (lpMsgBuf);
-
-	return g_szErrMsg;
+    TCHAR* szEnd = NULL;
+    double dSeconds = _tcstod (szValue, &szEnd);
+    if (szEnd == szValue || *szEnd || dSeconds < 0.001 || dSeconds > 86400)
+        return FALSE;
+    dwTimeoutMs = (DWORD) (dSeconds * 1000.0);
+    return TRUE;
 }
 
-
-// get the state of system encryption from the status returned by the driver
-eSysEncState GetSystemEncryptionState (BootEncryptionStatus& status)
+// /simsetup encrypt|decrypt MBPerSecond
+static BOOL ParseSimulatedSetup (LPCTSTR szMode, LPCTSTR szRate, VS_SESSION_OPTIONS& options)
 {
-    if (status.DriveMounted || status.DriveEncrypted)
-    {
-	    if (!status.SetupInProgress
-		    && status.ConfiguredEncryptedAreaEnd != 0
-		    && status.ConfiguredEncryptedAreaEnd != -1
-		    && status.ConfiguredEncryptedAreaStart == status.EncryptedAreaStart
-		    && status.ConfiguredEncryptedAreaEnd == status.EncryptedAreaEnd
-            )
-        {
-            return SYSENC_FULL;
-        }
-	
-        if (	status.EncryptedAreaEnd < 0 
-		    || status.EncryptedAreaStart < 0
-		    || status.EncryptedAreaEnd <= status.EncryptedAreaStart
-		    )
-        {
-            return SYSENC_NONE;
-        }
-
-        return SYSENC_PARTIAL;
-    }
+    TCHAR* szEnd = NULL;
+    double dRate = _tcstod (szRate, &szEnd);
+    if (szEnd == szRate || *szEnd || dRate < 0 || dRate > 4095)
+        return FALSE;
+    if (_tcsicmp (szMode, TEXT("encrypt")) == 0)
+        options.simulatedSetupMode = SetupEncryption;
+    else if (_tcsicmp (szMode, TEXT("decrypt")) == 0)
+        options.simulatedSetupMode = SetupDecryption;
     else
-        return SYSENC_NONE;
+        return FALSE;
+    options.dwSimulatedSetupRate = (DWORD) (dRate * 1024.0 * 1024.0);
+    return TRUE;
 }
 
-// print the status of system encryption as returned by the driver
-eSysEncState PrintSystemEncryptionInformation (BootEncryptionStatus& status, DWORD cbSize)
+// /trace: spans of the run written to the trace file and latency summary, on stderr not to mix with the results
+static void FinishTrace (unsigned __int64 startNs)
 {
-    double dVal;
-    eSysEncState state = GetSystemEncryptionState (status);
-
-    // display details
-    _tprintf(TEXT("System Encryption: %s\n"), (status.DriveMounted || status.DriveEncrypted)? TEXT("Yes") : TEXT("No"));
-    _tprintf(TEXT("Encryption State: %s\n"), (state == SYSENC_NONE)? TEXT("None") : (state == SYSENC_PARTIAL)? TEXT("Partial") : TEXT("Full"));
-    _tprintf(TEXT("Encrypted Portion: "));
-    switch (state)
-    {
-    case SYSENC_NONE:
-        _tprintf(TEXT("0%%\n"));
-        break;
-    case SYSENC_FULL:
-        _tprintf(TEXT("100%%\n"));
-        break;
-    default:
-        dVal = (double) (((unsigned __int64)(status.EncryptedAreaEnd - status.EncryptedAreaStart)) + 1);
-        dVal /= (double) (((unsigned __int64)(status.ConfiguredEncryptedAreaEnd - status.ConfiguredEncryptedAreaStart)) + 1);
-        dVal *= 100.0;
-        _tprintf(TEXT("%.2f%%\n"), dVal);
-        break;
-    }
-
-    if (status.DriveMounted || status.DriveEncrypted)
-    {
-        _tprintf(TEXT("Bootloader version: %x.%x\n"), (int) (status.BootLoaderVersion >> 8), (int) (status.BootLoaderVersion & 0x00FF));
-        _tprintf(TEXT("Drive mounted: %s\n"), status.DriveMounted? TEXT("Yes") : TEXT("No"));
-        _tprintf(TEXT("Drive encrypted: %s\n"), status.DriveEncrypted? TEXT("Yes") : TEXT("No"));
-        _tprintf(TEXT("Volume Header present: %s\n"), status.VolumeHeaderPresent? TEXT("Yes") : TEXT("No"));
-        _tprintf(TEXT("Hidden System: %s\n"), status.HiddenSystem? TEXT("Yes") : TEXT("No"));
-        if (status.HiddenSystem)
-        {
-            _tprintf(TEXT("Hidden System Partition Start: %I64d\n"), status.HiddenSystemPartitionStart);
-            _tprintf(TEXT("Hidden System Leak Protection Count: %d\n"), status.HiddenSysLeakProtectionCount);
-            _tprintf(TEXT("\n"));
-        }
-
-        _tprintf(TEXT("Setup in progress: %s\n"), status.SetupInProgress? TEXT("Yes") : TEXT("No"));
-        if (status.SetupInProgress)
-        {
-            _tprintf(TEXT("Setup Mode: %s\n"), status.SetupMode == SetupEncryption? TEXT("Encrypting") : 
-                status.SetupMode == SetupDecryption? TEXT("Decrypting") : TEXT("None"));
-        }
-        _tprintf(TEXT("Boot drive size: %I64d Bytes\n"), status.BootDriveLength.QuadPart);
-        _tprintf(TEXT("Configured Encrypted Area Start: %I64d\n"), status.ConfiguredEncryptedAreaStart);
-        _tprintf(TEXT("Encrypted Area Start: %I64d\n"), status.EncryptedAreaStart);
-        _tprintf(TEXT("Configured Encrypted Area End: %I64d\n"), status.ConfiguredEncryptedAreaEnd);
-        _tprintf(TEXT("Encrypted Area End: %I64d\n"), status.EncryptedAreaEnd);
-
-		// if the size of the status is smaller than the size of the structure, it means the driver is older than version 1.26.13 where the MasterKeyVulnerable field was added
-        if (cbSize >= sizeof(BootEncryptionStatus))
-        {
-            _tprintf(TEXT("Master Key Vulnerable: %s\n"), status.MasterKeyVulnerable ? TEXT("Yes") : TEXT("No"));
-        }
-    }
-
-    return state;
+    g_pTracer->AddSpan ("main", "phase", startNs, GetTimestampNs ());
+    if (!g_pTracer->Write ())
+        fprintf (stderr, "Failed to write the trace file.\n");
+    g_pTracer->PrintSummary (stderr);
 }
 
-LPCTSTR GetEncryptionAlgorithmName (int ea)
+// run a query command and write its result in a machine readable format with a single write
+int RunMachineReadableQuery (VS_SESSION* pSession, eOutputFormat format, int argc, TCHAR** argv)
 {
-	static TCHAR g_szName[128];
-    switch (ea)
-    {
-	case 1: return TEXT("AES");
-    case 2: return TEXT("Serpent");
-    case 3: return TEXT("Twofish");
-    case 4: return TEXT("Camellia");
-    case 5: return TEXT("GOST89");
-    case 6: return TEXT("Kuznyechik");
-    case 7: return TEXT("AES(Twofish)");
-    case 8: return TEXT("AES(Twofish(Serpent))");
-    case 9: return TEXT("Serpent(AES)");
-    case 10: return TEXT("Serpent(Twofish(AES))");
-    case 11: return TEXT("Twofish(Serpent)");
-	case 12: return TEXT("Camellia(Kuznyechik)");
-	case 13: return TEXT("Kuznyechik(Twofish)");
-	case 14: return TEXT("Camellia(Serpent)");
-	case 15: return TEXT("Kuznyechik(AES)");
-	case 16: return TEXT("Kuznyechik(Serpent(Camellia))");
-    default: 
-		StringCbPrintf (g_szName, sizeof (g_szName), TEXT("Unknown (id = %d)"), ea);
-		return g_szName;
-    }
-}
+    COutputBuffer out;
+    int iRet = FormatMachineReadableQuery (pSession, out, format, argc, argv);
 
-LPCTSTR GetPrfAlgorithmName (int pkcs5)
-{
-    switch (pkcs5)
-    {
-    case 1: return TEXT("HMAC-SHA-512");
-    case 2: return TEXT("HMAC-Whirlpool");
-    case 3: return TEXT("HMAC-SHA-256");
-    case 4: return TEXT("HMAC-RIPEMD-160");
-    case 5: return TEXT("HMAC-STREEBOG");
-    default: return TEXT("Unknown");
-    }
+    out.Write (stdout);
+    return iRet;
 }
 
-void PrintBuffer (unsigned char* pbData, size_t cbData)
+// /events [PollSeconds [Count]]
+BOOL ParseEventsArguments (int argc, TCHAR** argv, DWORD& dwPollMs, int& iCount)
 {
-    while (cbData--)
-    {
-        _tprintf(TEXT("%.2X"), *pbData++);
-    }
+    double dPoll = (argc >= 3)? _tcstod (argv[2], NULL) : 60.0;
+    iCount = (argc == 4)? (int) _tcstol (argv[3], NULL, 10) : 0;
+    if (dPoll < 0.1 || dPoll > 86400 || iCount < 0)
+        return FALSE;
+    dwPollMs = (DWORD) (dPoll * 1000.0);
+    return TRUE;
 }
 
-void PrintVolumeInformation (VOLUME_PROPERTIES_STRUCT& prop)
+// /alerts RulesFile [Seconds [Count]], evaluated once without Seconds
+BOOL ParseAlertsArguments (int argc, TCHAR** argv, DWORD& dwIntervalMs, int& iCount)
 {
-    // display only relevant fields
-    if (prop.wszVolume[0])
-    {
-		int driveLetter = TEXT('A') + prop.driveNo;
-		if (prop.mountDisabled)
-			_tprintf(TEXT("Drive Letter: %c (Virtual Device Only)\n"), driveLetter);
-		else
-			_tprintf(TEXT("Drive Letter: %c\n"), driveLetter);
-		_tprintf(TEXT("Virtual Device: \\Device\\VeraCryptVolume%c\n"), driveLetter);
-        _tprintf(TEXT("Volume: %s\n"), prop.wszVolume);
-        _tprintf(TEXT("Volume ID: ")); PrintBuffer (prop.volumeID, sizeof (prop.volumeID)); _tprintf(TEXT("\n"));
-        if (prop.bDriverSetLabel)
-        {
-            _tprintf(TEXT("Volume Label: %s\n"), prop.wszLabel);
-        }
-        _tprintf(TEXT("Hidden Volume: %s\n"), prop.hiddenVolume ? TEXT("Yes") : TEXT("No"));
-        _tprintf(TEXT("Hidden Volume Protection Enabled: %s\n"), prop.hiddenVolProtection ? TEXT("Yes") : TEXT("No"));
-        _tprintf(TEXT("Read Only: %s\n"), prop.readOnly ? TEXT("Yes") : TEXT("No"));
-        _tprintf(TEXT("Removable Media: %s\n"), prop.removable ? TEXT("Yes") : TEXT("No"));
-        _tprintf(TEXT("partition In Inactive System Encryption Scope: %s\n"), prop.partitionInInactiveSysEncScope ? TEXT("Yes") : TEXT("No"));
-        _tprintf(TEXT("Volume Header Flags: 0x%.8X\n"), prop.volumeHeaderFlags);
-    }
-
-    _tprintf(TEXT("Encryption Algorithm: %s\n"), GetEncryptionAlgorithmName (prop.ea));
-    _tprintf(TEXT("PKCS-5 PRF: %s\n"), GetPrfAlgorithmName (prop.pkcs5));
-    _tprintf(TEXT("Custom PIM used: %s\n"), prop.volumePim > 0 ? TEXT("Yes") : TEXT("No"));
-    if (prop.volumePim > 0)
-    {
-        _tprintf(TEXT("Custom PIM value: %d\n"), prop.volumePim);
-    }
-    _tprintf(TEXT("Iterations number: %d\n"), prop.pkcs5Iterations);
-    _tprintf(TEXT("Data Read Since Mount: %I64d Bytes\n"), prop.totalBytesRead);
-    _tprintf(TEXT("Data Written Since Mount: %I64d Bytes\n"), prop.totalBytesWritten);
-
+    double dInterval = (argc >= 4)? _tcstod (argv[3], NULL) : 0.0;
+    iCount = (argc == 5)? (int) _tcstol (argv[4], NULL, 10) : 0;
+    if ((argc >= 4 && (dInterval < 0.1 || dInterval > 86400)) || iCount < 0)
+        return FALSE;
+    dwIntervalMs = (DWORD) (dInterval * 1000.0);
+    return TRUE;
 }
 
-BOOL IsDriveLetter (LPCTSTR szName)
+// error document of the commands writing their machine readable output without banner
+static void WriteOpenDriverError (eOutputFormat format)
 {
-	BOOL bRet = FALSE;
-	if ((_tcslen (szName) == 2) && (szName[1] == TEXT(':')) && (_totupper(szName[0]) >= TEXT('A')) && (_totupper(szName[0]) <= TEXT('Z')))
-		bRet = TRUE;
-	return bRet;
+    COutputBuffer out;
+    CRecordWriter writer (out, format);
+    writer.BeginDocument ();
+    writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+    FormatDriverError (writer, "OPEN_DRIVER", GetLastError ());
+    writer.EndDocument ();
+    out.Write (stdout);
 }
 
 void PrintUsage ()
@@ -259,16 +138,46 @@ void PrintUsage ()
     _tprintf (TEXT("   Querying system encryption information: VeraStatus.exe [/sysenc]\n"));
     _tprintf (TEXT("   Querying volume encryption information: VeraStatus.exe DriveLetter: (e.g. VeraStatus.exe O:)\n"));
     _tprintf (TEXT("   List all mounted volumes: VeraStatus.exe /list\n"));
+    _tprintf (TEXT("   Report system encryption and all mounted volumes in a single pass: VeraStatus.exe /all\n"));
+    _tprintf (TEXT("   Watch mount changes and I/O rates of mounted volumes: VeraStatus.exe /watch Seconds [Count]\n"));
+    _tprintf (TEXT("   Stream mount, dismount, label, type and read-only changes as they happen: VeraStatus.exe /events [PollSeconds [Count]]\n"));
+    _tprintf (TEXT("   Evaluate alert rules against each snapshot: VeraStatus.exe /alerts RulesFile [Seconds [Count]]\n"));
+    _tprintf (TEXT("   Sample volumes I/O rates in the background and report percentiles: VeraStatus.exe /iostats SampleSeconds ReportSeconds [Count]\n"));
+    _tprintf (TEXT("   Answer query commands read from stdin, one per line, keeping the driver open: VeraStatus.exe /serve [CacheSeconds]\n"));
+    _tprintf (TEXT("   Publish a snapshot in shared memory for the query commands: VeraStatus.exe /agent Seconds\n"));
+    _tprintf (TEXT("   Serve OpenMetrics on 127.0.0.1 for scrapers: VeraStatus.exe /metrics Port [CacheSeconds]\n"));
+    _tprintf (TEXT("   Watch system encryption progress, rate and ETA: VeraStatus.exe /sysenc-progress Seconds [Count [StallSeconds]]\n"));
+    _tprintf (TEXT("   Append a compact snapshot to a history log file: VeraStatus.exe /log LogFile Seconds [RollupSeconds [Count]]\n"));
+    _tprintf (TEXT("   Read the records of a history log in a time range: VeraStatus.exe /history LogFile [From [To]] [/rollups]\n"));
+    _tprintf (TEXT("   Aggregate outputs collected from many endpoints (one file per host): VeraStatus.exe /aggregate Directory [/hosts]\n"));
     _tprintf (TEXT("   Clear volumes master keys from RAM including system encryption ones: VeraStatus.exe /clearkeys\n"));
-    _tprintf (TEXT("   Display this help message: VeraStatus.exe /h\n\n"));
+    _tprintf (TEXT("   Keep the driver open and clear the keys as soon as triggered: VeraStatus.exe /arm event [Name] | port Port TokenFile | file Path\n"));
+    _tprintf (TEXT("   Benchmark PBKDF2 and predict the header key derivation time of a volume: VeraStatus.exe /kdfcost DriveLetter:\n"));
+    _tprintf (TEXT("   Benchmark the ciphers against the I/O observed on the volumes (5 seconds by default): VeraStatus.exe /cipherbench [Seconds]\n"));
+    _tprintf (TEXT("   Display this help message: VeraStatus.exe /h\n"));
+    _tprintf (TEXT("   Use a simulated driver instead of the VeraCrypt one (global option): /simulate\n"));
+    _tprintf (TEXT("   Start a system encryption or decryption setup in the simulated driver, 0 for a stalled one (global option): /simsetup encrypt|decrypt MBPerSecond\n"));
+    _tprintf (TEXT("   Serve driver responses from a trace file (global option): /replay TraceFile\n"));
+    _tprintf (TEXT("   Dump all driver calls to a trace file (global option): /record TraceFile\n"));
+    _tprintf (TEXT("   Query the driver even if a VeraStatus agent is running (global option): /nocache\n"));
+    _tprintf (TEXT("   Find the Linux volumes in another sysfs tree than /sys (global option): /sysfs Directory\n"));
+    _tprintf (TEXT("   Fail the driver calls not answered within Seconds (global option): /timeout Seconds\n"));
+    _tprintf (TEXT("   Fail all the driver calls once Seconds elapsed since the start (global option): /deadline Seconds\n"));
+    _tprintf (TEXT("   Time driver calls, formatting and phases, write a trace viewer file and print latency histograms (global option): /trace TraceFile\n"));
+    _tprintf (TEXT("   Machine readable output for /sysenc, /list, /all, /events, /alerts, /aggregate, /history and DriveLetter: (global option): /format json|csv|kv\n\n"));
     _tprintf (TEXT("The exit code of the process can be one of the following values:\n"));
     _tprintf (TEXT("   0: The system/volume is encrypted.\n"));
-    _tprintf (TEXT("   1: [only when /sysenc specified] The system is partially encrypted.\n"));
-    _tprintf (TEXT("   2: [only when /sysenc specified] The system is not encrypted.\n"));
+    _tprintf (TEXT("   1: [only when /sysenc or /sysenc-progress specified] The system is partially encrypted.\n"));
+    _tprintf (TEXT("   2: [only when /sysenc or /sysenc-progress specified] The system is not encrypted.\n"));
     _tprintf (TEXT("   3: [only when DriveLetter: specified] The drive letter doesn't correspond to a mounted VeraCrypt volume.\n"));
+    _tprintf (TEXT("   4: [only when /all specified] Volumes were mounted or dismounted while the report was generated.\n"));
+    _tprintf (TEXT("   5: [only when /sysenc-progress specified] The system encryption setup is stalled.\n"));
+    _tprintf (TEXT("   6: [only when /alerts specified] Warning rules are violated by the last snapshot.\n"));
+    _tprintf (TEXT("   7: [only when /alerts specified] Critical rules are violated by the last snapshot.\n"));
     _tprintf (TEXT("  -1: VeraCrypt Windows driver not found.\n"));
     _tprintf (TEXT("  -2: Error occured when calling VeraCrypt Windows driver.\n"));
     _tprintf (TEXT("  -3: Incorrect command line parameter specified.\n"));
+    _tprintf (TEXT("  -4: [only when /timeout or /deadline specified] Calls to VeraCrypt Windows driver timed out, the results may be partial.\n"));
     _tprintf (TEXT("\n"));
 }
 
@@ -276,10 +185,193 @@ void PrintUsage ()
 int _tmain (int argc, TCHAR** argv)
 {
     int iRet = 0;
-    HANDLE hDriver = INVALID_HANDLE_VALUE;
+    VS_SESSION* pSession = NULL;
 	LONG DriverVersion = 0;
-    BOOL bResult;
-	DWORD dwResult;
+    VS_SESSION_OPTIONS sessionOptions = { FALSE, NULL, NULL, 0, 0, NULL, 0, 0 };
+    eOutputFormat outputFormat = OUTPUT_TEXT;
+    BOOL bUseAgentSnapshot = TRUE;
+    CSharedSnapshotDriver* pAgentSnapshot = NULL;
+    LPCTSTR szTraceFile = NULL;
+    unsigned __int64 startNs = GetTimestampNs ();
+    unsigned __int64 closeStartNs;
+    int argn = 1;
+
+    // global options can appear anywhere on the command line: remove them from argv
+    for (int i = 1; i < argc; i++)
+    {
+        if (_tcsicmp (argv[i], TEXT("/simulate")) == 0)
+            sessionOptions.bSimulate = TRUE;
+        else if (_tcsicmp (argv[i], TEXT("/simsetup")) == 0 && (i + 2 < argc) && ParseSimulatedSetup (argv[i + 1], argv[i + 2], sessionOptions))
+            i += 2;
+        else if (_tcsicmp (argv[i], TEXT("/replay")) == 0 && (i + 1 < argc))
+            sessionOptions.szReplayFile = argv[++i];
+        else if (_tcsicmp (argv[i], TEXT("/record")) == 0 && (i + 1 < argc))
+            sessionOptions.szRecordFile = argv[++i];
+        else if (_tcsicmp (argv[i], TEXT("/sysfs")) == 0 && (i + 1 < argc))
+            sessionOptions.szSysfsRoot = argv[++i];
+        else if (_tcsicmp (argv[i], TEXT("/nocache")) == 0)
+            bUseAgentSnapshot = FALSE;
+        else if (_tcsicmp (argv[i], TEXT("/trace")) == 0 && (i + 1 < argc))
+            szTraceFile = argv[++i];
+        else if (_tcsicmp (argv[i], TEXT("/timeout")) == 0 && (i + 1 < argc) && ParseTimeout (argv[i + 1], sessionOptions.dwCallTimeoutMs))
+            i++;
+        else if (_tcsicmp (argv[i], TEXT("/deadline")) == 0 && (i + 1 < argc) && ParseTimeout (argv[i + 1], sessionOptions.dwTotalTimeoutMs))
+            i++;
+        else if (_tcsicmp (argv[i], TEXT("/format")) == 0 && (i + 1 < argc) && ParseOutputFormat (argv[i + 1], outputFormat))
+            i++;
+        else
+            argv[argn++] = argv[i];
+    }
+    argc = argn;
+
+#ifndef _WIN32
+    // the Linux backend reads the volumes from sysfs, unlike the simulated and replayed drivers
+    g_bShowWindowsDevices = sessionOptions.bSimulate || sessionOptions.szReplayFile;
+#endif
+
+    if (szTraceFile && (g_pTracer = CTracer::Open (szTraceFile)) == NULL)
+    {
+        _tprintf (TEXT("Error: Can't write the trace file %s.\n"), szTraceFile);
+        iRet = VC_STATUS_INVALID_PARAMETER;
+        goto end;
+    }
+
+    // known answer tests of the algorithms, for the test suite: not documented
+    if (argc == 2 && _tcsicmp (argv[1], TEXT("/selftest")) == 0)
+    {
+        LPCTSTR szFailed = TestXtsCiphers ();
+
+        if (szFailed)
+        {
+            _tprintf (TEXT("Ciphers: FAILED (%s)\n"), szFailed);
+            iRet = VC_STATUS_SELF_TEST_FAILED;
+        }
+        else
+            _tprintf (TEXT("Ciphers: passed\n"));
+        if ((szFailed = TestPbkdf2 ()) != NULL)
+        {
+            _tprintf (TEXT("Hashes and PBKDF2: FAILED (%s)\n"), szFailed);
+            iRet = VC_STATUS_SELF_TEST_FAILED;
+        }
+        else
+            _tprintf (TEXT("Hashes and PBKDF2: passed\n"));
+        goto end;
+    }
+
+    // offline aggregation of collected outputs doesn't use the driver
+    if ((argc == 3 || argc == 4) && (_tcsicmp (argv[1], TEXT("/aggregate")) == 0))
+    {
+        if (argc == 4 && _tcsicmp (argv[3], TEXT("/hosts")) != 0)
+        {
+            _tprintf (TEXT("Error: Invalid parameter(s).\n"));
+            PrintUsage ();
+            iRet = VC_STATUS_INVALID_PARAMETER;
+        }
+        else
+            iRet = RunAggregate (argv[2], argc == 4, outputFormat);
+        goto end;
+    }
+
+    // so is the history log query
+    if ((argc >= 3 && argc <= 6) && (_tcsicmp (argv[1], TEXT("/history")) == 0))
+    {
+        unsigned __int64 times[2] = { 0, (unsigned __int64) -1 };
+        int iTimes = 0;
+        BOOL bRollupsOnly = FALSE, bValid = TRUE;
+
+        for (int i = 3; i < argc && bValid; i++)
+        {
+            if (_tcsicmp (argv[i], TEXT("/rollups")) == 0)
+                bRollupsOnly = TRUE;
+            else
+                bValid = (iTimes < 2) && ParseHistoryTime (argv[i], times[iTimes++]);
+        }
+
+        if (bValid && times[0] <= times[1])
+            iRet = RunHistoryQuery (argv[2], times[0], times[1], bRollupsOnly, outputFormat);
+        else
+        {
+            _tprintf (TEXT("Error: Invalid time range.\n"));
+            PrintUsage ();
+            iRet = VC_STATUS_INVALID_PARAMETER;
+        }
+        goto end;
+    }
+
+    // query commands use the snapshot published by the resident agent when it is recent enough
+    if (bUseAgentSnapshot && !sessionOptions.bSimulate && !sessionOptions.szReplayFile && !sessionOptions.szRecordFile && !sessionOptions.szSysfsRoot
+        && IsMachineReadableCommand (argc, argv))
+    {
+        pAgentSnapshot = CSharedSnapshotDriver::Open (0);
+    }
+
+    if (outputFormat != OUTPUT_TEXT && IsMachineReadableCommand (argc, argv))
+    {
+        // no banner: the output must be parseable as a whole
+        pSession = pAgentSnapshot? VsAttachDriver (TraceDriverCalls (pAgentSnapshot)) : VsOpenSession (&sessionOptions);
+        iRet = RunMachineReadableQuery (pSession, outputFormat, argc, argv);
+        goto end;
+    }
+
+    // co-process mode: machine readable responses only, json by default
+    if ((argc == 2 || argc == 3) && (_tcsicmp (argv[1], TEXT("/serve")) == 0))
+    {
+        double dCache = (argc == 3)? _tcstod (argv[2], NULL) : 1.0;
+        if (dCache >= 0 && dCache <= 3600)
+        {
+            pSession = VsOpenSession (&sessionOptions);
+            iRet = RunServe (pSession, (outputFormat == OUTPUT_TEXT)? OUTPUT_JSON : outputFormat, (DWORD) (dCache * 1000.0));
+        }
+        else
+        {
+            _tprintf (TEXT("Error: Invalid cache duration.\n"));
+            PrintUsage ();
+            iRet = VC_STATUS_INVALID_PARAMETER;
+        }
+        goto end;
+    }
+
+    // event stream without banner, one document per event
+    if (outputFormat != OUTPUT_TEXT && (argc >= 2 && argc <= 4) && (_tcsicmp (argv[1], TEXT("/events")) == 0))
+    {
+        DWORD dwPollMs;
+        int iCount;
+        if (!ParseEventsArguments (argc, argv, dwPollMs, iCount))
+        {
+            _tprintf (TEXT("Error: Invalid polling interval or count.\n"));
+            PrintUsage ();
+            iRet = VC_STATUS_INVALID_PARAMETER;
+        }
+        else if ((pSession = VsOpenSession (&sessionOptions)) != NULL)
+            iRet = RunMountEvents (VsGetDriver (pSession), dwPollMs, iCount, outputFormat);
+        else
+        {
+            WriteOpenDriverError (outputFormat);
+            iRet = VC_STATUS_NO_DRIVER;
+        }
+        goto end;
+    }
+
+    // alert stream without banner, one document per raised or cleared alert
+    if (outputFormat != OUTPUT_TEXT && (argc >= 3 && argc <= 5) && (_tcsicmp (argv[1], TEXT("/alerts")) == 0))
+    {
+        DWORD dwIntervalMs;
+        int iCount;
+        if (!ParseAlertsArguments (argc, argv, dwIntervalMs, iCount))
+        {
+            _tprintf (TEXT("Error: Invalid interval or count.\n"));
+            PrintUsage ();
+            iRet = VC_STATUS_INVALID_PARAMETER;
+        }
+        else if ((pSession = VsOpenSession (&sessionOptions)) != NULL)
+            iRet = RunAlerts (VsGetDriver (pSession), argv[2], dwIntervalMs, iCount, outputFormat);
+        else
+        {
+            WriteOpenDriverError (outputFormat);
+            iRet = VC_STATUS_NO_DRIVER;
+        }
+        goto end;
+    }
 
     _tprintf(TEXT("\n"));
     _tprintf(TEXT("Status of VeraCrypt encryption.By Mounir IDRASSI (mounir@idrix.fr)\n"));
@@ -287,11 +379,10 @@ int _tmain (int argc, TCHAR** argv)
     _tprintf(TEXT("\n"));
 
     // connect to the VeraCrypt driver
-    hDriver = CreateFileW (L"\\\\.\\VeraCrypt", 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
-    if (hDriver != INVALID_HANDLE_VALUE)
+    pSession = pAgentSnapshot? VsAttachDriver (TraceDriverCalls (pAgentSnapshot)) : VsOpenSession (&sessionOptions);
+    if (pSession)
     {
-        bResult = DeviceIoControl(hDriver, VC_IOCTL_GET_DRIVER_VERSION, NULL, 0, &DriverVersion, sizeof(DriverVersion), &dwResult, NULL);
-        if (bResult == FALSE)
+        if (!VsGetDriverVersion (pSession, &DriverVersion))
         {
             _tprintf(TEXT("Failed to get VeraCrypt driver version. Error %s\n"), GetWin32ErrorStr(GetLastError()));
             iRet = VC_STATUS_DRIVER_CALL_FAILED;
@@ -299,31 +390,30 @@ int _tmain (int argc, TCHAR** argv)
         }
         
         _tprintf(TEXT("VeraCrypt driver version: %x.%x\n\n"), (int)(unsigned char)(DriverVersion >> 8), (int)(unsigned char)(DriverVersion & 0x000000FF));
+        if (pAgentSnapshot)
+            _tprintf(TEXT("Snapshot published by the VeraStatus agent %.1f seconds ago\n\n"), pAgentSnapshot->GetAgeSeconds ());
         
         if ((argc == 1) || ((argc == 2) && (_tcsicmp (argv[1], TEXT("/sysenc")) == 0)))
         {
-            DWORD cbBytesReturned = 0;
-            BootEncryptionStatus status;
+            VS_BOOT_STATUS bootStatus;
         
             // Get system encryption status from VeraCrypt driver
-            if (DeviceIoControl(hDriver, VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS, NULL, 0, &status, sizeof(status), &cbBytesReturned, NULL))
+            if (VsQueryBootStatus (pSession, &bootStatus))
             {
-                eSysEncState state = PrintSystemEncryptionInformation (status, cbBytesReturned);
+                eSysEncState state = PrintSystemEncryptionInformation (bootStatus.status, bootStatus.cbReturned);
 
                 if (state != SYSENC_NONE)
                 {
                     VOLUME_PROPERTIES_STRUCT prop;
                     UINT16 bootloaderVersion = 0;
 
-                    cbBytesReturned = 0;
-                    if (DeviceIoControl (hDriver, VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES, NULL, 0, &prop, sizeof (prop), &cbBytesReturned, NULL))
+                    if (VsQueryBootDriveProperties (pSession, &prop))
                     {
                         _tprintf(TEXT("\n"));
                         PrintVolumeInformation (prop);
 
                         // get the bootloader version
-                        cbBytesReturned = 0;
-                        if (DeviceIoControl(hDriver, VC_IOCTL_GET_BOOT_LOADER_VERSION, NULL, 0, &bootloaderVersion, sizeof(bootloaderVersion), &cbBytesReturned, NULL))
+                        if (VsQueryBootLoaderVersion (pSession, &bootloaderVersion))
                         {
                             _tprintf(TEXT("\nBootloader version: %x.%x\n"), (int)(bootloaderVersion >> 8), (int)(bootloaderVersion & 0x00FF));
 						}
@@ -354,12 +444,10 @@ int _tmain (int argc, TCHAR** argv)
         }
         else if ((argc == 2) && ((_tcsicmp (argv[1], TEXT("/list")) == 0) || IsDriveLetter (argv[1])))
         {
-            DWORD cbBytesReturned = 0;
             VOLUME_PROPERTIES_STRUCT prop;
             MOUNT_LIST_STRUCT mlist;			
 
-	        memset (&mlist, 0, sizeof (mlist));
-	        if (DeviceIoControl (hDriver, VC_IOCTL_GET_MOUNTED_VOLUMES, &mlist, sizeof (mlist), &mlist, sizeof (mlist), &cbBytesReturned, NULL))
+	        if (VsQueryMountList (pSession, &mlist))
             {
 				if (_tcsicmp (argv[1], TEXT("/list")) == 0)
 				{
@@ -387,10 +475,10 @@ int _tmain (int argc, TCHAR** argv)
 				}
 				else
 				{
-					prop.driveNo = _totupper(argv[1][0]) - TEXT('A');    
-					if (mlist.ulMountedDrives & (1 << prop.driveNo))
+					int driveNo = _totupper(argv[1][0]) - TEXT('A');    
+					if (mlist.ulMountedDrives & (1 << driveNo))
 					{
-						if (DeviceIoControl (hDriver, VC_IOCTL_GET_VOLUME_PROPERTIES, &prop, sizeof (prop), &prop, sizeof (prop), &cbBytesReturned, NULL))
+						if (VsQueryVolumeProperties (pSession, driveNo, &prop))
 						{
 							PrintVolumeInformation (prop);
 						}
@@ -413,17 +501,153 @@ int _tmain (int argc, TCHAR** argv)
                 iRet = VC_STATUS_DRIVER_CALL_FAILED;
             }
         }
+        else if ((argc == 2) && (_tcsicmp (argv[1], TEXT("/all")) == 0))
+        {
+            static VC_SNAPSHOT snapshot;
+
+            if (TakeSnapshot (VsGetDriver (pSession), snapshot))
+            {
+                PrintSnapshotInformation (snapshot);
+                iRet = snapshot.bConsistent? VC_STATUS_OK : VC_STATUS_SNAPSHOT_INCONSISTENT;
+            }
+            else
+            {
+                _tprintf(TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr(GetLastError ()));
+                iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            }
+        }
+        else if ((argc == 3 || argc == 4) && (_tcsicmp (argv[1], TEXT("/watch")) == 0))
+        {
+            double dInterval = _tcstod (argv[2], NULL);
+            int iCount = (argc == 4)? (int) _tcstol (argv[3], NULL, 10) : 0;
+            if (dInterval >= 0.1 && dInterval <= 86400 && iCount >= 0)
+            {
+                iRet = RunWatch (VsGetDriver (pSession), (DWORD) (dInterval * 1000.0), iCount);
+            }
+            else
+            {
+                _tprintf (TEXT("Error: Invalid watch interval or count.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if ((argc >= 2 && argc <= 4) && (_tcsicmp (argv[1], TEXT("/events")) == 0))
+        {
+            DWORD dwPollMs;
+            int iCount;
+            if (ParseEventsArguments (argc, argv, dwPollMs, iCount))
+            {
+                iRet = RunMountEvents (VsGetDriver (pSession), dwPollMs, iCount, OUTPUT_TEXT);
+            }
+            else
+            {
+                _tprintf (TEXT("Error: Invalid polling interval or count.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if ((argc >= 3 && argc <= 5) && (_tcsicmp (argv[1], TEXT("/alerts")) == 0))
+        {
+            DWORD dwIntervalMs;
+            int iCount;
+            if (ParseAlertsArguments (argc, argv, dwIntervalMs, iCount))
+            {
+                iRet = RunAlerts (VsGetDriver (pSession), argv[2], dwIntervalMs, iCount, OUTPUT_TEXT);
+            }
+            else
+            {
+                _tprintf (TEXT("Error: Invalid interval or count.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if ((argc == 3) && (_tcsicmp (argv[1], TEXT("/agent")) == 0))
+        {
+            double dInterval = _tcstod (argv[2], NULL);
+            if (dInterval >= 0.1 && dInterval <= 3600)
+            {
+                iRet = RunAgent (VsGetDriver (pSession), (DWORD) (dInterval * 1000.0));
+            }
+            else
+            {
+                _tprintf (TEXT("Error: Invalid publishing interval.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if ((argc >= 4 && argc <= 6) && (_tcsicmp (argv[1], TEXT("/log")) == 0))
+        {
+            double dInterval = _tcstod (argv[3], NULL);
+            int iRollupSeconds = (argc >= 5)? (int) _tcstol (argv[4], NULL, 10) : 3600;
+            int iCount = (argc == 6)? (int) _tcstol (argv[5], NULL, 10) : 0;
+            if (dInterval >= 0.1 && dInterval <= 86400 && iRollupSeconds >= 1 && iRollupSeconds <= 31 * 86400 && iCount >= 0)
+            {
+                iRet = RunHistoryLog (VsGetDriver (pSession), argv[2], (DWORD) (dInterval * 1000.0), (DWORD) iRollupSeconds, iCount);
+            }
+            else
+            {
+                _tprintf (TEXT("Error: Invalid interval, rollup period or count.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if ((argc == 3 || argc == 4) && (_tcsicmp (argv[1], TEXT("/metrics")) == 0))
+        {
+            int iPort = (int) _tcstol (argv[2], NULL, 10);
+            double dTtl = (argc == 4)? _tcstod (argv[3], NULL) : 2.0;
+            if (iPort >= 0 && iPort <= 65535 && dTtl >= 0 && dTtl <= 86400)
+            {
+                iRet = RunMetricsServer (VsGetDriver (pSession), (unsigned short) iPort, (DWORD) (dTtl * 1000.0));
+            }
+            else
+            {
+                _tprintf (TEXT("Error: Invalid port or cache duration.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if ((argc == 4 || argc == 5) && (_tcsicmp (argv[1], TEXT("/iostats")) == 0))
+        {
+            double dInterval = _tcstod (argv[2], NULL);
+            double dWindow = _tcstod (argv[3], NULL);
+            int iCount = (argc == 5)? (int) _tcstol (argv[4], NULL, 10) : 0;
+            // the history of each drive must cover a whole window
+            if (dInterval >= 0.01 && dWindow >= dInterval && dWindow <= 86400 && dWindow / dInterval <= RATE_HISTORY_SIZE && iCount >= 0)
+            {
+                iRet = RunIoStats (VsGetDriver (pSession), (DWORD) (dInterval * 1000.0), (DWORD) (dWindow * 1000.0), iCount);
+            }
+            else
+            {
+                _tprintf (TEXT("Error: Invalid sampling interval, report window or count.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if ((argc >= 3 && argc <= 5) && (_tcsicmp (argv[1], TEXT("/sysenc-progress")) == 0))
+        {
+            double dInterval = _tcstod (argv[2], NULL);
+            int iCount = (argc >= 4)? (int) _tcstol (argv[3], NULL, 10) : 0;
+            int iStallSeconds = (argc == 5)? (int) _tcstol (argv[4], NULL, 10) : 300;
+            if (dInterval >= 0.1 && dInterval <= 86400 && iCount >= 0 && iStallSeconds >= 0)
+            {
+                iRet = RunSysEncProgress (VsGetDriver (pSession), (DWORD) (dInterval * 1000.0), iCount, (DWORD) iStallSeconds);
+            }
+            else
+            {
+                _tprintf (TEXT("Error: Invalid interval, count or stall period.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
         else if ((argc == 2) && ((_tcsicmp (argv[1], TEXT("/?")) == 0 || _tcsicmp (argv[1], TEXT("/h")) == 0 || _tcsicmp (argv[1], TEXT("/help")) == 0)))
         {
             PrintUsage ();
         }
         else if ((argc == 2) && ((_tcsicmp (argv[1], TEXT("/clearkeys")) == 0)))
         {
-            DWORD cbBytesReturned = 0;
-        
             // Ask VeraCrypt driver to clear Encrypion keys for all mounted volumes (including Encrypted System) from RAM 
 			// In case of system encryption, this will freeze the system. For mounted volume, this will render them unusable
-            if (DeviceIoControl (hDriver, VC_IOCTL_EMERGENCY_CLEAR_KEYS, NULL, 0, NULL, 0, &cbBytesReturned, NULL))
+            if (VsClearKeys (pSession))
             {
 				_tprintf (TEXT("Keys cleared successfully!\n"));
 			}
@@ -433,6 +657,76 @@ int _tmain (int argc, TCHAR** argv)
                 iRet = VC_STATUS_DRIVER_CALL_FAILED;
             }
         }
+        else if ((argc >= 3 && argc <= 5) && (_tcsicmp (argv[1], TEXT("/arm")) == 0))
+        {
+            // the driver is already open and its version queried: only the clear keys call is left. It
+            // may be issued long after arming, so /timeout and /deadline don't apply to it.
+            CVcDriver& driver = VsGetDriver (pSession);
+            CDeadlineDriver* pDeadline = dynamic_cast<CDeadlineDriver*> (&driver);
+            CVcDriver& armedDriver = pDeadline? pDeadline->GetDriver () : driver;
+            CArmTrigger* pTrigger = NULL;
+            if (!armedDriver.SupportsIoControl (VC_IOCTL_EMERGENCY_CLEAR_KEYS))
+            {
+                _tprintf (TEXT("Error: The keys can't be cleared with this driver backend: %s\n"), GetWin32ErrorStr (ERROR_NOT_SUPPORTED));
+                iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            }
+            else if ((argc <= 4) && _tcsicmp (argv[2], TEXT("event")) == 0)
+                pTrigger = CreateArmTrigger (ARM_TRIGGER_EVENT, (argc == 4)? argv[3] : NULL);
+            else if ((argc == 5) && (_tcsicmp (argv[2], TEXT("port")) == 0) && _tcstol (argv[3], NULL, 10) > 0 && _tcstol (argv[3], NULL, 10) <= 65535)
+                pTrigger = CreateArmTrigger (ARM_TRIGGER_PORT, argv[3], argv[4]);
+            else if ((argc == 4) && (_tcsicmp (argv[2], TEXT("file")) == 0))
+                pTrigger = CreateArmTrigger (ARM_TRIGGER_FILE, argv[3]);
+            else
+            {
+                _tprintf (TEXT("Error: Invalid trigger.\n"));
+                PrintUsage ();
+            }
+
+            if (pTrigger)
+            {
+                iRet = RunArm (armedDriver, *pTrigger);
+                delete pTrigger;
+            }
+            else if (iRet == 0)
+                iRet = VC_STATUS_INVALID_PARAMETER;
+        }
+        else if ((argc == 3) && (_tcsicmp (argv[1], TEXT("/kdfcost")) == 0) && IsDriveLetter (argv[2]))
+        {
+            VOLUME_PROPERTIES_STRUCT prop;
+            MOUNT_LIST_STRUCT mlist;
+            int driveNo = _totupper (argv[2][0]) - TEXT('A');
+
+            // the PRF, iterations and PIM are read from the driver, the benchmark runs locally
+            if (!VsQueryMountList (pSession, &mlist))
+            {
+                _tprintf (TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr (GetLastError ()));
+                iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            }
+            else if ((mlist.ulMountedDrives & (1 << driveNo)) == 0)
+            {
+                _tprintf (TEXT("Drive letter %s doesn't correspond to a mounted VeraCrypt volume.\n"), argv[2]);
+                iRet = VC_STATUS_NOT_VOLUME;
+            }
+            else if (!VsQueryVolumeProperties (pSession, driveNo, &prop))
+            {
+                _tprintf (TEXT("Call to VeraCrypt driver (GET_VOLUME_PROPERTIES) failed with error %s\n"), GetWin32ErrorStr (GetLastError ()));
+                iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            }
+            else
+                iRet = RunKdfCost (prop);
+        }
+        else if ((argc == 2 || argc == 3) && (_tcsicmp (argv[1], TEXT("/cipherbench")) == 0))
+        {
+            double dObserve = (argc == 3)? _tcstod (argv[2], NULL) : 5.0;
+            if (dObserve >= 0.1 && dObserve <= 86400)
+                iRet = RunCipherBench (VsGetDriver (pSession), (DWORD) (dObserve * 1000.0));
+            else
+            {
+                _tprintf (TEXT("Error: Invalid observation duration.\n"));
+                PrintUsage ();
+                iRet = VC_STATUS_INVALID_PARAMETER;
+            }
+        }
         else
         {
             _tprintf (TEXT("Error: Invalid parameter(s).\n"));
@@ -446,9 +740,15 @@ int _tmain (int argc, TCHAR** argv)
         iRet = VC_STATUS_NO_DRIVER;
     }
 end:
-    if (hDriver != INVALID_HANDLE_VALUE)
+    // the results of the calls that completed in time were reported
+    if (pSession && VsTimedOut (pSession))
+        iRet = VC_STATUS_DRIVER_TIMEOUT;
+    closeStartNs = GetTimestampNs ();
+    VsCloseSession (pSession);
+    if (g_pTracer)
     {
-        CloseHandle(hDriver);
+        g_pTracer->AddSpan ("close driver", "phase", closeStartNs, GetTimestampNs ());
+        FinishTrace (startNs);
     }
     return iRet;
 }
@@ -0,0 +1,239 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "metrics.h"
+#include "netio.h"
+#include "utf8.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// connections served concurrently, each by its own thread: further ones are closed
+#define METRICS_MAX_CONNECTIONS	64
+// time given to a client to send its whole request head, then to read the response
+#define METRICS_TIMEOUT_MS		5000
+#define METRICS_MAX_REQUEST		8192
+
+#define OPENMETRICS_CONTENT_TYPE	"application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+static void AppendFamily (COutputBuffer& out, const char* szName, const char* szType, const char* szHelp)
+{
+    out.AppendFormat ("# TYPE %s %s\n# HELP %s %s\n", szName, szType, szName, szHelp);
+}
+
+// label value with \, " and line feeds escaped
+static void AppendLabelValue (COutputBuffer& out, const char* szValue)
+{
+    for (const char* p = szValue; *p; p++)
+    {
+        if (*p == '\\' || *p == '"')
+        {
+            out.Append ('\\');
+            out.Append (*p);
+        }
+        else if (*p == '\n')
+            out.Append ("\\n");
+        else
+            out.Append (*p);
+    }
+}
+
+static void AppendAlgorithmName (COutputBuffer& out, int ea)
+{
+    LPCTSTR szName = GetEncryptionAlgorithmName (ea);
+#if defined (_WIN32) && defined (UNICODE)
+    char szUtf8[256];
+    Utf16ToUtf8 ((const WCHAR*) szName, (size_t) -1, szUtf8, sizeof (szUtf8));
+    AppendLabelValue (out, szUtf8);
+#else
+    AppendLabelValue (out, szName);
+#endif
+}
+
+void FormatOpenMetrics (COutputBuffer& out, const CACHED_SNAPSHOT& entry, unsigned __int64 sweepCount)
+{
+    const VC_SNAPSHOT& snapshot = entry.snapshot;
+    const VOLUME_SAMPLE& volumes = snapshot.volumes;
+    int i;
+
+    AppendFamily (out, "verastatus_up", "gauge", "Whether the last driver sweep succeeded.");
+    out.AppendFormat ("verastatus_up %d\n", entry.bValid? 1 : 0);
+    AppendFamily (out, "verastatus_driver_sweeps", "counter", "Number of driver sweeps done to serve the scrapes.");
+    out.AppendFormat ("verastatus_driver_sweeps_total %llu\n", (unsigned long long) sweepCount);
+    AppendFamily (out, "verastatus_snapshot_age_seconds", "gauge", "Time since the served snapshot was taken.");
+    out.AppendFormat ("verastatus_snapshot_age_seconds %.6f\n", (double) (GetTimestampUs () - entry.timestampUs) / 1000000.0);
+
+    if (entry.bValid)
+    {
+        AppendFamily (out, "verastatus_snapshot_consistent", "gauge", "Whether no volume was mounted or dismounted during the sweep.");
+        out.AppendFormat ("verastatus_snapshot_consistent %d\n", snapshot.bConsistent? 1 : 0);
+
+        AppendFamily (out, "verastatus_volume_mounted", "gauge", "Mount state of each drive letter.");
+        for (i = 0; i < 26; i++)
+            out.AppendFormat ("verastatus_volume_mounted{drive=\"%c\"} %d\n", 'A' + i, (volumes.ulMountedDrives & (1 << i))? 1 : 0);
+
+        AppendFamily (out, "verastatus_volume_read_bytes", "counter", "Bytes read from the volume since it was mounted.");
+        for (i = 0; i < 26; i++)
+        {
+            if (volumes.ulMountedDrives & (1 << i))
+                out.AppendFormat ("verastatus_volume_read_bytes_total{drive=\"%c\"} %llu\n", 'A' + i, (unsigned long long) volumes.prop[i].totalBytesRead);
+        }
+
+        AppendFamily (out, "verastatus_volume_written_bytes", "counter", "Bytes written to the volume since it was mounted.");
+        for (i = 0; i < 26; i++)
+        {
+            if (volumes.ulMountedDrives & (1 << i))
+                out.AppendFormat ("verastatus_volume_written_bytes_total{drive=\"%c\"} %llu\n", 'A' + i, (unsigned long long) volumes.prop[i].totalBytesWritten);
+        }
+
+        AppendFamily (out, "verastatus_volume_encryption_algorithm", "gauge", "Encryption algorithm id of the volume.");
+        for (i = 0; i < 26; i++)
+        {
+            if (volumes.ulMountedDrives & (1 << i))
+            {
+                out.AppendFormat ("verastatus_volume_encryption_algorithm{drive=\"%c\",name=\"", 'A' + i);
+                AppendAlgorithmName (out, volumes.prop[i].ea);
+                out.AppendFormat ("\"} %d\n", volumes.prop[i].ea);
+            }
+        }
+
+        AppendFamily (out, "verastatus_volume_hidden_volume_protection", "gauge", "Hidden volume protection status (0 = none, 1 = active, 2 = write blocked).");
+        for (i = 0; i < 26; i++)
+        {
+            if (volumes.ulMountedDrives & (1 << i))
+                out.AppendFormat ("verastatus_volume_hidden_volume_protection{drive=\"%c\"} %d\n", 'A' + i, volumes.prop[i].hiddenVolProtection);
+        }
+    }
+
+    if (snapshot.bBootStatusValid)
+    {
+        BootEncryptionStatus status = snapshot.bootStatus;
+        eSysEncState state = GetSystemEncryptionState (status);
+
+        AppendFamily (out, "verastatus_sysenc_encrypted_percent", "gauge", "Encrypted portion of the system drive.");
+        out.AppendFormat ("verastatus_sysenc_encrypted_percent %.4f\n", GetSystemEncryptionPercentage (status, state));
+        AppendFamily (out, "verastatus_sysenc_setup_in_progress", "gauge", "Whether system encryption or decryption is in progress.");
+        out.AppendFormat ("verastatus_sysenc_setup_in_progress %d\n", status.SetupInProgress? 1 : 0);
+        // drivers older than 1.26.13 don't report it
+        if (snapshot.cbBootStatus >= sizeof (BootEncryptionStatus))
+        {
+            AppendFamily (out, "verastatus_sysenc_master_key_vulnerable", "gauge", "Whether the system encryption master key is vulnerable.");
+            out.AppendFormat ("verastatus_sysenc_master_key_vulnerable %d\n", status.MasterKeyVulnerable? 1 : 0);
+        }
+    }
+
+    out.Append ("# EOF\n");
+}
+
+static void SendResponse (VC_SOCKET s, const char* szStatus, const char* szContentType, const char* pbBody, size_t cbBody)
+{
+    COutputBuffer response (1024 + cbBody);
+    response.AppendFormat ("HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+        szStatus, szContentType, (unsigned int) cbBody);
+    response.Append (pbBody, cbBody);
+    NetSendAll (s, response.Data (), response.Size ());
+}
+
+static void ServeConnection (VC_SOCKET s, CSnapshotCache& cache)
+{
+    char request[METRICS_MAX_REQUEST + 1];
+    int cbRequest = 0;
+    unsigned __int64 deadlineNs = GetTimestampNs () + METRICS_TIMEOUT_MS * 1000000ULL;
+
+    // the request line and headers, the body of a GET being ignored. Each receive waits for what
+    // is left of the deadline only, so that a client sending a byte now and then is dropped too.
+    while (cbRequest < METRICS_MAX_REQUEST)
+    {
+        unsigned __int64 nowNs = GetTimestampNs ();
+        if (nowNs >= deadlineNs)
+            return;
+        NetSetTimeout (s, (unsigned int) ((deadlineNs - nowNs + 999999) / 1000000));
+        int cbReceived = NetReceive (s, request + cbRequest, METRICS_MAX_REQUEST - cbRequest);
+        if (cbReceived <= 0)
+            return;
+        cbRequest += cbReceived;
+        request[cbRequest] = 0;
+        if (strstr (request, "\r\n\r\n") || strstr (request, "\n\n"))
+            break;
+    }
+    request[cbRequest] = 0;
+    NetSetTimeout (s, METRICS_TIMEOUT_MS);
+
+    if (strncmp (request, "GET ", 4) != 0)
+    {
+        static const char szBody[] = "Method not allowed\n";
+        SendResponse (s, "405 Method Not Allowed", "text/plain", szBody, sizeof (szBody) - 1);
+    }
+    else if (strncmp (request + 4, "/metrics ", 9) != 0 && strncmp (request + 4, "/metrics?", 9) != 0)
+    {
+        static const char szBody[] = "Not found, use /metrics\n";
+        SendResponse (s, "404 Not Found", "text/plain", szBody, sizeof (szBody) - 1);
+    }
+    else
+    {
+        std::shared_ptr<const CACHED_SNAPSHOT> pEntry = cache.Get ();
+        COutputBuffer body;
+        FormatOpenMetrics (body, *pEntry, cache.GetSweepCount ());
+        SendResponse (s, "200 OK", OPENMETRICS_CONTENT_TYPE, body.Data (), body.Size ());
+    }
+}
+
+int RunMetricsServer (CVcDriver& driver, unsigned short port, DWORD dwTtlMs)
+{
+    CSnapshotCache cache (driver, dwTtlMs);
+    std::mutex mutex;
+    std::condition_variable finished;
+    int activeConnections = 0, error;
+    VC_SOCKET listener;
+
+    listener = NetListenLoopback (port);
+    if (listener == VC_INVALID_SOCKET)
+    {
+        _tprintf (TEXT("Failed to listen on 127.0.0.1:%d. Error %d\n"), (int) port, NetGetLastError ());
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    _tprintf (TEXT("Serving OpenMetrics on http://127.0.0.1:%d/metrics (driver queried at most every %.1f seconds)\n"),
+        (int) NetGetLocalPort (listener), (double) dwTtlMs / 1000.0);
+    fflush (stdout);
+
+    // a thread per connection, so that clients slow to send their request don't delay the others
+    for (;;)
+    {
+        VC_SOCKET s = NetAccept (listener);
+        if (s == VC_INVALID_SOCKET)
+            break;
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            if (activeConnections >= METRICS_MAX_CONNECTIONS)
+            {
+                NetClose (s);
+                continue;
+            }
+            activeConnections++;
+        }
+        std::thread ([s, &cache, &mutex, &finished, &activeConnections] ()
+        {
+            ServeConnection (s, cache);
+            NetClose (s);
+            std::lock_guard<std::mutex> lock (mutex);
+            activeConnections--;
+            finished.notify_all ();
+        }).detach ();
+    }
+    error = NetGetLastError ();
+
+    // the connections use the cache
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+        finished.wait (lock, [&activeConnections] () { return activeConnections == 0; });
+    }
+
+    _tprintf (TEXT("Failed to accept connections. Error %d\n"), error);
+    NetClose (listener);
+    return VC_STATUS_INVALID_PARAMETER;
+}
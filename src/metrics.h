@@ -0,0 +1,17 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "cache.h"
+#include "format.h"
+
+// OpenMetrics text exposition of a cached snapshot
+void FormatOpenMetrics (COutputBuffer& out, const CACHED_SNAPSHOT& entry, unsigned __int64 sweepCount);
+
+// Serve GET /metrics on 127.0.0.1:port until a fatal error occurs.
+// Driver sweeps are shared by all the scrapes received during dwTtlMs.
+int RunMetricsServer (CVcDriver& driver, unsigned short port, DWORD dwTtlMs);
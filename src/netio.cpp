@@ -0,0 +1,136 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include <stddef.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+typedef int SOCKET;
+#define INVALID_SOCKET	(-1)
+#define SOCKET_ERROR	(-1)
+#define closesocket		close
+#endif
+#include <string.h>
+#include "netio.h"
+
+VC_SOCKET NetListenLoopback (unsigned short port)
+{
+    struct sockaddr_in addr;
+    SOCKET s;
+    int on = 1;
+
+#ifdef _WIN32
+    static bool bInitialized = false;
+    if (!bInitialized)
+    {
+        WSADATA wsaData;
+        if (WSAStartup (MAKEWORD (2, 2), &wsaData) != 0)
+            return VC_INVALID_SOCKET;
+        bInitialized = true;
+    }
+#endif
+
+    s = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+        return VC_INVALID_SOCKET;
+
+#ifndef _WIN32
+    // allow restarting the server while old connections are in TIME_WAIT
+    setsockopt (s, SOL_SOCKET, SO_REUSEADDR, (const char*) &on, sizeof (on));
+#else
+    // never share the port with another process
+    setsockopt (s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*) &on, sizeof (on));
+#endif
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    addr.sin_port = htons (port);
+    if (bind (s, (struct sockaddr*) &addr, sizeof (addr)) == SOCKET_ERROR || listen (s, 16) == SOCKET_ERROR)
+    {
+        closesocket (s);
+        return VC_INVALID_SOCKET;
+    }
+
+    return (VC_SOCKET) s;
+}
+
+unsigned short NetGetLocalPort (VC_SOCKET s)
+{
+    struct sockaddr_in addr;
+    socklen_t cbAddr = sizeof (addr);
+
+    if (getsockname ((SOCKET) s, (struct sockaddr*) &addr, &cbAddr) == SOCKET_ERROR)
+        return 0;
+    return ntohs (addr.sin_port);
+}
+
+VC_SOCKET NetAccept (VC_SOCKET s)
+{
+    SOCKET client = accept ((SOCKET) s, NULL, NULL);
+    return (client == INVALID_SOCKET)? VC_INVALID_SOCKET : (VC_SOCKET) client;
+}
+
+void NetSetTimeout (VC_SOCKET s, unsigned int timeoutMs)
+{
+#ifdef _WIN32
+    DWORD timeout = timeoutMs;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+#endif
+    setsockopt ((SOCKET) s, SOL_SOCKET, SO_RCVTIMEO, (const char*) &timeout, sizeof (timeout));
+    setsockopt ((SOCKET) s, SOL_SOCKET, SO_SNDTIMEO, (const char*) &timeout, sizeof (timeout));
+}
+
+int NetReceive (VC_SOCKET s, char* pbBuffer, int cbBuffer)
+{
+    int cbReceived = recv ((SOCKET) s, pbBuffer, cbBuffer, 0);
+    return (cbReceived == SOCKET_ERROR)? -1 : cbReceived;
+}
+
+bool NetSendAll (VC_SOCKET s, const char* pbData, size_t cbData)
+{
+    while (cbData > 0)
+    {
+        int cbChunk = (cbData > 65536)? 65536 : (int) cbData;
+#ifdef MSG_NOSIGNAL
+        int cbSent = send ((SOCKET) s, pbData, cbChunk, MSG_NOSIGNAL);
+#else
+        int cbSent = send ((SOCKET) s, pbData, cbChunk, 0);
+#endif
+        if (cbSent == SOCKET_ERROR || cbSent == 0)
+            return false;
+        pbData += cbSent;
+        cbData -= (size_t) cbSent;
+    }
+    return true;
+}
+
+void NetClose (VC_SOCKET s)
+{
+    if (s != VC_INVALID_SOCKET)
+        closesocket ((SOCKET) s);
+}
+
+int NetGetLastError ()
+{
+#ifdef _WIN32
+    return WSAGetLastError ();
+#else
+    return errno;
+#endif
+}
@@ -0,0 +1,28 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include <stddef.h>
+
+// Minimal TCP socket wrapper. It is kept apart from the other headers because winsock2.h
+// must be included before windows.h.
+
+// SOCKET on Windows, file descriptor elsewhere
+typedef long long VC_SOCKET;
+#define VC_INVALID_SOCKET	((VC_SOCKET) -1)
+
+// Listen on 127.0.0.1:port (0 = any free port). Returns VC_INVALID_SOCKET on failure.
+VC_SOCKET NetListenLoopback (unsigned short port);
+unsigned short NetGetLocalPort (VC_SOCKET s);
+VC_SOCKET NetAccept (VC_SOCKET s);
+void NetSetTimeout (VC_SOCKET s, unsigned int timeoutMs);
+// number of bytes received, 0 when the peer closed the connection, -1 on error or timeout
+int NetReceive (VC_SOCKET s, char* pbBuffer, int cbBuffer);
+bool NetSendAll (VC_SOCKET s, const char* pbData, size_t cbData);
+void NetClose (VC_SOCKET s);
+// error code of the last failed call (WSAGetLastError / errno)
+int NetGetLastError ();
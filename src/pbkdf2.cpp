@@ -0,0 +1,983 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "pbkdf2.h"
+#include <stdint.h>
+#include <string.h>
+
+#define ROTR32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define ROTL32(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+#define ROTR64(x, n)	(((x) >> (n)) | ((x) << (64 - (n))))
+
+static inline uint32_t LoadBe32 (const uint8_t* p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline uint32_t LoadLe32 (const uint8_t* p)
+{
+    return ((uint32_t) p[3] << 24) | ((uint32_t) p[2] << 16) | ((uint32_t) p[1] << 8) | p[0];
+}
+
+static inline uint64_t LoadBe64 (const uint8_t* p)
+{
+    return ((uint64_t) LoadBe32 (p) << 32) | LoadBe32 (p + 4);
+}
+
+static inline uint64_t LoadLe64 (const uint8_t* p)
+{
+    return ((uint64_t) LoadLe32 (p + 4) << 32) | LoadLe32 (p);
+}
+
+static inline void StoreBe32 (uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+static inline void StoreLe32 (uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+    p[3] = (uint8_t) (v >> 24);
+}
+
+static inline void StoreBe64 (uint8_t* p, uint64_t v)
+{
+    StoreBe32 (p, (uint32_t) (v >> 32));
+    StoreBe32 (p + 4, (uint32_t) v);
+}
+
+static inline void StoreLe64 (uint8_t* p, uint64_t v)
+{
+    StoreLe32 (p, (uint32_t) v);
+    StoreLe32 (p + 4, (uint32_t) (v >> 32));
+}
+
+// buffering of the hashes processing their input by blocks: H implements Compress (block)
+template <class H, size_t BLOCK> class CBlockHash
+{
+public:
+    void Update (const uint8_t* p, size_t cb)
+    {
+        m_cbTotal += cb;
+        if (m_cbBuffer)
+        {
+            size_t n = (cb < BLOCK - m_cbBuffer)? cb : BLOCK - m_cbBuffer;
+            memcpy (m_Buffer + m_cbBuffer, p, n);
+            m_cbBuffer += n;
+            p += n;
+            cb -= n;
+            if (m_cbBuffer < BLOCK)
+                return;
+            static_cast<H*> (this)->Compress (m_Buffer);
+            m_cbBuffer = 0;
+        }
+        for (; cb >= BLOCK; p += BLOCK, cb -= BLOCK)
+            static_cast<H*> (this)->Compress (p);
+        memcpy (m_Buffer, p, cb);
+        m_cbBuffer = cb;
+    }
+
+protected:
+    void Reset ()
+    {
+        m_cbBuffer = 0;
+        m_cbTotal = 0;
+    }
+
+    // Merkle-Damgard padding: 0x80, zeros and the length in bits in the last cbLength bytes of a block
+    void Pad (size_t cbLength, BOOL bBigEndian)
+    {
+        uint64_t bits = m_cbTotal * 8;
+
+        m_Buffer[m_cbBuffer++] = 0x80;
+        if (m_cbBuffer > BLOCK - cbLength)
+        {
+            memset (m_Buffer + m_cbBuffer, 0, BLOCK - m_cbBuffer);
+            static_cast<H*> (this)->Compress (m_Buffer);
+            m_cbBuffer = 0;
+        }
+        memset (m_Buffer + m_cbBuffer, 0, BLOCK - m_cbBuffer);
+        if (bBigEndian)
+            StoreBe64 (m_Buffer + BLOCK - 8, bits);
+        else
+            StoreLe64 (m_Buffer + BLOCK - cbLength, bits);
+        static_cast<H*> (this)->Compress (m_Buffer);
+    }
+
+    uint8_t m_Buffer[BLOCK];
+    size_t m_cbBuffer;
+    uint64_t m_cbTotal;
+};
+
+static const uint32_t g_Sha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+class CSha256 : public CBlockHash<CSha256, 64>
+{
+public:
+    enum { BlockSize = 64, DigestSize = 32 };
+
+    void Init ()
+    {
+        static const uint32_t iv[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+        memcpy (m_State, iv, sizeof (m_State));
+        Reset ();
+    }
+
+    void Final (uint8_t* pDigest)
+    {
+        Pad (8, TRUE);
+        for (int i = 0; i < 8; i++)
+            StoreBe32 (pDigest + 4 * i, m_State[i]);
+    }
+
+    void Compress (const uint8_t* p)
+    {
+        uint32_t w[64], s[8];
+
+        for (int i = 0; i < 16; i++)
+            w[i] = LoadBe32 (p + 4 * i);
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = ROTR32 (w[i - 15], 7) ^ ROTR32 (w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROTR32 (w[i - 2], 17) ^ ROTR32 (w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        memcpy (s, m_State, sizeof (s));
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t t1 = s[7] + (ROTR32 (s[4], 6) ^ ROTR32 (s[4], 11) ^ ROTR32 (s[4], 25)) + ((s[4] & s[5]) ^ (~s[4] & s[6])) + g_Sha256K[i] + w[i];
+            uint32_t t2 = (ROTR32 (s[0], 2) ^ ROTR32 (s[0], 13) ^ ROTR32 (s[0], 22)) + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+            s[7] = s[6];
+            s[6] = s[5];
+            s[5] = s[4];
+            s[4] = s[3] + t1;
+            s[3] = s[2];
+            s[2] = s[1];
+            s[1] = s[0];
+            s[0] = t1 + t2;
+        }
+        for (int i = 0; i < 8; i++)
+            m_State[i] += s[i];
+    }
+
+protected:
+    uint32_t m_State[8];
+};
+
+static const uint64_t g_Sha512K[80] =
+{
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+class CSha512 : public CBlockHash<CSha512, 128>
+{
+public:
+    enum { BlockSize = 128, DigestSize = 64 };
+
+    void Init ()
+    {
+        static const uint64_t iv[8] =
+        {
+            0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+            0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+        };
+        memcpy (m_State, iv, sizeof (m_State));
+        Reset ();
+    }
+
+    void Final (uint8_t* pDigest)
+    {
+        Pad (16, TRUE);
+        for (int i = 0; i < 8; i++)
+            StoreBe64 (pDigest + 8 * i, m_State[i]);
+    }
+
+    void Compress (const uint8_t* p)
+    {
+        uint64_t w[80], s[8];
+
+        for (int i = 0; i < 16; i++)
+            w[i] = LoadBe64 (p + 8 * i);
+        for (int i = 16; i < 80; i++)
+        {
+            uint64_t s0 = ROTR64 (w[i - 15], 1) ^ ROTR64 (w[i - 15], 8) ^ (w[i - 15] >> 7);
+            uint64_t s1 = ROTR64 (w[i - 2], 19) ^ ROTR64 (w[i - 2], 61) ^ (w[i - 2] >> 6);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        memcpy (s, m_State, sizeof (s));
+        for (int i = 0; i < 80; i++)
+        {
+            uint64_t t1 = s[7] + (ROTR64 (s[4], 14) ^ ROTR64 (s[4], 18) ^ ROTR64 (s[4], 41)) + ((s[4] & s[5]) ^ (~s[4] & s[6])) + g_Sha512K[i] + w[i];
+            uint64_t t2 = (ROTR64 (s[0], 28) ^ ROTR64 (s[0], 34) ^ ROTR64 (s[0], 39)) + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+            s[7] = s[6];
+            s[6] = s[5];
+            s[5] = s[4];
+            s[4] = s[3] + t1;
+            s[3] = s[2];
+            s[2] = s[1];
+            s[1] = s[0];
+            s[0] = t1 + t2;
+        }
+        for (int i = 0; i < 8; i++)
+            m_State[i] += s[i];
+    }
+
+protected:
+    uint64_t m_State[8];
+};
+
+// RIPEMD-160: message word, rotation and constant of each step of the left and right lines
+static const uint8_t g_RipemdR[2][80] =
+{
+    {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+        3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+        1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+        4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13
+    },
+    {
+        5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+        6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+        15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+        8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+        12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11
+    }
+};
+
+static const uint8_t g_RipemdS[2][80] =
+{
+    {
+        11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+        7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+        11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+        11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+        9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6
+    },
+    {
+        8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+        9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+        9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+        15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+        8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11
+    }
+};
+
+static const uint32_t g_RipemdK[2][5] =
+{
+    { 0x00000000, 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xa953fd4e },
+    { 0x50a28be6, 0x5c4dd124, 0x6d703ef3, 0x7a6d76e9, 0x00000000 }
+};
+
+static inline uint32_t RipemdF (int round, uint32_t x, uint32_t y, uint32_t z)
+{
+    switch (round)
+    {
+    case 0: return x ^ y ^ z;
+    case 1: return (x & y) | (~x & z);
+    case 2: return (x | ~y) ^ z;
+    case 3: return (x & z) | (y & ~z);
+    default: return x ^ (y | ~z);
+    }
+}
+
+class CRipemd160 : public CBlockHash<CRipemd160, 64>
+{
+public:
+    enum { BlockSize = 64, DigestSize = 20 };
+
+    void Init ()
+    {
+        static const uint32_t iv[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+        memcpy (m_State, iv, sizeof (m_State));
+        Reset ();
+    }
+
+    void Final (uint8_t* pDigest)
+    {
+        Pad (8, FALSE);
+        for (int i = 0; i < 5; i++)
+            StoreLe32 (pDigest + 4 * i, m_State[i]);
+    }
+
+    void Compress (const uint8_t* p)
+    {
+        uint32_t x[16], l[5], r[5];
+
+        for (int i = 0; i < 16; i++)
+            x[i] = LoadLe32 (p + 4 * i);
+        memcpy (l, m_State, sizeof (l));
+        memcpy (r, m_State, sizeof (r));
+
+        // the right line uses the functions in reverse order
+        for (int j = 0; j < 80; j++)
+        {
+            uint32_t t = ROTL32 (l[0] + RipemdF (j / 16, l[1], l[2], l[3]) + x[g_RipemdR[0][j]] + g_RipemdK[0][j / 16], g_RipemdS[0][j]) + l[4];
+            l[0] = l[4];
+            l[4] = l[3];
+            l[3] = ROTL32 (l[2], 10);
+            l[2] = l[1];
+            l[1] = t;
+
+            t = ROTL32 (r[0] + RipemdF (4 - j / 16, r[1], r[2], r[3]) + x[g_RipemdR[1][j]] + g_RipemdK[1][j / 16], g_RipemdS[1][j]) + r[4];
+            r[0] = r[4];
+            r[4] = r[3];
+            r[3] = ROTL32 (r[2], 10);
+            r[2] = r[1];
+            r[1] = t;
+        }
+
+        uint32_t t = m_State[1] + l[2] + r[3];
+        m_State[1] = m_State[2] + l[3] + r[4];
+        m_State[2] = m_State[3] + l[4] + r[0];
+        m_State[3] = m_State[4] + l[0] + r[1];
+        m_State[4] = m_State[0] + l[1] + r[2];
+        m_State[0] = t;
+    }
+
+protected:
+    uint32_t m_State[5];
+};
+
+// Whirlpool tables, computed once from the mini-boxes of the S-box and the circulant matrix
+// cir (1, 1, 4, 1, 8, 5, 2, 9) over GF(2^8) modulo x^8 + x^4 + x^3 + x^2 + 1
+struct WHIRLPOOL_TABLES
+{
+    uint64_t c[8][256];
+    uint64_t rc[10];
+};
+
+static uint8_t WhirlpoolMul (uint8_t a, int b)
+{
+    uint8_t r = 0;
+    for (; b; b >>= 1)
+    {
+        if (b & 1)
+            r ^= a;
+        a = (uint8_t) ((a << 1) ^ ((a & 0x80)? 0x1D : 0));
+    }
+    return r;
+}
+
+static const WHIRLPOOL_TABLES& GetWhirlpoolTables ()
+{
+    static WHIRLPOOL_TABLES tables;
+    static BOOL bInitialized = []
+    {
+        static const uint8_t e[16] = { 0x1, 0xB, 0x9, 0xC, 0xD, 0x6, 0xF, 0x3, 0xE, 0x8, 0x7, 0x4, 0xA, 0x2, 0x5, 0x0 };
+        static const uint8_t r[16] = { 0x7, 0xC, 0xB, 0xD, 0xE, 0x4, 0x9, 0xF, 0x6, 0x3, 0x8, 0xA, 0x2, 0x5, 0x1, 0x0 };
+        static const int factors[8] = { 1, 1, 4, 1, 8, 5, 2, 9 };
+        uint8_t eInv[16], sbox[256];
+
+        for (int i = 0; i < 16; i++)
+            eInv[e[i]] = (uint8_t) i;
+        for (int x = 0; x < 256; x++)
+        {
+            uint8_t u = e[x >> 4], l = eInv[x & 0xF];
+            uint8_t t = r[u ^ l];
+            sbox[x] = (uint8_t) ((e[u ^ t] << 4) | eInv[l ^ t]);
+        }
+
+        for (int x = 0; x < 256; x++)
+        {
+            uint64_t v = 0;
+            for (int j = 0; j < 8; j++)
+                v = (v << 8) | WhirlpoolMul (sbox[x], factors[j]);
+            for (int k = 0; k < 8; k++)
+                tables.c[k][x] = k? ROTR64 (v, 8 * k) : v;
+        }
+        for (int round = 0; round < 10; round++)
+            tables.rc[round] = LoadBe64 (sbox + 8 * round);
+        return TRUE;
+    } ();
+
+    (void) bInitialized;
+    return tables;
+}
+
+class CWhirlpool : public CBlockHash<CWhirlpool, 64>
+{
+public:
+    enum { BlockSize = 64, DigestSize = 64 };
+
+    CWhirlpool () : m_pTables (&GetWhirlpoolTables ()) {}
+
+    void Init ()
+    {
+        memset (m_State, 0, sizeof (m_State));
+        Reset ();
+    }
+
+    void Final (uint8_t* pDigest)
+    {
+        Pad (32, TRUE);
+        for (int i = 0; i < 8; i++)
+            StoreBe64 (pDigest + 8 * i, m_State[i]);
+    }
+
+    void Compress (const uint8_t* p)
+    {
+        uint64_t block[8], k[8], s[8], t[8];
+
+        for (int i = 0; i < 8; i++)
+        {
+            block[i] = LoadBe64 (p + 8 * i);
+            k[i] = m_State[i];
+            s[i] = block[i] ^ k[i];
+        }
+        for (int round = 0; round < 10; round++)
+        {
+            Round (k, t);
+            t[0] ^= m_pTables->rc[round];
+            memcpy (k, t, sizeof (k));
+            Round (s, t);
+            for (int i = 0; i < 8; i++)
+                s[i] = t[i] ^ k[i];
+        }
+        for (int i = 0; i < 8; i++)
+            m_State[i] ^= s[i] ^ block[i];
+    }
+
+protected:
+    // substitution, shift of the columns and mixing of the rows through the tables, unrolled so
+    // that the rows stay in registers
+#define WHIRLPOOL_ROW(c, in, i) \
+    ((c)[0][(in)[(i) & 7] >> 56] ^ (c)[1][((in)[((i) - 1) & 7] >> 48) & 0xFF] ^ \
+     (c)[2][((in)[((i) - 2) & 7] >> 40) & 0xFF] ^ (c)[3][((in)[((i) - 3) & 7] >> 32) & 0xFF] ^ \
+     (c)[4][((in)[((i) - 4) & 7] >> 24) & 0xFF] ^ (c)[5][((in)[((i) - 5) & 7] >> 16) & 0xFF] ^ \
+     (c)[6][((in)[((i) - 6) & 7] >> 8) & 0xFF] ^ (c)[7][(in)[((i) - 7) & 7] & 0xFF])
+
+    void Round (const uint64_t* in, uint64_t* out) const
+    {
+        const uint64_t (*c)[256] = m_pTables->c;
+
+        out[0] = WHIRLPOOL_ROW (c, in, 0);
+        out[1] = WHIRLPOOL_ROW (c, in, 1);
+        out[2] = WHIRLPOOL_ROW (c, in, 2);
+        out[3] = WHIRLPOOL_ROW (c, in, 3);
+        out[4] = WHIRLPOOL_ROW (c, in, 4);
+        out[5] = WHIRLPOOL_ROW (c, in, 5);
+        out[6] = WHIRLPOOL_ROW (c, in, 6);
+        out[7] = WHIRLPOOL_ROW (c, in, 7);
+    }
+
+    const WHIRLPOOL_TABLES* m_pTables;
+    uint64_t m_State[8];
+};
+
+// Streebog (GOST R 34.11-2012, 512-bit digest): blocks are little endian 512-bit numbers
+const unsigned char g_GostPi[256] =
+{
+    252, 238, 221, 17, 207, 110, 49, 22, 251, 196, 250, 218, 35, 197, 4, 77,
+    233, 119, 240, 219, 147, 46, 153, 186, 23, 54, 241, 187, 20, 205, 95, 193,
+    249, 24, 101, 90, 226, 92, 239, 33, 129, 28, 60, 66, 139, 1, 142, 79,
+    5, 132, 2, 174, 227, 106, 143, 160, 6, 11, 237, 152, 127, 212, 211, 31,
+    235, 52, 44, 81, 234, 200, 72, 171, 242, 42, 104, 162, 253, 58, 206, 204,
+    181, 112, 14, 86, 8, 12, 118, 18, 191, 114, 19, 71, 156, 183, 93, 135,
+    21, 161, 150, 41, 16, 123, 154, 199, 243, 145, 120, 111, 157, 158, 178, 177,
+    50, 117, 25, 61, 255, 53, 138, 126, 109, 84, 198, 128, 195, 189, 13, 87,
+    223, 245, 36, 169, 62, 168, 67, 201, 215, 121, 214, 246, 124, 34, 185, 3,
+    224, 15, 236, 222, 122, 148, 176, 188, 220, 232, 40, 80, 78, 51, 10, 74,
+    167, 151, 96, 115, 30, 0, 98, 68, 26, 184, 56, 130, 100, 159, 38, 65,
+    173, 69, 70, 146, 39, 94, 85, 47, 140, 163, 165, 125, 105, 213, 149, 59,
+    7, 88, 179, 64, 134, 172, 29, 247, 48, 55, 107, 228, 136, 217, 231, 137,
+    225, 27, 131, 73, 76, 63, 248, 254, 141, 83, 170, 144, 202, 216, 133, 97,
+    32, 113, 103, 164, 45, 43, 9, 91, 203, 155, 37, 208, 190, 229, 108, 82,
+    89, 166, 116, 210, 230, 244, 180, 192, 209, 102, 175, 194, 57, 75, 99, 182
+};
+
+// rows of the matrix of the linear transformation, the first one applied to the most significant bit
+static const uint64_t g_StreebogA[64] =
+{
+    0x8e20faa72ba0b470ULL, 0x47107ddd9b505a38ULL, 0xad08b0e0c3282d1cULL, 0xd8045870ef14980eULL,
+    0x6c022c38f90a4c07ULL, 0x3601161cf205268dULL, 0x1b8e0b0e798c13c8ULL, 0x83478b07b2468764ULL,
+    0xa011d380818e8f40ULL, 0x5086e740ce47c920ULL, 0x2843fd2067adea10ULL, 0x14aff010bdd87508ULL,
+    0x0ad97808d06cb404ULL, 0x05e23c0468365a02ULL, 0x8c711e02341b2d01ULL, 0x46b60f011a83988eULL,
+    0x90dab52a387ae76fULL, 0x486dd4151c3dfdb9ULL, 0x24b86a840e90f0d2ULL, 0x125c354207487869ULL,
+    0x092e94218d243cbaULL, 0x8a174a9ec8121e5dULL, 0x4585254f64090fa0ULL, 0xaccc9ca9328a8950ULL,
+    0x9d4df05d5f661451ULL, 0xc0a878a0a1330aa6ULL, 0x60543c50de970553ULL, 0x302a1e286fc58ca7ULL,
+    0x18150f14b9ec46ddULL, 0x0c84890ad27623e0ULL, 0x0642ca05693b9f70ULL, 0x0321658cba93c138ULL,
+    0x86275df09ce8aaa8ULL, 0x439da0784e745554ULL, 0xafc0503c273aa42aULL, 0xd960281e9d1d5215ULL,
+    0xe230140fc0802984ULL, 0x71180a8960409a42ULL, 0xb60c05ca30204d21ULL, 0x5b068c651810a89eULL,
+    0x456c34887a3805b9ULL, 0xac361a443d1c8cd2ULL, 0x561b0d22900e4669ULL, 0x2b838811480723baULL,
+    0x9bcf4486248d9f5dULL, 0xc3e9224312c8c1a0ULL, 0xeffa11af0964ee50ULL, 0xf97d86d98a327728ULL,
+    0xe4fa2054a80b329cULL, 0x727d102a548b194eULL, 0x39b008152acb8227ULL, 0x9258048415eb419dULL,
+    0x492c024284fbaec0ULL, 0xaa16012142f35760ULL, 0x550b8e9e21f7a530ULL, 0xa48b474f9ef5dc18ULL,
+    0x70a6a56e2440598eULL, 0x3853dc371220a247ULL, 0x1ca76e95091051adULL, 0x0edd37c48a08a6d8ULL,
+    0x07e095624504536cULL, 0x8d70c431ac02a736ULL, 0xc83862965601dd1bULL, 0x641c314b2b8ee083ULL
+};
+
+// iteration constants C1 to C12, least significant word first
+static const uint64_t g_StreebogC[12][8] =
+{
+    {
+        0xdd806559f2a64507ULL, 0x05767436cc744d23ULL, 0xa2422a08a460d315ULL, 0x4b7ce09192676901ULL,
+        0x714eb88d7585c4fcULL, 0x2f6a76432e45d016ULL, 0xebcb2f81c0657c1fULL, 0xb1085bda1ecadae9ULL
+    },
+    {
+        0xe679047021b19bb7ULL, 0x55dda21bd7cbcd56ULL, 0x5cb561c2db0aa7caULL, 0x9ab5176b12d69958ULL,
+        0x61d55e0f16b50131ULL, 0xf3feea720a232b98ULL, 0x4fe39d460f70b5d7ULL, 0x6fa3b58aa99d2f1aULL
+    },
+    {
+        0x991e96f50aba0ab2ULL, 0xc2b6f443867adb31ULL, 0xc1c93a376062db09ULL, 0xd3e20fe490359eb1ULL,
+        0xf2ea7514b1297b7bULL, 0x06f15e5f529c1f8bULL, 0x0a39fc286a3d8435ULL, 0xf574dcac2bce2fc7ULL
+    },
+    {
+        0x220cbebc84e3d12eULL, 0x3453eaa193e837f1ULL, 0xd8b71333935203beULL, 0xa9d72c82ed03d675ULL,
+        0x9d721cad685e353fULL, 0x488e857e335c3c7dULL, 0xf948e1a05d71e4ddULL, 0xef1fdfb3e81566d2ULL
+    },
+    {
+        0x601758fd7c6cfe57ULL, 0x7a56a27ea9ea63f5ULL, 0xdfff00b723271a16ULL, 0xbfcd1747253af5a3ULL,
+        0x359e35d7800fffbdULL, 0x7f151c1f1686104aULL, 0x9a3f410c6ca92363ULL, 0x4bea6bacad474799ULL
+    },
+    {
+        0xfa68407a46647d6eULL, 0xbf71c57236904f35ULL, 0x0af21f66c2bec6b6ULL, 0xcffaa6b71c9ab7b4ULL,
+        0x187f9ab49af08ec6ULL, 0x2d66c4f95142a46cULL, 0x6fa4c33b7a3039c0ULL, 0xae4faeae1d3ad3d9ULL
+    },
+    {
+        0x8886564d3a14d493ULL, 0x3517454ca23c4af3ULL, 0x06476983284a0504ULL, 0x0992abc52d822c37ULL,
+        0xd3473e33197a93c9ULL, 0x399ec6c7e6bf87c9ULL, 0x51ac86febf240954ULL, 0xf4c70e16eeaac5ecULL
+    },
+    {
+        0xa47f0dd4bf02e71eULL, 0x36acc2355951a8d9ULL, 0x69d18d2bd1a5c42fULL, 0xf4892bcb929b0690ULL,
+        0x89b4443b4ddbc49aULL, 0x4eb7f8719c36de1eULL, 0x03e7aa020c6e4141ULL, 0x9b1f5b424d93c9a7ULL
+    },
+    {
+        0x7261445183235adbULL, 0x0e38dc92cb1f2a60ULL, 0x7b2b8a9aa6079c54ULL, 0x800a440bdbb2ceb1ULL,
+        0x3cd955b7e00d0984ULL, 0x3a7d3a1b25894224ULL, 0x944c9ad8ec165fdeULL, 0x378f5a541631229bULL
+    },
+    {
+        0x74b4c7fb98459cedULL, 0x3698fad1153bb6c3ULL, 0x7a1e6c303b7652f4ULL, 0x9fe76702af69334bULL,
+        0x1fffe18a1b336103ULL, 0x8941e71cff8a78dbULL, 0x382ae548b2e4f3f3ULL, 0xabbedea680056f52ULL
+    },
+    {
+        0x6bcaa4cd81f32d1bULL, 0xdea2594ac06fd85dULL, 0xefbacd1d7d476e98ULL, 0x8a1d71efea48b9caULL,
+        0x2001802114846679ULL, 0xd8fa6bbbebab0761ULL, 0x3002c6cd635afe94ULL, 0x7bcd9ed0efc889fbULL
+    },
+    {
+        0x48bc924af11bd720ULL, 0xfaf417d5d9b21b99ULL, 0xe71da4aa88e12852ULL, 0x5d80ef9d1891cc86ULL,
+        0xf82012d430219f9bULL, 0xcda43c32bcdf1d77ULL, 0xd21380b00449b17aULL, 0x378ee767f11631baULL
+    }
+};
+
+// LPS transformation tables: t[j][v] is the linear transformation of Pi (v) in byte j of a word
+static const uint64_t (*GetStreebogTables ())[256]
+{
+    static uint64_t tables[8][256];
+    static BOOL bInitialized = []
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            for (int v = 0; v < 256; v++)
+            {
+                uint64_t x = (uint64_t) g_GostPi[v] << (8 * j), r = 0;
+                for (int bit = 0; bit < 64; bit++)
+                {
+                    if (x & (1ULL << (63 - bit)))
+                        r ^= g_StreebogA[bit];
+                }
+                tables[j][v] = r;
+            }
+        }
+        return TRUE;
+    } ();
+
+    (void) bInitialized;
+    return tables;
+}
+
+class CStreebog : public CBlockHash<CStreebog, 64>
+{
+public:
+    enum { BlockSize = 64, DigestSize = 64 };
+
+    CStreebog () : m_pTables (GetStreebogTables ()) {}
+
+    void Init ()
+    {
+        memset (m_H, 0, sizeof (m_H));
+        memset (m_N, 0, sizeof (m_N));
+        memset (m_Sigma, 0, sizeof (m_Sigma));
+        Reset ();
+    }
+
+    void Final (uint8_t* pDigest)
+    {
+        static const uint64_t zero[8] = { 0 };
+        uint64_t m[8];
+
+        // the last block, possibly empty, is padded with 1 and zeros
+        memset (m_Buffer + m_cbBuffer, 0, BlockSize - m_cbBuffer);
+        m_Buffer[m_cbBuffer] = 0x01;
+        Load (m_Buffer, m);
+        G (m_N, m);
+        Add (m_N, (uint64_t) m_cbBuffer * 8);
+        Add (m_Sigma, m);
+        G (zero, m_N);
+        G (zero, m_Sigma);
+        for (int i = 0; i < 8; i++)
+            StoreLe64 (pDigest + 8 * i, m_H[i]);
+    }
+
+    void Compress (const uint8_t* p)
+    {
+        uint64_t m[8];
+
+        Load (p, m);
+        G (m_N, m);
+        Add (m_N, 512);
+        Add (m_Sigma, m);
+    }
+
+protected:
+    static void Load (const uint8_t* p, uint64_t* m)
+    {
+        for (int i = 0; i < 8; i++)
+            m[i] = LoadLe64 (p + 8 * i);
+    }
+
+    // addition modulo 2^512
+    static void Add (uint64_t* a, const uint64_t* b)
+    {
+        uint64_t carry = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            uint64_t sum = a[i] + b[i];
+            uint64_t carryOut = (sum < a[i])? 1 : 0;
+            a[i] = sum + carry;
+            carry = carryOut | ((a[i] < sum)? 1 : 0);
+        }
+    }
+
+    static void Add (uint64_t* a, uint64_t b)
+    {
+        for (int i = 0; i < 8 && b; i++)
+        {
+            a[i] += b;
+            b = (a[i] < b)? 1 : 0;
+        }
+    }
+
+#define STREEBOG_LPS_WORD(t, in, i) \
+    ((t)[0][((in)[0] >> (8 * (i))) & 0xFF] ^ (t)[1][((in)[1] >> (8 * (i))) & 0xFF] ^ \
+     (t)[2][((in)[2] >> (8 * (i))) & 0xFF] ^ (t)[3][((in)[3] >> (8 * (i))) & 0xFF] ^ \
+     (t)[4][((in)[4] >> (8 * (i))) & 0xFF] ^ (t)[5][((in)[5] >> (8 * (i))) & 0xFF] ^ \
+     (t)[6][((in)[6] >> (8 * (i))) & 0xFF] ^ (t)[7][((in)[7] >> (8 * (i))) & 0xFF])
+
+    void Lps (const uint64_t* in, uint64_t* out) const
+    {
+        const uint64_t (*t)[256] = m_pTables;
+
+        out[0] = STREEBOG_LPS_WORD (t, in, 0);
+        out[1] = STREEBOG_LPS_WORD (t, in, 1);
+        out[2] = STREEBOG_LPS_WORD (t, in, 2);
+        out[3] = STREEBOG_LPS_WORD (t, in, 3);
+        out[4] = STREEBOG_LPS_WORD (t, in, 4);
+        out[5] = STREEBOG_LPS_WORD (t, in, 5);
+        out[6] = STREEBOG_LPS_WORD (t, in, 6);
+        out[7] = STREEBOG_LPS_WORD (t, in, 7);
+    }
+
+    // compression function g_N (h, m) = E (LPS (h ^ N), m) ^ h ^ m
+    void G (const uint64_t* n, const uint64_t* m)
+    {
+        uint64_t k[8], s[8], t[8];
+
+        for (int i = 0; i < 8; i++)
+            t[i] = m_H[i] ^ n[i];
+        Lps (t, k);
+        for (int i = 0; i < 8; i++)
+            t[i] = k[i] ^ m[i];
+        for (int round = 0; round < 12; round++)
+        {
+            Lps (t, s);
+            for (int i = 0; i < 8; i++)
+                k[i] ^= g_StreebogC[round][i];
+            Lps (k, t);
+            memcpy (k, t, sizeof (k));
+            for (int i = 0; i < 8; i++)
+                t[i] = s[i] ^ k[i];
+        }
+        for (int i = 0; i < 8; i++)
+            m_H[i] ^= t[i] ^ m[i];
+    }
+
+    const uint64_t (*m_pTables)[256];
+    uint64_t m_H[8];
+    uint64_t m_N[8];
+    uint64_t m_Sigma[8];
+};
+
+// PBKDF2 (RFC 2898) with HMAC-H: the inner and outer states after the pads are copied for each HMAC
+template <class H> static void DeriveKey (const uint8_t* pbPassword, size_t cbPassword, const uint8_t* pbSalt, size_t cbSalt,
+    int iterations, uint8_t* pbKey, size_t cbKey)
+{
+    uint8_t key[H::BlockSize], pad[H::BlockSize], u[H::DigestSize], t[H::DigestSize], counter[4];
+    H inner, outer, h;
+
+    memset (key, 0, sizeof (key));
+    if (cbPassword > H::BlockSize)
+    {
+        h.Init ();
+        h.Update (pbPassword, cbPassword);
+        h.Final (key);
+    }
+    else
+        memcpy (key, pbPassword, cbPassword);
+
+    for (int i = 0; i < H::BlockSize; i++)
+        pad[i] = key[i] ^ 0x36;
+    inner.Init ();
+    inner.Update (pad, H::BlockSize);
+    for (int i = 0; i < H::BlockSize; i++)
+        pad[i] = key[i] ^ 0x5C;
+    outer.Init ();
+    outer.Update (pad, H::BlockSize);
+
+    for (uint32_t block = 1; cbKey > 0; block++)
+    {
+        size_t n = (cbKey < (size_t) H::DigestSize)? cbKey : (size_t) H::DigestSize;
+
+        StoreBe32 (counter, block);
+        h = inner;
+        h.Update (pbSalt, cbSalt);
+        h.Update (counter, sizeof (counter));
+        h.Final (u);
+        h = outer;
+        h.Update (u, H::DigestSize);
+        h.Final (u);
+        memcpy (t, u, sizeof (t));
+
+        for (int i = 1; i < iterations; i++)
+        {
+            h = inner;
+            h.Update (u, H::DigestSize);
+            h.Final (u);
+            h = outer;
+            h.Update (u, H::DigestSize);
+            h.Final (u);
+            for (int j = 0; j < H::DigestSize; j++)
+                t[j] ^= u[j];
+        }
+
+        memcpy (pbKey, t, n);
+        pbKey += n;
+        cbKey -= n;
+    }
+}
+
+size_t GetPrfDigestSize (int pkcs5)
+{
+    switch (pkcs5)
+    {
+    case 1: return CSha512::DigestSize;
+    case 2: return CWhirlpool::DigestSize;
+    case 3: return CSha256::DigestSize;
+    case 4: return CRipemd160::DigestSize;
+    case 5: return CStreebog::DigestSize;
+    default: return 0;
+    }
+}
+
+BOOL DerivePbkdf2 (int pkcs5, const unsigned char* pbPassword, size_t cbPassword, const unsigned char* pbSalt, size_t cbSalt,
+    int iterations, unsigned char* pbKey, size_t cbKey)
+{
+    switch (pkcs5)
+    {
+    case 1: DeriveKey<CSha512> (pbPassword, cbPassword, pbSalt, cbSalt, iterations, pbKey, cbKey); return TRUE;
+    case 2: DeriveKey<CWhirlpool> (pbPassword, cbPassword, pbSalt, cbSalt, iterations, pbKey, cbKey); return TRUE;
+    case 3: DeriveKey<CSha256> (pbPassword, cbPassword, pbSalt, cbSalt, iterations, pbKey, cbKey); return TRUE;
+    case 4: DeriveKey<CRipemd160> (pbPassword, cbPassword, pbSalt, cbSalt, iterations, pbKey, cbKey); return TRUE;
+    case 5: DeriveKey<CStreebog> (pbPassword, cbPassword, pbSalt, cbSalt, iterations, pbKey, cbKey); return TRUE;
+    default: return FALSE;
+    }
+}
+
+int GetPkcs5IterationCount (int pkcs5, int pim, BOOL bBoot)
+{
+    switch (pkcs5)
+    {
+    case 1:
+    case 2:
+        return (pim == 0)? 500000 : 15000 + pim * 1000;
+    case 3:
+    case 5:
+        if (pim == 0)
+            return bBoot? 200000 : 500000;
+        return bBoot? pim * 2048 : 15000 + pim * 1000;
+    case 4:
+        if (pim == 0)
+            return bBoot? 327661 : 655331;
+        return bBoot? pim * 2048 : 15000 + pim * 1000;
+    default:
+        return 0;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Known answer tests
+
+typedef struct
+{
+    const char* szPassword;
+    size_t cbPassword;
+    const char* szSalt;
+    size_t cbSalt;
+    int iterations;
+    size_t cbKey;
+} PBKDF2_TEST_INPUT;
+
+// inputs of the RFC 6070 vectors 1, 5 and 6, written for HMAC-SHA-1 which VeraCrypt doesn't use.
+// The first one derives 64 bytes to span several blocks of the shorter digests.
+static const PBKDF2_TEST_INPUT g_Pbkdf2TestInputs[3] =
+{
+    { "password", 8, "salt", 4, 1, 64 },
+    { "passwordPASSWORDpassword", 24, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096, 25 },
+    { "pass\0word", 9, "sa\0lt", 5, 4096, 16 }
+};
+
+// keys derived from the inputs above with each PRF, computed with libgcrypt
+static const struct
+{
+    LPCTSTR szName;
+    const char* szKeys[3];
+} g_Pbkdf2Tests[PRF_LAST_ID] =
+{
+    {
+        TEXT("PBKDF2 HMAC-SHA-512"),
+        {
+            "867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce",
+            "8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868",
+            "9d9e9c4cd21fe4be24d5b8244c759665"
+        }
+    },
+    {
+        TEXT("PBKDF2 HMAC-Whirlpool"),
+        {
+            "7e25009bf8afade8ab33911d331b5b3e987fc7c3e2d5fdb3f33c183e837c357850a75eb8baad2c05b1e3bc7068c2a2d5c0f3e586f401610ad02f525c8fcf2cbd",
+            "b704488bcc9371a5fa3a7eb6e7555549a96eae3d572c0d505e",
+            "a5a8f2abe3b0cd5a4084987de2f6ef48"
+        }
+    },
+    {
+        TEXT("PBKDF2 HMAC-SHA-256"),
+        {
+            "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b4dbf3a2f3dad3377264bb7b8e8330d4efc7451418617dabef683735361cdc18c",
+            "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c",
+            "89b69d0516f829893c696226650a8687"
+        }
+    },
+    {
+        TEXT("PBKDF2 HMAC-RIPEMD-160"),
+        {
+            "b725258b125e0bacb0e2307e34feb16a4d0d6aed6cb4b0eee458fc18290204289e55d962783bf52237d264cbbab25f18d89d8c798f90f558ea7b45bdf3d08334",
+            "503b9a069633b261b2d3e4f21c5d0cafeb3f5008aec25ed214",
+            "7b2f446afb201a536f7c9bf53fd2f14a"
+        }
+    },
+    {
+        TEXT("PBKDF2 HMAC-STREEBOG"),
+        {
+            "64770af7f748c3b1c9ac831dbcfd85c26111b30a8a657ddc3056b80ca73e040d2854fd36811f6d825cc4ab66ec0a68a490a9e5cf5156b3a2b7eecddbf9a16b47",
+            "b2d8f1245fc4d29274802057e4b54e0a0753aa22fc53760b30",
+            "50df062885b69801a3c10248eb0a27ab"
+        }
+    }
+};
+
+static BOOL MatchesHex (const uint8_t* p, size_t cb, const char* szHex)
+{
+    static const char szDigits[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < cb; i++)
+    {
+        if (szHex[2 * i] != szDigits[p[i] >> 4] || szHex[2 * i + 1] != szDigits[p[i] & 0x0F])
+            return FALSE;
+    }
+    return szHex[2 * cb] == 0;
+}
+
+// digest of szMessage repeated count times
+template <class H> static BOOL TestDigest (const char* szMessage, size_t count, const char* szExpected)
+{
+    uint8_t digest[H::DigestSize];
+    H h;
+
+    h.Init ();
+    for (size_t i = 0; i < count; i++)
+        h.Update ((const uint8_t*) szMessage, strlen (szMessage));
+    h.Final (digest);
+    return MatchesHex (digest, sizeof (digest), szExpected);
+}
+
+#define TEST_MESSAGE_10_A	"aaaaaaaaaa"
+
+LPCTSTR TestPbkdf2 ()
+{
+    // ISO/IEC 10118-3 and GOST R 34.11-2012 (example 1), the million "a" of Streebog computed with libgcrypt
+    if (!TestDigest<CWhirlpool> ("abc", 1, "4e2448a4c6f486bb16b6562c73b4020bf3043e3a731bce721ae1b303d97e6d4c7181eebdb6c57e277d0e34957114cbd6c797fc9d95d8b582d225292076d4eef5")
+        || !TestDigest<CWhirlpool> (TEST_MESSAGE_10_A, 100000, "0c99005beb57eff50a7cf005560ddf5d29057fd86b20bfd62deca0f1ccea4af51fc15490eddc47af32bb2b66c34ff9ad8c6008ad677f77126953b226e4ed8b01"))
+    {
+        return TEXT("Whirlpool");
+    }
+    if (!TestDigest<CStreebog> ("012345678901234567890123456789012345678901234567890123456789012", 1, "1b54d01a4af5b9d5cc3d86d68d285462b19abc2475222f35c085122be4ba1ffa00ad30f8767b3a82384c6574f024c311e2a481332b08ef7f41797891c1646f48")
+        || !TestDigest<CStreebog> (TEST_MESSAGE_10_A, 100000, "d396a40b126b1f324465bfa7aa159859ab33fac02dcdd4515ad231206396a266d0102367e4c544ef47d2294064e1a25342d0cd25ae3d904b45abb1425ae41095"))
+    {
+        return TEXT("Streebog");
+    }
+
+    for (int pkcs5 = PRF_FIRST_ID; pkcs5 <= PRF_LAST_ID; pkcs5++)
+    {
+        for (size_t i = 0; i < ARRAYSIZE (g_Pbkdf2TestInputs); i++)
+        {
+            const PBKDF2_TEST_INPUT& input = g_Pbkdf2TestInputs[i];
+            uint8_t key[64];
+
+            DerivePbkdf2 (pkcs5, (const uint8_t*) input.szPassword, input.cbPassword, (const uint8_t*) input.szSalt, input.cbSalt,
+                input.iterations, key, input.cbKey);
+            if (!MatchesHex (key, input.cbKey, g_Pbkdf2Tests[pkcs5 - 1].szKeys[i]))
+                return g_Pbkdf2Tests[pkcs5 - 1].szName;
+        }
+    }
+
+    return NULL;
+}
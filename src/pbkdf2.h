@@ -0,0 +1,37 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "defs.h"
+
+// PBKDF2 with the PRFs of VeraCrypt (pkcs5 field of the volume properties), used to measure the
+// header key derivation cost on this machine. The pads of the password are hashed once per
+// derivation and each iteration only hashes the previous digest from the saved HMAC states.
+
+#define PRF_FIRST_ID			1
+#define PRF_LAST_ID				5
+
+// bytes derived from the password to decrypt a volume header: the largest key of a cascade of
+// three ciphers in XTS mode
+#define PRF_HEADER_KEY_SIZE		192
+
+// digest size of the PRF, 0 if it is unknown
+size_t GetPrfDigestSize (int pkcs5);
+
+// FALSE if the PRF is unknown
+BOOL DerivePbkdf2 (int pkcs5, const unsigned char* pbPassword, size_t cbPassword, const unsigned char* pbSalt, size_t cbSalt,
+	int iterations, unsigned char* pbKey, size_t cbKey);
+
+// Known answer tests of the Whirlpool and Streebog digests and of PBKDF2 with each PRF: NULL if
+// all of them passed, else the name of the first one that failed.
+LPCTSTR TestPbkdf2 ();
+
+// iterations used by VeraCrypt for a PRF and a PIM (0 = default), for volumes or system encryption
+int GetPkcs5IterationCount (int pkcs5, int pim, BOOL bBoot);
+
+// substitution of Streebog, also used by the Kuznyechik cipher (GOST R 34.12-2015)
+extern const unsigned char g_GostPi[256];
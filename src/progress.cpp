@@ -0,0 +1,208 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "progress.h"
+#include <math.h>
+
+// time constant of the exponential smoothing of the transform rate
+#define PROGRESS_RATE_SMOOTHING_SECONDS		60.0
+
+BOOL SampleSysEncProgress (CVcDriver& driver, SYSENC_PROGRESS_SAMPLE& sample)
+{
+    BootEncryptionStatus status;
+    DWORD cbBytesReturned = 0;
+
+    memset (&status, 0, sizeof (status));
+    if (!driver.IoControl (VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS, NULL, 0, &status, sizeof (status), &cbBytesReturned))
+        return FALSE;
+
+    sample.timestampUs = GetTimestampUs ();
+    sample.bSetupInProgress = status.SetupInProgress;
+    sample.setupMode = status.SetupInProgress? status.SetupMode : SetupNone;
+    sample.bWaitingForIdle = status.SetupInProgress && status.TransformWaitingForIdle;
+    sample.state = GetSystemEncryptionState (status);
+
+    if (status.ConfiguredEncryptedAreaEnd > status.ConfiguredEncryptedAreaStart && status.ConfiguredEncryptedAreaStart >= 0)
+        sample.totalBytes = (unsigned __int64) (status.ConfiguredEncryptedAreaEnd - status.ConfiguredEncryptedAreaStart) + 1;
+    else
+        sample.totalBytes = 0;
+
+    if (status.EncryptedAreaStart >= 0 && status.EncryptedAreaEnd > status.EncryptedAreaStart)
+        sample.encryptedBytes = (unsigned __int64) (status.EncryptedAreaEnd - status.EncryptedAreaStart) + 1;
+    else
+        sample.encryptedBytes = 0;
+    if (sample.state == SYSENC_FULL)
+        sample.encryptedBytes = sample.totalBytes;
+
+    return TRUE;
+}
+
+void InitSysEncProgress (SYSENC_PROGRESS_TRACKER& tracker, DWORD dwStallSeconds)
+{
+    memset (&tracker, 0, sizeof (tracker));
+    tracker.dwStallSeconds = dwStallSeconds;
+}
+
+void UpdateSysEncProgress (SYSENC_PROGRESS_TRACKER& tracker, const SYSENC_PROGRESS_SAMPLE& sample, SYSENC_PROGRESS& progress)
+{
+    unsigned __int64 remainingBytes;
+
+    memset (&progress, 0, sizeof (progress));
+    progress.etaSeconds = -1;
+    progress.percent = sample.totalBytes? (double) sample.encryptedBytes * 100.0 / (double) sample.totalBytes : 0.0;
+    if (sample.state == SYSENC_FULL)
+        progress.percent = 100.0;
+
+    if (!tracker.bHasPrevious || sample.encryptedBytes != tracker.previous.encryptedBytes)
+        tracker.lastAdvanceUs = sample.timestampUs;
+
+    if (tracker.bHasPrevious)
+    {
+        const SYSENC_PROGRESS_SAMPLE& previous = tracker.previous;
+
+        progress.bModeChanged = (sample.setupMode != previous.setupMode);
+
+        // the rate of the previous setup is meaningless for the new one
+        if (progress.bModeChanged || !sample.bSetupInProgress)
+            tracker.bRateValid = FALSE;
+        else if (sample.timestampUs > previous.timestampUs)
+        {
+            double dElapsed = (double) (sample.timestampUs - previous.timestampUs) / 1000000.0;
+            double dDelta = (double) sample.encryptedBytes - (double) previous.encryptedBytes;
+            double dRate = ((sample.setupMode == SetupDecryption)? -dDelta : dDelta) / dElapsed;
+
+            // exponential moving average, weighted by the sampling period
+            if (tracker.bRateValid)
+            {
+                double alpha = 1.0 - exp (-dElapsed / PROGRESS_RATE_SMOOTHING_SECONDS);
+                tracker.bytesPerSec += alpha * (dRate - tracker.bytesPerSec);
+            }
+            else
+                tracker.bytesPerSec = dRate;
+            tracker.bRateValid = TRUE;
+        }
+    }
+
+    progress.stalledSeconds = (double) (sample.timestampUs - tracker.lastAdvanceUs) / 1000000.0;
+
+    if (!sample.bSetupInProgress)
+        progress.state = PROGRESS_STOPPED;
+    else if (sample.bWaitingForIdle)
+        progress.state = PROGRESS_WAITING_FOR_IDLE;
+    else if (tracker.dwStallSeconds && progress.stalledSeconds >= (double) tracker.dwStallSeconds)
+        progress.state = PROGRESS_STALLED;
+    else
+        progress.state = PROGRESS_RUNNING;
+
+    if (tracker.bRateValid)
+    {
+        progress.bytesPerSec = tracker.bytesPerSec;
+        remainingBytes = (sample.setupMode == SetupDecryption)? sample.encryptedBytes : sample.totalBytes - sample.encryptedBytes;
+        if (progress.bytesPerSec > 0)
+            progress.etaSeconds = (double) remainingBytes / progress.bytesPerSec;
+    }
+
+    tracker.previous = sample;
+    tracker.bHasPrevious = TRUE;
+}
+
+static LPCTSTR GetSetupModeName (BootEncryptionSetupMode mode)
+{
+    switch (mode)
+    {
+    case SetupEncryption: return TEXT("encryption");
+    case SetupDecryption: return TEXT("decryption");
+    default: return TEXT("none");
+    }
+}
+
+static void FormatDuration (double dSeconds, TCHAR* szOut, size_t cchOut)
+{
+    unsigned __int64 seconds = (unsigned __int64) (dSeconds + 0.5);
+    StringCchPrintf (szOut, cchOut, TEXT("%I64u:%02u:%02u"), seconds / 3600, (unsigned int) ((seconds / 60) % 60), (unsigned int) (seconds % 60));
+}
+
+static int GetSysEncExitCode (eSysEncState state)
+{
+    switch (state)
+    {
+        case SYSENC_FULL: return VC_STATUS_OK;
+        case SYSENC_PARTIAL: return VC_STATUS_SYSENC_PARTIAL;
+        default: return VC_STATUS_SYSENC_NONE;
+    }
+}
+
+// Sample the system encryption status every dwIntervalMs and print the progress of the
+// encryption/decryption with its rate and ETA, stalls and setup mode changes.
+// Stops after iCount samples (0 = no limit) or when no setup is in progress anymore.
+int RunSysEncProgress (CVcDriver& driver, DWORD dwIntervalMs, int iCount, DWORD dwStallSeconds)
+{
+    SYSENC_PROGRESS_TRACKER tracker;
+    SYSENC_PROGRESS_SAMPLE sample;
+    SYSENC_PROGRESS progress;
+    eProgressState previousState = PROGRESS_RUNNING;
+    unsigned __int64 startUs, nextUs;
+    TCHAR szRate[32], szEta[32];
+
+    InitSysEncProgress (tracker, dwStallSeconds);
+    _tprintf (TEXT("Watching system encryption progress every %.1f seconds\n"), (double) dwIntervalMs / 1000.0);
+
+    startUs = nextUs = GetTimestampUs ();
+    for (int n = 0; iCount <= 0 || n < iCount; n++)
+    {
+        // the sampling period doesn't drift
+        if (n > 0)
+            SleepUntilNext (nextUs, dwIntervalMs);
+
+        if (!SampleSysEncProgress (driver, sample))
+        {
+            _tprintf(TEXT("Call to VeraCrypt driver (GET_BOOT_ENCRYPTION_STATUS) failed with error %s\n"), GetWin32ErrorStr(GetLastError ()));
+            return VC_STATUS_DRIVER_CALL_FAILED;
+        }
+        BootEncryptionSetupMode previousMode = tracker.previous.setupMode;
+        UpdateSysEncProgress (tracker, sample, progress);
+
+        double dTime = (double) (sample.timestampUs - startUs) / 1000000.0;
+        if (progress.bModeChanged && sample.bSetupInProgress)
+            _tprintf (TEXT("[%8.1fs] Setup mode changed: %s -> %s\n"), dTime, GetSetupModeName (previousMode), GetSetupModeName (sample.setupMode));
+
+        if (progress.state == PROGRESS_STOPPED)
+        {
+            _tprintf (TEXT("[%8.1fs] No system encryption setup in progress. Encrypted Portion: %.2f%%\n"), dTime, progress.percent);
+            fflush (stdout);
+            return GetSysEncExitCode (sample.state);
+        }
+
+        if (progress.state == PROGRESS_WAITING_FOR_IDLE && previousState != PROGRESS_WAITING_FOR_IDLE)
+            _tprintf (TEXT("[%8.1fs] Stalled: waiting for the system to be idle\n"), dTime);
+        else if (progress.state == PROGRESS_STALLED && previousState != PROGRESS_STALLED)
+            _tprintf (TEXT("[%8.1fs] Stalled: no progress for %.0f seconds\n"), dTime, progress.stalledSeconds);
+        else if (progress.state == PROGRESS_RUNNING && previousState != PROGRESS_RUNNING)
+            _tprintf (TEXT("[%8.1fs] Resumed\n"), dTime);
+        previousState = progress.state;
+
+        if (progress.bytesPerSec < 0)
+        {
+            FormatRate (-progress.bytesPerSec, szRate, ARRAYSIZE (szRate));
+            StringCchPrintf (szEta, ARRAYSIZE (szEta), TEXT("unknown (moving backwards at %s)"), szRate);
+            szRate[0] = 0;
+        }
+        else
+        {
+            FormatRate (progress.bytesPerSec, szRate, ARRAYSIZE (szRate));
+            if (progress.etaSeconds >= 0)
+                FormatDuration (progress.etaSeconds, szEta, ARRAYSIZE (szEta));
+            else
+                StringCchPrintf (szEta, ARRAYSIZE (szEta), TEXT("unknown"));
+        }
+        _tprintf (TEXT("[%8.1fs] %s %.2f%%, %s%sETA %s\n"), dTime, (sample.setupMode == SetupDecryption)? TEXT("Decrypting") : TEXT("Encrypting"),
+            progress.percent, szRate, szRate[0]? TEXT(", ") : TEXT(""), szEta);
+        fflush (stdout);
+    }
+
+    return (previousState == PROGRESS_RUNNING)? GetSysEncExitCode (sample.state) : VC_STATUS_SYSENC_STALLED;
+}
@@ -0,0 +1,57 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "common.h"
+#include "driver.h"
+
+// transform state of system encryption at a given time
+typedef struct
+{
+	unsigned __int64 timestampUs;
+	BOOL bSetupInProgress;
+	BootEncryptionSetupMode setupMode;
+	BOOL bWaitingForIdle;			/* TransformWaitingForIdle: the driver pauses while the system is busy */
+	unsigned __int64 encryptedBytes;	/* size of the encrypted area */
+	unsigned __int64 totalBytes;		/* size of the configured area */
+	eSysEncState state;
+} SYSENC_PROGRESS_SAMPLE;
+
+typedef enum
+{
+	PROGRESS_RUNNING = 0,
+	PROGRESS_WAITING_FOR_IDLE,
+	PROGRESS_STALLED,		/* setup in progress but the encrypted area didn't change for the stall period */
+	PROGRESS_STOPPED,		/* no setup in progress (finished, or interrupted by the user) */
+} eProgressState;
+
+// estimation computed from the successive samples
+typedef struct
+{
+	eProgressState state;
+	BOOL bModeChanged;		/* SetupMode differs from the one of the previous sample */
+	double percent;			/* encrypted portion of the configured area */
+	double bytesPerSec;		/* smoothed transform rate towards the end of the current setup, negative if moving backwards */
+	double etaSeconds;		/* -1 if unknown */
+	double stalledSeconds;	/* time since the encrypted area last changed */
+} SYSENC_PROGRESS;
+
+// state kept between samples by UpdateSysEncProgress
+typedef struct
+{
+	BOOL bHasPrevious;
+	SYSENC_PROGRESS_SAMPLE previous;
+	unsigned __int64 lastAdvanceUs;
+	BOOL bRateValid;
+	double bytesPerSec;
+	DWORD dwStallSeconds;
+} SYSENC_PROGRESS_TRACKER;
+
+BOOL SampleSysEncProgress (CVcDriver& driver, SYSENC_PROGRESS_SAMPLE& sample);
+void InitSysEncProgress (SYSENC_PROGRESS_TRACKER& tracker, DWORD dwStallSeconds);
+void UpdateSysEncProgress (SYSENC_PROGRESS_TRACKER& tracker, const SYSENC_PROGRESS_SAMPLE& sample, SYSENC_PROGRESS& progress);
+int RunSysEncProgress (CVcDriver& driver, DWORD dwIntervalMs, int iCount, DWORD dwStallSeconds);
@@ -0,0 +1,192 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "query.h"
+#include "snapshot.h"
+#include "trace.h"
+#ifdef _WIN32
+#include <strsafe.h>
+#endif
+
+BOOL IsDriveLetter (LPCTSTR szName)
+{
+	BOOL bRet = FALSE;
+	if ((_tcslen (szName) == 2) && (szName[1] == TEXT(':')) && (_totupper(szName[0]) >= TEXT('A')) && (_totupper(szName[0]) <= TEXT('Z')))
+		bRet = TRUE;
+	return bRet;
+}
+
+// commands supporting /format json|csv|kv
+BOOL IsMachineReadableCommand (int argc, TCHAR** argv)
+{
+    return (argc == 1)
+        || ((argc == 2) && (_tcsicmp (argv[1], TEXT("/sysenc")) == 0
+                            || _tcsicmp (argv[1], TEXT("/list")) == 0
+                            || _tcsicmp (argv[1], TEXT("/all")) == 0
+                            || IsDriveLetter (argv[1])));
+}
+
+int FormatMachineReadableQuery (VS_SESSION* pSession, COutputBuffer& out, eOutputFormat format, int argc, TCHAR** argv)
+{
+    static VC_SNAPSHOT snapshot;
+    CTraceScope scope ("query", "phase");
+    CRecordWriter writer (out, format);
+    int iRet = VC_STATUS_OK;
+    LONG DriverVersion = 0;
+    char szVersion[16];
+
+    writer.BeginDocument ();
+    writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+
+    if (!pSession)
+    {
+        FormatDriverError (writer, "OPEN_DRIVER", GetLastError ());
+        iRet = VC_STATUS_NO_DRIVER;
+    }
+    else if (!VsGetDriverVersion (pSession, &DriverVersion))
+    {
+        FormatDriverError (writer, "GET_DRIVER_VERSION", GetLastError ());
+        iRet = VC_STATUS_DRIVER_CALL_FAILED;
+    }
+    else
+    {
+        StringCbPrintfA (szVersion, sizeof (szVersion), "%x.%x", (int)(unsigned char)(DriverVersion >> 8), (int)(unsigned char)(DriverVersion & 0x000000FF));
+        writer.String ("driverVersion", szVersion);
+
+        if (argc == 1 || _tcsicmp (argv[1], TEXT("/sysenc")) == 0 || _tcsicmp (argv[1], TEXT("/all")) == 0)
+        {
+            BOOL bAll = (argc == 2) && (_tcsicmp (argv[1], TEXT("/all")) == 0);
+
+            memset (&snapshot, 0, sizeof (snapshot));
+            if (!bAll)
+                QuerySystemEncryption (VsGetDriver (pSession), snapshot);
+
+            if (bAll && !TakeSnapshot (VsGetDriver (pSession), snapshot))
+            {
+                FormatDriverError (writer, "GET_MOUNTED_VOLUMES", GetLastError ());
+                iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            }
+            else if (!snapshot.bBootStatusValid && !bAll)
+            {
+                FormatDriverError (writer, "GET_BOOT_ENCRYPTION_STATUS", GetLastError ());
+                iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            }
+            else
+            {
+                if (snapshot.bBootStatusValid)
+                {
+                    eSysEncState state = GetSystemEncryptionState (snapshot.bootStatus);
+
+                    writer.BeginRecord ("sysenc");
+                    FormatSystemEncryptionInformation (writer, snapshot.bootStatus, snapshot.cbBootStatus);
+                    if (snapshot.bBootLoaderVersionValid)
+                        writer.UInt ("DriverBootLoaderVersion", snapshot.bootLoaderVersion);
+                    writer.EndRecord ();
+
+                    if (snapshot.bBootDrivePropValid)
+                    {
+                        writer.BeginRecord ("bootDrive");
+                        FormatVolumeInformation (writer, snapshot.bootDriveProp);
+                        writer.EndRecord ();
+                    }
+
+                    switch (state)
+                    {
+                        case SYSENC_FULL: iRet = VC_STATUS_OK; break;
+                        case SYSENC_PARTIAL: iRet = VC_STATUS_SYSENC_PARTIAL; break;
+                        default: iRet = VC_STATUS_SYSENC_NONE; break;
+                    }
+                }
+
+                if (bAll)
+                {
+                    writer.BeginList ("volumes");
+                    for (int i = 0; i < 26; i++)
+                    {
+                        if (snapshot.volumes.ulMountedDrives & (1 << i))
+                        {
+                            char szKey[2] = { (char) ('A' + i), 0 };
+                            writer.BeginRecord ("volume", szKey);
+                            FormatVolumeInformation (writer, snapshot.volumes.prop[i]);
+                            writer.EndRecord ();
+                        }
+                    }
+                    writer.EndList ();
+                    if (snapshot.volumes.ulTimedOutDrives)
+                        writer.Hex32 ("timedOutDrives", snapshot.volumes.ulTimedOutDrives);
+                    writer.Bool ("consistent", snapshot.bConsistent);
+                    iRet = snapshot.bConsistent? VC_STATUS_OK : VC_STATUS_SNAPSHOT_INCONSISTENT;
+                }
+            }
+        }
+        else
+        {
+            MOUNT_LIST_STRUCT mlist;
+
+            if (!VsQueryMountList (pSession, &mlist))
+            {
+                FormatDriverError (writer, "GET_MOUNTED_VOLUMES", GetLastError ());
+                iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            }
+            else if (_tcsicmp (argv[1], TEXT("/list")) == 0)
+            {
+                writer.Hex32 ("mountedDrives", mlist.ulMountedDrives);
+                writer.BeginList ("volumes");
+                for (int i = 0; i < 26; i++)
+                {
+                    if (mlist.ulMountedDrives & (1 << i))
+                    {
+                        char szKey[2] = { (char) ('A' + i), 0 };
+                        writer.BeginRecord ("volume", szKey);
+                        writer.Int ("driveNo", i);
+                        writer.String ("driveLetter", szKey);
+                        writer.WideString ("wszVolume", mlist.wszVolume[i], ARRAYSIZE (mlist.wszVolume[i]));
+                        writer.WideString ("wszLabel", mlist.wszLabel[i], ARRAYSIZE (mlist.wszLabel[i]));
+                        writer.UInt ("diskLength", mlist.diskLength[i]);
+                        writer.Int ("ea", mlist.ea[i]);
+                        writer.Int ("volumeType", mlist.volumeType[i]);
+                        writer.Bool ("truecryptMode", mlist.truecryptMode[i]);
+                        writer.EndRecord ();
+                    }
+                }
+                writer.EndList ();
+            }
+            else
+            {
+                VOLUME_PROPERTIES_STRUCT prop;
+                int driveNo = _totupper(argv[1][0]) - TEXT('A');
+
+                if (!(mlist.ulMountedDrives & (1 << driveNo)))
+                {
+                    writer.BeginRecord ("error");
+                    writer.String ("message", "not a mounted VeraCrypt volume");
+                    writer.Int ("driveNo", driveNo);
+                    writer.EndRecord ();
+                    iRet = VC_STATUS_NOT_VOLUME;
+                }
+                else if (!VsQueryVolumeProperties (pSession, driveNo, &prop))
+                {
+                    FormatDriverError (writer, "GET_VOLUME_PROPERTIES", GetLastError ());
+                    iRet = VC_STATUS_DRIVER_CALL_FAILED;
+                }
+                else
+                {
+                    writer.BeginRecord ("volume");
+                    FormatVolumeInformation (writer, prop);
+                    writer.EndRecord ();
+                }
+            }
+        }
+    }
+
+    // partial results: the calls that didn't time out are reported
+    if (pSession && VsTimedOut (pSession))
+        iRet = VC_STATUS_DRIVER_TIMEOUT;
+    writer.Int ("exitCode", iRet);
+    writer.EndDocument ();
+    return iRet;
+}
@@ -0,0 +1,19 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "format.h"
+
+// Query commands available in the machine readable formats, shared by the command line
+// (/format) and the co-process mode (/serve).
+
+BOOL IsDriveLetter (LPCTSTR szName);
+// commands supporting /format json|csv|kv: [/sysenc], /list, /all and DriveLetter:
+BOOL IsMachineReadableCommand (int argc, TCHAR** argv);
+// Append the result of a query command to out as a single document and return the exit code of
+// the command. pSession can be NULL when the driver couldn't be opened.
+int FormatMachineReadableQuery (VS_SESSION* pSession, COutputBuffer& out, eOutputFormat format, int argc, TCHAR** argv);
@@ -0,0 +1,299 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "replay.h"
+
+// identify requests whose response depends on the input buffer
+int GetRequestKey (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize)
+{
+    if (dwIoControlCode == VC_IOCTL_GET_VOLUME_PROPERTIES && lpInBuffer && nInBufferSize >= sizeof (int))
+        return ((VOLUME_PROPERTIES_STRUCT*) lpInBuffer)->driveNo;
+    return -1;
+}
+
+// write a buffer as comma separated hex chunks, runs of identical bytes being written as "XX*N"
+static void WriteHexData (FILE* f, const unsigned char* pbData, size_t cbData)
+{
+    size_t i = 0;
+    BOOL bInChunk = FALSE;
+
+    while (i < cbData)
+    {
+        size_t run = 1;
+        while (i + run < cbData && pbData[i + run] == pbData[i])
+            run++;
+
+        if (run >= 8)
+        {
+            fprintf (f, "%s%.2X*%u", (i > 0)? "," : "", pbData[i], (unsigned int) run);
+            bInChunk = FALSE;
+            i += run;
+        }
+        else
+        {
+            if (!bInChunk && i > 0)
+                fputc (',', f);
+            fprintf (f, "%.2X", pbData[i]);
+            bInChunk = TRUE;
+            i++;
+        }
+    }
+}
+
+static int HexDigit (char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// parse data written by WriteHexData. szData ends at the first space or end of line.
+static BOOL ParseHexData (const char* szData, std::vector<unsigned char>& data)
+{
+    const char* p = szData;
+
+    data.clear ();
+    while (*p && *p != ' ' && *p != '\r' && *p != '\n')
+    {
+        if (*p == ',')
+        {
+            p++;
+            continue;
+        }
+
+        int hi = HexDigit (p[0]);
+        int lo = (hi >= 0)? HexDigit (p[1]) : -1;
+        if (lo < 0)
+            return FALSE;
+        p += 2;
+
+        if (*p == '*')
+        {
+            char* pEnd;
+            unsigned long count = strtoul (p + 1, &pEnd, 10);
+            if (pEnd == p + 1 || count > 16 * 1024 * 1024)
+                return FALSE;
+            data.insert (data.end (), count, (unsigned char) ((hi << 4) | lo));
+            p = pEnd;
+        }
+        else
+            data.push_back ((unsigned char) ((hi << 4) | lo));
+    }
+
+    return TRUE;
+}
+
+CRecordingDriver* CRecordingDriver::Create (CVcDriver* pDriver, LPCTSTR szFileName)
+{
+    FILE* f = _tfopen (szFileName, TEXT("w"));
+    if (!f)
+    {
+        SetLastError (ERROR_FILE_NOT_FOUND);
+        return NULL;
+    }
+
+    fprintf (f, "# VeraStatus driver trace\n");
+    return new CRecordingDriver (pDriver, f);
+}
+
+CRecordingDriver::~CRecordingDriver ()
+{
+    fclose (m_File);
+    delete m_pDriver;
+}
+
+BOOL CRecordingDriver::IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    const char* szName = GetIoctlName (dwIoControlCode);
+    int key = GetRequestKey (dwIoControlCode, lpInBuffer, nInBufferSize);
+    std::vector<unsigned char> request;
+    unsigned __int64 startUs;
+    DWORD dwError = ERROR_SUCCESS;
+    BOOL bResult;
+
+    // the input buffer can be the same as the output one
+    if (lpInBuffer && nInBufferSize)
+        request.assign ((unsigned char*) lpInBuffer, (unsigned char*) lpInBuffer + nInBufferSize);
+
+    startUs = GetTimestampUs ();
+    bResult = m_pDriver->IoControl (dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize, lpBytesReturned);
+    if (!bResult)
+        dwError = GetLastError ();
+
+    std::lock_guard<std::mutex> lock (m_Mutex);
+    if (szName)
+        fprintf (m_File, "ioctl=%s ", szName);
+    else
+        fprintf (m_File, "ioctl=0x%.8X ", dwIoControlCode);
+    if (key >= 0)
+        fprintf (m_File, "key=%d ", key);
+    else
+        fprintf (m_File, "key=- ");
+    fprintf (m_File, "result=%d error=%u returned=%u latency_us=%u delay_us=0 in=",
+        bResult? 1 : 0, dwError, (unsigned int) *lpBytesReturned, (unsigned int) (GetTimestampUs () - startUs));
+    if (!request.empty ())
+        WriteHexData (m_File, &request[0], request.size ());
+    fprintf (m_File, " out=");
+    if (bResult && lpOutBuffer && *lpBytesReturned)
+        WriteHexData (m_File, (unsigned char*) lpOutBuffer, (*lpBytesReturned < nOutBufferSize)? *lpBytesReturned : nOutBufferSize);
+    fprintf (m_File, "\n");
+    fflush (m_File);
+
+    if (!bResult)
+        SetLastError (dwError);
+    return bResult;
+}
+
+CReplayDriver* CReplayDriver::Load (LPCTSTR szFileName)
+{
+    FILE* f = _tfopen (szFileName, TEXT("rb"));
+    std::vector<char> content;
+    char buffer[4096];
+    size_t cbRead;
+
+    if (!f)
+    {
+        SetLastError (ERROR_FILE_NOT_FOUND);
+        return NULL;
+    }
+    while ((cbRead = fread (buffer, 1, sizeof (buffer), f)) > 0)
+        content.insert (content.end (), buffer, buffer + cbRead);
+    fclose (f);
+    content.push_back (0);
+
+    CReplayDriver* pDriver = new CReplayDriver ();
+    if (!pDriver->AddEntries (&content[0]))
+    {
+        delete pDriver;
+        SetLastError (ERROR_INVALID_PARAMETER);
+        return NULL;
+    }
+    return pDriver;
+}
+
+// find the value of "name=" in the line, NULL if absent
+static const char* FindField (const char* szLine, const char* szLineEnd, const char* szName)
+{
+    size_t cchName = strlen (szName);
+    for (const char* p = szLine; p + cchName < szLineEnd; p++)
+    {
+        if ((p == szLine || p[-1] == ' ') && strncmp (p, szName, cchName) == 0 && p[cchName] == '=')
+            return p + cchName + 1;
+    }
+    return NULL;
+}
+
+// parse trace lines and add them to the entries to serve
+BOOL CReplayDriver::AddEntries (const char* szTrace)
+{
+    const char* szLine = szTrace;
+
+    while (*szLine)
+    {
+        const char* szLineEnd = strchr (szLine, '\n');
+        if (!szLineEnd)
+            szLineEnd = szLine + strlen (szLine);
+
+        if (*szLine != '#' && szLineEnd > szLine + 1)
+        {
+            REPLAY_ENTRY entry;
+            const char* szValue;
+            char szName[64];
+            size_t cchName = 0;
+
+            szValue = FindField (szLine, szLineEnd, "ioctl");
+            if (!szValue)
+                return FALSE;
+            while (szValue[cchName] && szValue[cchName] != ' ' && cchName + 1 < sizeof (szName))
+            {
+                szName[cchName] = szValue[cchName];
+                cchName++;
+            }
+            szName[cchName] = 0;
+            entry.dwIoControlCode = (strncmp (szName, "0x", 2) == 0)? (DWORD) strtoul (szName, NULL, 16) : GetIoctlCode (szName);
+            if (!entry.dwIoControlCode)
+                return FALSE;
+
+            szValue = FindField (szLine, szLineEnd, "key");
+            entry.key = (szValue && *szValue != '-')? atoi (szValue) : -1;
+            szValue = FindField (szLine, szLineEnd, "result");
+            entry.bResult = szValue? atoi (szValue) : TRUE;
+            szValue = FindField (szLine, szLineEnd, "error");
+            entry.dwError = szValue? (DWORD) strtoul (szValue, NULL, 10) : ERROR_SUCCESS;
+            szValue = FindField (szLine, szLineEnd, "delay_us");
+            entry.dwDelayUs = szValue? (DWORD) strtoul (szValue, NULL, 10) : 0;
+            szValue = FindField (szLine, szLineEnd, "out");
+            if (szValue && !ParseHexData (szValue, entry.data))
+                return FALSE;
+            szValue = FindField (szLine, szLineEnd, "returned");
+            entry.cbReturned = szValue? (DWORD) strtoul (szValue, NULL, 10) : (DWORD) entry.data.size ();
+
+            m_Entries.push_back (entry);
+            m_Served.push_back (0);
+        }
+
+        szLine = *szLineEnd? szLineEnd + 1 : szLineEnd;
+    }
+
+    return TRUE;
+}
+
+BOOL CReplayDriver::IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    int key = GetRequestKey (dwIoControlCode, lpInBuffer, nInBufferSize);
+    REPLAY_ENTRY* pEntry = NULL;
+
+    *lpBytesReturned = 0;
+
+    // first entry not served yet, or the last matching one
+    m_Mutex.lock ();
+    for (size_t i = 0; i < m_Entries.size (); i++)
+    {
+        if (m_Entries[i].dwIoControlCode == dwIoControlCode && m_Entries[i].key == key)
+        {
+            pEntry = &m_Entries[i];
+            if (m_Served[i] == 0)
+            {
+                m_Served[i]++;
+                break;
+            }
+        }
+    }
+    m_Mutex.unlock ();
+
+    if (!pEntry)
+    {
+        SetLastError ((dwIoControlCode == VC_IOCTL_GET_VOLUME_PROPERTIES)? ERROR_FILE_NOT_FOUND : ERROR_INVALID_FUNCTION);
+        return FALSE;
+    }
+
+    if (pEntry->dwDelayUs)
+        Sleep ((pEntry->dwDelayUs + 999) / 1000);
+
+    if (!pEntry->bResult)
+    {
+        SetLastError (pEntry->dwError);
+        return FALSE;
+    }
+
+    // bytes of "returned" not present in "out" are zero
+    DWORD cbReturned = pEntry->cbReturned;
+    DWORD cbData = (DWORD) pEntry->data.size ();
+    if (cbReturned > nOutBufferSize)
+    {
+        SetLastError (ERROR_INSUFFICIENT_BUFFER);
+        return FALSE;
+    }
+    if (cbData > cbReturned)
+        cbData = cbReturned;
+    if (cbData)
+        memcpy (lpOutBuffer, &pEntry->data[0], cbData);
+    if (cbReturned > cbData)
+        memset ((unsigned char*) lpOutBuffer + cbData, 0, cbReturned - cbData);
+    *lpBytesReturned = cbReturned;
+    return TRUE;
+}
@@ -0,0 +1,70 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+#include <vector>
+
+// Driver trace files are text files with one call per line:
+//
+//   ioctl=GET_BOOT_ENCRYPTION_STATUS key=- result=1 error=0 returned=94 latency_us=35 delay_us=0 in= out=01000000,...
+//
+// "in" and "out" are the request and response buffers (only the returned bytes for "out") encoded
+// as comma separated hex chunks, "XX*N" standing for the byte XX repeated N times.
+// "key" identifies the request for calls whose response depends on the input (the drive number
+// for GET_VOLUME_PROPERTIES), "-" otherwise.
+// "latency_us" is informative. "delay_us" makes the replay backend wait before answering.
+// Lines starting with '#' are comments.
+
+// Backend wrapping another one and dumping every call to a trace file
+class CRecordingDriver : public CVcDriver
+{
+public:
+	static CRecordingDriver* Create (CVcDriver* pDriver, LPCTSTR szFileName);
+	virtual ~CRecordingDriver ();
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned);
+	virtual BOOL SupportsIoControl (DWORD dwIoControlCode) { return m_pDriver->SupportsIoControl (dwIoControlCode); }
+	virtual BOOL TimedOut () const { return m_pDriver->TimedOut (); }
+
+protected:
+	CRecordingDriver (CVcDriver* pDriver, FILE* f) : m_pDriver (pDriver), m_File (f) {}
+
+	CVcDriver* m_pDriver;
+	FILE* m_File;
+	std::mutex m_Mutex;		/* lines of concurrent calls */
+};
+
+typedef struct
+{
+	DWORD dwIoControlCode;
+	int key;
+	BOOL bResult;
+	DWORD dwError;
+	DWORD cbReturned;
+	DWORD dwDelayUs;
+	std::vector<unsigned char> data;
+} REPLAY_ENTRY;
+
+// Backend serving the responses of a trace file, either recorded or written by hand.
+// Entries matching a request (same ioctl and key) are served in file order, the last one
+// being repeated once all of them have been used. A "returned" value smaller than the
+// response size of the real driver simulates older drivers (e.g. BootEncryptionStatus
+// without MasterKeyVulnerable).
+class CReplayDriver : public CVcDriver
+{
+public:
+	static CReplayDriver* Load (LPCTSTR szFileName);
+	BOOL AddEntries (const char* szTrace);
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned);
+
+protected:
+	std::vector<REPLAY_ENTRY> m_Entries;
+	std::vector<size_t> m_Served;	/* number of times each entry was served */
+	std::mutex m_Mutex;		/* m_Served, the delays of concurrent calls overlap */
+};
+
+int GetRequestKey (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize);
@@ -0,0 +1,249 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "sampler.h"
+#include <algorithm>
+
+void CRateHistory::Push (const RATE_SAMPLE& sample)
+{
+    unsigned __int64 index = m_WriteIndex.load (std::memory_order_relaxed);
+    Slot& slot = m_Slots[index & (RATE_HISTORY_SIZE - 1)];
+
+    // pairs with the acquire fence of Read: a reader seeing any of the stores below then sees
+    // m_WriteIndex >= index, and drops the slot
+    std::atomic_thread_fence (std::memory_order_release);
+    slot.timestampUs.store (sample.timestampUs, std::memory_order_relaxed);
+    slot.uniqueId.store (sample.uniqueId, std::memory_order_relaxed);
+    slot.readBytesPerSec.store (sample.readBytesPerSec, std::memory_order_relaxed);
+    slot.writtenBytesPerSec.store (sample.writtenBytesPerSec, std::memory_order_relaxed);
+    m_WriteIndex.store (index + 1, std::memory_order_release);
+}
+
+size_t CRateHistory::Read (unsigned __int64 sinceUs, RATE_SAMPLE* pSamples, size_t maxSamples) const
+{
+    unsigned __int64 end = m_WriteIndex.load (std::memory_order_acquire);
+    unsigned __int64 start = (end > RATE_HISTORY_SIZE)? end - RATE_HISTORY_SIZE : 0;
+    size_t count = 0;
+
+    if (end - start > maxSamples)
+        start = end - maxSamples;
+
+    for (unsigned __int64 i = start; i < end; i++)
+    {
+        const Slot& slot = m_Slots[i & (RATE_HISTORY_SIZE - 1)];
+        pSamples[count].timestampUs = slot.timestampUs.load (std::memory_order_relaxed);
+        pSamples[count].uniqueId = slot.uniqueId.load (std::memory_order_relaxed);
+        pSamples[count].readBytesPerSec = slot.readBytesPerSec.load (std::memory_order_relaxed);
+        pSamples[count].writtenBytesPerSec = slot.writtenBytesPerSec.load (std::memory_order_relaxed);
+        count++;
+    }
+
+    // the writer may have reused the oldest slots while they were copied: the one being written
+    // has the index of the last published sample + 1 - RATE_HISTORY_SIZE
+    std::atomic_thread_fence (std::memory_order_acquire);
+    unsigned __int64 latest = m_WriteIndex.load (std::memory_order_relaxed);
+    unsigned __int64 firstValid = (latest + 1 > RATE_HISTORY_SIZE)? latest + 1 - RATE_HISTORY_SIZE : 0;
+    size_t skipped = (firstValid > start)? (size_t) std::min<unsigned __int64> (firstValid - start, count) : 0;
+
+    // drop overwritten samples and those older than sinceUs
+    while (skipped < count && pSamples[skipped].timestampUs <= sinceUs)
+        skipped++;
+    if (skipped)
+    {
+        memmove (pSamples, pSamples + skipped, (count - skipped) * sizeof (RATE_SAMPLE));
+        count -= skipped;
+    }
+
+    return count;
+}
+
+CVolumeSampler::CVolumeSampler (CVcDriver& driver, DWORD dwIntervalMs) :
+    m_Driver (driver),
+    m_dwIntervalMs (dwIntervalMs),
+    m_bStop (false),
+    m_SampleCount (0),
+    m_FailureCount (0),
+    m_LastFailure (ERROR_SUCCESS)
+{
+    memset (m_Samples, 0, sizeof (m_Samples));
+}
+
+CVolumeSampler::~CVolumeSampler ()
+{
+    Stop ();
+}
+
+void CVolumeSampler::Start ()
+{
+    m_bStop.store (false);
+    m_Thread = std::thread (&CVolumeSampler::Run, this);
+}
+
+void CVolumeSampler::Stop ()
+{
+    m_bStop.store (true);
+    if (m_Thread.joinable ())
+        m_Thread.join ();
+}
+
+void CVolumeSampler::Run ()
+{
+    VOLUME_SAMPLE* pPrevious = &m_Samples[0];
+    VOLUME_SAMPLE* pCurrent = &m_Samples[1];
+    BOOL bHasPrevious = FALSE;
+    unsigned __int64 nextUs = GetTimestampUs ();
+
+    while (!m_bStop.load (std::memory_order_relaxed))
+    {
+        if (SampleVolumes (m_Driver, *pCurrent))
+        {
+            if (bHasPrevious)
+            {
+                CarryTimedOutVolumes (*pPrevious, *pCurrent);
+                for (int i = 0; i < 26; i++)
+                {
+                    VOLUME_DELTA delta;
+                    ComputeVolumeDelta (*pPrevious, *pCurrent, i, delta);
+                    // no rate for the interval in which the volume was (re)mounted
+                    if (delta.change == VOLUME_UNCHANGED && (pCurrent->ulMountedDrives & (1 << i)))
+                    {
+                        RATE_SAMPLE sample;
+                        sample.timestampUs = pCurrent->timestampUs;
+                        sample.uniqueId = pCurrent->prop[i].uniqueId;
+                        sample.readBytesPerSec = delta.readBytesPerSec;
+                        sample.writtenBytesPerSec = delta.writtenBytesPerSec;
+                        m_History[i].Push (sample);
+                    }
+                }
+            }
+
+            VOLUME_SAMPLE* pTmp = pPrevious;
+            pPrevious = pCurrent;
+            pCurrent = pTmp;
+            bHasPrevious = TRUE;
+            m_SampleCount.fetch_add (1, std::memory_order_relaxed);
+        }
+        else
+        {
+            m_LastFailure.store (GetLastError (), std::memory_order_relaxed);
+            m_FailureCount.fetch_add (1, std::memory_order_relaxed);
+            bHasPrevious = FALSE;
+        }
+
+        SleepUntilNext (nextUs, m_dwIntervalMs);
+    }
+}
+
+// nearest rank percentile of sorted values
+static double Percentile (const double* pSorted, size_t count, double p)
+{
+    size_t rank = (size_t) (p / 100.0 * (double) count + 0.999999);
+    if (rank == 0)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+    return pSorted[rank - 1];
+}
+
+static void ComputePercentiles (double* pValues, size_t count, double* pResult)
+{
+    std::sort (pValues, pValues + count);
+    pResult[0] = Percentile (pValues, count, 50);
+    pResult[1] = Percentile (pValues, count, 95);
+    pResult[2] = Percentile (pValues, count, 99);
+    pResult[3] = pValues[count - 1];
+}
+
+// Percentiles of the rates sampled after sinceUs for the volume currently using the drive letter.
+// pBuffer and pValues must hold RATE_HISTORY_SIZE entries. Returns FALSE if there is no sample.
+BOOL ComputeRatePercentiles (const CRateHistory& history, unsigned __int64 sinceUs, RATE_SAMPLE* pBuffer, double* pValues, RATE_PERCENTILES& result)
+{
+    size_t count = history.Read (sinceUs, pBuffer, RATE_HISTORY_SIZE);
+    size_t first = 0;
+
+    memset (&result, 0, sizeof (result));
+    if (count == 0)
+        return FALSE;
+
+    // ignore the samples of a volume previously mounted on the same drive letter
+    int uniqueId = pBuffer[count - 1].uniqueId;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (pBuffer[i].uniqueId != uniqueId)
+            first = i + 1;
+    }
+    result.count = count - first;
+
+    for (size_t i = first; i < count; i++)
+        pValues[i - first] = pBuffer[i].readBytesPerSec;
+    ComputePercentiles (pValues, result.count, result.read);
+    for (size_t i = first; i < count; i++)
+        pValues[i - first] = pBuffer[i].writtenBytesPerSec;
+    ComputePercentiles (pValues, result.count, result.written);
+
+    return TRUE;
+}
+
+static void PrintRates (LPCTSTR szName, const double* pRates)
+{
+    TCHAR szRates[4][32];
+    for (int i = 0; i < 4; i++)
+        FormatRate (pRates[i], szRates[i], ARRAYSIZE (szRates[i]));
+    _tprintf (TEXT("      %-5s p50 %-12s p95 %-12s p99 %-12s peak %s\n"), szName, szRates[0], szRates[1], szRates[2], szRates[3]);
+}
+
+// Sample the mounted volumes every dwIntervalMs in a background thread and print, every
+// dwWindowMs, the percentiles of their read/write rates over the last window.
+// iCount is the number of reports to print (0 = forever).
+int RunIoStats (CVcDriver& driver, DWORD dwIntervalMs, DWORD dwWindowMs, int iCount)
+{
+    CVolumeSampler* pSampler;
+    static RATE_SAMPLE buffer[RATE_HISTORY_SIZE];
+    static double values[RATE_HISTORY_SIZE];
+    unsigned __int64 startUs, windowStartUs, lastFailures = 0;
+    int iRet = VC_STATUS_OK;
+
+    pSampler = new CVolumeSampler (driver, dwIntervalMs);
+    _tprintf (TEXT("Sampling mounted volumes every %.3f seconds, reporting every %.1f seconds\n"), (double) dwIntervalMs / 1000.0, (double) dwWindowMs / 1000.0);
+    fflush (stdout);
+
+    startUs = windowStartUs = GetTimestampUs ();
+    pSampler->Start ();
+    for (int n = 0; iCount <= 0 || n < iCount; n++)
+    {
+        unsigned __int64 windowEndUs = windowStartUs + (unsigned __int64) dwWindowMs * 1000;
+        unsigned __int64 nowUs = GetTimestampUs ();
+        if (windowEndUs > nowUs)
+            Sleep ((DWORD) ((windowEndUs - nowUs) / 1000));
+
+        _tprintf (TEXT("[%8.1fs] %I64u samples\n"), (double) (GetTimestampUs () - startUs) / 1000000.0, pSampler->GetSampleCount ());
+        for (int i = 0; i < 26; i++)
+        {
+            RATE_PERCENTILES result;
+            if (ComputeRatePercentiles (pSampler->GetHistory (i), windowStartUs, buffer, values, result))
+            {
+                _tprintf (TEXT("   %c: %u rate samples\n"), TEXT('A') + i, (unsigned int) result.count);
+                PrintRates (TEXT("read"), result.read);
+                PrintRates (TEXT("write"), result.written);
+            }
+        }
+
+        unsigned __int64 failures = pSampler->GetFailureCount ();
+        if (failures != lastFailures)
+        {
+            _tprintf (TEXT("   %I64u calls to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed, last error %s\n"), failures - lastFailures, GetWin32ErrorStr (pSampler->GetLastFailure ()));
+            iRet = VC_STATUS_DRIVER_CALL_FAILED;
+            lastFailures = failures;
+        }
+        fflush (stdout);
+        windowStartUs = windowEndUs;
+    }
+
+    pSampler->Stop ();
+    delete pSampler;
+    return iRet;
+}
@@ -0,0 +1,87 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "watch.h"
+#include <atomic>
+#include <thread>
+
+// number of rate samples kept per drive (power of 2)
+#define RATE_HISTORY_SIZE	4096
+
+// I/O rates of a volume between two consecutive samples
+typedef struct
+{
+	unsigned __int64 timestampUs;	/* time of the second sample */
+	int uniqueId;					/* VOLUME_PROPERTIES_STRUCT.uniqueId, changes when the drive letter is reused */
+	double readBytesPerSec;
+	double writtenBytesPerSec;
+} RATE_SAMPLE;
+
+// Fixed size history of rate samples with a single writer and any number of readers.
+// The writer never waits: readers detect and drop the entries overwritten while they were copying them.
+class CRateHistory
+{
+public:
+	CRateHistory () : m_WriteIndex (0) {}
+
+	void Push (const RATE_SAMPLE& sample);
+	// copy the samples taken after sinceUs, oldest first. Returns the number of samples copied.
+	size_t Read (unsigned __int64 sinceUs, RATE_SAMPLE* pSamples, size_t maxSamples) const;
+
+protected:
+	struct Slot
+	{
+		std::atomic<unsigned __int64> timestampUs;
+		std::atomic<int> uniqueId;
+		std::atomic<double> readBytesPerSec;
+		std::atomic<double> writtenBytesPerSec;
+	};
+
+	Slot m_Slots[RATE_HISTORY_SIZE];
+	std::atomic<unsigned __int64> m_WriteIndex;		/* number of samples pushed since creation */
+};
+
+// Thread sampling the counters of all mounted volumes at a fixed period and storing
+// their read/write rates in per drive histories.
+class CVolumeSampler
+{
+public:
+	CVolumeSampler (CVcDriver& driver, DWORD dwIntervalMs);
+	~CVolumeSampler ();
+
+	void Start ();
+	void Stop ();
+	const CRateHistory& GetHistory (int driveNo) const { return m_History[driveNo]; }
+	unsigned __int64 GetSampleCount () const { return m_SampleCount.load (std::memory_order_relaxed); }
+	unsigned __int64 GetFailureCount () const { return m_FailureCount.load (std::memory_order_relaxed); }
+	DWORD GetLastFailure () const { return m_LastFailure.load (std::memory_order_relaxed); }
+
+protected:
+	void Run ();
+
+	CVcDriver& m_Driver;
+	DWORD m_dwIntervalMs;
+	std::thread m_Thread;
+	std::atomic<bool> m_bStop;
+	std::atomic<unsigned __int64> m_SampleCount;
+	std::atomic<unsigned __int64> m_FailureCount;
+	std::atomic<DWORD> m_LastFailure;
+	VOLUME_SAMPLE m_Samples[2];
+	CRateHistory m_History[26];
+};
+
+// percentiles of the read and write rates of a drive over a window
+typedef struct
+{
+	size_t count;
+	double read[4];		/* p50, p95, p99, peak */
+	double written[4];
+} RATE_PERCENTILES;
+
+BOOL ComputeRatePercentiles (const CRateHistory& history, unsigned __int64 sinceUs, RATE_SAMPLE* pBuffer, double* pValues, RATE_PERCENTILES& result);
+int RunIoStats (CVcDriver& driver, DWORD dwIntervalMs, DWORD dwWindowMs, int iCount);
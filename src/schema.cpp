@@ -0,0 +1,418 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "schema.h"
+#ifdef _WIN32
+#include <strsafe.h>
+#endif
+
+static LPCTSTR GetSetupModeName (int mode)
+{
+    switch (mode)
+    {
+    case SetupNone: return TEXT("None");
+    case SetupEncryption: return TEXT("Encryption");
+    case SetupDecryption: return TEXT("Decryption");
+    default: return TEXT("Unknown");
+    }
+}
+
+// wording of the text report
+static LPCTSTR GetSetupModeText (int mode)
+{
+    return (mode == SetupEncryption)? TEXT("Encrypting") : (mode == SetupDecryption)? TEXT("Decrypting") : TEXT("None");
+}
+
+BOOL g_bShowWindowsDevices = TRUE;
+
+// index of the fields in the tables below, referenced by the text lines
+enum
+{
+    VOL_DRIVE_NO = 0,
+    VOL_DRIVE_LETTER,
+    VOL_UNIQUE_ID,
+    VOL_VOLUME,
+    VOL_DISK_LENGTH,
+    VOL_EA,
+    VOL_EA_NAME,
+    VOL_MODE,
+    VOL_PKCS5,
+    VOL_PKCS5_NAME,
+    VOL_PKCS5_ITERATIONS,
+    VOL_HIDDEN_VOLUME,
+    VOL_READ_ONLY,
+    VOL_REMOVABLE,
+    VOL_INACTIVE_SYSENC_SCOPE,
+    VOL_HEADER_FLAGS,
+    VOL_BYTES_READ,
+    VOL_BYTES_WRITTEN,
+    VOL_HIDDEN_VOL_PROTECTION,
+    VOL_FORMAT_VERSION,
+    VOL_PIM,
+    VOL_LABEL,
+    VOL_DRIVER_SET_LABEL,
+    VOL_VOLUME_ID,
+    VOL_MOUNT_DISABLED,
+    VOL_FIELD_COUNT
+};
+
+static const FIELD_DESC g_VolumeFields[] = {
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, driveNo, "driveNo", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, driveNo, "driveLetter", FIELD_DRIVE_LETTER, 0, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, uniqueId, "uniqueId", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, wszVolume, "wszVolume", FIELD_WSTRING, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, diskLength, "diskLength", FIELD_UINT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, ea, "ea", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, ea, "eaName", FIELD_NAME, 0, GetEncryptionAlgorithmName),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, mode, "mode", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, pkcs5, "pkcs5", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, pkcs5, "pkcs5Name", FIELD_NAME, 0, GetPrfAlgorithmName),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, pkcs5Iterations, "pkcs5Iterations", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, hiddenVolume, "hiddenVolume", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, readOnly, "readOnly", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, removable, "removable", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, partitionInInactiveSysEncScope, "partitionInInactiveSysEncScope", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, volumeHeaderFlags, "volumeHeaderFlags", FIELD_HEX32, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, totalBytesRead, "totalBytesRead", FIELD_UINT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, totalBytesWritten, "totalBytesWritten", FIELD_UINT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, hiddenVolProtection, "hiddenVolProtection", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, volFormatVersion, "volFormatVersion", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, volumePim, "volumePim", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, wszLabel, "wszLabel", FIELD_WSTRING, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, bDriverSetLabel, "bDriverSetLabel", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, volumeID, "volumeID", FIELD_BYTES, FIELD_RAW, NULL),
+    FIELD_OF (VOLUME_PROPERTIES_STRUCT, mountDisabled, "mountDisabled", FIELD_BOOL, FIELD_RAW, NULL),
+};
+
+static_assert (ARRAYSIZE (g_VolumeFields) == VOL_FIELD_COUNT, "g_VolumeFields doesn't match the field indexes");
+
+// only the relevant fields, details of the mount being available if the volume name is set
+static const TEXT_LINE g_VolumeLines[] = {
+    { "Drive Letter: ", VOL_DRIVE_LETTER, TEXT_VALUE, { VOL_VOLUME, NO_FIELD }, " (Virtual Device Only)", VOL_MOUNT_DISABLED, NULL },
+    { "Virtual Device: \\Device\\VeraCryptVolume", VOL_DRIVE_LETTER, TEXT_WINDOWS_DEVICE, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Volume: ", VOL_VOLUME, TEXT_VALUE, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Volume ID: ", VOL_VOLUME_ID, TEXT_VALUE, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Volume Label: ", VOL_LABEL, TEXT_VALUE, { VOL_VOLUME, VOL_DRIVER_SET_LABEL }, NULL, NO_FIELD, NULL },
+    { "Hidden Volume: ", VOL_HIDDEN_VOLUME, TEXT_YES_NO, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Hidden Volume Protection Enabled: ", VOL_HIDDEN_VOL_PROTECTION, TEXT_YES_NO, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Read Only: ", VOL_READ_ONLY, TEXT_YES_NO, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Removable Media: ", VOL_REMOVABLE, TEXT_YES_NO, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "partition In Inactive System Encryption Scope: ", VOL_INACTIVE_SYSENC_SCOPE, TEXT_YES_NO, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Volume Header Flags: ", VOL_HEADER_FLAGS, TEXT_VALUE, { VOL_VOLUME, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Encryption Algorithm: ", VOL_EA_NAME, TEXT_VALUE, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "PKCS-5 PRF: ", VOL_PKCS5_NAME, TEXT_VALUE, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Custom PIM used: ", VOL_PIM, TEXT_YES_NO, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Custom PIM value: ", VOL_PIM, TEXT_VALUE, { VOL_PIM, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Iterations number: ", VOL_PKCS5_ITERATIONS, TEXT_VALUE, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Data Read Since Mount: ", VOL_BYTES_READ, TEXT_VALUE, { NO_FIELD, NO_FIELD }, " Bytes", NO_FIELD, NULL },
+    { "Data Written Since Mount: ", VOL_BYTES_WRITTEN, TEXT_VALUE, { NO_FIELD, NO_FIELD }, " Bytes", NO_FIELD, NULL },
+};
+
+const STRUCT_SCHEMA g_VolumePropertiesSchema = {
+    g_VolumeFields, ARRAYSIZE (g_VolumeFields), g_VolumeLines, ARRAYSIZE (g_VolumeLines), sizeof (VOLUME_PROPERTIES_STRUCT)
+};
+
+enum
+{
+    BOOT_DEVICE_FILTER_ACTIVE = 0,
+    BOOT_LOADER_VERSION,
+    BOOT_LOADER_VERSION_STRING,
+    BOOT_DRIVE_MOUNTED,
+    BOOT_VOLUME_HEADER_PRESENT,
+    BOOT_DRIVE_ENCRYPTED,
+    BOOT_DRIVE_LENGTH,
+    BOOT_CONFIGURED_AREA_START,
+    BOOT_CONFIGURED_AREA_END,
+    BOOT_AREA_START,
+    BOOT_AREA_END,
+    BOOT_HEADER_SALT_CRC32,
+    BOOT_SETUP_IN_PROGRESS,
+    BOOT_SETUP_MODE,
+    BOOT_SETUP_MODE_NAME,
+    BOOT_TRANSFORM_WAITING_FOR_IDLE,
+    BOOT_HIBERNATION_PREVENTION_COUNT,
+    BOOT_HIDDEN_SYSTEM,
+    BOOT_HIDDEN_SYSTEM_PARTITION_START,
+    BOOT_HIDDEN_SYS_LEAK_PROTECTION_COUNT,
+    BOOT_MASTER_KEY_VULNERABLE,
+    BOOT_FIELD_COUNT
+};
+
+static const FIELD_DESC g_BootStatusFields[] = {
+    FIELD_OF (BootEncryptionStatus, DeviceFilterActive, "DeviceFilterActive", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, BootLoaderVersion, "BootLoaderVersion", FIELD_UINT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, BootLoaderVersion, "BootLoaderVersionString", FIELD_VERSION, 0, NULL),
+    FIELD_OF (BootEncryptionStatus, DriveMounted, "DriveMounted", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, VolumeHeaderPresent, "VolumeHeaderPresent", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, DriveEncrypted, "DriveEncrypted", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, BootDriveLength, "BootDriveLength", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, ConfiguredEncryptedAreaStart, "ConfiguredEncryptedAreaStart", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, ConfiguredEncryptedAreaEnd, "ConfiguredEncryptedAreaEnd", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, EncryptedAreaStart, "EncryptedAreaStart", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, EncryptedAreaEnd, "EncryptedAreaEnd", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, VolumeHeaderSaltCrc32, "VolumeHeaderSaltCrc32", FIELD_UINT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, SetupInProgress, "SetupInProgress", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, SetupMode, "SetupMode", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, SetupMode, "SetupModeName", FIELD_NAME, 0, GetSetupModeName),
+    FIELD_OF (BootEncryptionStatus, TransformWaitingForIdle, "TransformWaitingForIdle", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, HibernationPreventionCount, "HibernationPreventionCount", FIELD_UINT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, HiddenSystem, "HiddenSystem", FIELD_BOOL, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, HiddenSystemPartitionStart, "HiddenSystemPartitionStart", FIELD_INT, FIELD_RAW, NULL),
+    FIELD_OF (BootEncryptionStatus, HiddenSysLeakProtectionCount, "HiddenSysLeakProtectionCount", FIELD_UINT, FIELD_RAW, NULL),
+    // introduced in version 1.26.13
+    FIELD_OF (BootEncryptionStatus, MasterKeyVulnerable, "MasterKeyVulnerable", FIELD_BOOL, FIELD_RAW | FIELD_VERSIONED, NULL),
+};
+
+static_assert (ARRAYSIZE (g_BootStatusFields) == BOOT_FIELD_COUNT, "g_BootStatusFields doesn't match the field indexes");
+
+// details displayed when system encryption is active
+static const TEXT_LINE g_BootStatusLines[] = {
+    { "Bootloader version: ", BOOT_LOADER_VERSION_STRING, TEXT_VALUE, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Drive mounted: ", BOOT_DRIVE_MOUNTED, TEXT_YES_NO, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Drive encrypted: ", BOOT_DRIVE_ENCRYPTED, TEXT_YES_NO, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Volume Header present: ", BOOT_VOLUME_HEADER_PRESENT, TEXT_YES_NO, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Hidden System: ", BOOT_HIDDEN_SYSTEM, TEXT_YES_NO, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Hidden System Partition Start: ", BOOT_HIDDEN_SYSTEM_PARTITION_START, TEXT_VALUE, { BOOT_HIDDEN_SYSTEM, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Hidden System Leak Protection Count: ", BOOT_HIDDEN_SYS_LEAK_PROTECTION_COUNT, TEXT_VALUE, { BOOT_HIDDEN_SYSTEM, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { NULL, NO_FIELD, TEXT_EMPTY_LINE, { BOOT_HIDDEN_SYSTEM, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Setup in progress: ", BOOT_SETUP_IN_PROGRESS, TEXT_YES_NO, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Setup Mode: ", BOOT_SETUP_MODE_NAME, TEXT_VALUE, { BOOT_SETUP_IN_PROGRESS, NO_FIELD }, NULL, NO_FIELD, GetSetupModeText },
+    { "Boot drive size: ", BOOT_DRIVE_LENGTH, TEXT_VALUE, { NO_FIELD, NO_FIELD }, " Bytes", NO_FIELD, NULL },
+    { "Configured Encrypted Area Start: ", BOOT_CONFIGURED_AREA_START, TEXT_VALUE, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Encrypted Area Start: ", BOOT_AREA_START, TEXT_VALUE, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Configured Encrypted Area End: ", BOOT_CONFIGURED_AREA_END, TEXT_VALUE, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Encrypted Area End: ", BOOT_AREA_END, TEXT_VALUE, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+    { "Master Key Vulnerable: ", BOOT_MASTER_KEY_VULNERABLE, TEXT_YES_NO, { NO_FIELD, NO_FIELD }, NULL, NO_FIELD, NULL },
+};
+
+const STRUCT_SCHEMA g_BootEncryptionStatusSchema = {
+    g_BootStatusFields, ARRAYSIZE (g_BootStatusFields), g_BootStatusLines, ARRAYSIZE (g_BootStatusLines), sizeof (BootEncryptionStatus)
+};
+
+static __int64 ReadInt (const FIELD_DESC& field, const void* pStruct)
+{
+    const unsigned char* pField = (const unsigned char*) pStruct + field.offset;
+    switch (field.size)
+    {
+    case 1: { signed char v; memcpy (&v, pField, 1); return v; }
+    case 2: { short v; memcpy (&v, pField, 2); return v; }
+    case 4: { __int32 v; memcpy (&v, pField, 4); return v; }
+    default: { __int64 v; memcpy (&v, pField, 8); return v; }
+    }
+}
+
+static unsigned __int64 ReadUInt (const FIELD_DESC& field, const void* pStruct)
+{
+    const unsigned char* pField = (const unsigned char*) pStruct + field.offset;
+    switch (field.size)
+    {
+    case 1: return *pField;
+    case 2: { UINT16 v; memcpy (&v, pField, 2); return v; }
+    case 4: { unsigned __int32 v; memcpy (&v, pField, 4); return v; }
+    default: { unsigned __int64 v; memcpy (&v, pField, 8); return v; }
+    }
+}
+
+BOOL IsFieldAvailable (const FIELD_DESC& field, size_t cbReturned)
+{
+    return !(field.flags & FIELD_VERSIONED) || (size_t) field.offset + field.size <= cbReturned;
+}
+
+// non zero value, positive for signed ones, or non empty string
+BOOL IsFieldSet (const FIELD_DESC& field, const void* pStruct)
+{
+    const unsigned char* pField = (const unsigned char*) pStruct + field.offset;
+    switch (field.kind)
+    {
+    case FIELD_INT:
+    case FIELD_NAME:
+    case FIELD_DRIVE_LETTER:
+        return ReadInt (field, pStruct) > 0;
+    case FIELD_WSTRING:
+        return pField[0] || pField[1];
+    case FIELD_BYTES:
+        for (size_t i = 0; i < field.size; i++)
+        {
+            if (pField[i])
+                return TRUE;
+        }
+        return FALSE;
+    default:
+        return ReadUInt (field, pStruct) != 0;
+    }
+}
+
+const FIELD_DESC* FindSchemaField (const STRUCT_SCHEMA& schema, const char* szName)
+{
+    for (size_t i = 0; i < schema.fieldCount; i++)
+    {
+        if (strcmp (schema.pFields[i].szName, szName) == 0)
+            return &schema.pFields[i];
+    }
+    return NULL;
+}
+
+__int64 ReadFieldValue (const FIELD_DESC& field, const void* pStruct)
+{
+    switch (field.kind)
+    {
+    case FIELD_INT:
+    case FIELD_NAME:
+    case FIELD_DRIVE_LETTER:
+        return ReadInt (field, pStruct);
+    default:
+        return (__int64) ReadUInt (field, pStruct);
+    }
+}
+
+static void AppendTString (COutputBuffer& out, LPCTSTR szValue)
+{
+#if defined (_WIN32) && defined (UNICODE)
+    out.AppendUtf16 ((const WCHAR*) szValue, (size_t) -1);
+#else
+    out.Append (szValue);
+#endif
+}
+
+void FormatSchemaFields (CRecordWriter& writer, const STRUCT_SCHEMA& schema, const void* pStruct, size_t cbReturned)
+{
+    char szValue[16];
+
+    for (size_t i = 0; i < schema.fieldCount; i++)
+    {
+        const FIELD_DESC& field = schema.pFields[i];
+        const unsigned char* pField = (const unsigned char*) pStruct + field.offset;
+
+        if (!IsFieldAvailable (field, cbReturned))
+        {
+            writer.Null (field.szName);
+            continue;
+        }
+
+        switch (field.kind)
+        {
+        case FIELD_INT:
+            writer.Int (field.szName, ReadInt (field, pStruct));
+            break;
+        case FIELD_UINT:
+            writer.UInt (field.szName, ReadUInt (field, pStruct));
+            break;
+        case FIELD_BOOL:
+            writer.Bool (field.szName, (BOOL) ReadInt (field, pStruct));
+            break;
+        case FIELD_HEX32:
+            writer.Hex32 (field.szName, (unsigned __int32) ReadUInt (field, pStruct));
+            break;
+        case FIELD_WSTRING:
+            writer.WideString (field.szName, (const WCHAR*) pField, field.size / sizeof (WCHAR));
+            break;
+        case FIELD_BYTES:
+            writer.Bytes (field.szName, pField, field.size);
+            break;
+        case FIELD_NAME:
+            writer.TString (field.szName, field.pfnName ((int) ReadInt (field, pStruct)));
+            break;
+        case FIELD_VERSION:
+        {
+            unsigned int version = (unsigned int) ReadUInt (field, pStruct);
+            StringCbPrintfA (szValue, sizeof (szValue), "%x.%x", version >> 8, version & 0x00FF);
+            writer.String (field.szName, szValue);
+            break;
+        }
+        case FIELD_DRIVE_LETTER:
+        {
+            __int64 driveNo = ReadInt (field, pStruct);
+            szValue[0] = (char) ('A' + driveNo);
+            szValue[1] = 0;
+            writer.String (field.szName, (driveNo >= 0 && driveNo < 26)? szValue : "");
+            break;
+        }
+        }
+    }
+}
+
+static void AppendFieldText (COutputBuffer& out, const FIELD_DESC& field, const void* pStruct, PFN_FIELD_NAME pfnName)
+{
+    const unsigned char* pField = (const unsigned char*) pStruct + field.offset;
+
+    switch (field.kind)
+    {
+    case FIELD_INT:
+        out.AppendFormat ("%lld", (long long) ReadInt (field, pStruct));
+        break;
+    case FIELD_UINT:
+        out.AppendFormat ("%llu", (unsigned long long) ReadUInt (field, pStruct));
+        break;
+    case FIELD_BOOL:
+        out.Append (ReadInt (field, pStruct)? "Yes" : "No");
+        break;
+    case FIELD_HEX32:
+        out.AppendFormat ("0x%.8X", (unsigned int) ReadUInt (field, pStruct));
+        break;
+    case FIELD_WSTRING:
+        out.AppendUtf16 ((const WCHAR*) pField, field.size / sizeof (WCHAR));
+        break;
+    case FIELD_BYTES:
+    {
+        static const char g_szHex[] = "0123456789ABCDEF";
+        for (size_t i = 0; i < field.size; i++)
+        {
+            char szByte[2] = { g_szHex[pField[i] >> 4], g_szHex[pField[i] & 0x0F] };
+            out.Append (szByte, 2);
+        }
+        break;
+    }
+    case FIELD_NAME:
+        AppendTString (out, (pfnName? pfnName : field.pfnName) ((int) ReadInt (field, pStruct)));
+        break;
+    case FIELD_VERSION:
+    {
+        unsigned int version = (unsigned int) ReadUInt (field, pStruct);
+        out.AppendFormat ("%x.%x", version >> 8, version & 0x00FF);
+        break;
+    }
+    case FIELD_DRIVE_LETTER:
+        out.Append ((char) ('A' + ReadInt (field, pStruct)));
+        break;
+    }
+}
+
+void FormatSchemaText (COutputBuffer& out, const STRUCT_SCHEMA& schema, const void* pStruct, size_t cbReturned)
+{
+    for (size_t i = 0; i < schema.lineCount; i++)
+    {
+        const TEXT_LINE& line = schema.pLines[i];
+        BOOL bDisplay = TRUE;
+
+        for (size_t c = 0; c < ARRAYSIZE (line.conditions) && bDisplay; c++)
+        {
+            if (line.conditions[c] != NO_FIELD)
+                bDisplay = IsFieldSet (schema.pFields[line.conditions[c]], pStruct);
+        }
+        if (line.field != NO_FIELD && !IsFieldAvailable (schema.pFields[line.field], cbReturned))
+            bDisplay = FALSE;
+        if (line.style == TEXT_WINDOWS_DEVICE && !g_bShowWindowsDevices)
+            bDisplay = FALSE;
+        if (!bDisplay)
+            continue;
+
+        if (line.style != TEXT_EMPTY_LINE)
+        {
+            const FIELD_DESC& field = schema.pFields[line.field];
+
+            out.Append (line.szLabel);
+            if (line.style == TEXT_YES_NO)
+                out.Append (IsFieldSet (field, pStruct)? "Yes" : "No");
+            else
+                AppendFieldText (out, field, pStruct, line.pfnName);
+
+            if (line.szSuffix && (line.suffixCondition == NO_FIELD || IsFieldSet (schema.pFields[line.suffixCondition], pStruct)))
+                out.Append (line.szSuffix);
+        }
+        out.Append ('\n');
+    }
+}
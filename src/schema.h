@@ -0,0 +1,94 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "format.h"
+#include <stddef.h>
+
+// Description of the fields of the driver structures, from which the text report, the machine
+// readable formats (json, csv, kv) and the compact encoding of the history log are generated.
+// Machine readable outputs list the fields in table order; the text report uses its own list
+// of lines referencing the fields. Raw fields must stay in declaration order and new ones can
+// only be appended since the compact encoding depends on it.
+
+typedef enum
+{
+	FIELD_INT = 0,		/* signed integer */
+	FIELD_UINT,			/* unsigned integer */
+	FIELD_BOOL,
+	FIELD_HEX32,
+	FIELD_WSTRING,		/* WCHAR array, not always NUL terminated */
+	FIELD_BYTES,		/* byte array, hex encoded */
+	FIELD_NAME,			/* integer mapped to a name by pfnName */
+	FIELD_VERSION,		/* 16-bit version, major in the high byte, displayed as hex digits */
+	FIELD_DRIVE_LETTER	/* drive number displayed as a letter */
+} eFieldKind;
+
+#define FIELD_RAW		0x01	/* value returned by the driver, as opposed to one derived from another field */
+#define FIELD_VERSIONED	0x02	/* not returned by older drivers: unavailable if it doesn't end within the returned size */
+
+typedef LPCTSTR (*PFN_FIELD_NAME) (int value);
+
+typedef struct
+{
+	const char* szName;		/* machine readable name: the name of the driver structure field */
+	unsigned short offset;
+	unsigned short size;
+	eFieldKind kind;
+	unsigned int flags;
+	PFN_FIELD_NAME pfnName;	/* FIELD_NAME only */
+} FIELD_DESC;
+
+#define FIELD_OF(T, m, name, kind, flags, pfnName)	{ name, (unsigned short) offsetof (T, m), (unsigned short) sizeof (((T*) 0)->m), kind, flags, pfnName }
+
+typedef enum
+{
+	TEXT_VALUE = 0,		/* value formatted according to the kind of the field */
+	TEXT_YES_NO,		/* "Yes" if the value is set (see IsFieldSet) */
+	TEXT_EMPTY_LINE,
+	TEXT_WINDOWS_DEVICE	/* as TEXT_VALUE, only displayed when g_bShowWindowsDevices is set */
+} eTextStyle;
+
+#define NO_FIELD	-1
+
+// line of the text report
+typedef struct
+{
+	const char* szLabel;
+	int field;				/* index of the field in the schema */
+	eTextStyle style;
+	int conditions[2];		/* fields that must be set for the line to be displayed */
+	const char* szSuffix;
+	int suffixCondition;	/* field that must be set for the suffix to be displayed */
+	PFN_FIELD_NAME pfnName;	/* replaces the names of a FIELD_NAME */
+} TEXT_LINE;
+
+typedef struct
+{
+	const FIELD_DESC* pFields;
+	size_t fieldCount;
+	const TEXT_LINE* pLines;
+	size_t lineCount;
+	size_t cbStruct;
+} STRUCT_SCHEMA;
+
+// the text report names the \Device\VeraCryptVolumeX devices of the Windows driver, which the
+// volumes found in sysfs don't have
+extern BOOL g_bShowWindowsDevices;
+
+extern const STRUCT_SCHEMA g_VolumePropertiesSchema;
+extern const STRUCT_SCHEMA g_BootEncryptionStatusSchema;
+
+// cbReturned is the size returned by the driver, which limits the FIELD_VERSIONED fields
+BOOL IsFieldAvailable (const FIELD_DESC& field, size_t cbReturned);
+BOOL IsFieldSet (const FIELD_DESC& field, const void* pStruct);
+// field of the schema with this machine readable name, NULL if none
+const FIELD_DESC* FindSchemaField (const STRUCT_SCHEMA& schema, const char* szName);
+// integer value of a field that isn't a string or a byte array
+__int64 ReadFieldValue (const FIELD_DESC& field, const void* pStruct);
+void FormatSchemaFields (CRecordWriter& writer, const STRUCT_SCHEMA& schema, const void* pStruct, size_t cbReturned);
+void FormatSchemaText (COutputBuffer& out, const STRUCT_SCHEMA& schema, const void* pStruct, size_t cbReturned);
@@ -0,0 +1,189 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "serve.h"
+#include "query.h"
+#include "trace.h"
+
+#define VC_SERVE_MAX_ARGS	8
+#define VC_SERVE_MAX_LINE	1024
+
+// Driver backend answering GET_DRIVER_VERSION with its first response, which can't change while
+// the driver is open, and GET_MOUNTED_VOLUMES with the last response during the cache duration.
+// The other calls are forwarded. The session driver is not owned.
+class CCachedDriver : public CVcDriver
+{
+public:
+    CCachedDriver (CVcDriver& driver, DWORD dwCacheMs) : m_Driver (driver), m_CacheUs ((unsigned __int64) dwCacheMs * 1000),
+        m_bVersionValid (FALSE), m_Version (0), m_bMountListValid (FALSE), m_MountListUs (0), m_cbMountList (0), m_bTimedOut (false)
+    {
+        memset (&m_MountList, 0, sizeof (m_MountList));
+    }
+
+    virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+    {
+        BOOL bResult = ForwardIoControl (dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize, lpBytesReturned);
+        if (!bResult && GetLastError () == ERROR_TIMEOUT)
+            m_bTimedOut = true;
+        return bResult;
+    }
+    virtual BOOL SupportsIoControl (DWORD dwIoControlCode) { return m_Driver.SupportsIoControl (dwIoControlCode); }
+    // the limits of the session driver are reported for each request, not once for all of them
+    virtual BOOL TimedOut () const { return m_bTimedOut; }
+    void ResetTimedOut () { m_bTimedOut = false; }
+
+protected:
+    BOOL ForwardIoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+    {
+        if (dwIoControlCode == VC_IOCTL_GET_DRIVER_VERSION && nOutBufferSize >= sizeof (LONG))
+        {
+            if (!m_bVersionValid)
+            {
+                DWORD cbReturned = 0;
+                if (!m_Driver.IoControl (dwIoControlCode, lpInBuffer, nInBufferSize, &m_Version, sizeof (m_Version), &cbReturned))
+                    return FALSE;
+                m_bVersionValid = TRUE;
+            }
+            memcpy (lpOutBuffer, &m_Version, sizeof (m_Version));
+            *lpBytesReturned = sizeof (m_Version);
+            return TRUE;
+        }
+
+        if (dwIoControlCode == VC_IOCTL_GET_MOUNTED_VOLUMES && nOutBufferSize >= sizeof (MOUNT_LIST_STRUCT) && m_CacheUs)
+        {
+            unsigned __int64 nowUs = GetTimestampUs ();
+            if (!m_bMountListValid || nowUs - m_MountListUs >= m_CacheUs)
+            {
+                DWORD cbReturned = 0;
+                if (!m_Driver.IoControl (dwIoControlCode, lpInBuffer, nInBufferSize, &m_MountList, sizeof (m_MountList), &cbReturned))
+                {
+                    m_bMountListValid = FALSE;
+                    return FALSE;
+                }
+                m_bMountListValid = TRUE;
+                m_MountListUs = nowUs;
+                m_cbMountList = cbReturned;
+            }
+            memcpy (lpOutBuffer, &m_MountList, sizeof (m_MountList));
+            *lpBytesReturned = m_cbMountList;
+            return TRUE;
+        }
+
+        return m_Driver.IoControl (dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize, lpBytesReturned);
+    }
+
+    CVcDriver& m_Driver;
+    unsigned __int64 m_CacheUs;
+    BOOL m_bVersionValid;
+    LONG m_Version;
+    BOOL m_bMountListValid;
+    unsigned __int64 m_MountListUs;
+    DWORD m_cbMountList;
+    MOUNT_LIST_STRUCT m_MountList;
+    std::atomic<bool> m_bTimedOut;	/* during the current request */
+};
+
+// split a request line in arguments, argv[0] standing for the program name as on the command line
+static int ParseRequest (const char* szLine, TCHAR* szArgs, size_t cchArgs, TCHAR** argv)
+{
+    int argc = 1;
+    size_t j = 0;
+
+    argv[0] = (TCHAR*) TEXT("VeraStatus");
+    for (const char* p = szLine; *p && j + 1 < cchArgs; )
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            p++;
+        if (!*p)
+            break;
+        if (argc == VC_SERVE_MAX_ARGS)
+            return -1;
+
+        argv[argc++] = &szArgs[j];
+        // the arguments of the query commands are ASCII
+        while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && j + 1 < cchArgs)
+            szArgs[j++] = (TCHAR) (unsigned char) *p++;
+        szArgs[j++] = 0;
+    }
+
+    return argc;
+}
+
+static void FormatInvalidRequest (COutputBuffer& out, eOutputFormat format)
+{
+    CRecordWriter writer (out, format);
+
+    writer.BeginDocument ();
+    writer.Int ("schemaVersion", VC_OUTPUT_SCHEMA_VERSION);
+    writer.BeginRecord ("error");
+    writer.String ("message", "invalid request");
+    writer.EndRecord ();
+    writer.Int ("exitCode", VC_STATUS_INVALID_PARAMETER);
+    writer.EndDocument ();
+}
+
+// size line and document, written with a single call so that a reader never sees a partial frame
+static BOOL WriteResponse (COutputBuffer& frame, const COutputBuffer& response)
+{
+    frame.Reset ();
+    frame.AppendFormat ("%u\n", (unsigned int) response.Size ());
+    frame.Append (response.Data (), response.Size ());
+    return frame.Write (stdout);
+}
+
+int RunServe (VS_SESSION* pSession, eOutputFormat format, DWORD dwCacheMs)
+{
+    COutputBuffer response, frame;
+    char szLine[VC_SERVE_MAX_LINE];
+    TCHAR szArgs[VC_SERVE_MAX_LINE];
+    TCHAR* argv[VC_SERVE_MAX_ARGS];
+    CCachedDriver* pCache;
+    VS_SESSION* pCachedSession;
+
+    if (!pSession)
+    {
+        int iRet = FormatMachineReadableQuery (NULL, response, format, 1, argv);
+        WriteResponse (frame, response);
+        return iRet;
+    }
+
+    pCache = new CCachedDriver (VsGetDriver (pSession), dwCacheMs);
+    pCachedSession = VsAttachDriver (pCache);
+    while (fgets (szLine, sizeof (szLine), stdin))
+    {
+        CTraceScope scope ("serve request", "phase");
+        int argc;
+
+        if (!strchr (szLine, '\n') && !feof (stdin))
+        {
+            // too long to be a query command: skip the rest of the line
+            int c;
+            while ((c = getchar ()) != EOF && c != '\n')
+                ;
+            argc = -1;
+        }
+        else
+            argc = ParseRequest (szLine, szArgs, ARRAYSIZE (szArgs), argv);
+
+        if (argc == 2 && _tcsicmp (argv[1], TEXT("/quit")) == 0)
+            break;
+
+        response.Reset ();
+        pCache->ResetTimedOut ();
+        if (argc > 0 && IsMachineReadableCommand (argc, argv))
+            FormatMachineReadableQuery (pCachedSession, response, format, argc, argv);
+        else
+            FormatInvalidRequest (response, format);
+
+        if (!WriteResponse (frame, response))
+            break;
+    }
+
+    // only deletes the cache, the session driver is closed by the caller
+    VsCloseSession (pCachedSession);
+    return VC_STATUS_OK;
+}
@@ -0,0 +1,18 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+#include "format.h"
+
+// Co-process mode (/serve): each line read from stdin holds the arguments of a query command
+// ("/sysenc", "M:", "/list", "/all", or an empty line like no arguments) and is answered on
+// stdout by a line holding the size in bytes of the response, followed by the response document.
+//
+// The driver stays open for the whole session: its version is only queried once and the mount
+// list is reused during dwCacheMs (0 = always fetched). Stops at the end of stdin or on "/quit".
+int RunServe (VS_SESSION* pSession, eOutputFormat format, DWORD dwCacheMs);
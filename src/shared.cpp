@@ -0,0 +1,332 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "shared.h"
+#ifdef _WIN32
+#include <aclapi.h>
+#include <sddl.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+static_assert (sizeof (SHARED_REGION_HEADER) >= VC_SHARED_HEADER_V1_SIZE, "fields can only be appended to SHARED_REGION_HEADER");
+
+// number of times a reader retries when the agent publishes while it copies the snapshot
+#define SHARED_READ_RETRIES		100
+
+#ifdef _WIN32
+// Global requires SeCreateGlobalPrivilege (services have it), Local is used otherwise
+static const LPCTSTR g_szMappingNames[] = { TEXT("Global\\VeraStatusSnapshot"), TEXT("Local\\VeraStatusSnapshot") };
+// full access for SYSTEM, Administrators and the agent, read access for the authenticated users
+#define SHARED_MAPPING_SDDL	TEXT("D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GA;;;OW)(A;;GR;;;AU)")
+#else
+#define SHARED_MEMORY_NAME	"/verastatus_snapshot"
+#endif
+
+typedef struct
+{
+	void* pView;
+	size_t cbView;
+#ifdef _WIN32
+	HANDLE hMapping;
+#endif
+} SHARED_REGION;
+
+#ifdef _WIN32
+// the region is owned by SYSTEM, Administrators or the current user
+static BOOL IsTrustedMapping (HANDLE hMapping)
+{
+    PSID pOwner = NULL;
+    PSECURITY_DESCRIPTOR pSecurityDescriptor = NULL;
+    HANDLE hToken = NULL;
+    BYTE userBuffer[sizeof (TOKEN_USER) + SECURITY_MAX_SID_SIZE];
+    DWORD cbUser = 0;
+    BOOL bResult = FALSE;
+
+    if (GetSecurityInfo (hMapping, SE_KERNEL_OBJECT, OWNER_SECURITY_INFORMATION, &pOwner, NULL, NULL, NULL, &pSecurityDescriptor) != ERROR_SUCCESS)
+        return FALSE;
+    if (IsWellKnownSid (pOwner, WinLocalSystemSid) || IsWellKnownSid (pOwner, WinBuiltinAdministratorsSid))
+        bResult = TRUE;
+    else if (OpenProcessToken (GetCurrentProcess (), TOKEN_QUERY, &hToken)
+        && GetTokenInformation (hToken, TokenUser, userBuffer, sizeof (userBuffer), &cbUser))
+    {
+        bResult = EqualSid (pOwner, ((TOKEN_USER*) userBuffer)->User.Sid);
+    }
+    if (hToken)
+        CloseHandle (hToken);
+    LocalFree (pSecurityDescriptor);
+    return bResult;
+}
+#endif
+
+// Map the region read-only, or read-write after creating it when cbCreate is not 0.
+// The agent never reuses an existing region, and readers ignore a region created by another
+// user than root (SYSTEM, Administrators) or themselves: they use the driver instead.
+static BOOL MapSharedRegion (SHARED_REGION& region, size_t cbCreate)
+{
+    memset (&region, 0, sizeof (region));
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES sa = { sizeof (sa), NULL, FALSE };
+    if (cbCreate && !ConvertStringSecurityDescriptorToSecurityDescriptor (SHARED_MAPPING_SDDL, SDDL_REVISION_1, &sa.lpSecurityDescriptor, NULL))
+        return FALSE;
+    for (size_t i = 0; i < ARRAYSIZE (g_szMappingNames) && !region.hMapping; i++)
+    {
+        if (cbCreate)
+        {
+            region.hMapping = CreateFileMapping (INVALID_HANDLE_VALUE, &sa, PAGE_READWRITE, 0, (DWORD) cbCreate, g_szMappingNames[i]);
+            if (region.hMapping && GetLastError () == ERROR_ALREADY_EXISTS)
+            {
+                // created by someone else: its content and access can't be trusted
+                CloseHandle (region.hMapping);
+                region.hMapping = NULL;
+                SetLastError (ERROR_ALREADY_EXISTS);
+                break;
+            }
+        }
+        else
+            region.hMapping = OpenFileMapping (FILE_MAP_READ | READ_CONTROL, FALSE, g_szMappingNames[i]);
+    }
+    if (cbCreate)
+        LocalFree (sa.lpSecurityDescriptor);
+    if (!region.hMapping)
+        return FALSE;
+    if (!cbCreate && !IsTrustedMapping (region.hMapping))
+    {
+        CloseHandle (region.hMapping);
+        return FALSE;
+    }
+
+    region.pView = MapViewOfFile (region.hMapping, cbCreate? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (!region.pView)
+    {
+        CloseHandle (region.hMapping);
+        return FALSE;
+    }
+
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery (region.pView, &info, sizeof (info));
+    region.cbView = info.RegionSize;
+#else
+    struct stat st;
+    int fd;
+    if (cbCreate)
+    {
+        // a region left by a previous agent or created by another user is replaced
+        shm_unlink (SHARED_MEMORY_NAME);
+        fd = shm_open (SHARED_MEMORY_NAME, O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    else
+        fd = shm_open (SHARED_MEMORY_NAME, O_RDONLY, 0);
+    if (fd < 0)
+        return FALSE;
+    if ((cbCreate && ftruncate (fd, (off_t) cbCreate) != 0) || fstat (fd, &st) != 0 || st.st_size <= 0
+        || (st.st_uid != 0 && st.st_uid != geteuid ()) || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    {
+        close (fd);
+        return FALSE;
+    }
+
+    region.cbView = (size_t) st.st_size;
+    region.pView = mmap (NULL, region.cbView, cbCreate? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (region.pView == MAP_FAILED)
+        return FALSE;
+#endif
+    return TRUE;
+}
+
+static void UnmapSharedRegion (SHARED_REGION& region)
+{
+#ifdef _WIN32
+    UnmapViewOfFile (region.pView);
+    CloseHandle (region.hMapping);
+#else
+    munmap (region.pView, region.cbView);
+#endif
+}
+
+CSharedSnapshotDriver* CSharedSnapshotDriver::Open (DWORD dwMaxAgeMs)
+{
+    SHARED_REGION region;
+    CSharedSnapshotDriver* pDriver = NULL;
+
+    if (!MapSharedRegion (region, 0))
+        return NULL;
+
+    const SHARED_REGION_HEADER* pHeader = (const SHARED_REGION_HEADER*) region.pView;
+    if (region.cbView >= VC_SHARED_HEADER_V1_SIZE)
+    {
+        pDriver = new CSharedSnapshotDriver ();
+        for (int i = 0; ; i++)
+        {
+            unsigned __int64 sequence = pHeader->sequence.load (std::memory_order_acquire);
+            BOOL bCopied = FALSE;
+
+            if ((sequence & 1) == 0
+                && pHeader->magic == VC_SHARED_MAGIC
+                && pHeader->headerSize >= VC_SHARED_HEADER_V1_SIZE
+                && pHeader->headerSize <= region.cbView
+                && pHeader->cbSnapshot <= region.cbView - pHeader->headerSize)
+            {
+                // responses not published by an older agent stay unavailable
+                memset (&pDriver->m_Snapshot, 0, sizeof (pDriver->m_Snapshot));
+                memcpy (&pDriver->m_Snapshot, (const unsigned char*) region.pView + pHeader->headerSize,
+                    (pHeader->cbSnapshot < sizeof (SHARED_SNAPSHOT))? pHeader->cbSnapshot : sizeof (SHARED_SNAPSHOT));
+                pDriver->m_PublishTimeUs = pHeader->publishTimeUs;
+                if (dwMaxAgeMs == 0)
+                    dwMaxAgeMs = (pHeader->publishIntervalMs < 1000 / 3)? 1000 : 3 * pHeader->publishIntervalMs;
+                bCopied = TRUE;
+            }
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+            if (bCopied && pHeader->sequence.load (std::memory_order_relaxed) == sequence)
+                break;
+
+            if (i == SHARED_READ_RETRIES || (!bCopied && (sequence & 1) == 0))
+            {
+                delete pDriver;
+                pDriver = NULL;
+                break;
+            }
+            Sleep (0);
+        }
+    }
+    UnmapSharedRegion (region);
+
+    // the agent isn't running anymore or is stuck
+    if (pDriver && (GetTimestampUs () < pDriver->m_PublishTimeUs || pDriver->GetAgeSeconds () * 1000.0 > (double) dwMaxAgeMs))
+    {
+        delete pDriver;
+        pDriver = NULL;
+    }
+
+    return pDriver;
+}
+
+static BOOL ServeResponse (const SHARED_RESPONSE& response, const void* pData, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    if (!response.bResult)
+    {
+        // a response without error was not published
+        SetLastError (response.dwError? response.dwError : ERROR_INVALID_FUNCTION);
+        return FALSE;
+    }
+    if (response.cbReturned > nOutBufferSize)
+    {
+        SetLastError (ERROR_INSUFFICIENT_BUFFER);
+        return FALSE;
+    }
+    memcpy (lpOutBuffer, pData, response.cbReturned);
+    *lpBytesReturned = response.cbReturned;
+    return TRUE;
+}
+
+BOOL CSharedSnapshotDriver::IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    const SHARED_SNAPSHOT& s = m_Snapshot;
+
+    *lpBytesReturned = 0;
+    switch (dwIoControlCode)
+    {
+    case VC_IOCTL_GET_DRIVER_VERSION:
+        return ServeResponse (s.driverVersionResponse, &s.driverVersion, lpOutBuffer, nOutBufferSize, lpBytesReturned);
+    case VC_IOCTL_GET_MOUNTED_VOLUMES:
+        return ServeResponse (s.mountListResponse, &s.mountList, lpOutBuffer, nOutBufferSize, lpBytesReturned);
+    case VC_IOCTL_GET_VOLUME_PROPERTIES:
+        {
+            int driveNo = (lpInBuffer && nInBufferSize >= sizeof (int))? ((VOLUME_PROPERTIES_STRUCT*) lpInBuffer)->driveNo : -1;
+            if (driveNo < 0 || driveNo >= 26)
+            {
+                SetLastError (ERROR_FILE_NOT_FOUND);
+                return FALSE;
+            }
+            return ServeResponse (s.volumePropertiesResponse[driveNo], &s.volumeProperties[driveNo], lpOutBuffer, nOutBufferSize, lpBytesReturned);
+        }
+    case VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS:
+        return ServeResponse (s.bootStatusResponse, &s.bootStatus, lpOutBuffer, nOutBufferSize, lpBytesReturned);
+    case VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES:
+        return ServeResponse (s.bootDrivePropertiesResponse, &s.bootDriveProperties, lpOutBuffer, nOutBufferSize, lpBytesReturned);
+    case VC_IOCTL_GET_BOOT_LOADER_VERSION:
+        return ServeResponse (s.bootLoaderVersionResponse, &s.bootLoaderVersion, lpOutBuffer, nOutBufferSize, lpBytesReturned);
+    default:
+        // actions such as EMERGENCY_CLEAR_KEYS always go to the driver
+        SetLastError (ERROR_INVALID_FUNCTION);
+        return FALSE;
+    }
+}
+
+static void CallDriver (CVcDriver& driver, DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, SHARED_RESPONSE& response)
+{
+    response.cbReturned = 0;
+    response.bResult = driver.IoControl (dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize, &response.cbReturned);
+    response.dwError = response.bResult? ERROR_SUCCESS : GetLastError ();
+}
+
+// query everything the query commands may ask for
+static void SweepDriver (CVcDriver& driver, SHARED_SNAPSHOT& s)
+{
+    memset (&s, 0, sizeof (s));
+    CallDriver (driver, VC_IOCTL_GET_DRIVER_VERSION, NULL, 0, &s.driverVersion, sizeof (s.driverVersion), s.driverVersionResponse);
+    CallDriver (driver, VC_IOCTL_GET_MOUNTED_VOLUMES, &s.mountList, sizeof (s.mountList), &s.mountList, sizeof (s.mountList), s.mountListResponse);
+    for (int i = 0; i < 26; i++)
+    {
+        if (s.mountListResponse.bResult && (s.mountList.ulMountedDrives & (1 << i)))
+        {
+            s.volumeProperties[i].driveNo = i;
+            CallDriver (driver, VC_IOCTL_GET_VOLUME_PROPERTIES, &s.volumeProperties[i], sizeof (s.volumeProperties[i]), &s.volumeProperties[i], sizeof (s.volumeProperties[i]), s.volumePropertiesResponse[i]);
+        }
+        else
+            s.volumePropertiesResponse[i].dwError = ERROR_FILE_NOT_FOUND;
+    }
+    CallDriver (driver, VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS, NULL, 0, &s.bootStatus, sizeof (s.bootStatus), s.bootStatusResponse);
+    CallDriver (driver, VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES, NULL, 0, &s.bootDriveProperties, sizeof (s.bootDriveProperties), s.bootDrivePropertiesResponse);
+    CallDriver (driver, VC_IOCTL_GET_BOOT_LOADER_VERSION, NULL, 0, &s.bootLoaderVersion, sizeof (s.bootLoaderVersion), s.bootLoaderVersionResponse);
+}
+
+int RunAgent (CVcDriver& driver, DWORD dwIntervalMs)
+{
+    static SHARED_SNAPSHOT snapshot;
+    SHARED_REGION region;
+    unsigned __int64 nextUs;
+
+    if (!MapSharedRegion (region, sizeof (SHARED_REGION_HEADER) + sizeof (SHARED_SNAPSHOT)))
+    {
+        _tprintf (TEXT("Failed to create the shared snapshot. Error %s\n"), GetWin32ErrorStr (GetLastError ()));
+        return VC_STATUS_INVALID_PARAMETER;
+    }
+
+    SHARED_REGION_HEADER* pHeader = (SHARED_REGION_HEADER*) region.pView;
+    _tprintf (TEXT("Publishing a snapshot every %.1f seconds\n"), (double) dwIntervalMs / 1000.0);
+    fflush (stdout);
+
+    nextUs = GetTimestampUs ();
+    for (;;)
+    {
+        // the driver is swept outside of the write section to keep it short
+        SweepDriver (driver, snapshot);
+
+        pHeader->sequence.fetch_add (1, std::memory_order_acq_rel);
+        std::atomic_thread_fence (std::memory_order_release);
+        pHeader->magic = VC_SHARED_MAGIC;
+        pHeader->layoutVersion = VC_SHARED_LAYOUT_VERSION;
+        pHeader->headerSize = sizeof (SHARED_REGION_HEADER);
+        pHeader->cbSnapshot = sizeof (SHARED_SNAPSHOT);
+        pHeader->publishTimeUs = GetTimestampUs ();
+        pHeader->publishIntervalMs = dwIntervalMs;
+#ifdef _WIN32
+        pHeader->agentProcessId = GetCurrentProcessId ();
+#else
+        pHeader->agentProcessId = (unsigned __int32) getpid ();
+#endif
+        memcpy ((unsigned char*) region.pView + sizeof (SHARED_REGION_HEADER), &snapshot, sizeof (snapshot));
+        pHeader->sequence.fetch_add (1, std::memory_order_release);
+
+        SleepUntilNext (nextUs, dwIntervalMs);
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+#include <atomic>
+
+// Snapshot of the driver responses published in shared memory by a resident agent (/agent)
+// so that query commands can be served without opening the driver.
+//
+// Layout rules: fields are only ever appended to SHARED_REGION_HEADER and SHARED_SNAPSHOT.
+// Readers use headerSize and cbSnapshot to locate and bound what they read, and consider the
+// responses they know but the writer didn't publish as unavailable. An incompatible change
+// requires a new magic value.
+
+#define VC_SHARED_MAGIC				0x53535656	/* "VVSS" */
+#define VC_SHARED_LAYOUT_VERSION	1
+// size of the version 1 header: the fields every reader can rely on
+#define VC_SHARED_HEADER_V1_SIZE	40
+
+// result of one driver call
+typedef struct
+{
+	BOOL bResult;
+	DWORD dwError;		/* GetLastError () when bResult is FALSE */
+	DWORD cbReturned;
+} SHARED_RESPONSE;
+
+typedef struct
+{
+	SHARED_RESPONSE driverVersionResponse;
+	LONG driverVersion;
+	SHARED_RESPONSE mountListResponse;
+	MOUNT_LIST_STRUCT mountList;
+	SHARED_RESPONSE volumePropertiesResponse[26];
+	VOLUME_PROPERTIES_STRUCT volumeProperties[26];
+	SHARED_RESPONSE bootStatusResponse;
+	BootEncryptionStatus bootStatus;
+	SHARED_RESPONSE bootDrivePropertiesResponse;
+	VOLUME_PROPERTIES_STRUCT bootDriveProperties;
+	SHARED_RESPONSE bootLoaderVersionResponse;
+	UINT16 bootLoaderVersion;
+} SHARED_SNAPSHOT;
+
+typedef struct
+{
+	unsigned __int32 magic;
+	unsigned __int32 layoutVersion;
+	unsigned __int32 headerSize;	/* offset of the snapshot in the region */
+	unsigned __int32 cbSnapshot;	/* size of the snapshot written by the agent */
+	std::atomic<unsigned __int64> sequence;	/* seqlock: odd while the agent writes */
+	unsigned __int64 publishTimeUs;	/* GetTimestampUs () of the agent when the snapshot was published */
+	unsigned __int32 publishIntervalMs;
+	unsigned __int32 agentProcessId;
+} SHARED_REGION_HEADER;
+
+// Driver backend serving the responses of the snapshot published by the agent.
+// The snapshot is copied when opened so that a whole command sees a single point in time.
+class CSharedSnapshotDriver : public CVcDriver
+{
+public:
+	// NULL if no agent published a snapshot during the last dwMaxAgeMs
+	// (0 = three publishing intervals of the agent)
+	static CSharedSnapshotDriver* Open (DWORD dwMaxAgeMs);
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned);
+	double GetAgeSeconds () const { return (double) (GetTimestampUs () - m_PublishTimeUs) / 1000000.0; }
+
+protected:
+	CSharedSnapshotDriver () : m_PublishTimeUs (0) {}
+
+	SHARED_SNAPSHOT m_Snapshot;
+	unsigned __int64 m_PublishTimeUs;
+};
+
+// Keep the driver open and publish a snapshot every dwIntervalMs until the process is stopped.
+int RunAgent (CVcDriver& driver, DWORD dwIntervalMs);
@@ -0,0 +1,104 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "snapshot.h"
+#include "trace.h"
+#include <memory>
+
+// fill the system encryption part of the snapshot
+void QuerySystemEncryption (CVcDriver& driver, VC_SNAPSHOT& snapshot)
+{
+    CTraceScope scope ("query sysenc", "phase");
+    DWORD cbBytesReturned = 0;
+
+    if (driver.IoControl (VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS, NULL, 0, &snapshot.bootStatus, sizeof (snapshot.bootStatus), &cbBytesReturned))
+    {
+        snapshot.bBootStatusValid = TRUE;
+        snapshot.cbBootStatus = cbBytesReturned;
+
+        if (GetSystemEncryptionState (snapshot.bootStatus) != SYSENC_NONE)
+        {
+            VC_DRIVER_CALL calls[2];
+
+            InitDriverCall (calls[0], VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES, NULL, 0, &snapshot.bootDriveProp, sizeof (snapshot.bootDriveProp));
+            InitDriverCall (calls[1], VC_IOCTL_GET_BOOT_LOADER_VERSION, NULL, 0, &snapshot.bootLoaderVersion, sizeof (snapshot.bootLoaderVersion));
+            driver.IoControlBatch (calls, 2, INFINITE);
+            snapshot.bBootDrivePropValid = calls[0].bResult;
+            snapshot.bBootLoaderVersionValid = calls[1].bResult;
+        }
+    }
+}
+
+// Fetch the mount list once, the properties of every mounted volume and the system encryption
+// status, then the mount list again to detect mount/dismount races during the snapshot. Only the
+// drives that appeared, disappeared or whose volume ID changed in between are queried again: the
+// unique ID of a volume changes when its drive is dismounted and mounted again. A volume dismounted
+// and mounted again at the same drive letter without any change of the mount list isn't detected.
+// Returns FALSE only if the mount list can't be retrieved.
+BOOL TakeSnapshot (CVcDriver& driver, VC_SNAPSHOT& snapshot)
+{
+    CTraceScope scope ("snapshot", "phase");
+    std::unique_ptr<MOUNT_LIST_STRUCT> pFinal (new MOUNT_LIST_STRUCT);
+    DWORD cbBytesReturned = 0;
+
+    memset (&snapshot, 0, sizeof (snapshot));
+
+    if (!SampleVolumes (driver, snapshot.volumes))
+        return FALSE;
+
+    QuerySystemEncryption (driver, snapshot);
+
+    memset (pFinal.get (), 0, sizeof (MOUNT_LIST_STRUCT));
+    if (driver.IoControl (VC_IOCTL_GET_MOUNTED_VOLUMES, pFinal.get (), sizeof (MOUNT_LIST_STRUCT), pFinal.get (), sizeof (MOUNT_LIST_STRUCT), &cbBytesReturned))
+    {
+        const VOLUME_SAMPLE& first = snapshot.volumes;
+        unsigned __int32 ulChanged = first.ulListedDrives ^ pFinal->ulMountedDrives;
+        VOLUME_PROPERTIES_STRUCT prop[26];
+        VC_DRIVER_CALL calls[26];
+        int drives[26];
+        size_t count = 0;
+
+        for (int i = 0; i < 26; i++)
+        {
+            // the driver only fills the first VOLUME_ID_SIZE bytes of the WCHAR array
+            if ((first.ulMountedDrives & pFinal->ulMountedDrives & (1 << i))
+                && memcmp (first.prop[i].volumeID, pFinal->volumeID[i], VOLUME_ID_SIZE) != 0)
+            {
+                ulChanged |= (1 << i);
+            }
+            if ((ulChanged & pFinal->ulMountedDrives) & (1 << i))
+            {
+                memset (&prop[i], 0, sizeof (prop[i]));
+                prop[i].driveNo = i;
+                InitDriverCall (calls[count], VC_IOCTL_GET_VOLUME_PROPERTIES, &prop[i], sizeof (prop[i]), &prop[i], sizeof (prop[i]));
+                drives[count++] = i;
+            }
+        }
+        driver.IoControlBatch (calls, count, INFINITE);
+
+        // drives that timed out are reported as such, not as a mount change
+        snapshot.ulFinalMountedDrives = pFinal->ulMountedDrives;
+        snapshot.bConsistent = (first.ulListedDrives == pFinal->ulMountedDrives)
+            && ((first.ulMountedDrives | first.ulTimedOutDrives) == first.ulListedDrives);
+        for (size_t n = 0; n < count; n++)
+        {
+            int i = drives[n];
+            // another failure means that the volume was dismounted after GET_MOUNTED_VOLUMES returned
+            if (!calls[n].bResult && calls[n].dwError != ERROR_TIMEOUT)
+                snapshot.ulFinalMountedDrives &= ~(1 << i);
+            if ((first.ulMountedDrives & (1 << i)) && (!calls[n].bResult || first.prop[i].uniqueId != prop[i].uniqueId))
+                snapshot.bConsistent = FALSE;
+        }
+    }
+    else
+    {
+        snapshot.ulFinalMountedDrives = snapshot.volumes.ulListedDrives;
+        snapshot.bConsistent = FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,32 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "watch.h"
+
+// complete inventory of the volumes and system encryption state taken in a single pass
+typedef struct
+{
+	VOLUME_SAMPLE volumes;
+
+	BOOL bBootStatusValid;
+	DWORD cbBootStatus;	/* size returned by the driver: smaller than sizeof (BootEncryptionStatus) for drivers older than 1.26.13 */
+	BootEncryptionStatus bootStatus;
+
+	BOOL bBootDrivePropValid;
+	VOLUME_PROPERTIES_STRUCT bootDriveProp;
+
+	BOOL bBootLoaderVersionValid;
+	UINT16 bootLoaderVersion;
+
+	unsigned __int32 ulFinalMountedDrives;	/* Bitfield returned by GET_MOUNTED_VOLUMES at the end of the snapshot */
+	BOOL bConsistent;	/* FALSE if volumes were mounted or dismounted while the snapshot was taken */
+} VC_SNAPSHOT;
+
+void QuerySystemEncryption (CVcDriver& driver, VC_SNAPSHOT& snapshot);
+BOOL TakeSnapshot (CVcDriver& driver, VC_SNAPSHOT& snapshot);
+void PrintSnapshotInformation (VC_SNAPSHOT& snapshot);
@@ -0,0 +1,225 @@
+/*
+ Legal Notice: Some portions of the source code contained in this file were
+ derived from the source code of TrueCrypt 7.1a, which is 
+ Copyright (c) 2003-2012 TrueCrypt Developers Association and which is 
+ governed by the TrueCrypt License 3.0, also from the source code of
+ Encryption for the Masses 2.02a, which is Copyright (c) 1998-2000 Paul Le Roux
+ and which is governed by the 'License Agreement for Encryption for the Masses' 
+ Modifications and additions to the original source code (contained in this file) 
+ and all other portions of this file are Copyright (c) 2013-2016 IDRIX
+ and are governed by the Apache License 2.0 the full text of which is
+ contained in the file License.txt included in VeraCrypt binary and source
+ code distribution packages. */
+
+#include "common.h"
+#include "snapshot.h"
+#include "schema.h"
+#include "trace.h"
+#ifdef _WIN32
+#include <strsafe.h>
+#endif
+
+LPTSTR GetWin32ErrorStr (DWORD dwError)
+{
+	static TCHAR g_szErrMsg[1024];	
+#ifdef _WIN32
+	LPTSTR lpMsgBuf = NULL;
+
+	FormatMessage (
+		FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+			      NULL,
+			      dwError,
+			      MAKELANGID (LANG_NEUTRAL, SUBLANG_DEFAULT),	/* Default language */
+			      (PWSTR) &lpMsgBuf,
+			      0,
+			      NULL
+	    );
+
+	if (lpMsgBuf)
+	{
+		LPTSTR szFormatMsg = (LPTSTR) lpMsgBuf;
+		size_t msgLen = _tcslen(szFormatMsg);
+		// remove ending \r\n
+		if (msgLen >= 1 && szFormatMsg[msgLen - 1] == TEXT('\n'))
+			szFormatMsg[msgLen - 1] = 0;
+		if (msgLen >= 2 && szFormatMsg[msgLen - 2] == TEXT('\r'))
+			szFormatMsg[msgLen - 2] = 0;
+		StringCchPrintf (g_szErrMsg, ARRAYSIZE (g_szErrMsg), TEXT("0x%.8X: %s"), dwError, szFormatMsg);
+	}
+	else
+	{
+		StringCchPrintf (g_szErrMsg, ARRAYSIZE (g_szErrMsg), TEXT("0x%.8X."), dwError);
+	}
+
+	if (lpMsgBuf) LocalFree (lpMsgBuf);
+#else
+	StringCchPrintf (g_szErrMsg, ARRAYSIZE (g_szErrMsg), TEXT("0x%.8X."), dwError);
+#endif
+
+	return g_szErrMsg;
+}
+
+
+static const char* GetYesNo (BOOL bValue)
+{
+    return bValue? "Yes" : "No";
+}
+
+// status of system encryption as returned by the driver, details generated from g_BootEncryptionStatusSchema
+static eSysEncState AppendSystemEncryptionText (COutputBuffer& out, BootEncryptionStatus& status, DWORD cbSize)
+{
+    eSysEncState state = GetSystemEncryptionState (status);
+
+    out.AppendFormat ("System Encryption: %s\n", GetYesNo (status.DriveMounted || status.DriveEncrypted));
+    out.AppendFormat ("Encryption State: %s\n", (state == SYSENC_NONE)? "None" : (state == SYSENC_PARTIAL)? "Partial" : "Full");
+    switch (state)
+    {
+    case SYSENC_NONE:
+        out.Append ("Encrypted Portion: 0%\n");
+        break;
+    case SYSENC_FULL:
+        out.Append ("Encrypted Portion: 100%\n");
+        break;
+    default:
+        out.AppendFormat ("Encrypted Portion: %.2f%%\n", GetSystemEncryptionPercentage (status, state));
+        break;
+    }
+
+    // fields not returned by drivers older than the structure (e.g. MasterKeyVulnerable before 1.26.13) are skipped
+    if (status.DriveMounted || status.DriveEncrypted)
+        FormatSchemaText (out, g_BootEncryptionStatusSchema, &status, cbSize);
+
+    return state;
+}
+
+// print the status of system encryption as returned by the driver
+eSysEncState PrintSystemEncryptionInformation (BootEncryptionStatus& status, DWORD cbSize)
+{
+    CTraceScope scope ("print sysenc", "format");
+    COutputBuffer out (4096);
+    eSysEncState state = AppendSystemEncryptionText (out, status, cbSize);
+
+    out.WriteText (stdout);
+    return state;
+}
+
+LPCTSTR GetEncryptionAlgorithmName (int ea)
+{
+	static TCHAR g_szName[128];
+    switch (ea)
+    {
+	case 1: return TEXT("AES");
+    case 2: return TEXT("Serpent");
+    case 3: return TEXT("Twofish");
+    case 4: return TEXT("Camellia");
+    case 5: return TEXT("GOST89");
+    case 6: return TEXT("Kuznyechik");
+    case 7: return TEXT("AES(Twofish)");
+    case 8: return TEXT("AES(Twofish(Serpent))");
+    case 9: return TEXT("Serpent(AES)");
+    case 10: return TEXT("Serpent(Twofish(AES))");
+    case 11: return TEXT("Twofish(Serpent)");
+	case 12: return TEXT("Camellia(Kuznyechik)");
+	case 13: return TEXT("Kuznyechik(Twofish)");
+	case 14: return TEXT("Camellia(Serpent)");
+	case 15: return TEXT("Kuznyechik(AES)");
+	case 16: return TEXT("Kuznyechik(Serpent(Camellia))");
+    default: 
+		StringCbPrintf (g_szName, sizeof (g_szName), TEXT("Unknown (id = %d)"), ea);
+		return g_szName;
+    }
+}
+
+LPCTSTR GetPrfAlgorithmName (int pkcs5)
+{
+    switch (pkcs5)
+    {
+    case 1: return TEXT("HMAC-SHA-512");
+    case 2: return TEXT("HMAC-Whirlpool");
+    case 3: return TEXT("HMAC-SHA-256");
+    case 4: return TEXT("HMAC-RIPEMD-160");
+    case 5: return TEXT("HMAC-STREEBOG");
+    default: return TEXT("Unknown");
+    }
+}
+
+void PrintVolumeInformation (VOLUME_PROPERTIES_STRUCT& prop)
+{
+    CTraceScope scope ("print volume", "format");
+    COutputBuffer out (4096);
+
+    FormatSchemaText (out, g_VolumePropertiesSchema, &prop, sizeof (prop));
+    out.WriteText (stdout);
+}
+
+// print the content of a snapshot taken by /all, written at once
+void PrintSnapshotInformation (VC_SNAPSHOT& snapshot)
+{
+    CTraceScope scope ("print snapshot", "format");
+    COutputBuffer out;
+    int count = 0;
+
+    if (snapshot.bBootStatusValid)
+    {
+        AppendSystemEncryptionText (out, snapshot.bootStatus, snapshot.cbBootStatus);
+        if (snapshot.bBootDrivePropValid)
+        {
+            out.Append ('\n');
+            FormatSchemaText (out, g_VolumePropertiesSchema, &snapshot.bootDriveProp, sizeof (snapshot.bootDriveProp));
+        }
+        if (snapshot.bBootLoaderVersionValid)
+        {
+            out.AppendFormat ("\nBootloader version: %x.%x\n", (int)(snapshot.bootLoaderVersion >> 8), (int)(snapshot.bootLoaderVersion & 0x00FF));
+        }
+    }
+    else
+    {
+        out.Append ("System Encryption: Unknown (GET_BOOT_ENCRYPTION_STATUS failed)\n");
+    }
+
+    for (int i = 0; i < 26; i++)
+    {
+        if (snapshot.volumes.ulMountedDrives & (1 << i))
+        {
+            out.Append ('\n');
+            FormatSchemaText (out, g_VolumePropertiesSchema, &snapshot.volumes.prop[i], sizeof (snapshot.volumes.prop[i]));
+            count++;
+        }
+    }
+
+    for (int i = 0; i < 26; i++)
+    {
+        if (snapshot.volumes.ulTimedOutDrives & (1 << i))
+        {
+            out.AppendFormat ("\nDrive Letter: %c: (no answer from the driver before the timeout)\n", 'A' + i);
+            count++;
+        }
+    }
+
+    if (!count)
+    {
+        out.Append ("\nNo volumes are currently mounted on this machine.\n");
+    }
+
+    if (!snapshot.bConsistent)
+    {
+        out.Append ("\nWarning: volumes were mounted or dismounted while the snapshot was taken. The report may be incomplete.\n");
+        out.AppendFormat ("Mounted drives bitmap: 0x%.8X at start, 0x%.8X at end, 0x%.8X queried successfully\n",
+            snapshot.volumes.ulListedDrives, snapshot.ulFinalMountedDrives, snapshot.volumes.ulMountedDrives);
+    }
+
+    out.WriteText (stdout);
+}
+
+// human readable transfer rate (e.g. "12.50 MB/s")
+void FormatRate (double dBytesPerSec, TCHAR* szOut, size_t cchOut)
+{
+    if (dBytesPerSec >= 1024.0 * 1024.0 * 1024.0)
+        StringCchPrintf (szOut, cchOut, TEXT("%.2f GB/s"), dBytesPerSec / (1024.0 * 1024.0 * 1024.0));
+    else if (dBytesPerSec >= 1024.0 * 1024.0)
+        StringCchPrintf (szOut, cchOut, TEXT("%.2f MB/s"), dBytesPerSec / (1024.0 * 1024.0));
+    else if (dBytesPerSec >= 1024.0)
+        StringCchPrintf (szOut, cchOut, TEXT("%.2f KB/s"), dBytesPerSec / 1024.0);
+    else
+        StringCchPrintf (szOut, cchOut, TEXT("%.0f B/s"), dBytesPerSec);
+}
@@ -0,0 +1,403 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "trace.h"
+#include "replay.h"
+#include <algorithm>
+#include <set>
+
+#define VC_TRACE_MAX_LINE	8192
+
+CTracer* g_pTracer = NULL;
+
+CTracer::CTracer (LPCTSTR szFileName) :
+    m_FileName (szFileName),
+    m_StartNs (GetTimestampNs ()),
+    m_Runs (1),
+    m_DroppedEvents (0),
+    m_NextLane (0)
+{
+}
+
+CTracer* CTracer::Open (LPCTSTR szFileName)
+{
+    CTracer* pTracer = new CTracer (szFileName);
+    FILE* f;
+
+    // a file that isn't a VeraStatus trace is overwritten, as by /record
+    if (!pTracer->Load ())
+    {
+        pTracer->m_Histograms.clear ();
+        pTracer->m_Runs = 1;
+    }
+
+    f = _tfopen (szFileName, TEXT("a"));
+    if (!f)
+    {
+        delete pTracer;
+        SetLastError (ERROR_FILE_NOT_FOUND);
+        return NULL;
+    }
+    fclose (f);
+    return pTracer;
+}
+
+// "veraStatusRuns" and "veraStatusHistograms" lines written by Write
+BOOL CTracer::Load ()
+{
+    FILE* f = _tfopen (m_FileName.c_str (), TEXT("r"));
+    std::vector<char> line (VC_TRACE_MAX_LINE);
+    BOOL bInHistograms = FALSE;
+    BOOL bResult = TRUE;
+
+    if (!f)
+        return TRUE;
+
+    while (bResult && fgets (&line[0], (int) line.size (), f))
+    {
+        const char* szLine = &line[0];
+        unsigned long long runs;
+
+        if (sscanf (szLine, "\"veraStatusRuns\":%llu", &runs) == 1)
+            m_Runs = runs + 1;
+        else if (strncmp (szLine, "\"veraStatusHistograms\":[", 24) == 0)
+            bInHistograms = TRUE;
+        else if (bInHistograms && szLine[0] == '{')
+        {
+            char szName[64], szCategory[16];
+            unsigned long long count, timeouts, sumNs, minNs, maxNs;
+            int n = 0;
+
+            if (sscanf (szLine, "{\"name\":\"%63[^\"]\",\"cat\":\"%15[^\"]\",\"count\":%llu,\"timeouts\":%llu,\"sumNs\":%llu,\"minNs\":%llu,\"maxNs\":%llu,\"buckets\":[%n",
+                    szName, szCategory, &count, &timeouts, &sumNs, &minNs, &maxNs, &n) != 7 || n == 0)
+            {
+                bResult = FALSE;
+                break;
+            }
+
+            TRACE_HISTOGRAM& histogram = m_Histograms[szName];
+            memset (histogram.buckets, 0, sizeof (histogram.buckets));
+            histogram.category = szCategory;
+            histogram.count = count;
+            histogram.timeouts = timeouts;
+            histogram.sumNs = sumNs;
+            histogram.minNs = minNs;
+            histogram.maxNs = maxNs;
+
+            // [bucket,count] pairs of the non empty buckets
+            for (const char* p = szLine + n; *p != ']'; )
+            {
+                int bucket, cch = 0;
+                unsigned long long bucketCount;
+
+                if (sscanf (p, "[%d,%llu]%n", &bucket, &bucketCount, &cch) != 2 || cch == 0 || bucket < 0 || bucket >= VC_TRACE_BUCKETS)
+                {
+                    bResult = FALSE;
+                    break;
+                }
+                histogram.buckets[bucket] = bucketCount;
+                p += cch;
+                if (*p == ',')
+                    p++;
+            }
+        }
+    }
+
+    fclose (f);
+    return bResult;
+}
+
+// 0 to 7 ns exactly, then 4 buckets per power of two
+int CTracer::GetBucket (unsigned __int64 valueNs)
+{
+    int exponent = 3;
+
+    if (valueNs < 8)
+        return (int) valueNs;
+    while (exponent < 63 && (valueNs >> (exponent + 1)))
+        exponent++;
+
+    int bucket = 8 + (exponent - 3) * 4 + (int) ((valueNs >> (exponent - 2)) & 3);
+    return (bucket < VC_TRACE_BUCKETS)? bucket : VC_TRACE_BUCKETS - 1;
+}
+
+unsigned __int64 CTracer::GetBucketUpperBound (int bucket)
+{
+    if (bucket < 8)
+        return (unsigned __int64) bucket;
+
+    int exponent = 3 + (bucket - 8) / 4;
+    unsigned __int64 lower = (unsigned __int64) (4 + (bucket - 8) % 4) << (exponent - 2);
+    return lower + ((unsigned __int64) 1 << (exponent - 2)) - 1;
+}
+
+// upper bound of the bucket holding the percentile, within the observed range
+unsigned __int64 CTracer::GetPercentile (const TRACE_HISTOGRAM& histogram, double dPercentile)
+{
+    unsigned __int64 target = (unsigned __int64) (dPercentile / 100.0 * (double) histogram.count + 0.999999);
+    unsigned __int64 cumulated = 0;
+
+    if (target == 0)
+        target = 1;
+    for (int i = 0; i < VC_TRACE_BUCKETS; i++)
+    {
+        cumulated += histogram.buckets[i];
+        if (cumulated >= target)
+        {
+            unsigned __int64 valueNs = GetBucketUpperBound (i);
+            if (valueNs > histogram.maxNs)
+                valueNs = histogram.maxNs;
+            if (valueNs < histogram.minNs)
+                valueNs = histogram.minNs;
+            return valueNs;
+        }
+    }
+    return histogram.maxNs;
+}
+
+DWORD CTracer::GetLane ()
+{
+    static thread_local DWORD t_Lane = 0;
+
+    if (!t_Lane)
+    {
+        std::lock_guard<std::mutex> lock (m_Mutex);
+        t_Lane = ++m_NextLane;
+    }
+    return t_Lane;
+}
+
+void CTracer::AddEvent (const TRACE_EVENT& ev, BOOL bTimedOut)
+{
+    std::lock_guard<std::mutex> lock (m_Mutex);
+    std::map<std::string, TRACE_HISTOGRAM>::iterator it = m_Histograms.find (ev.szName);
+
+    if (it == m_Histograms.end ())
+    {
+        TRACE_HISTOGRAM& histogram = m_Histograms[ev.szName];
+        histogram.category = ev.szCategory;
+        histogram.count = histogram.timeouts = histogram.sumNs = histogram.minNs = histogram.maxNs = 0;
+        memset (histogram.buckets, 0, sizeof (histogram.buckets));
+        it = m_Histograms.find (ev.szName);
+    }
+
+    TRACE_HISTOGRAM& histogram = it->second;
+    if (bTimedOut)
+        histogram.timeouts++;
+    else
+    {
+        if (histogram.count == 0 || ev.durationNs < histogram.minNs)
+            histogram.minNs = ev.durationNs;
+        if (ev.durationNs > histogram.maxNs)
+            histogram.maxNs = ev.durationNs;
+        histogram.count++;
+        histogram.sumNs += ev.durationNs;
+        histogram.buckets[GetBucket (ev.durationNs)]++;
+    }
+
+    if (m_Events.size () < VC_TRACE_MAX_EVENTS)
+        m_Events.push_back (ev);
+    else
+        m_DroppedEvents++;
+}
+
+void CTracer::AddSpan (const char* szName, const char* szCategory, unsigned __int64 startNs, unsigned __int64 endNs)
+{
+    TRACE_EVENT ev;
+
+    ev.szName = szName;
+    ev.szCategory = szCategory;
+    ev.startNs = startNs;
+    ev.durationNs = (endNs > startNs)? endNs - startNs : 0;
+    ev.dwLane = GetLane ();
+    ev.key = -1;
+    ev.bResult = TRUE;
+    ev.dwError = ERROR_SUCCESS;
+    AddEvent (ev, FALSE);
+}
+
+void CTracer::AddDriverCall (const VC_DRIVER_CALL& call, DWORD dwLane)
+{
+    const char* szName = GetIoctlName (call.dwIoControlCode);
+    TRACE_EVENT ev;
+
+    ev.szName = szName? szName : "UNKNOWN_IOCTL";
+    ev.szCategory = "ioctl";
+    ev.startNs = call.startNs;
+    ev.durationNs = (call.endNs > call.startNs)? call.endNs - call.startNs : 0;
+    ev.dwLane = dwLane;
+    ev.key = GetRequestKey (call.dwIoControlCode, call.lpInBuffer, call.nInBufferSize);
+    ev.bResult = call.bResult;
+    ev.dwError = call.bResult? ERROR_SUCCESS : call.dwError;
+    AddEvent (ev, !call.bResult && call.dwError == ERROR_TIMEOUT);
+}
+
+BOOL CTracer::Write ()
+{
+    std::lock_guard<std::mutex> lock (m_Mutex);
+    FILE* f = _tfopen (m_FileName.c_str (), TEXT("w"));
+    std::set<DWORD> lanes;
+    unsigned __int64 originNs = m_StartNs;
+    BOOL bFirst = TRUE;
+
+    if (!f)
+        return FALSE;
+
+    // spans recorded by the caller may have started before the tracer
+    for (size_t i = 0; i < m_Events.size (); i++)
+    {
+        if (m_Events[i].startNs < originNs)
+            originNs = m_Events[i].startNs;
+    }
+
+    fprintf (f, "{\"traceEvents\":[\n");
+    fprintf (f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"VeraStatus\"}}");
+    for (size_t i = 0; i < m_Events.size (); i++)
+    {
+        const TRACE_EVENT& ev = m_Events[i];
+
+        unsigned __int64 tsNs = ev.startNs - originNs;
+
+        // the viewer takes microseconds
+        fprintf (f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"pid\":1,\"tid\":%u",
+            ev.szName, ev.szCategory, (unsigned long long) (tsNs / 1000), (unsigned int) (tsNs % 1000),
+            (unsigned long long) (ev.durationNs / 1000), (unsigned int) (ev.durationNs % 1000), (unsigned int) ev.dwLane);
+        if (strcmp (ev.szCategory, "ioctl") == 0)
+        {
+            fprintf (f, ",\"args\":{");
+            if (ev.key >= 0 && ev.key < 26)
+                fprintf (f, "\"drive\":\"%c:\",", 'A' + ev.key);
+            fprintf (f, "\"result\":%d,\"error\":%u}", ev.bResult? 1 : 0, (unsigned int) ev.dwError);
+        }
+        fprintf (f, "}");
+        lanes.insert (ev.dwLane);
+    }
+
+    // names of the viewer threads
+    for (std::set<DWORD>::const_iterator it = lanes.begin (); it != lanes.end (); ++it)
+    {
+        if (*it >= VC_TRACE_BATCH_LANE)
+            fprintf (f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"batch call %u\"}}", (unsigned int) *it, (unsigned int) (*it - VC_TRACE_BATCH_LANE));
+        else if (*it == 1)
+            fprintf (f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}");
+        else
+            fprintf (f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", (unsigned int) *it, (unsigned int) *it);
+    }
+
+    fprintf (f, "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"droppedEvents\":%llu},\n", (unsigned long long) m_DroppedEvents);
+    fprintf (f, "\"veraStatusRuns\":%llu,\n", (unsigned long long) m_Runs);
+    fprintf (f, "\"veraStatusHistograms\":[\n");
+    for (std::map<std::string, TRACE_HISTOGRAM>::const_iterator it = m_Histograms.begin (); it != m_Histograms.end (); ++it)
+    {
+        const TRACE_HISTOGRAM& histogram = it->second;
+        BOOL bFirstBucket = TRUE;
+
+        fprintf (f, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"count\":%llu,\"timeouts\":%llu,\"sumNs\":%llu,\"minNs\":%llu,\"maxNs\":%llu,\"buckets\":[",
+            bFirst? "" : ",\n", it->first.c_str (), histogram.category.c_str (),
+            (unsigned long long) histogram.count, (unsigned long long) histogram.timeouts, (unsigned long long) histogram.sumNs,
+            (unsigned long long) histogram.minNs, (unsigned long long) histogram.maxNs);
+        for (int i = 0; i < VC_TRACE_BUCKETS; i++)
+        {
+            if (histogram.buckets[i])
+            {
+                fprintf (f, "%s[%d,%llu]", bFirstBucket? "" : ",", i, (unsigned long long) histogram.buckets[i]);
+                bFirstBucket = FALSE;
+            }
+        }
+        fprintf (f, "]}");
+        bFirst = FALSE;
+    }
+    fprintf (f, "\n]}\n");
+
+    return (fclose (f) == 0)? TRUE : FALSE;
+}
+
+static int GetCategoryRank (const std::string& category)
+{
+    static const char* g_Categories[] = { "ioctl", "phase", "format", "output" };
+
+    for (int i = 0; i < (int) ARRAYSIZE (g_Categories); i++)
+    {
+        if (category == g_Categories[i])
+            return i;
+    }
+    return (int) ARRAYSIZE (g_Categories);
+}
+
+// driver calls first, then by name
+static bool CompareHistograms (const std::pair<std::string, const TRACE_HISTOGRAM*>& a, const std::pair<std::string, const TRACE_HISTOGRAM*>& b)
+{
+    int rankA = GetCategoryRank (a.second->category), rankB = GetCategoryRank (b.second->category);
+
+    if (rankA != rankB)
+        return rankA < rankB;
+    return a.first < b.first;
+}
+
+void CTracer::PrintSummary (FILE* f)
+{
+    std::lock_guard<std::mutex> lock (m_Mutex);
+    std::vector<std::pair<std::string, const TRACE_HISTOGRAM*> > rows;
+
+    for (std::map<std::string, TRACE_HISTOGRAM>::const_iterator it = m_Histograms.begin (); it != m_Histograms.end (); ++it)
+        rows.push_back (std::make_pair (it->first, &it->second));
+    std::sort (rows.begin (), rows.end (), CompareHistograms);
+
+    fprintf (f, "\nLatency of %u span(s) of this run, histograms of %llu run(s) (microseconds):\n",
+        (unsigned int) (m_Events.size () + m_DroppedEvents), (unsigned long long) m_Runs);
+    fprintf (f, "%-7s %-40s %10s %9s %10s %10s %10s %10s %10s\n", "Kind", "Span", "Count", "Timeouts", "Mean", "p50", "p90", "p99", "Max");
+    for (size_t i = 0; i < rows.size (); i++)
+    {
+        const TRACE_HISTOGRAM& histogram = *rows[i].second;
+
+        if (histogram.count == 0)
+        {
+            fprintf (f, "%-7s %-40s %10s %9llu %10s %10s %10s %10s %10s\n", histogram.category.c_str (), rows[i].first.c_str (), "0",
+                (unsigned long long) histogram.timeouts, "-", "-", "-", "-", "-");
+            continue;
+        }
+
+        fprintf (f, "%-7s %-40s %10llu %9llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", histogram.category.c_str (), rows[i].first.c_str (),
+            (unsigned long long) histogram.count, (unsigned long long) histogram.timeouts,
+            (double) histogram.sumNs / (double) histogram.count / 1000.0,
+            (double) GetPercentile (histogram, 50.0) / 1000.0, (double) GetPercentile (histogram, 90.0) / 1000.0,
+            (double) GetPercentile (histogram, 99.0) / 1000.0, (double) histogram.maxNs / 1000.0);
+    }
+}
+
+BOOL CTracingDriver::IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned)
+{
+    VC_DRIVER_CALL call;
+
+    InitDriverCall (call, dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize);
+    call.startNs = GetTimestampNs ();
+    call.bResult = m_pDriver->IoControl (dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize, &call.cbReturned);
+    call.dwError = call.bResult? ERROR_SUCCESS : GetLastError ();
+    call.endNs = GetTimestampNs ();
+
+    if (g_pTracer)
+        g_pTracer->AddDriverCall (call, g_pTracer->GetLane ());
+
+    *lpBytesReturned = call.cbReturned;
+    if (!call.bResult)
+        SetLastError (call.dwError);
+    return call.bResult;
+}
+
+// the calls of a batch overlap: each one is shown on its own lane
+BOOL CTracingDriver::IoControlBatch (VC_DRIVER_CALL* pCalls, size_t count, DWORD dwTimeoutMs)
+{
+    BOOL bCompleted = m_pDriver->IoControlBatch (pCalls, count, dwTimeoutMs);
+
+    for (size_t i = 0; g_pTracer && i < count; i++)
+        g_pTracer->AddDriverCall (pCalls[i], (count > 1)? VC_TRACE_BATCH_LANE + (DWORD) i : g_pTracer->GetLane ());
+    return bCompleted;
+}
+
+CVcDriver* TraceDriverCalls (CVcDriver* pDriver)
+{
+    return (pDriver && g_pTracer)? new CTracingDriver (pDriver) : pDriver;
+}
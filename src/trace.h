@@ -0,0 +1,112 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Latency tracing (global command line option /trace TraceFile).
+// Driver calls, output formatting and process phases are timed as spans. At exit, the spans of the
+// run are written to the trace file in the trace event format of Chrome (chrome://tracing, Perfetto),
+// and the latency histograms of each span name, accumulated over all the runs using the same file,
+// are stored in it and printed as a summary table on stderr.
+// Spans are timed in nanoseconds. When tracing is off, g_pTracer is NULL and a span costs a pointer test.
+
+#define VC_TRACE_MAX_EVENTS		(256 * 1024)	/* spans kept for the trace viewer, the histograms count all of them */
+#define VC_TRACE_BUCKETS		160				/* log-linear buckets: 4 per power of two, up to 2^41 ns */
+#define VC_TRACE_BATCH_LANE		1000			/* lane of the first call of a batch, the calls of a batch overlap */
+
+typedef struct
+{
+	const char* szName;		/* static string */
+	const char* szCategory;	/* "ioctl", "phase", "format" or "output" */
+	unsigned __int64 startNs;
+	unsigned __int64 durationNs;
+	DWORD dwLane;			/* thread of the viewer */
+	int key;				/* drive number of GET_VOLUME_PROPERTIES, -1 otherwise */
+	BOOL bResult;			/* ioctl only */
+	DWORD dwError;
+} TRACE_EVENT;
+
+typedef struct
+{
+	std::string category;
+	unsigned __int64 count;		/* completed spans, counted in buckets */
+	unsigned __int64 timeouts;	/* driver calls that timed out, not counted in buckets */
+	unsigned __int64 sumNs;
+	unsigned __int64 minNs;
+	unsigned __int64 maxNs;
+	unsigned __int64 buckets[VC_TRACE_BUCKETS];
+} TRACE_HISTOGRAM;
+
+class CTracer
+{
+public:
+	// load the histograms of the previous runs stored in the file, if any
+	static CTracer* Open (LPCTSTR szFileName);
+
+	void AddSpan (const char* szName, const char* szCategory, unsigned __int64 startNs, unsigned __int64 endNs);
+	void AddDriverCall (const VC_DRIVER_CALL& call, DWORD dwLane);
+	// lane of the calling thread
+	DWORD GetLane ();
+
+	BOOL Write ();
+	void PrintSummary (FILE* f);
+
+	static int GetBucket (unsigned __int64 valueNs);
+	static unsigned __int64 GetBucketUpperBound (int bucket);
+	static unsigned __int64 GetPercentile (const TRACE_HISTOGRAM& histogram, double dPercentile);
+
+protected:
+	CTracer (LPCTSTR szFileName);
+	BOOL Load ();
+	void AddEvent (const TRACE_EVENT& ev, BOOL bTimedOut);
+
+	std::basic_string<TCHAR> m_FileName;
+	unsigned __int64 m_StartNs;
+	unsigned __int64 m_Runs;			/* including this one */
+	unsigned __int64 m_DroppedEvents;
+	DWORD m_NextLane;
+	std::vector<TRACE_EVENT> m_Events;
+	std::map<std::string, TRACE_HISTOGRAM> m_Histograms;
+	std::mutex m_Mutex;
+};
+
+extern CTracer* g_pTracer;
+
+// span covering the lifetime of the object
+class CTraceScope
+{
+public:
+	CTraceScope (const char* szName, const char* szCategory) : m_szName (szName), m_szCategory (szCategory), m_StartNs (g_pTracer? GetTimestampNs () : 0) {}
+	~CTraceScope () { if (g_pTracer) g_pTracer->AddSpan (m_szName, m_szCategory, m_StartNs, GetTimestampNs ()); }
+
+protected:
+	const char* m_szName;
+	const char* m_szCategory;
+	unsigned __int64 m_StartNs;
+};
+
+// Backend timing the calls of another one, which it owns
+class CTracingDriver : public CVcDriver
+{
+public:
+	CTracingDriver (CVcDriver* pDriver) : m_pDriver (pDriver) {}
+	virtual ~CTracingDriver () { delete m_pDriver; }
+	virtual BOOL IoControl (DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned);
+	virtual BOOL IoControlBatch (VC_DRIVER_CALL* pCalls, size_t count, DWORD dwTimeoutMs);
+	virtual BOOL SupportsIoControl (DWORD dwIoControlCode) { return m_pDriver->SupportsIoControl (dwIoControlCode); }
+	virtual BOOL TimedOut () const { return m_pDriver->TimedOut (); }
+
+protected:
+	CVcDriver* m_pDriver;
+};
+
+// pDriver wrapped in a CTracingDriver when tracing is on
+CVcDriver* TraceDriverCalls (CVcDriver* pDriver);
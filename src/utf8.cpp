@@ -0,0 +1,196 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "utf8.h"
+#include <stdint.h>
+
+#if defined (_M_X64) || defined (__x86_64__)
+#define UTF8_X64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define UTF8_TARGET_AVX2
+#define UTF8_CTZ(x)	_tzcnt_u32 (x)
+#else
+#define UTF8_TARGET_AVX2	__attribute__ ((target ("avx2")))
+#define UTF8_CTZ(x)	__builtin_ctz (x)
+#endif
+#endif
+
+// Converts the run of ASCII characters starting at pSrc by blocks, stopping at the first block
+// containing a NUL or non ASCII character. Returns the number of characters written to pDest.
+typedef size_t (*PFN_ASCII_RUN) (const WCHAR* pSrc, size_t cchSrc, char* pDest, size_t cbDest);
+
+#ifdef UTF8_X64
+// a block can be read if it is within the source and, for NUL terminated strings of unknown length,
+// within the memory page of the string
+#define CAN_READ_BLOCK(p, cch, n, block)	((n) + (block) <= (cch) && ((uintptr_t) ((p) + (n)) & 4095) <= 4096 - (block) * sizeof (WCHAR))
+
+static size_t AsciiRunSse2 (const WCHAR* pSrc, size_t cchSrc, char* pDest, size_t cbDest)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i nonAsciiBits = _mm_set1_epi16 ((short) 0xFF80);
+    size_t n = 0;
+
+    // each block stores 8 bytes, the last one must leave room for the NUL
+    while (CAN_READ_BLOCK (pSrc, cchSrc, n, 8) && n + 8 < cbDest)
+    {
+        __m128i v = _mm_loadu_si128 ((const __m128i*) (pSrc + n));
+        __m128i ascii = _mm_andnot_si128 (_mm_cmpeq_epi16 (v, zero), _mm_cmpeq_epi16 (_mm_and_si128 (v, nonAsciiBits), zero));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8 (ascii);
+
+        _mm_storel_epi64 ((__m128i*) (pDest + n), _mm_packus_epi16 (v, v));
+        if (mask != 0xFFFF)
+            return n + UTF8_CTZ (~mask) / 2;
+        n += 8;
+    }
+    return n;
+}
+
+static UTF8_TARGET_AVX2 size_t AsciiRunAvx2 (const WCHAR* pSrc, size_t cchSrc, char* pDest, size_t cbDest)
+{
+    const __m256i zero = _mm256_setzero_si256 ();
+    const __m256i nonAsciiBits = _mm256_set1_epi16 ((short) 0xFF80);
+    size_t n = 0;
+
+    while (CAN_READ_BLOCK (pSrc, cchSrc, n, 16) && n + 16 < cbDest)
+    {
+        __m256i v = _mm256_loadu_si256 ((const __m256i*) (pSrc + n));
+        __m256i ascii = _mm256_andnot_si256 (_mm256_cmpeq_epi16 (v, zero), _mm256_cmpeq_epi16 (_mm256_and_si256 (v, nonAsciiBits), zero));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8 (ascii);
+        // packing works within 128-bit lanes: gather the low 8 bytes of both lanes
+        __m256i packed = _mm256_permute4x64_epi64 (_mm256_packus_epi16 (v, v), 0xD8);
+
+        _mm_storeu_si128 ((__m128i*) (pDest + n), _mm256_castsi256_si128 (packed));
+        if (mask != 0xFFFFFFFF)
+            return n + UTF8_CTZ (~mask) / 2;
+        n += 16;
+    }
+    return n;
+}
+
+static BOOL IsAvx2Supported ()
+{
+#ifdef _MSC_VER
+    int regs[4];
+
+    // AVX2 instructions, and YMM registers saved by the OS
+    __cpuid (regs, 0);
+    if (regs[0] < 7)
+        return FALSE;
+    __cpuid (regs, 1);
+    if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0 || (_xgetbv (0) & 6) != 6)
+        return FALSE;
+    __cpuidex (regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports ("avx2");
+#endif
+}
+#endif
+
+static PFN_ASCII_RUN GetAsciiRun (eUtf8Implementation impl)
+{
+    switch (impl)
+    {
+#ifdef UTF8_X64
+    case UTF8_AVX2:
+        return AsciiRunAvx2;
+    case UTF8_SSE2:
+        return AsciiRunSse2;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+eUtf8Implementation GetUtf8Implementation ()
+{
+#ifdef UTF8_X64
+    static const eUtf8Implementation impl = IsAvx2Supported ()? UTF8_AVX2 : UTF8_SSE2;
+    return impl;
+#else
+    return UTF8_SCALAR;
+#endif
+}
+
+static size_t Convert (const WCHAR* wszSrc, size_t cchSrcMax, char* szDest, size_t cbDest, PFN_ASCII_RUN pfnAsciiRun)
+{
+    size_t j = 0;
+
+    if (cbDest == 0)
+        return 0;
+
+    for (size_t i = 0; i < cchSrcMax && wszSrc[i]; i++)
+    {
+        unsigned int cp = wszSrc[i];
+
+        // paths and labels are mostly ASCII: convert them by blocks, the remaining characters one by one
+        if (cp < 0x80 && pfnAsciiRun)
+        {
+            size_t n = pfnAsciiRun (wszSrc + i, cchSrcMax - i, szDest + j, cbDest - j);
+            if (n)
+            {
+                i += n - 1;
+                j += n;
+                continue;
+            }
+        }
+
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < cchSrcMax && wszSrc[i + 1] >= 0xDC00 && wszSrc[i + 1] <= 0xDFFF)
+        {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (wszSrc[i + 1] - 0xDC00);
+            i++;
+        }
+        else if (cp >= 0xD800 && cp <= 0xDFFF)
+            cp = 0xFFFD;
+
+        if (cp < 0x80)
+        {
+            if (j + 1 >= cbDest)
+                break;
+            szDest[j++] = (char) cp;
+        }
+        else if (cp < 0x800)
+        {
+            if (j + 2 >= cbDest)
+                break;
+            szDest[j++] = (char) (0xC0 | (cp >> 6));
+            szDest[j++] = (char) (0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            if (j + 3 >= cbDest)
+                break;
+            szDest[j++] = (char) (0xE0 | (cp >> 12));
+            szDest[j++] = (char) (0x80 | ((cp >> 6) & 0x3F));
+            szDest[j++] = (char) (0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            if (j + 4 >= cbDest)
+                break;
+            szDest[j++] = (char) (0xF0 | (cp >> 18));
+            szDest[j++] = (char) (0x80 | ((cp >> 12) & 0x3F));
+            szDest[j++] = (char) (0x80 | ((cp >> 6) & 0x3F));
+            szDest[j++] = (char) (0x80 | (cp & 0x3F));
+        }
+    }
+
+    szDest[j] = 0;
+    return j;
+}
+
+size_t Utf16ToUtf8 (const WCHAR* wszSrc, size_t cchSrcMax, char* szDest, size_t cbDest)
+{
+    static const PFN_ASCII_RUN pfnAsciiRun = GetAsciiRun (GetUtf8Implementation ());
+    return Convert (wszSrc, cchSrcMax, szDest, cbDest, pfnAsciiRun);
+}
+
+size_t Utf16ToUtf8With (eUtf8Implementation impl, const WCHAR* wszSrc, size_t cchSrcMax, char* szDest, size_t cbDest)
+{
+    return Convert (wszSrc, cchSrcMax, szDest, cbDest, GetAsciiRun (impl));
+}
@@ -0,0 +1,29 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "defs.h"
+
+// Convert the UTF-16 string wszSrc to UTF-8. Conversion stops at the first NUL character or after
+// cchSrcMax characters (fixed size driver buffers are not always NUL terminated).
+// The output is always NUL terminated and truncated on a character boundary if szDest is too small.
+// Unpaired surrogates are replaced by U+FFFD. Returns the number of bytes written, excluding the NUL.
+size_t Utf16ToUtf8 (const WCHAR* wszSrc, size_t cchSrcMax, char* szDest, size_t cbDest);
+
+// Runs of ASCII characters are converted 8 (SSE2) or 16 (AVX2) at a time on x64, the other
+// characters one by one.
+typedef enum
+{
+	UTF8_SCALAR = 0,
+	UTF8_SSE2,
+	UTF8_AVX2
+} eUtf8Implementation;
+
+// fastest implementation supported by the processor, used by Utf16ToUtf8
+eUtf8Implementation GetUtf8Implementation ();
+// Utf16ToUtf8 with a given implementation, which must be supported by the processor (benchmark)
+size_t Utf16ToUtf8With (eUtf8Implementation impl, const WCHAR* wszSrc, size_t cchSrcMax, char* szDest, size_t cbDest);
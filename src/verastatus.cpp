@@ -0,0 +1,175 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+// Implementation of libverastatus (see verastatus.h) on top of the driver backends
+
+#include "common.h"
+#include "driver.h"
+
+struct VS_SESSION
+{
+    CVcDriver* pDriver;
+};
+
+// get the state of system encryption from the status returned by the driver
+eSysEncState GetSystemEncryptionState (BootEncryptionStatus& status)
+{
+    if (status.DriveMounted || status.DriveEncrypted)
+    {
+	    if (!status.SetupInProgress
+		    && status.ConfiguredEncryptedAreaEnd != 0
+		    && status.ConfiguredEncryptedAreaEnd != -1
+		    && status.ConfiguredEncryptedAreaStart == status.EncryptedAreaStart
+		    && status.ConfiguredEncryptedAreaEnd == status.EncryptedAreaEnd
+            )
+        {
+            return SYSENC_FULL;
+        }
+	
+        if (	status.EncryptedAreaEnd < 0 
+		    || status.EncryptedAreaStart < 0
+		    || status.EncryptedAreaEnd <= status.EncryptedAreaStart
+		    )
+        {
+            return SYSENC_NONE;
+        }
+
+        return SYSENC_PARTIAL;
+    }
+    else
+        return SYSENC_NONE;
+}
+
+// get the encrypted portion of the system drive in percent
+double GetSystemEncryptionPercentage (BootEncryptionStatus& status, eSysEncState state)
+{
+    double dVal;
+
+    switch (state)
+    {
+    case SYSENC_NONE:
+        return 0.0;
+    case SYSENC_FULL:
+        return 100.0;
+    default:
+        dVal = (double) (((unsigned __int64)(status.EncryptedAreaEnd - status.EncryptedAreaStart)) + 1);
+        dVal /= (double) (((unsigned __int64)(status.ConfiguredEncryptedAreaEnd - status.ConfiguredEncryptedAreaStart)) + 1);
+        return dVal * 100.0;
+    }
+}
+
+VS_SESSION* VsAttachDriver (CVcDriver* pDriver)
+{
+    VS_SESSION* pSession = new VS_SESSION;
+    pSession->pDriver = pDriver;
+    return pSession;
+}
+
+CVcDriver& VsGetDriver (VS_SESSION* pSession)
+{
+    return *pSession->pDriver;
+}
+
+VS_SESSION* VsOpenSession (const VS_SESSION_OPTIONS* pOptions)
+{
+    static const VS_SESSION_OPTIONS g_DefaultOptions = { FALSE, NULL, NULL, 0, 0, NULL, 0, 0 };
+    CVcDriver* pDriver = OpenVcDriver (pOptions? *pOptions : g_DefaultOptions);
+
+    return pDriver? VsAttachDriver (pDriver) : NULL;
+}
+
+void VsCloseSession (VS_SESSION* pSession)
+{
+    if (pSession)
+    {
+        delete pSession->pDriver;
+        delete pSession;
+    }
+}
+
+BOOL VsGetDriverVersion (VS_SESSION* pSession, LONG* pVersion)
+{
+    DWORD cbBytesReturned = 0;
+
+    *pVersion = 0;
+    return pSession->pDriver->IoControl (VC_IOCTL_GET_DRIVER_VERSION, NULL, 0, pVersion, sizeof (LONG), &cbBytesReturned);
+}
+
+BOOL VsQueryMountList (VS_SESSION* pSession, MOUNT_LIST_STRUCT* pList)
+{
+    DWORD cbBytesReturned = 0;
+
+    memset (pList, 0, sizeof (MOUNT_LIST_STRUCT));
+    return pSession->pDriver->IoControl (VC_IOCTL_GET_MOUNTED_VOLUMES, pList, sizeof (MOUNT_LIST_STRUCT), pList, sizeof (MOUNT_LIST_STRUCT), &cbBytesReturned);
+}
+
+BOOL VsQueryVolumeProperties (VS_SESSION* pSession, int driveNo, VOLUME_PROPERTIES_STRUCT* pProp)
+{
+    DWORD cbBytesReturned = 0;
+
+    if (driveNo < 0 || driveNo >= 26)
+    {
+        SetLastError (ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    memset (pProp, 0, sizeof (VOLUME_PROPERTIES_STRUCT));
+    pProp->driveNo = driveNo;
+    return pSession->pDriver->IoControl (VC_IOCTL_GET_VOLUME_PROPERTIES, pProp, sizeof (VOLUME_PROPERTIES_STRUCT), pProp, sizeof (VOLUME_PROPERTIES_STRUCT), &cbBytesReturned);
+}
+
+BOOL VsQueryBootStatus (VS_SESSION* pSession, VS_BOOT_STATUS* pStatus)
+{
+    memset (pStatus, 0, sizeof (VS_BOOT_STATUS));
+    pStatus->state = SYSENC_NONE;
+    if (!pSession->pDriver->IoControl (VC_IOCTL_GET_BOOT_ENCRYPTION_STATUS, NULL, 0, &pStatus->status, sizeof (pStatus->status), &pStatus->cbReturned))
+        return FALSE;
+
+    // drivers older than 1.26.13 return the structure without MasterKeyVulnerable
+    if (pStatus->cbReturned < sizeof (pStatus->status))
+        memset ((unsigned char*) &pStatus->status + pStatus->cbReturned, 0, sizeof (pStatus->status) - pStatus->cbReturned);
+    pStatus->bMasterKeyVulnerableValid = (pStatus->cbReturned >= sizeof (pStatus->status));
+    pStatus->state = VsGetSystemEncryptionState (&pStatus->status, &pStatus->encryptedPercentage);
+    return TRUE;
+}
+
+BOOL VsQueryBootDriveProperties (VS_SESSION* pSession, VOLUME_PROPERTIES_STRUCT* pProp)
+{
+    DWORD cbBytesReturned = 0;
+
+    memset (pProp, 0, sizeof (VOLUME_PROPERTIES_STRUCT));
+    return pSession->pDriver->IoControl (VC_IOCTL_GET_BOOT_DRIVE_VOLUME_PROPERTIES, NULL, 0, pProp, sizeof (VOLUME_PROPERTIES_STRUCT), &cbBytesReturned);
+}
+
+BOOL VsQueryBootLoaderVersion (VS_SESSION* pSession, UINT16* pVersion)
+{
+    DWORD cbBytesReturned = 0;
+
+    *pVersion = 0;
+    return pSession->pDriver->IoControl (VC_IOCTL_GET_BOOT_LOADER_VERSION, NULL, 0, pVersion, sizeof (UINT16), &cbBytesReturned);
+}
+
+BOOL VsClearKeys (VS_SESSION* pSession)
+{
+    DWORD cbBytesReturned = 0;
+
+    return pSession->pDriver->IoControl (VC_IOCTL_EMERGENCY_CLEAR_KEYS, NULL, 0, NULL, 0, &cbBytesReturned);
+}
+
+BOOL VsTimedOut (VS_SESSION* pSession)
+{
+    return pSession->pDriver->TimedOut ();
+}
+
+eSysEncState VsGetSystemEncryptionState (const BootEncryptionStatus* pStatus, double* pEncryptedPercentage)
+{
+    BootEncryptionStatus& status = *(BootEncryptionStatus*) pStatus;
+    eSysEncState state = GetSystemEncryptionState (status);
+
+    if (pEncryptedPercentage)
+        *pEncryptedPercentage = GetSystemEncryptionPercentage (status, state);
+    return state;
+}
@@ -0,0 +1,83 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "defs.h"
+
+// libverastatus: the driver queries of VeraStatus as a C API, so that monitoring agents can call
+// them in process instead of running VeraStatus.exe and parsing its output.
+// Functions follow the Win32 conventions: they return FALSE (NULL for VsOpenSession) on failure
+// and the error code is available through GetLastError. Nothing is written to the console.
+// A session is not thread safe: use one session per thread or serialize the calls.
+
+#define VS_API_VERSION	1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// possible state values of system encryption
+typedef enum
+{
+    SYSENC_FULL = 0,
+    SYSENC_PARTIAL = 1,
+    SYSENC_NONE = 2
+} eSysEncState;
+
+typedef struct VS_SESSION VS_SESSION;
+
+// driver backend of a session, the real VeraCrypt driver when all the fields are zero
+typedef struct
+{
+	BOOL bSimulate;			/* in-memory driver with sample volumes, also usable where VeraCrypt isn't available (tests, Linux) */
+	LPCTSTR szReplayFile;	/* serve the responses stored in a trace file */
+	LPCTSTR szRecordFile;	/* dump every call made to the selected backend to a trace file */
+	DWORD dwCallTimeoutMs;	/* calls not answered within this time fail with ERROR_TIMEOUT (0 = no limit) */
+	DWORD dwTotalTimeoutMs;	/* all calls fail with ERROR_TIMEOUT once this time elapsed since the session was opened (0 = no limit) */
+	LPCTSTR szSysfsRoot;	/* Linux: mount point of sysfs where the volumes are found (NULL = /sys) */
+	int simulatedSetupMode;	/* with bSimulate: SetupEncryption or SetupDecryption to start a system encryption setup (0 = none) */
+	DWORD dwSimulatedSetupRate;	/* bytes of the system drive transformed per second by the simulated setup (0 = stalled) */
+} VS_SESSION_OPTIONS;
+
+typedef struct
+{
+	BootEncryptionStatus status;	/* fields not returned by the driver are zero */
+	DWORD cbReturned;				/* smaller than sizeof (BootEncryptionStatus) for drivers older than 1.26.13 */
+	BOOL bMasterKeyVulnerableValid;	/* FALSE if the driver didn't return MasterKeyVulnerable */
+	eSysEncState state;
+	double encryptedPercentage;
+} VS_BOOT_STATUS;
+
+// pOptions can be NULL to open the VeraCrypt driver
+VS_SESSION* VsOpenSession (const VS_SESSION_OPTIONS* pOptions);
+void VsCloseSession (VS_SESSION* pSession);
+
+BOOL VsGetDriverVersion (VS_SESSION* pSession, LONG* pVersion);
+BOOL VsQueryMountList (VS_SESSION* pSession, MOUNT_LIST_STRUCT* pList);
+// driveNo: 0 for A: to 25 for Z:
+BOOL VsQueryVolumeProperties (VS_SESSION* pSession, int driveNo, VOLUME_PROPERTIES_STRUCT* pProp);
+BOOL VsQueryBootStatus (VS_SESSION* pSession, VS_BOOT_STATUS* pStatus);
+BOOL VsQueryBootDriveProperties (VS_SESSION* pSession, VOLUME_PROPERTIES_STRUCT* pProp);
+BOOL VsQueryBootLoaderVersion (VS_SESSION* pSession, UINT16* pVersion);
+// clear the keys of all the mounted volumes, including the system one, from memory
+BOOL VsClearKeys (VS_SESSION* pSession);
+// TRUE if a call of the session failed because of the timeouts of its options
+BOOL VsTimedOut (VS_SESSION* pSession);
+
+// pEncryptedPercentage can be NULL
+eSysEncState VsGetSystemEncryptionState (const BootEncryptionStatus* pStatus, double* pEncryptedPercentage);
+
+#ifdef __cplusplus
+}
+
+class CVcDriver;
+
+// session over a backend opened by the caller (e.g. the snapshot published by the agent), which the session then owns
+VS_SESSION* VsAttachDriver (CVcDriver* pDriver);
+// backend of the session, for the commands using the driver directly
+CVcDriver& VsGetDriver (VS_SESSION* pSession);
+#endif
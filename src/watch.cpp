@@ -0,0 +1,199 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#include "common.h"
+#include "watch.h"
+#include "trace.h"
+
+// query the properties of all mounted volumes using a single GET_MOUNTED_VOLUMES call,
+// then one GET_VOLUME_PROPERTIES call per volume, issued concurrently
+BOOL SampleVolumes (CVcDriver& driver, VOLUME_SAMPLE& sample)
+{
+    CTraceScope scope ("sample volumes", "phase");
+    DWORD cbBytesReturned = 0;
+    MOUNT_LIST_STRUCT mlist;
+    VC_DRIVER_CALL calls[26];
+    int drives[26];
+    size_t count = 0;
+
+    memset (&mlist, 0, sizeof (mlist));
+    if (!driver.IoControl (VC_IOCTL_GET_MOUNTED_VOLUMES, &mlist, sizeof (mlist), &mlist, sizeof (mlist), &cbBytesReturned))
+        return FALSE;
+
+    sample.timestampUs = GetTimestampUs ();
+    sample.ulListedDrives = mlist.ulMountedDrives;
+    sample.ulMountedDrives = 0;
+    sample.ulTimedOutDrives = 0;
+    sample.ulCarriedDrives = 0;
+    for (int i = 0; i < 26; i++)
+    {
+        if (mlist.ulMountedDrives & (1 << i))
+        {
+            VOLUME_PROPERTIES_STRUCT& prop = sample.prop[i];
+            memset (&prop, 0, sizeof (prop));
+            prop.driveNo = i;
+            InitDriverCall (calls[count], VC_IOCTL_GET_VOLUME_PROPERTIES, &prop, sizeof (prop), &prop, sizeof (prop));
+            drives[count++] = i;
+        }
+    }
+
+    driver.IoControlBatch (calls, count, INFINITE);
+    for (size_t n = 0; n < count; n++)
+    {
+        // another failure means that the volume was dismounted after GET_MOUNTED_VOLUMES returned
+        if (calls[n].bResult)
+            sample.ulMountedDrives |= (1 << drives[n]);
+        else if (calls[n].dwError == ERROR_TIMEOUT)
+            sample.ulTimedOutDrives |= (1 << drives[n]);
+    }
+
+    return TRUE;
+}
+
+void CarryTimedOutVolumes (const VOLUME_SAMPLE& previous, VOLUME_SAMPLE& current)
+{
+    for (int i = 0; i < 26; i++)
+    {
+        if ((current.ulTimedOutDrives & (1 << i)) && ((previous.ulMountedDrives | previous.ulCarriedDrives) & (1 << i)))
+        {
+            current.prop[i] = previous.prop[i];
+            current.ulCarriedDrives |= (1 << i);
+        }
+    }
+}
+
+void ComputeVolumeDelta (const VOLUME_SAMPLE& previous, const VOLUME_SAMPLE& current, int driveNo, VOLUME_DELTA& delta)
+{
+    // the properties of a carried drive are those of the last sample that read them
+    BOOL bWasMounted = ((previous.ulMountedDrives | previous.ulCarriedDrives) & (1 << driveNo))? TRUE : FALSE;
+    BOOL bIsMounted = (current.ulMountedDrives & (1 << driveNo))? TRUE : FALSE;
+
+    delta.change = VOLUME_UNCHANGED;
+    delta.readBytesPerSec = delta.writtenBytesPerSec = 0;
+
+    if (current.ulTimedOutDrives & (1 << driveNo))
+    {
+        // listed by the driver: neither dismounted nor mounted until its properties are read again
+        delta.change = VOLUME_TIMED_OUT;
+    }
+    else if ((previous.ulTimedOutDrives & ~previous.ulCarriedDrives) & (1 << driveNo))
+    {
+        // timed out without ever being read: there is nothing to compare with
+        if (bIsMounted)
+            delta.change = VOLUME_TIMED_OUT;
+    }
+    else if (bWasMounted && !bIsMounted)
+        delta.change = VOLUME_DISMOUNTED;
+    else if (!bWasMounted && bIsMounted)
+        delta.change = VOLUME_MOUNTED;
+    else if (bIsMounted)
+    {
+        const VOLUME_PROPERTIES_STRUCT& before = previous.prop[driveNo];
+        const VOLUME_PROPERTIES_STRUCT& after = current.prop[driveNo];
+
+        // counters going backwards mean that the volume was dismounted and mounted again in between
+        if (before.uniqueId != after.uniqueId
+            || after.totalBytesRead < before.totalBytesRead
+            || after.totalBytesWritten < before.totalBytesWritten)
+        {
+            delta.change = VOLUME_REMOUNTED;
+        }
+        else if (previous.ulCarriedDrives & (1 << driveNo))
+        {
+            // the counters were read before the previous sample: the elapsed time isn't known
+            delta.change = VOLUME_TIMED_OUT;
+        }
+        else if (current.timestampUs > previous.timestampUs)
+        {
+            double dElapsed = (double) (current.timestampUs - previous.timestampUs) / 1000000.0;
+            delta.readBytesPerSec = (double) (after.totalBytesRead - before.totalBytesRead) / dElapsed;
+            delta.writtenBytesPerSec = (double) (after.totalBytesWritten - before.totalBytesWritten) / dElapsed;
+        }
+    }
+}
+
+static void PrintMountEvent (double dTime, LPCTSTR szEvent, const VOLUME_PROPERTIES_STRUCT& prop)
+{
+    _tprintf (TEXT("[%8.1fs] %c: %s %s (%s)\n"), dTime, TEXT('A') + prop.driveNo, szEvent, VC_WSTR (prop.wszVolume), GetEncryptionAlgorithmName (prop.ea));
+}
+
+// Keep the driver open and print, every dwIntervalMs, the mount/dismount changes and the
+// read/write rates of mounted volumes. iCount is the number of samples to take (0 = forever).
+int RunWatch (CVcDriver& driver, DWORD dwIntervalMs, int iCount)
+{
+    static VOLUME_SAMPLE samples[2];
+    VOLUME_SAMPLE* pPrevious = &samples[0];
+    VOLUME_SAMPLE* pCurrent = &samples[1];
+    unsigned __int64 startUs, nextUs;
+    TCHAR szRead[32], szWritten[32];
+
+    if (!SampleVolumes (driver, *pPrevious))
+    {
+        _tprintf(TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr(GetLastError ()));
+        return VC_STATUS_DRIVER_CALL_FAILED;
+    }
+
+    startUs = nextUs = pPrevious->timestampUs;
+    _tprintf (TEXT("Watching mounted volumes every %.1f seconds\n"), (double) dwIntervalMs / 1000.0);
+    for (int i = 0; i < 26; i++)
+    {
+        if (pPrevious->ulMountedDrives & (1 << i))
+            PrintMountEvent (0.0, TEXT("mounted"), pPrevious->prop[i]);
+        else if (pPrevious->ulTimedOutDrives & (1 << i))
+            _tprintf (TEXT("[%8.1fs] %c: timed out\n"), 0.0, TEXT('A') + i);
+    }
+    fflush (stdout);
+
+    for (int n = 1; iCount <= 0 || n < iCount; n++)
+    {
+        SleepUntilNext (nextUs, dwIntervalMs);
+
+        if (!SampleVolumes (driver, *pCurrent))
+        {
+            _tprintf(TEXT("Call to VeraCrypt driver (GET_MOUNTED_VOLUMES) failed with error %s\n"), GetWin32ErrorStr(GetLastError ()));
+            return VC_STATUS_DRIVER_CALL_FAILED;
+        }
+
+        CarryTimedOutVolumes (*pPrevious, *pCurrent);
+        double dTime = (double) (pCurrent->timestampUs - startUs) / 1000000.0;
+        for (int i = 0; i < 26; i++)
+        {
+            VOLUME_DELTA delta;
+            ComputeVolumeDelta (*pPrevious, *pCurrent, i, delta);
+            switch (delta.change)
+            {
+            case VOLUME_MOUNTED:
+                PrintMountEvent (dTime, TEXT("mounted"), pCurrent->prop[i]);
+                break;
+            case VOLUME_DISMOUNTED:
+                _tprintf (TEXT("[%8.1fs] %c: dismounted\n"), dTime, TEXT('A') + i);
+                break;
+            case VOLUME_REMOUNTED:
+                PrintMountEvent (dTime, TEXT("remounted"), pCurrent->prop[i]);
+                break;
+            case VOLUME_TIMED_OUT:
+                if (pCurrent->ulTimedOutDrives & (1 << i))
+                    _tprintf (TEXT("[%8.1fs] %c: timed out\n"), dTime, TEXT('A') + i);
+                break;
+            default:
+                if (delta.readBytesPerSec > 0 || delta.writtenBytesPerSec > 0)
+                {
+                    FormatRate (delta.readBytesPerSec, szRead, ARRAYSIZE (szRead));
+                    FormatRate (delta.writtenBytesPerSec, szWritten, ARRAYSIZE (szWritten));
+                    _tprintf (TEXT("[%8.1fs] %c: read %s, write %s\n"), dTime, TEXT('A') + i, szRead, szWritten);
+                }
+                break;
+            }
+        }
+        fflush (stdout);
+
+        VOLUME_SAMPLE* pTmp = pPrevious;
+        pPrevious = pCurrent;
+        pCurrent = pTmp;
+    }
+
+    return VC_STATUS_OK;
+}
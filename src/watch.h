@@ -0,0 +1,44 @@
+/*
+ Copyright (c) 2016-2025 IDRIX
+ Governed by the Apache License 2.0 the full text of which is contained
+ in the file License.txt included in VeraCrypt binary and source code
+ distribution packages. */
+
+#pragma once
+
+#include "driver.h"
+
+// state of all mounted volumes at a given time
+typedef struct
+{
+	unsigned __int64 timestampUs;
+	unsigned __int32 ulListedDrives;	/* Bitfield returned by GET_MOUNTED_VOLUMES */
+	unsigned __int32 ulMountedDrives;	/* Bitfield of drive letters for which prop[] is valid */
+	VOLUME_PROPERTIES_STRUCT prop[26];
+	unsigned __int32 ulTimedOutDrives;	/* Bitfield of drive letters whose GET_VOLUME_PROPERTIES call timed out */
+	unsigned __int32 ulCarriedDrives;	/* Timed out drives whose prop[] was carried from the previous sample */
+} VOLUME_SAMPLE;
+
+// change of a drive between two samples
+typedef enum
+{
+	VOLUME_UNCHANGED = 0,
+	VOLUME_MOUNTED,
+	VOLUME_DISMOUNTED,
+	VOLUME_REMOUNTED,	/* a different volume (or the same one after a dismount) now uses the drive letter */
+	VOLUME_TIMED_OUT	/* still listed, but its properties timed out in one of the samples: no rate */
+} eVolumeChange;
+
+typedef struct
+{
+	eVolumeChange change;
+	double readBytesPerSec;
+	double writtenBytesPerSec;
+} VOLUME_DELTA;
+
+BOOL SampleVolumes (CVcDriver& driver, VOLUME_SAMPLE& sample);
+// Keep the properties of the drives that timed out in current from previous, so that the next
+// sample is compared with the last ones read instead of reporting a dismount and a mount.
+void CarryTimedOutVolumes (const VOLUME_SAMPLE& previous, VOLUME_SAMPLE& current);
+void ComputeVolumeDelta (const VOLUME_SAMPLE& previous, const VOLUME_SAMPLE& current, int driveNo, VOLUME_DELTA& delta);
+int RunWatch (CVcDriver& driver, DWORD dwIntervalMs, int iCount);
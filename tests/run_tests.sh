@@ -0,0 +1,98 @@
+#!/bin/sh
+# Checks of the Linux build against the fixtures of this directory, without driver:
+#
+#   tests/run_tests.sh ./verastatus
+#
+# - sysfs: a fake /sys/block with VeraCrypt volumes on dm-crypt (container and cascaded
+#   partition) and FUSE, next to devices that aren't VeraCrypt volumes
+# - selftest: known answers of the ciphers, hashes and PBKDF2
+# - simsetup: system encryption setups of the simulated driver, progressing or stalled
+# - replay: driver traces served by /replay, with a driver call that hangs (hung.trace) or
+#   hangs once between two answers (flaky.trace)
+# - aggregate: a fleet of one endpoint next to a JSON file nested too deeply
+
+BINARY=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+FAILED=0
+
+cd "$(dirname "$0")" || exit 1
+
+# check NAME EXPECTED_EXIT_CODE ARGS...
+check ()
+{
+    NAME=$1
+    EXPECTED=$2
+    shift 2
+    "$BINARY" "$@" > output.tmp 2>&1
+    CODE=$?
+    if [ "$CODE" -ne "$EXPECTED" ]; then
+        echo "FAIL $NAME: exit code $CODE, expected $EXPECTED"
+        cat output.tmp
+        FAILED=1
+        return 1
+    fi
+    echo "ok   $NAME"
+    return 0
+}
+
+# the backing files of the FUSE volumes are relative to this directory
+if check "sysfs inventory" 0 /sysfs sysfs /format kv /all && ! diff -u sysfs.expected output.tmp; then
+    echo "FAIL sysfs inventory: output differs from sysfs.expected"
+    FAILED=1
+fi
+check "sysfs clearkeys not supported" 254 /sysfs sysfs /clearkeys
+check "sysfs arm refused" 254 /sysfs sysfs /arm event
+
+check "selftest" 0 /selftest
+
+# 1 GB/s on a 512 GB drive encrypted for a third: about 341 seconds left, the measured rate being
+# slightly above or below the configured one
+if check "sysenc progress" 1 /simulate /simsetup encrypt 1024 /sysenc-progress 0.3 3 \
+    && ! grep -Eq "Encrypting 33\.[0-9]+%, (1\.00 GB|102[34]\.[0-9]+ MB)/s, ETA 0:05:4[01]$" output.tmp; then
+    echo "FAIL sysenc progress: rate or ETA not reported"
+    FAILED=1
+fi
+if check "sysenc decryption progress" 1 /simulate /simsetup decrypt 512 /sysenc-progress 0.3 3 \
+    && ! grep -Eq "Decrypting 33\.[0-9]+%, 51[12]\.[0-9]+ MB/s, ETA 0:05:4[01]$" output.tmp; then
+    echo "FAIL sysenc decryption progress: rate or ETA not reported"
+    FAILED=1
+fi
+if check "sysenc stalled" 5 /simulate /simsetup encrypt 0 /sysenc-progress 0.3 5 1 \
+    && ! grep -q "Stalled: no progress for 1 seconds" output.tmp; then
+    echo "FAIL sysenc stalled: stall not reported"
+    FAILED=1
+fi
+
+check "replay" 0 /replay replay/volumes.trace /all
+if check "replay timeout" 252 /replay replay/hung.trace /timeout 0.2 /format kv /all && ! grep -q "^timedOutDrives=0x00002000$" output.tmp; then
+    echo "FAIL replay timeout: N: not reported as timed out"
+    FAILED=1
+fi
+# /serve reports the timeout in the exitCode of the request that hit it only
+printf '/all\n/sysenc\n/quit\n' > requests.tmp
+if check "serve timeout" 252 /replay replay/hung.trace /timeout 0.2 /format kv /serve < requests.tmp \
+    && [ "$(grep -a "^exitCode=" output.tmp | tr '\n' ' ')" != "exitCode=-4 exitCode=2 " ]; then
+    echo "FAIL serve timeout: the timeout of /all is not reported, or reported for /sysenc too"
+    FAILED=1
+fi
+# a volume whose properties timed out once is neither dismounted nor mounted again
+if check "watch timeout" 252 /replay replay/flaky.trace /timeout 0.2 /watch 0.3 4 \
+    && { ! grep -q "N: timed out" output.tmp || grep -q "dismounted" output.tmp; }; then
+    echo "FAIL watch timeout: N: not reported as timed out, or reported as dismounted"
+    FAILED=1
+fi
+check "replay deadline" 252 /replay replay/hung.trace /deadline 0.2 /all
+check "replay alerts" 7 /replay replay/volumes.trace /alerts replay/alerts.rules
+
+# 100000 nested arrays are an invalid file, not a stack overflow
+mkdir -p aggregate.tmp
+"$BINARY" /simulate /format json /all > aggregate.tmp/host1.json
+awk 'BEGIN { printf "{\"a\":"; for (i = 0; i < 100000; i++) printf "["; for (i = 0; i < 100000; i++) printf "]"; print "}" }' \
+    > aggregate.tmp/host2.json
+if check "aggregate nesting" 0 /aggregate aggregate.tmp \
+    && ! { grep -q "^Endpoints: 1$" output.tmp && grep -q "^Ignored files: 1$" output.tmp; }; then
+    echo "FAIL aggregate nesting: host2.json not ignored"
+    FAILED=1
+fi
+
+rm -rf output.tmp requests.tmp aggregate.tmp
+exit $FAILED